@@ -364,6 +364,10 @@ struct configuration_balancer_request
     2:list<configuration_proposal_action> action_list;
     3:optional bool force = false;
     4:optional balancer_request_type balance_type;
+
+    // The reason of the proposal, which is set by the automatic tools (e.g. the hotspot
+    // remediation of the collector) to record the proposal in the audit log of meta server.
+    5:optional string reason;
 }
 
 struct configuration_balancer_response
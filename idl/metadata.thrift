@@ -101,6 +101,18 @@ struct replica_configuration
     8:optional dsn.host_port hp_primary;
 }
 
+// The cumulative load of a replica since it was opened, which is reported to the meta server
+// along with replica_info, from which the meta server derives the load per second.
+struct replica_load_stats
+{
+    1:i64 read_cu;
+    2:i64 write_cu;
+    // The bytes of the read and write requests served by the replica.
+    3:i64 network_bytes;
+    // The size of the data stored by the replica, which is not cumulative.
+    4:i64 storage_bytes;
+}
+
 struct replica_info
 {
     1:dsn.gpid                          pid;
@@ -112,4 +124,5 @@ struct replica_info
     7:string                            app_type;
     8:string                            disk_tag;
     9:optional manual_compaction_status manual_compact_status;
+    10:optional replica_load_stats      load_stats;
 }
@@ -28,6 +28,9 @@ struct start_partition_split_request
 {
     1:string    app_name;
     2:i32       new_partition_count;
+    // The reason of the split, which is set by the automatic tools (e.g. the hotspot
+    // remediation of the collector) to record the split in the audit log of meta server.
+    3:optional string reason;
 }
 
 struct start_partition_split_response
@@ -287,6 +287,21 @@ struct get_scanner_request
     12:optional bool    return_expire_ts;
     13:optional bool full_scan; // true means client want to build 'full scan' context with the server side, false otherwise
     14:optional bool only_return_count = false;
+    // Only valid if only_return_count is true: the server also aggregates the statistics of
+    // the counted records and returns them in scan_response.stat.
+    15:optional bool return_stat = false;
+}
+
+// The statistics aggregated on the server side over the records counted by a scan, the
+// layout of the histograms is defined in src/base/pegasus_scan_stat.h.
+struct scan_stat
+{
+    1:i64           hash_key_count;
+    2:i64           hash_key_size_sum;
+    3:i64           sort_key_size_sum;
+    4:i64           value_size_sum;
+    5:list<i64>     row_size_histogram;
+    6:list<i64>     ttl_histogram;
 }
 
 struct scan_request
@@ -303,6 +318,7 @@ struct scan_response
     5:i32           partition_index;
     6:string        server;
     7:optional i32  kv_count;
+    8:optional scan_stat stat;
 }
 
 service rrdb
@@ -408,6 +408,7 @@ function run_test()
       partition_split_test
       pegasus_geo_test
       pegasus_rproxy_test
+      pegasus_shell_test
       pegasus_unit_test
       recovery_test
       restore_test
@@ -0,0 +1,161 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <fmt/core.h>
+#include <rrdb/rrdb_types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace pegasus {
+
+// =====================================================================================
+// The statistics aggregated by a count-only scan on the server side (see 'return_stat' in
+// get_scanner_request), which are shared by the server and the shell.
+//
+// The row size histogram is bucketed by the power of two: bucket 0 counts the empty rows,
+// bucket i (i > 0) counts the rows whose size is in [2^(i-1), 2^i), and the last bucket
+// also counts all the larger rows.
+//
+// The ttl histogram is bucketed by kScanStatTtlBucketBounds: bucket 0 counts the rows
+// without ttl, bucket i (i > 0) counts the rows whose ttl is less than the i-th bound, and
+// the last bucket counts all the other rows.
+
+constexpr size_t kScanStatSizeBucketCount = 32;
+
+constexpr uint32_t kScanStatTtlBucketBounds[] = {3600, 24 * 3600, 7 * 24 * 3600, 30 * 24 * 3600};
+constexpr const char *kScanStatTtlBucketNames[] = {
+    "no_ttl", "< 1h", "< 1d", "< 7d", "< 30d", ">= 30d"};
+constexpr size_t kScanStatTtlBucketCount =
+    sizeof(kScanStatTtlBucketNames) / sizeof(kScanStatTtlBucketNames[0]);
+static_assert(kScanStatTtlBucketCount ==
+                  sizeof(kScanStatTtlBucketBounds) / sizeof(kScanStatTtlBucketBounds[0]) + 2,
+              "each ttl bound should have a bucket name");
+
+inline size_t scan_stat_size_bucket(uint64_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+    // 'size' is in [2^(bucket-1), 2^bucket).
+    size_t bucket = 64 - __builtin_clzll(size);
+    return std::min(bucket, kScanStatSizeBucketCount - 1);
+}
+
+// 'ttl_seconds' is 0 if the row has no ttl.
+inline size_t scan_stat_ttl_bucket(uint32_t ttl_seconds)
+{
+    if (ttl_seconds == 0) {
+        return 0;
+    }
+    size_t bucket = 1;
+    for (uint32_t bound : kScanStatTtlBucketBounds) {
+        if (ttl_seconds < bound) {
+            break;
+        }
+        ++bucket;
+    }
+    return bucket;
+}
+
+inline std::string scan_stat_size_bucket_name(size_t bucket)
+{
+    if (bucket == 0) {
+        return "0";
+    }
+    if (bucket + 1 >= kScanStatSizeBucketCount) {
+        return fmt::format(">= {}", uint64_t(1) << (kScanStatSizeBucketCount - 2));
+    }
+    return fmt::format("[{}, {})", uint64_t(1) << (bucket - 1), uint64_t(1) << bucket);
+}
+
+inline const char *scan_stat_ttl_bucket_name(size_t bucket)
+{
+    return kScanStatTtlBucketNames[std::min(bucket, kScanStatTtlBucketCount - 1)];
+}
+
+inline void init_scan_stat(::dsn::apps::scan_stat &stat)
+{
+    stat.hash_key_count = 0;
+    stat.hash_key_size_sum = 0;
+    stat.sort_key_size_sum = 0;
+    stat.value_size_sum = 0;
+    stat.row_size_histogram.assign(kScanStatSizeBucketCount, 0);
+    stat.ttl_histogram.assign(kScanStatTtlBucketCount, 0);
+}
+
+// The state carried across the batches of a scan on a partition while aggregating.
+struct scan_stat_cursor
+{
+    bool has_last_hash_key = false;
+    std::string last_hash_key;
+};
+
+// Accumulates a row into 'stat', which must have been initialized by init_scan_stat().
+// The rows of a hash key are adjacent in a partition, thus the distinct hash keys could be
+// counted by comparing with the hash key of the previous row, which is kept in 'cursor'.
+inline void add_scan_stat_row(absl::string_view hash_key,
+                              size_t sort_key_size,
+                              size_t value_size,
+                              uint32_t ttl_seconds,
+                              scan_stat_cursor &cursor,
+                              ::dsn::apps::scan_stat &stat)
+{
+    if (!cursor.has_last_hash_key || hash_key != cursor.last_hash_key) {
+        ++stat.hash_key_count;
+        cursor.has_last_hash_key = true;
+        cursor.last_hash_key.assign(hash_key.data(), hash_key.size());
+    }
+    stat.hash_key_size_sum += hash_key.size();
+    stat.sort_key_size_sum += sort_key_size;
+    stat.value_size_sum += value_size;
+    ++stat.row_size_histogram[scan_stat_size_bucket(hash_key.size() + sort_key_size + value_size)];
+    ++stat.ttl_histogram[scan_stat_ttl_bucket(ttl_seconds)];
+}
+
+// Merges 'from' into 'to', the histograms are extended if needed so that the statistics
+// returned by servers with different bucket counts could also be merged.
+// T may be ::dsn::apps::scan_stat or pegasus_client::scan_stats.
+template <typename T>
+inline void merge_scan_stat(const T &from, ::dsn::apps::scan_stat &to)
+{
+    to.hash_key_count += from.hash_key_count;
+    to.hash_key_size_sum += from.hash_key_size_sum;
+    to.sort_key_size_sum += from.sort_key_size_sum;
+    to.value_size_sum += from.value_size_sum;
+    if (to.row_size_histogram.size() < from.row_size_histogram.size()) {
+        to.row_size_histogram.resize(from.row_size_histogram.size(), 0);
+    }
+    for (size_t i = 0; i < from.row_size_histogram.size(); ++i) {
+        to.row_size_histogram[i] += from.row_size_histogram[i];
+    }
+    if (to.ttl_histogram.size() < from.ttl_histogram.size()) {
+        to.ttl_histogram.resize(from.ttl_histogram.size(), 0);
+    }
+    for (size_t i = 0; i < from.ttl_histogram.size(); ++i) {
+        to.ttl_histogram[i] += from.ttl_histogram[i];
+    }
+}
+
+} // namespace pegasus
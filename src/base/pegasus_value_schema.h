@@ -83,6 +83,19 @@ pegasus_extract_user_data(uint32_t version, std::string &&raw_value, ::dsn::blob
     user_data.assign(std::move(buf), 0, static_cast<unsigned int>(view.length()));
 }
 
+/// Extracts the length of user value from a raw rocksdb value without copying it.
+inline size_t pegasus_extract_user_data_length(uint32_t version, absl::string_view raw_value)
+{
+    CHECK_LE(version, PEGASUS_DATA_VERSION_MAX);
+
+    size_t header_length = sizeof(uint32_t);
+    if (version == 1) {
+        header_length += sizeof(uint64_t);
+    }
+    CHECK_GE(raw_value.length(), header_length);
+    return raw_value.length() - header_length;
+}
+
 /// Extracts timetag from a v1 value.
 inline uint64_t pegasus_extract_timetag(int version, absl::string_view value)
 {
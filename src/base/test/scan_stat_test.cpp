@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <rrdb/rrdb_types.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../pegasus_scan_stat.h"
+#include "gtest/gtest.h"
+
+namespace pegasus {
+
+TEST(scan_stat_test, size_bucket)
+{
+    struct test_case
+    {
+        uint64_t size;
+        size_t expected_bucket;
+    } tests[] = {{0, 0},
+                 {1, 1},
+                 {2, 2},
+                 {3, 2},
+                 {4, 3},
+                 {1023, 10},
+                 {1024, 11},
+                 {uint64_t(1) << 30, kScanStatSizeBucketCount - 1},
+                 {UINT64_MAX, kScanStatSizeBucketCount - 1}};
+    for (const auto &test : tests) {
+        ASSERT_EQ(test.expected_bucket, scan_stat_size_bucket(test.size)) << test.size;
+    }
+
+    ASSERT_EQ("0", scan_stat_size_bucket_name(0));
+    ASSERT_EQ("[1, 2)", scan_stat_size_bucket_name(1));
+    ASSERT_EQ("[512, 1024)", scan_stat_size_bucket_name(10));
+    ASSERT_EQ(">= 1073741824", scan_stat_size_bucket_name(kScanStatSizeBucketCount - 1));
+}
+
+TEST(scan_stat_test, ttl_bucket)
+{
+    struct test_case
+    {
+        uint32_t ttl_seconds;
+        std::string expected_name;
+    } tests[] = {{0, "no_ttl"},
+                 {1, "< 1h"},
+                 {3599, "< 1h"},
+                 {3600, "< 1d"},
+                 {7 * 24 * 3600 - 1, "< 7d"},
+                 {29 * 24 * 3600, "< 30d"},
+                 {30 * 24 * 3600, ">= 30d"},
+                 {UINT32_MAX, ">= 30d"}};
+    for (const auto &test : tests) {
+        const size_t bucket = scan_stat_ttl_bucket(test.ttl_seconds);
+        ASSERT_EQ(test.expected_name, scan_stat_ttl_bucket_name(bucket)) << test.ttl_seconds;
+    }
+}
+
+TEST(scan_stat_test, add_and_merge)
+{
+    // The rows of a partition are split into two batches, and the hash key "h2" spans both
+    // of them, which should be counted only once.
+    scan_stat_cursor cursor;
+    ::dsn::apps::scan_stat batch1;
+    init_scan_stat(batch1);
+    add_scan_stat_row("h1", 2, 4, 0, cursor, batch1);
+    add_scan_stat_row("h2", 2, 0, 100, cursor, batch1);
+
+    ::dsn::apps::scan_stat batch2;
+    init_scan_stat(batch2);
+    add_scan_stat_row("h2", 3, 9, 0, cursor, batch2);
+    add_scan_stat_row("", 1, 0, 0, cursor, batch2);
+    ASSERT_EQ(1, batch2.hash_key_count);
+
+    ::dsn::apps::scan_stat total;
+    init_scan_stat(total);
+    merge_scan_stat(batch1, total);
+    merge_scan_stat(batch2, total);
+
+    ASSERT_EQ(3, total.hash_key_count);
+    ASSERT_EQ(6, total.hash_key_size_sum);
+    ASSERT_EQ(8, total.sort_key_size_sum);
+    ASSERT_EQ(13, total.value_size_sum);
+
+    std::vector<int64_t> expected_row_size_histogram(kScanStatSizeBucketCount, 0);
+    // The row sizes are 8, 4, 14 and 1.
+    expected_row_size_histogram[1] = 1;
+    expected_row_size_histogram[3] = 1;
+    expected_row_size_histogram[4] = 2;
+    ASSERT_EQ(expected_row_size_histogram, total.row_size_histogram);
+
+    std::vector<int64_t> expected_ttl_histogram(kScanStatTtlBucketCount, 0);
+    expected_ttl_histogram[0] = 3;
+    expected_ttl_histogram[1] = 1;
+    ASSERT_EQ(expected_ttl_histogram, total.ttl_histogram);
+}
+
+} // namespace pegasus
@@ -188,6 +188,96 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
     return ERR_OK;
 }
 
+// ThreadPool: THREAD_POOL_DEFAULT
+error_code block_service_manager::upload_file(const std::string &remote_dir,
+                                              const std::string &local_dir,
+                                              const std::string &file_name,
+                                              block_filesystem *fs)
+{
+    task_tracker tracker;
+
+    const std::string remote_file_name = utils::filesystem::path_combine(remote_dir, file_name);
+    auto create_resp =
+        create_block_file_sync(remote_file_name, true /*ignore file meta*/, fs, &tracker);
+    if (create_resp.err != ERR_OK) {
+        LOG_ERROR("create file({}) failed with error({})", remote_file_name, create_resp.err);
+        return create_resp.err;
+    }
+
+    const std::string local_file_name = utils::filesystem::path_combine(local_dir, file_name);
+    upload_response resp;
+    create_resp.file_handle->upload(upload_request{local_file_name},
+                                    TASK_CODE_EXEC_INLINED,
+                                    [&resp](const upload_response &r) { resp = r; },
+                                    &tracker);
+    tracker.wait_outstanding_tasks();
+    if (resp.err != ERR_OK) {
+        LOG_ERROR("upload file({}) to {} failed with error({})",
+                  local_file_name,
+                  remote_file_name,
+                  resp.err);
+        return resp.err;
+    }
+
+    LOG_INFO("upload file({}) to {} succeed, file_size = {}",
+             local_file_name,
+             remote_file_name,
+             resp.uploaded_size);
+    return ERR_OK;
+}
+
+error_code block_service_manager::write_file(const std::string &remote_file_name,
+                                             const blob &value,
+                                             block_filesystem *fs)
+{
+    task_tracker tracker;
+
+    auto create_resp =
+        create_block_file_sync(remote_file_name, true /*ignore file meta*/, fs, &tracker);
+    if (create_resp.err != ERR_OK) {
+        LOG_ERROR("create file({}) failed with error({})", remote_file_name, create_resp.err);
+        return create_resp.err;
+    }
+
+    write_response resp;
+    create_resp.file_handle->write(write_request{value},
+                                   TASK_CODE_EXEC_INLINED,
+                                   [&resp](const write_response &r) { resp = r; },
+                                   &tracker);
+    tracker.wait_outstanding_tasks();
+    if (resp.err != ERR_OK) {
+        LOG_ERROR("write file({}) failed with error({})", remote_file_name, resp.err);
+    }
+    return resp.err;
+}
+
+error_code block_service_manager::read_file(const std::string &remote_file_name,
+                                            block_filesystem *fs,
+                                            /*out*/ blob &value)
+{
+    task_tracker tracker;
+
+    auto create_resp =
+        create_block_file_sync(remote_file_name, true /*ignore file meta*/, fs, &tracker);
+    if (create_resp.err != ERR_OK) {
+        LOG_ERROR("create file({}) failed with error({})", remote_file_name, create_resp.err);
+        return create_resp.err;
+    }
+
+    read_response resp;
+    create_resp.file_handle->read(read_request{0, -1},
+                                  TASK_CODE_EXEC_INLINED,
+                                  [&resp](const read_response &r) { resp = r; },
+                                  &tracker);
+    tracker.wait_outstanding_tasks();
+    if (resp.err != ERR_OK) {
+        LOG_ERROR("read file({}) failed with error({})", remote_file_name, resp.err);
+        return resp.err;
+    }
+    value = resp.buffer;
+    return ERR_OK;
+}
+
 } // namespace block_service
 } // namespace dist
 } // namespace dsn
@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 
+#include "utils/blob.h"
 #include "utils/error_code.h"
 #include "utils/singleton.h"
 #include "utils/zlocks.h"
@@ -75,6 +76,28 @@ public:
                              block_filesystem *fs,
                              /*out*/ uint64_t &download_file_size);
 
+    // upload a local file to remote file system, the remote file will be overwritten if exists
+    // \return  ERR_FILE_OPERATION_FAILED: local file system error
+    // \return  ERR_FS_INTERNAL: remote file system error
+    error_code upload_file(const std::string &remote_dir,
+                           const std::string &local_dir,
+                           const std::string &file_name,
+                           block_filesystem *fs);
+
+    // write a small piece of data as a whole remote file, the remote file will be overwritten
+    // if exists
+    // \return  ERR_FS_INTERNAL: remote file system error
+    error_code write_file(const std::string &remote_file_name,
+                          const blob &value,
+                          block_filesystem *fs);
+
+    // read a whole remote file
+    // \return  ERR_OBJECT_NOT_FOUND: remote file not exist
+    // \return  ERR_FS_INTERNAL: remote file system error
+    error_code read_file(const std::string &remote_file_name,
+                         block_filesystem *fs,
+                         /*out*/ blob &value);
+
 private:
     block_service_registry &_registry_holder;
 
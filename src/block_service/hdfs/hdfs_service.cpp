@@ -20,6 +20,8 @@
 #include <rocksdb/env.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include <type_traits>
 #include <unordered_set>
 #include <utility>
@@ -463,10 +465,11 @@ dsn::task_ptr hdfs_file_object::upload(const upload_request &req,
     return t;
 }
 
-error_code hdfs_file_object::read_data_in_batches(uint64_t start_pos,
-                                                  int64_t length,
-                                                  std::string &read_buffer,
-                                                  size_t &read_length)
+error_code hdfs_file_object::read_data_in_batches(
+    uint64_t start_pos,
+    int64_t length,
+    const std::function<error_code(const char *, size_t)> &handler,
+    size_t &read_length)
 {
     // get file meta if it is not synchronized.
     if (!_has_meta_synced) {
@@ -484,17 +487,19 @@ error_code hdfs_file_object::read_data_in_batches(uint64_t start_pos,
                   utils::safe_strerror(errno));
         return ERR_FS_INTERNAL;
     }
-    std::unique_ptr<char[]> raw_buf(new char[_size]);
-    char *dst_buf = raw_buf.get();
 
     // if length = -1, we should read the whole file.
     uint64_t data_length = (length == -1 ? _size : length);
+    // Only a batch is buffered in memory, rather than the whole file.
+    const uint64_t batch_size =
+        std::max<uint64_t>(std::min(data_length, FLAGS_hdfs_read_batch_size_bytes), 1);
+    std::unique_ptr<char[]> raw_buf(new char[batch_size]);
     uint64_t cur_pos = start_pos;
     uint64_t read_size = 0;
-    bool read_success = true;
+    error_code err = ERR_OK;
     while (cur_pos < start_pos + data_length) {
         const uint64_t rate = FLAGS_hdfs_read_limit_rate_mb_per_sec << 20;
-        read_size = std::min(start_pos + data_length - cur_pos, FLAGS_hdfs_read_batch_size_bytes);
+        read_size = std::min(start_pos + data_length - cur_pos, batch_size);
         // burst size should not be less than consume size
         const uint64_t burst_size = std::max(2 * rate, read_size);
         _service->_read_token_bucket->consumeWithBorrowAndWait(read_size, rate, burst_size);
@@ -502,16 +507,22 @@ error_code hdfs_file_object::read_data_in_batches(uint64_t start_pos,
         tSize num_read_bytes = hdfsPread(_service->get_fs(),
                                          read_file,
                                          static_cast<tOffset>(cur_pos),
-                                         (void *)dst_buf,
+                                         (void *)raw_buf.get(),
                                          static_cast<tSize>(read_size));
         if (num_read_bytes > 0) {
             cur_pos += num_read_bytes;
-            dst_buf += num_read_bytes;
+            err = handler(raw_buf.get(), static_cast<size_t>(num_read_bytes));
+            if (err != ERR_OK) {
+                break;
+            }
         } else if (num_read_bytes == -1) {
             LOG_ERROR("Failed to read HDFS file {}, error: {}.",
                       file_name(),
                       utils::safe_strerror(errno));
-            read_success = false;
+            err = ERR_FS_INTERNAL;
+            break;
+        } else {
+            // reach the end of the file
             break;
         }
     }
@@ -520,12 +531,10 @@ error_code hdfs_file_object::read_data_in_batches(uint64_t start_pos,
             "Failed to close HDFS file {}, error: {}.", file_name(), utils::safe_strerror(errno));
         return ERR_FS_INTERNAL;
     }
-    if (read_success) {
+    if (err == ERR_OK) {
         read_length = cur_pos - start_pos;
-        read_buffer = std::string(raw_buf.get(), dst_buf - raw_buf.get());
-        return ERR_OK;
     }
-    return ERR_FS_INTERNAL;
+    return err;
 }
 
 dsn::task_ptr hdfs_file_object::read(const read_request &req,
@@ -541,8 +550,14 @@ dsn::task_ptr hdfs_file_object::read(const read_request &req,
         size_t read_length = 0;
         read_response resp;
         std::string read_buffer;
-        resp.err =
-            read_data_in_batches(req.remote_pos, req.remote_length, read_buffer, read_length);
+        resp.err = read_data_in_batches(
+            req.remote_pos,
+            req.remote_length,
+            [&read_buffer](const char *data, size_t size) {
+                read_buffer.append(data, size);
+                return ERR_OK;
+            },
+            read_length);
         if (resp.err == ERR_OK) {
             resp.buffer = blob::create_from_bytes(std::move(read_buffer));
         }
@@ -572,15 +587,6 @@ dsn::task_ptr hdfs_file_object::download(const download_request &req,
         do {
             LOG_INFO("start to download from '{}' to '{}'", file_name(), target_file);
 
-            std::string read_buffer;
-            size_t read_length = 0;
-            resp.err =
-                read_data_in_batches(req.remote_pos, req.remote_length, read_buffer, read_length);
-            if (resp.err != ERR_OK) {
-                LOG_ERROR("read data from remote '{}' failed, err = {}", file_name(), resp.err);
-                break;
-            }
-
             rocksdb::EnvOptions env_options;
             env_options.use_direct_writes = FLAGS_enable_direct_io;
             std::unique_ptr<rocksdb::WritableFile> wfile;
@@ -591,9 +597,26 @@ dsn::task_ptr hdfs_file_object::download(const download_request &req,
                 break;
             }
 
-            s = wfile->Append(rocksdb::Slice(read_buffer.data(), read_length));
-            if (!s.ok()) {
-                LOG_ERROR("append local file '{}' failed, err = {}", target_file, s.ToString());
+            // Write each batch to the local file and calculate the md5 once it is read, thus
+            // the whole file needn't be buffered in memory or read again.
+            utils::md5_calculator md5;
+            size_t read_length = 0;
+            resp.err = read_data_in_batches(
+                req.remote_pos,
+                req.remote_length,
+                [&](const char *data, size_t size) {
+                    s = wfile->Append(rocksdb::Slice(data, size));
+                    if (!s.ok()) {
+                        LOG_ERROR(
+                            "append local file '{}' failed, err = {}", target_file, s.ToString());
+                        return ERR_FILE_OPERATION_FAILED;
+                    }
+                    md5.update(data, size);
+                    return ERR_OK;
+                },
+                read_length);
+            if (resp.err != ERR_OK) {
+                LOG_ERROR("read data from remote '{}' failed, err = {}", file_name(), resp.err);
                 break;
             }
 
@@ -604,7 +627,7 @@ dsn::task_ptr hdfs_file_object::download(const download_request &req,
             }
 
             resp.downloaded_size = read_length;
-            resp.file_md5 = utils::string_md5(read_buffer.c_str(), read_length);
+            resp.file_md5 = md5.finalize();
             write_succ = true;
         } while (false);
 
@@ -614,6 +637,8 @@ dsn::task_ptr hdfs_file_object::download(const download_request &req,
                       file_name());
             resp.err = ERR_FILE_OPERATION_FAILED;
             resp.downloaded_size = 0;
+            // the local file may have been partially written
+            utils::filesystem::remove_path(target_file);
         }
         t->enqueue_with(resp);
         release_ref();
@@ -21,6 +21,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -110,10 +111,14 @@ public:
 private:
     error_code
     write_data_in_batches(const char *data, const uint64_t data_size, uint64_t &written_size);
-    error_code read_data_in_batches(uint64_t start_pos,
-                                    int64_t length,
-                                    std::string &read_buffer,
-                                    size_t &read_length);
+    // read the data in [start_pos, start_pos + length) of the file batch by batch, `length` = -1
+    // means reading the whole file, and each batch is passed to `handler` once it is read, the
+    // reading stops once `handler` returns an error.
+    error_code
+    read_data_in_batches(uint64_t start_pos,
+                         int64_t length,
+                         const std::function<error_code(const char *, size_t)> &handler,
+                         size_t &read_length);
 
     hdfs_service *_service;
     std::string _md5sum;
@@ -118,6 +118,42 @@ TEST_P(block_service_manager_test, do_download_succeed)
     ASSERT_EQ(download_size, _file_meta.size);
 }
 
+TEST_P(block_service_manager_test, upload_and_write_file)
+{
+    const std::string remote_root = "remote_test_dir";
+    auto fs = std::make_unique<local_service>();
+    ASSERT_EQ(ERR_OK, fs->initialize({remote_root}));
+
+    // Read a non-exist remote file.
+    blob value;
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, _block_service_manager.read_file("not_exist", fs.get(), value));
+
+    // Write and read a whole remote file.
+    const std::string content = "bulk_load_metadata";
+    ASSERT_EQ(ERR_OK,
+              _block_service_manager.write_file(
+                  FILE_NAME, blob::create_from_bytes(std::string(content)), fs.get()));
+    ASSERT_EQ(ERR_OK, _block_service_manager.read_file(FILE_NAME, fs.get(), value));
+    ASSERT_EQ(content, value.to_string());
+
+    // Upload a local file, and then download it to another directory.
+    NO_FATALS(pegasus::create_local_test_file(utils::filesystem::path_combine(LOCAL_DIR, FILE_NAME),
+                                              &_file_meta));
+    ASSERT_EQ(ERR_OK,
+              _block_service_manager.upload_file(PROVIDER, LOCAL_DIR, FILE_NAME, fs.get()));
+    const std::string download_dir = "download_test_dir";
+    uint64_t download_size = 0;
+    std::string download_md5;
+    ASSERT_EQ(ERR_OK,
+              _block_service_manager.download_file(
+                  PROVIDER, download_dir, FILE_NAME, fs.get(), download_size, download_md5));
+    ASSERT_EQ(_file_meta.size, download_size);
+    ASSERT_EQ(_file_meta.md5, download_md5);
+
+    utils::filesystem::remove_path(remote_root);
+    utils::filesystem::remove_path(download_dir);
+}
+
 } // namespace block_service
 } // namespace dist
 } // namespace dsn
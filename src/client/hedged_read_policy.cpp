@@ -0,0 +1,146 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "hedged_read_policy.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "utils/flags.h"
+
+DSN_DEFINE_uint32(hedged_read,
+                  hedged_read_delay_percentile,
+                  95,
+                  "The percentile of the latencies of the recent reads of a table, after which "
+                  "a read is hedged");
+DSN_TAG_VARIABLE(hedged_read_delay_percentile, FT_MUTABLE);
+DSN_DEFINE_validator(hedged_read_delay_percentile,
+                     [](uint32_t value) -> bool { return value > 0 && value < 100; });
+
+DSN_DEFINE_uint32(hedged_read,
+                  hedged_read_min_delay_ms,
+                  2,
+                  "The min delay in milliseconds after which a read is hedged");
+DSN_TAG_VARIABLE(hedged_read_min_delay_ms, FT_MUTABLE);
+
+DSN_DEFINE_uint32(hedged_read,
+                  hedged_read_budget_percent,
+                  5,
+                  "The max percent of the reads of a table which could be hedged");
+DSN_TAG_VARIABLE(hedged_read_budget_percent, FT_MUTABLE);
+DSN_DEFINE_validator(hedged_read_budget_percent,
+                     [](uint32_t value) -> bool { return value <= 100; });
+
+namespace dsn {
+namespace replication {
+
+hedged_read_policy::hedged_read_policy() { _latencies_us.reserve(kLatencyWindowSize); }
+
+bool hedged_read_policy::on_read_started()
+{
+    if (!enabled()) {
+        return false;
+    }
+
+    zauto_lock l(_lock);
+    _hedge_budget =
+        std::min(kMaxHedges, _hedge_budget + FLAGS_hedged_read_budget_percent / 100.0);
+    return true;
+}
+
+void hedged_read_policy::on_read_completed(const host_port &node,
+                                           uint64_t latency_us,
+                                           bool is_backup)
+{
+    zauto_lock l(_lock);
+    if (node) {
+        auto it = _node_latencies_us.find(node);
+        if (it == _node_latencies_us.end()) {
+            _node_latencies_us.emplace(node, latency_us);
+        } else {
+            it->second = kNodeLatencyAlpha * latency_us + (1 - kNodeLatencyAlpha) * it->second;
+        }
+    }
+
+    // The backup requests are only sent for the slowest reads, whose latencies would
+    // underestimate the latencies of the reads.
+    if (is_backup) {
+        return;
+    }
+
+    if (_latencies_us.size() < kLatencyWindowSize) {
+        _latencies_us.push_back(latency_us);
+    } else {
+        _latencies_us[_next_latency_index] = latency_us;
+        _next_latency_index = (_next_latency_index + 1) % kLatencyWindowSize;
+    }
+    if (++_samples_since_delay_update >= kDelayUpdateInterval) {
+        _samples_since_delay_update = 0;
+        update_hedge_delay();
+    }
+}
+
+void hedged_read_policy::update_hedge_delay()
+{
+    auto latencies_us = _latencies_us;
+    const auto nth = latencies_us.begin() +
+                     latencies_us.size() * FLAGS_hedged_read_delay_percentile / 100;
+    std::nth_element(latencies_us.begin(), nth, latencies_us.end());
+
+    // Round up, since the delay is scheduled by a timer of milliseconds.
+    const auto delay_ms = static_cast<int>((*nth + 999) / 1000);
+    _hedge_delay_ms.store(std::max(delay_ms, static_cast<int>(FLAGS_hedged_read_min_delay_ms)),
+                          std::memory_order_relaxed);
+}
+
+bool hedged_read_policy::try_acquire_hedge()
+{
+    zauto_lock l(_lock);
+    if (_hedge_budget < 1) {
+        return false;
+    }
+    _hedge_budget -= 1;
+    return true;
+}
+
+host_port hedged_read_policy::choose_backup(const std::vector<host_port> &candidates) const
+{
+    zauto_lock l(_lock);
+    host_port best;
+    double best_latency_us = std::numeric_limits<double>::max();
+    for (const auto &candidate : candidates) {
+        const auto it = _node_latencies_us.find(candidate);
+        if (it == _node_latencies_us.end()) {
+            return candidate;
+        }
+        if (it->second < best_latency_us) {
+            best = candidate;
+            best_latency_us = it->second;
+        }
+    }
+    return best;
+}
+
+double hedged_read_policy::get_node_latency_us(const host_port &node) const
+{
+    zauto_lock l(_lock);
+    const auto it = _node_latencies_us.find(node);
+    return it == _node_latencies_us.end() ? -1 : it->second;
+}
+
+} // namespace replication
+} // namespace dsn
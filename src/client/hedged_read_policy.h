@@ -0,0 +1,94 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+#include "runtime/rpc/rpc_host_port.h"
+#include "utils/zlocks.h"
+
+namespace dsn {
+namespace replication {
+
+// The policy of the hedged reads of a table, see partition_resolver::call_task_hedged().
+//
+// Hedging is opted in by the table, see set_enabled(). A read is hedged by a backup request to
+// a secondary once it has been in flight longer than the FLAGS_hedged_read_delay_percentile of
+// the latencies of the recent reads of the table, and the first successful response of the two
+// is taken. The secondary with the lowest latency EWMA is chosen, and the hedges are limited by
+// a budget: each read earns FLAGS_hedged_read_budget_percent / 100 of a hedge, thus the extra
+// load is capped at the percent of the reads.
+class hedged_read_policy
+{
+public:
+    hedged_read_policy();
+
+    // Enables or disables hedging of the reads of the table, which is disabled by default, since
+    // the responses of the secondaries may be staler than the primaries.
+    void set_enabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    // Earns the hedge budget of a read. Returns false if hedging is disabled.
+    bool on_read_started();
+
+    // Records the latency of a read served by `node`, which also adjusts the hedge delay
+    // unless it is the latency of a backup request.
+    void on_read_completed(const host_port &node, uint64_t latency_us, bool is_backup);
+
+    // Returns the delay in milliseconds after which a read should be hedged, or -1 if it is
+    // unknown yet.
+    int hedge_delay_ms() const { return _hedge_delay_ms.load(std::memory_order_relaxed); }
+
+    // Consumes a hedge of the budget. Returns false if the budget has been exhausted.
+    bool try_acquire_hedge();
+
+    // Returns the candidate with the lowest latency EWMA, while the candidates which have
+    // never been measured are preferred so that they could be measured. Returns an invalid
+    // host_port if `candidates` is empty.
+    host_port choose_backup(const std::vector<host_port> &candidates) const;
+
+    // Returns the latency EWMA of `node` in microseconds, or -1 if it has never been measured.
+    double get_node_latency_us(const host_port &node) const;
+
+private:
+    static constexpr size_t kLatencyWindowSize = 1024;
+    static constexpr size_t kDelayUpdateInterval = 128;
+    static constexpr double kNodeLatencyAlpha = 0.2;
+    static constexpr double kMaxHedges = 10;
+
+    void update_hedge_delay();
+
+    std::atomic<bool> _enabled{false};
+
+    mutable zlock _lock;
+    // The latencies of the recent reads in a ring buffer.
+    std::vector<uint64_t> _latencies_us;
+    size_t _next_latency_index = 0;
+    size_t _samples_since_delay_update = 0;
+    std::atomic<int> _hedge_delay_ms{-1};
+
+    double _hedge_budget = 0;
+    std::unordered_map<host_port, double> _node_latencies_us;
+};
+
+} // namespace replication
+} // namespace dsn
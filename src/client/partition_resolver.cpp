@@ -26,15 +26,20 @@
 
 #include "client/partition_resolver.h"
 
+#include <memory>
+#include <vector>
+
 // IWYU pragma: no_include <type_traits>
 
 #include "partition_resolver_manager.h"
 #include "runtime/api_layer1.h"
 #include "runtime/api_task.h"
 #include "runtime/rpc/dns_resolver.h"
+#include "runtime/rpc/rpc_host_port.h"
 #include "runtime/task/task_spec.h"
 #include "utils/fmt_logging.h"
 #include "utils/threadpool_code.h"
+#include "utils/zlocks.h"
 
 namespace dsn {
 namespace replication {
@@ -52,6 +57,7 @@ int partition_resolver::get_partition_index(int partition_count, uint64_t partit
 }
 
 DEFINE_TASK_CODE(LPC_RPC_DELAY_CALL, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_HEDGED_READ, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
 static inline bool error_retry(error_code err)
 {
@@ -113,7 +119,7 @@ void partition_resolver::call_task(const rpc_response_task_ptr &t)
     t->replace_callback(std::move(new_callback));
 
     resolve(hdr.client.partition_hash,
-            [t](resolve_result &&result) mutable {
+            [this, t](resolve_result &&result) mutable {
                 if (result.err != ERR_OK) {
                     t->enqueue(result.err, nullptr);
                     return;
@@ -130,9 +136,230 @@ void partition_resolver::call_task(const rpc_response_task_ptr &t)
                     }
                     hdr.gpid = result.pid;
                 }
-                dsn_rpc_call(dns_resolver::instance().resolve_address(result.hp), t.get());
+                send_request(result.hp, t);
             },
             hdr.client.timeout_ms);
 }
+
+void partition_resolver::send_request(const host_port &target, const rpc_response_task_ptr &task)
+{
+    dsn_rpc_call(dns_resolver::instance().resolve_address(target), task.get());
+}
+
+struct partition_resolver::hedged_read_context
+{
+    // The callback of the task, which is invoked once by whichever of the original and the
+    // backup requests completes first, or by the last one if both of them fail.
+    rpc_response_handler callback;
+
+    zlock lock; // [
+    bool completed = false;
+    // The timer to send the backup request, which is cancelled once the read completes.
+    task_ptr hedge_timer;
+    rpc_response_task_ptr backup_task;
+    host_port backup_node;
+    uint64_t backup_start_us = 0;
+    bool backup_failed = false;
+    // The failed response of the original request, which is taken only if the backup request
+    // fails too.
+    bool original_failed = false;
+    error_code original_err;
+    message_ptr original_request;
+    message_ptr original_response;
+    // ]
+};
+
+void partition_resolver::call_task_hedged(const rpc_response_task_ptr &t)
+{
+    if (!_hedged_read_policy.on_read_started()) {
+        call_task(t);
+        return;
+    }
+
+    const auto &hdr = *(t->get_request()->header);
+    const int delay_ms = _hedged_read_policy.hedge_delay_ms();
+    const bool hedge = delay_ms >= 0 && delay_ms < hdr.client.timeout_ms;
+
+    // The backup request is copied before the original one is sent, since the header of the
+    // original one would be updated while it is being sent.
+    message_ptr backup_request;
+    if (hedge) {
+        backup_request = t->get_request()->copy(true, false);
+    }
+
+    auto context = std::make_shared<hedged_read_context>();
+    t->fetch_current_handler(context->callback);
+    const uint64_t start_us = dsn_now_us();
+    partition_resolver_ptr r(this);
+    t->replace_callback([r, context, start_us](
+        dsn::error_code err, dsn::message_ex * req, dsn::message_ex * resp) {
+        const uint64_t now_us = dsn_now_us();
+        if (err == ERR_OK) {
+            r->_hedged_read_policy.on_read_completed(req->to_host_port, now_us - start_us, false);
+        }
+
+        task_ptr hedge_timer;
+        rpc_response_task_ptr backup_task;
+        host_port backup_node;
+        uint64_t backup_start_us = 0;
+        {
+            zauto_lock l(context->lock);
+            if (context->completed) {
+                // The backup request has been responded.
+                return;
+            }
+            if (err != ERR_OK && context->backup_task != nullptr && !context->backup_failed) {
+                // Wait for the backup request, which may still succeed.
+                context->original_failed = true;
+                context->original_err = err;
+                context->original_request = req;
+                context->original_response = resp;
+                return;
+            }
+            context->completed = true;
+            hedge_timer = std::move(context->hedge_timer);
+            backup_task = context->backup_task;
+            backup_node = context->backup_node;
+            backup_start_us = context->backup_start_us;
+        }
+
+        if (hedge_timer != nullptr) {
+            hedge_timer->cancel(false);
+        }
+        if (backup_task != nullptr && backup_task->cancel(false)) {
+            // The backup request is at least as slow as it has been.
+            r->_hedged_read_policy.on_read_completed(backup_node, now_us - backup_start_us, true);
+        }
+        if (context->callback) {
+            context->callback(err, req, resp);
+        }
+    });
+    call_task(t);
+
+    if (hedge) {
+        auto hedge_timer =
+            tasking::enqueue(LPC_HEDGED_READ,
+                             t->tracker(),
+                             [r, t, context, backup_request, start_us]() {
+                                 r->send_backup_request(t, context, backup_request, start_us);
+                             },
+                             0,
+                             std::chrono::milliseconds(delay_ms));
+        {
+            zauto_lock l(context->lock);
+            if (!context->completed) {
+                context->hedge_timer = hedge_timer;
+                return;
+            }
+        }
+        // The read has completed before the timer is recorded.
+        hedge_timer->cancel(false);
+    }
+}
+
+void partition_resolver::send_backup_request(const rpc_response_task_ptr &t,
+                                             const std::shared_ptr<hedged_read_context> &context,
+                                             const message_ptr &request,
+                                             uint64_t start_us)
+{
+    {
+        zauto_lock l(context->lock);
+        if (context->completed) {
+            return;
+        }
+        context->hedge_timer = nullptr;
+    }
+
+    auto &hdr = *(request->header);
+    const uint64_t elapsed_ms = (dsn_now_us() - start_us) / 1000;
+    if (elapsed_ms >= static_cast<uint64_t>(hdr.client.timeout_ms)) {
+        return;
+    }
+
+    dsn::gpid pid;
+    std::vector<host_port> candidates;
+    if (!get_backup_candidates(hdr.client.partition_hash, pid, candidates)) {
+        return;
+    }
+    const auto target = _hedged_read_policy.choose_backup(candidates);
+    if (!target || !_hedged_read_policy.try_acquire_hedge()) {
+        return;
+    }
+
+    // Only the backup requests are allowed to be served by the secondaries.
+    hdr.context.u.is_backup_request = true;
+    hdr.id = message_ex::new_id();
+    hdr.gpid = pid;
+    if (hdr.client.thread_hash == 0) {
+        hdr.client.thread_hash = pid.thread_hash();
+    }
+    hdr.client.timeout_ms -= static_cast<int>(elapsed_ms);
+    const uint64_t timeout_us = hdr.client.timeout_ms * 1000ULL;
+
+    // The backup request is neither retried nor regarded as an access failure of the
+    // partition, the original request is responsible for them.
+    partition_resolver_ptr r(this);
+    const uint64_t backup_start_us = dsn_now_us();
+    auto backup_task = rpc::create_rpc_response_task(
+        request.get(),
+        t->tracker(),
+        [r, context, target, backup_start_us, timeout_us](
+            dsn::error_code err, dsn::message_ex * req, dsn::message_ex * resp) {
+            r->_hedged_read_policy.on_read_completed(
+                target, err == ERR_OK ? dsn_now_us() - backup_start_us : timeout_us, true);
+
+            error_code original_err;
+            message_ptr original_request;
+            message_ptr original_response;
+            {
+                zauto_lock l(context->lock);
+                if (context->completed) {
+                    return;
+                }
+                if (err != ERR_OK) {
+                    context->backup_failed = true;
+                    if (!context->original_failed) {
+                        // Wait for the original request, which may still succeed.
+                        return;
+                    }
+                    original_err = context->original_err;
+                    original_request = std::move(context->original_request);
+                    original_response = std::move(context->original_response);
+                }
+                context->completed = true;
+            }
+
+            if (err != ERR_OK) {
+                // Both of the requests have failed, take the failure of the original one.
+                if (context->callback) {
+                    context->callback(
+                        original_err, original_request.get(), original_response.get());
+                }
+                return;
+            }
+
+            LOG_DEBUG("{}: hedged read was served by {} ahead of the primary, trace_id = "
+                      "{:#018x}",
+                      r->log_prefix(),
+                      target,
+                      req->header->trace_id);
+            if (context->callback) {
+                context->callback(err, req, resp);
+            }
+        },
+        t->hash());
+
+    {
+        zauto_lock l(context->lock);
+        if (context->completed) {
+            return;
+        }
+        context->backup_task = backup_task;
+        context->backup_node = target;
+        context->backup_start_us = backup_start_us;
+    }
+    send_request(target, backup_task);
+}
+
 } // namespace replication
 } // namespace dsn
@@ -29,10 +29,12 @@
 #include <stdint.h>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "client/hedged_read_policy.h"
 #include "common/gpid.h"
 #include "runtime/rpc/rpc_host_port.h"
 #include "runtime/rpc/rpc_message.h"
@@ -84,6 +86,28 @@ public:
         return response_task;
     }
 
+    // Like call_op(), while the request may be hedged by a backup request to a secondary, see
+    // call_task_hedged(). It should only be used for the idempotent reads whose callers could
+    // accept stale responses, and never be waited for, since the returned task may complete
+    // after the callback has been invoked by the backup request.
+    template <typename TReq, typename TCallback>
+    dsn::rpc_response_task_ptr call_read_op(dsn::task_code code,
+                                            TReq &&request,
+                                            dsn::task_tracker *tracker,
+                                            TCallback &&callback,
+                                            std::chrono::milliseconds timeout,
+                                            uint64_t partition_hash,
+                                            int reply_hash = 0)
+    {
+        dsn::message_ex *msg = dsn::message_ex::create_request(
+            code, static_cast<int>(timeout.count()), 0, partition_hash);
+        marshall(msg, std::forward<TReq>(request));
+        dsn::rpc_response_task_ptr response_task = rpc::create_rpc_response_task(
+            msg, tracker, std::forward<TCallback>(callback), reply_hash);
+        call_task_hedged(response_task);
+        return response_task;
+    }
+
     // choosing a proper replica server from meta server or local route cache
     // and send the read/write request.
     // if got reply or error, call the callback.
@@ -91,12 +115,32 @@ public:
     // into "task", you may want to refer to dsn::rpc_response_task for details.
     void call_task(const dsn::rpc_response_task_ptr &task);
 
+    // Like call_task(), while a backup request is sent to the secondary chosen by the hedged
+    // read policy of the table once the task has been in flight longer than the hedge delay,
+    // if hedging is enabled for the table.
+    // The first successful response of the two is taken, and the other one is cancelled or
+    // dropped. A failed response is only taken if the other one has failed too, or the backup
+    // request has not been sent yet, in which case it never will be.
+    void call_task_hedged(const dsn::rpc_response_task_ptr &task);
+
+    // Opts the table in or out of the hedged reads, which is disabled by default. It applies
+    // to all the clients of the table in the process, since they share the resolver.
+    void set_hedged_read_enabled(bool enabled) { _hedged_read_policy.set_enabled(enabled); }
+
     std::string get_app_name() const { return _app_name; }
 
     const dsn::host_port &get_meta_server() const { return _meta_server; }
 
     const char *log_prefix() const { return _app_name.c_str(); }
 
+    /**
+     * get the partition count of the app from the local route cache
+     *
+     * \return the partition count, or -1 if it is unknown yet (e.g. no request has been
+     *         resolved, or the cache was cleared by a partition split).
+     */
+    virtual int get_partition_count() const = 0;
+
 protected:
     partition_resolver(host_port meta_server, const char *app_name)
         : _app_name(app_name), _meta_server(meta_server)
@@ -141,9 +185,34 @@ protected:
      */
     virtual void on_access_failure(int partition_index, error_code err) = 0;
 
+    /**
+     * get the secondaries which the backup requests of partition_hash could be sent to
+     *
+     * \return false if they are unknown, or the app has no secondaries
+     */
+    virtual bool get_backup_candidates(uint64_t partition_hash,
+                                       /*out*/ dsn::gpid &pid,
+                                       /*out*/ std::vector<host_port> &candidates) const
+    {
+        return false;
+    }
+
+    // Sends the request of `task` to `target`, which could be overridden by the tests.
+    virtual void send_request(const host_port &target, const dsn::rpc_response_task_ptr &task);
+
     std::string _cluster_name;
     std::string _app_name;
     host_port _meta_server;
+
+private:
+    struct hedged_read_context;
+
+    void send_backup_request(const dsn::rpc_response_task_ptr &task,
+                             const std::shared_ptr<hedged_read_context> &context,
+                             const message_ptr &request,
+                             uint64_t start_us);
+
+    hedged_read_policy _hedged_read_policy;
 };
 
 typedef ref_ptr<partition_resolver> partition_resolver_ptr;
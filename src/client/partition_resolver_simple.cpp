@@ -89,6 +89,38 @@ void partition_resolver_simple::resolve(uint64_t partition_hash,
     call(std::move(rc), false);
 }
 
+int partition_resolver_simple::get_partition_count() const
+{
+    zauto_read_lock l(_config_lock);
+    return _app_partition_count;
+}
+
+bool partition_resolver_simple::get_backup_candidates(
+    uint64_t partition_hash,
+    /*out*/ dsn::gpid &pid,
+    /*out*/ std::vector<host_port> &candidates) const
+{
+    zauto_read_lock l(_config_lock);
+    if (!_app_is_stateful || _app_partition_count == -1) {
+        return false;
+    }
+
+    int idx = get_partition_index(_app_partition_count, partition_hash);
+    auto it = _config_cache.find(idx);
+    if (it != _config_cache.end() && it->second->config.ballot < 0) {
+        // child partition is not ready, its requests should be sent to parent partition
+        idx -= _app_partition_count / 2;
+        it = _config_cache.find(idx);
+    }
+    if (it == _config_cache.end() || it->second->config.ballot < 0) {
+        return false;
+    }
+
+    pid = dsn::gpid(_app_id, idx);
+    candidates = it->second->config.hp_secondaries;
+    return !candidates.empty();
+}
+
 void partition_resolver_simple::on_access_failure(int partition_index, error_code err)
 {
     // ERR_CAPACITY_EXCEEDED : no need for reconfiguration on primary
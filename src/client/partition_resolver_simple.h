@@ -31,8 +31,10 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "client/partition_resolver.h"
+#include "common/gpid.h"
 #include "common/serialization_helper/dsn.layer2_types.h"
 #include "runtime/rpc/rpc_host_port.h"
 #include "runtime/task/task.h"
@@ -59,7 +61,11 @@ public:
 
     virtual void on_access_failure(int partition_index, error_code err) override;
 
-    int get_partition_count() const { return _app_partition_count; }
+    int get_partition_count() const override;
+
+    bool get_backup_candidates(uint64_t partition_hash,
+                               /*out*/ dsn::gpid &pid,
+                               /*out*/ std::vector<host_port> &candidates) const override;
 
 private:
     struct partition_info
@@ -0,0 +1,39 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "partitioned_batch.h"
+
+namespace dsn {
+namespace replication {
+
+/*static*/ bool
+partitioned_batch::should_split(error_code err, int partition_index, int served_partition_index)
+{
+    if (partition_index < 0) {
+        return false;
+    }
+
+    if (err == ERR_SPLITTING || err == ERR_PARENT_PARTITION_MISUSED) {
+        return true;
+    }
+
+    return err == ERR_OK && served_partition_index >= 0 &&
+           served_partition_index != partition_index;
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#include "client/partition_resolver.h"
+#include "utils/error_code.h"
+
+namespace dsn {
+namespace replication {
+
+// The helpers for the requests of multiple keys which are sent in a batch to the partition of
+// the keys, e.g. batch_get.
+//
+// The keys are grouped by the partition count in the route cache, which may be stale once the
+// partition has been split. Since the server only validates the hash of the first key of a
+// batch, the batch should be sent again grouped by the hashes of the keys, if:
+// - it is served by another partition than it was grouped for, which means the partition count
+//   has been changed and the batch was redirected by the hash of its first key;
+// - it fails with ERR_SPLITTING or ERR_PARENT_PARTITION_MISUSED.
+// The keys of the same hash always belong to the same partition, thus the batches grouped by
+// the hashes are never split again.
+class partitioned_batch
+{
+public:
+    // Group the indexes of `count` keys by their partitions if `partition_count` > 0, otherwise
+    // by their hashes. The groups are keyed by the partition indexes or the hashes.
+    template <typename GetHash>
+    static std::map<uint64_t, std::vector<size_t>>
+    group(size_t count, int partition_count, const GetHash &get_hash)
+    {
+        std::map<uint64_t, std::vector<size_t>> groups;
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t hash = get_hash(i);
+            groups[partition_count > 0
+                       ? partition_resolver::get_partition_index(partition_count, hash)
+                       : hash]
+                .push_back(i);
+        }
+        return groups;
+    }
+
+    // Whether a batch grouped for `partition_index`, which is -1 if it is grouped by hash,
+    // should be sent again grouped by the hashes of the keys. `served_partition_index` is the
+    // partition which has served the batch, or -1 if the batch failed.
+    static bool should_split(error_code err, int partition_index, int served_partition_index);
+
+    // Match the found entries of a reply, which are in the order of the keys of the request, with
+    // the keys in one pass. `visit(key, entry)` is called for each key in order, with the entry
+    // of the key or nullptr if it is not found.
+    template <typename Key, typename Entry, typename Equal, typename Visit>
+    static void match_in_order(const std::vector<Key> &keys,
+                               const std::vector<Entry> &entries,
+                               const Equal &equal,
+                               const Visit &visit)
+    {
+        size_t entry_index = 0;
+        for (const auto &key : keys) {
+            const Entry *entry = nullptr;
+            if (entry_index < entries.size() && equal(key, entries[entry_index])) {
+                entry = &entries[entry_index++];
+            }
+            visit(key, entry);
+        }
+    }
+};
+
+} // namespace replication
+} // namespace dsn
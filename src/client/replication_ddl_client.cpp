@@ -1652,11 +1652,16 @@ error_code replication_ddl_client::detect_hotkey(const dsn::host_port &target,
 }
 
 error_with<start_partition_split_response>
-replication_ddl_client::start_partition_split(const std::string &app_name, int new_partition_count)
+replication_ddl_client::start_partition_split(const std::string &app_name,
+                                              int new_partition_count,
+                                              const std::string &reason)
 {
     auto req = std::make_unique<start_partition_split_request>();
     req->__set_app_name(app_name);
     req->__set_new_partition_count(new_partition_count);
+    if (!reason.empty()) {
+        req->__set_reason(reason);
+    }
     return call_rpc_sync(start_split_rpc(std::move(req), RPC_CM_START_PARTITION_SPLIT));
 }
 
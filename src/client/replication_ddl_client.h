@@ -233,8 +233,9 @@ public:
                              detect_hotkey_response &resp);
 
     // partition split
-    error_with<start_partition_split_response> start_partition_split(const std::string &app_name,
-                                                                     int partition_count);
+    // `reason` is recorded in the audit log of the meta server if it is not empty.
+    error_with<start_partition_split_response> start_partition_split(
+        const std::string &app_name, int partition_count, const std::string &reason = "");
     error_with<control_split_response> pause_partition_split(const std::string &app_name,
                                                              const int32_t parent_pidx);
     error_with<control_split_response> restart_partition_split(const std::string &app_name,
@@ -0,0 +1,128 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdint.h>
+#include <vector>
+
+#include "client/hedged_read_policy.h"
+#include "gtest/gtest.h"
+#include "runtime/rpc/rpc_host_port.h"
+#include "test_util/test_util.h"
+#include "utils/flags.h"
+
+DSN_DECLARE_uint32(hedged_read_budget_percent);
+
+namespace dsn {
+namespace replication {
+
+TEST(hedged_read_policy_test, disabled)
+{
+    // Hedging is disabled by default.
+    hedged_read_policy policy;
+    ASSERT_FALSE(policy.enabled());
+    ASSERT_FALSE(policy.on_read_started());
+    ASSERT_FALSE(policy.try_acquire_hedge());
+
+    policy.set_enabled(true);
+    ASSERT_TRUE(policy.on_read_started());
+    policy.set_enabled(false);
+    ASSERT_FALSE(policy.on_read_started());
+}
+
+TEST(hedged_read_policy_test, hedge_delay)
+{
+    const host_port node("localhost", 34801);
+    hedged_read_policy policy;
+    policy.set_enabled(true);
+
+    // The latencies of the backup requests are not used to adjust the delay.
+    for (int i = 0; i < 1000; ++i) {
+        policy.on_read_completed(node, 100, true);
+    }
+    ASSERT_EQ(-1, policy.hedge_delay_ms());
+
+    // The delay is updated once enough latencies have been recorded.
+    for (uint64_t i = 1; i < 128; ++i) {
+        policy.on_read_completed(node, i * 100, false);
+    }
+    ASSERT_EQ(-1, policy.hedge_delay_ms());
+    policy.on_read_completed(node, 12800, false);
+    // The 95th percentile of 100us, 200us, ..., 12800us is 12200us, which is rounded up.
+    ASSERT_EQ(13, policy.hedge_delay_ms());
+
+    // The delay is no less than FLAGS_hedged_read_min_delay_ms.
+    hedged_read_policy fast_policy;
+    for (int i = 0; i < 128; ++i) {
+        fast_policy.on_read_completed(node, 10, false);
+    }
+    ASSERT_EQ(2, fast_policy.hedge_delay_ms());
+}
+
+TEST(hedged_read_policy_test, hedge_budget)
+{
+    PRESERVE_FLAG(hedged_read_budget_percent);
+    FLAGS_hedged_read_budget_percent = 5;
+
+    hedged_read_policy policy;
+    policy.set_enabled(true);
+    ASSERT_FALSE(policy.try_acquire_hedge());
+
+    // A hedge is earned by every 20 reads.
+    for (int i = 0; i < 21; ++i) {
+        ASSERT_TRUE(policy.on_read_started());
+    }
+    ASSERT_TRUE(policy.try_acquire_hedge());
+    ASSERT_FALSE(policy.try_acquire_hedge());
+
+    // The budget saved during the idle time is limited.
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(policy.on_read_started());
+    }
+    int hedges = 0;
+    while (policy.try_acquire_hedge()) {
+        ++hedges;
+    }
+    ASSERT_EQ(10, hedges);
+}
+
+TEST(hedged_read_policy_test, choose_backup)
+{
+    const host_port node1("localhost", 34801);
+    const host_port node2("localhost", 34802);
+    const host_port node3("localhost", 34803);
+    hedged_read_policy policy;
+    ASSERT_FALSE(policy.choose_backup({}));
+
+    policy.on_read_completed(node1, 1000, true);
+    policy.on_read_completed(node2, 3000, true);
+    ASSERT_DOUBLE_EQ(1000, policy.get_node_latency_us(node1));
+    ASSERT_DOUBLE_EQ(-1, policy.get_node_latency_us(node3));
+
+    // The node which has never been measured is preferred.
+    ASSERT_EQ(node3, policy.choose_backup({node1, node2, node3}));
+    ASSERT_EQ(node1, policy.choose_backup({node1, node2}));
+
+    // The latencies are smoothed by EWMAs.
+    policy.on_read_completed(node1, 11000, true);
+    ASSERT_DOUBLE_EQ(3000, policy.get_node_latency_us(node1));
+    policy.on_read_completed(node1, 11000, true);
+    ASSERT_DOUBLE_EQ(4600, policy.get_node_latency_us(node1));
+    ASSERT_EQ(node2, policy.choose_backup({node1, node2}));
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,336 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "client/partition_resolver.h"
+#include "common/gpid.h"
+#include "common/replication.codes.h"
+#include "gtest/gtest.h"
+#include "runtime/rpc/rpc_host_port.h"
+#include "runtime/rpc/rpc_message.h"
+#include "runtime/task/async_calls.h"
+#include "runtime/task/task.h"
+#include "runtime/task/task_tracker.h"
+#include "test_util/test_util.h"
+#include "utils/autoref_ptr.h"
+#include "utils/error_code.h"
+#include "utils/flags.h"
+#include "utils/zlocks.h"
+
+DSN_DECLARE_uint32(hedged_read_min_delay_ms);
+
+namespace dsn {
+namespace replication {
+
+// The resolver of a table of a single partition, which records the requests rather than sends
+// them, so that the tests could respond to them in any order.
+class hedged_read_test_resolver : public partition_resolver
+{
+public:
+    hedged_read_test_resolver(const host_port &primary, const host_port &secondary)
+        : partition_resolver(host_port("localhost", 34601), "hedged_read_test"),
+          _primary(primary),
+          _secondary(secondary)
+    {
+    }
+
+    // Takes the request sent to `target`, or returns nullptr if there is none.
+    rpc_response_task_ptr take_request(const host_port &target)
+    {
+        zauto_lock l(_lock);
+        for (auto it = _requests.begin(); it != _requests.end(); ++it) {
+            if (it->first == target) {
+                auto task = std::move(it->second);
+                _requests.erase(it);
+                return task;
+            }
+        }
+        return rpc_response_task_ptr();
+    }
+
+    int get_partition_count() const override { return 1; }
+
+protected:
+    void resolve(uint64_t partition_hash,
+                 std::function<void(resolve_result &&)> &&callback,
+                 int timeout_ms) override
+    {
+        resolve_result result;
+        result.err = ERR_OK;
+        result.hp = _primary;
+        result.pid = gpid(1, 0);
+        callback(std::move(result));
+    }
+
+    void on_access_failure(int partition_index, error_code err) override {}
+
+    bool get_backup_candidates(uint64_t partition_hash,
+                               /*out*/ gpid &pid,
+                               /*out*/ std::vector<host_port> &candidates) const override
+    {
+        pid = gpid(1, 0);
+        candidates = {_secondary};
+        return true;
+    }
+
+    void send_request(const host_port &target, const rpc_response_task_ptr &task) override
+    {
+        zauto_lock l(_lock);
+        _requests.emplace_back(target, task);
+    }
+
+private:
+    const host_port _primary;
+    const host_port _secondary;
+
+    zlock _lock;
+    std::vector<std::pair<host_port, rpc_response_task_ptr>> _requests;
+};
+
+class partition_resolver_test : public testing::Test
+{
+protected:
+    struct read_result
+    {
+        std::atomic<int> count{0};
+        error_code err;
+        bool from_backup = false;
+    };
+
+    void SetUp() override
+    {
+        _resolver = new hedged_read_test_resolver(_primary, _secondary);
+        _resolver->set_hedged_read_enabled(true);
+    }
+
+    void TearDown() override { _tracker.cancel_outstanding_tasks(); }
+
+    rpc_response_task_ptr start_read(const std::shared_ptr<read_result> &result)
+    {
+        auto *request =
+            message_ex::create_request(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX, 120000, 0, 0);
+        auto task = rpc::create_rpc_response_task(
+            request, &_tracker, [result](error_code err, message_ex *req, message_ex *resp) {
+                result->err = err;
+                result->from_backup = req->header->context.u.is_backup_request;
+                ++result->count;
+            });
+        _resolver->call_task_hedged(task);
+        return task;
+    }
+
+    void wait_for_request(const host_port &target, /*out*/ rpc_response_task_ptr &task)
+    {
+        ASSERT_IN_TIME(
+            [&] {
+                task = _resolver->take_request(target);
+                ASSERT_FALSE(task == nullptr);
+            },
+            10);
+    }
+
+    static void respond(const rpc_response_task_ptr &task, error_code err)
+    {
+        task->enqueue(err, err == ERR_OK ? task->get_request()->create_response() : nullptr);
+    }
+
+    static void wait_for_result(const std::shared_ptr<read_result> &result)
+    {
+        ASSERT_IN_TIME([&] { ASSERT_EQ(1, result->count.load()); }, 10);
+    }
+
+    // Records the latencies of enough reads, so that the reads are hedged after
+    // FLAGS_hedged_read_min_delay_ms.
+    void warm_up()
+    {
+        for (int i = 0; i < 128; ++i) {
+            auto result = std::make_shared<read_result>();
+            start_read(result);
+            rpc_response_task_ptr primary;
+            ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+            respond(primary, ERR_OK);
+            ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        }
+    }
+
+    const host_port _primary{"localhost", 34801};
+    const host_port _secondary{"localhost", 34802};
+    ref_ptr<hedged_read_test_resolver> _resolver;
+    task_tracker _tracker;
+};
+
+TEST_F(partition_resolver_test, hedged_read_disabled)
+{
+    ASSERT_NO_FATAL_FAILURE(warm_up());
+    _resolver->set_hedged_read_enabled(false);
+
+    auto result = std::make_shared<read_result>();
+    auto task = start_read(result);
+    rpc_response_task_ptr primary;
+    ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_TRUE(_resolver->take_request(_secondary) == nullptr);
+
+    respond(primary, ERR_OK);
+    ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+    ASSERT_EQ(ERR_OK, result->err);
+    ASSERT_FALSE(result->from_backup);
+}
+
+TEST_F(partition_resolver_test, hedged_read_race)
+{
+    ASSERT_NO_FATAL_FAILURE(warm_up());
+
+    // The backup request responds first.
+    {
+        auto result = std::make_shared<read_result>();
+        start_read(result);
+        rpc_response_task_ptr primary;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+        rpc_response_task_ptr backup;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_secondary, backup));
+        ASSERT_TRUE(backup->get_request()->header->context.u.is_backup_request);
+
+        respond(backup, ERR_OK);
+        ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        ASSERT_EQ(ERR_OK, result->err);
+        ASSERT_TRUE(result->from_backup);
+
+        // The response of the original request is dropped.
+        respond(primary, ERR_OK);
+        ASSERT_IN_TIME([&] { ASSERT_EQ(TASK_STATE_FINISHED, primary->state()); }, 10);
+        ASSERT_EQ(1, result->count.load());
+    }
+
+    // The original request responds first, and the backup one is cancelled.
+    {
+        auto result = std::make_shared<read_result>();
+        start_read(result);
+        rpc_response_task_ptr primary;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+        rpc_response_task_ptr backup;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_secondary, backup));
+
+        respond(primary, ERR_OK);
+        ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        ASSERT_EQ(ERR_OK, result->err);
+        ASSERT_FALSE(result->from_backup);
+        ASSERT_EQ(TASK_STATE_CANCELLED, backup->state());
+    }
+}
+
+TEST_F(partition_resolver_test, hedged_read_fallback)
+{
+    ASSERT_NO_FATAL_FAILURE(warm_up());
+
+    // The original request fails, and the backup one succeeds.
+    {
+        auto result = std::make_shared<read_result>();
+        start_read(result);
+        rpc_response_task_ptr primary;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+        rpc_response_task_ptr backup;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_secondary, backup));
+
+        // The failure waits for the backup request.
+        respond(primary, ERR_BUSY);
+        ASSERT_IN_TIME([&] { ASSERT_EQ(TASK_STATE_FINISHED, primary->state()); }, 10);
+        ASSERT_EQ(0, result->count.load());
+
+        respond(backup, ERR_OK);
+        ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        ASSERT_EQ(ERR_OK, result->err);
+        ASSERT_TRUE(result->from_backup);
+    }
+
+    // The backup request fails, and the original one succeeds.
+    {
+        auto result = std::make_shared<read_result>();
+        start_read(result);
+        rpc_response_task_ptr primary;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+        rpc_response_task_ptr backup;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_secondary, backup));
+
+        respond(backup, ERR_NETWORK_FAILURE);
+        ASSERT_IN_TIME([&] { ASSERT_EQ(TASK_STATE_FINISHED, backup->state()); }, 10);
+        ASSERT_EQ(0, result->count.load());
+
+        respond(primary, ERR_OK);
+        ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        ASSERT_EQ(ERR_OK, result->err);
+        ASSERT_FALSE(result->from_backup);
+    }
+
+    // Both of the requests fail, in either order, and the failure of the original one is taken.
+    for (const bool original_first : {true, false}) {
+        auto result = std::make_shared<read_result>();
+        start_read(result);
+        rpc_response_task_ptr primary;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+        rpc_response_task_ptr backup;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_secondary, backup));
+
+        auto first = original_first ? primary : backup;
+        auto second = original_first ? backup : primary;
+        respond(first, original_first ? ERR_BUSY : ERR_NETWORK_FAILURE);
+        ASSERT_IN_TIME([&] { ASSERT_EQ(TASK_STATE_FINISHED, first->state()); }, 10);
+        ASSERT_EQ(0, result->count.load());
+
+        respond(second, original_first ? ERR_NETWORK_FAILURE : ERR_BUSY);
+        ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        ASSERT_EQ(ERR_BUSY, result->err);
+        ASSERT_FALSE(result->from_backup);
+    }
+}
+
+TEST_F(partition_resolver_test, hedged_read_completed_before_hedge)
+{
+    // The reads are hedged after a minute, which is far longer than the test.
+    PRESERVE_FLAG(hedged_read_min_delay_ms);
+    FLAGS_hedged_read_min_delay_ms = 60000;
+    ASSERT_NO_FATAL_FAILURE(warm_up());
+
+    for (const auto err : {ERR_OK, ERR_BUSY}) {
+        auto result = std::make_shared<read_result>();
+        auto task = start_read(result);
+        rpc_response_task_ptr primary;
+        ASSERT_NO_FATAL_FAILURE(wait_for_request(_primary, primary));
+        primary = nullptr;
+
+        // The response is taken at once, even if it is a failure.
+        respond(task, err);
+        ASSERT_NO_FATAL_FAILURE(wait_for_result(result));
+        ASSERT_EQ(err, result->err);
+        ASSERT_FALSE(result->from_backup);
+
+        // The hedge timer, which refers to the task, is cancelled.
+        ASSERT_IN_TIME([&] { ASSERT_EQ(1, task->get_count()); }, 10);
+        ASSERT_TRUE(_resolver->take_request(_secondary) == nullptr);
+    }
+}
+
+} // namespace replication
+} // namespace dsn
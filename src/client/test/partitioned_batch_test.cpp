@@ -0,0 +1,113 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "client/partitioned_batch.h"
+#include "gtest/gtest.h"
+#include "utils/error_code.h"
+
+namespace dsn {
+namespace replication {
+
+TEST(partitioned_batch_test, group)
+{
+    const std::vector<uint64_t> hashes({3, 11, 5, 19, 8, 13, 3});
+    const auto get_hash = [&hashes](size_t i) { return hashes[i]; };
+
+    // Grouped by the partitions.
+    const std::map<uint64_t, std::vector<size_t>> expected_partition_groups(
+        {{0, {4}}, {3, {0, 1, 3, 6}}, {5, {2, 5}}});
+    ASSERT_EQ(expected_partition_groups, partitioned_batch::group(hashes.size(), 8, get_hash));
+
+    // Grouped by the hashes if the partition count is unknown.
+    const std::map<uint64_t, std::vector<size_t>> expected_hash_groups(
+        {{3, {0, 6}}, {5, {2}}, {8, {4}}, {11, {1}}, {13, {5}}, {19, {3}}});
+    ASSERT_EQ(expected_hash_groups, partitioned_batch::group(hashes.size(), -1, get_hash));
+    ASSERT_EQ(expected_hash_groups, partitioned_batch::group(hashes.size(), 0, get_hash));
+
+    ASSERT_TRUE(partitioned_batch::group(0, 8, get_hash).empty());
+}
+
+TEST(partitioned_batch_test, should_split)
+{
+    struct test_case
+    {
+        error_code err;
+        int partition_index;
+        int served_partition_index;
+        bool expected;
+    } tests[] = {
+        // Served by the partition which the batch is grouped for.
+        {ERR_OK, 3, 3, false},
+        // Served by another partition after the partition count has been changed.
+        {ERR_OK, 3, 11, true},
+        // Failed by the server.
+        {ERR_OK, 3, -1, false},
+        {ERR_SPLITTING, 3, -1, true},
+        {ERR_PARENT_PARTITION_MISUSED, 3, -1, true},
+        {ERR_TIMEOUT, 3, -1, false},
+        // The batches grouped by the hashes are never split.
+        {ERR_OK, -1, 11, false},
+        {ERR_SPLITTING, -1, -1, false},
+        {ERR_PARENT_PARTITION_MISUSED, -1, -1, false},
+    };
+    for (const auto &test : tests) {
+        ASSERT_EQ(test.expected,
+                  partitioned_batch::should_split(
+                      test.err, test.partition_index, test.served_partition_index))
+            << test.err << ", " << test.partition_index << ", " << test.served_partition_index;
+    }
+}
+
+TEST(partitioned_batch_test, match_in_order)
+{
+    const std::vector<std::string> keys({"a", "b", "c", "d", "e"});
+    const auto equal = [](const std::string &key, const std::pair<std::string, int> &entry) {
+        return key == entry.first;
+    };
+
+    struct test_case
+    {
+        std::vector<std::pair<std::string, int>> entries;
+        std::vector<int> expected_values;
+    } tests[] = {
+        {{}, {-1, -1, -1, -1, -1}},
+        {{{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}, {"e", 5}}, {1, 2, 3, 4, 5}},
+        {{{"b", 2}, {"e", 5}}, {-1, 2, -1, -1, 5}},
+        {{{"a", 1}, {"d", 4}}, {1, -1, -1, 4, -1}},
+    };
+    for (const auto &test : tests) {
+        std::vector<int> values;
+        partitioned_batch::match_in_order(
+            keys,
+            test.entries,
+            equal,
+            [&values](const std::string &, const std::pair<std::string, int> *entry) {
+                values.push_back(entry == nullptr ? -1 : entry->second);
+            });
+        ASSERT_EQ(test.expected_values, values);
+    }
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "fan_out.h"
+
+#include <stddef.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "utils/zlocks.h"
+
+namespace pegasus {
+namespace client {
+
+namespace {
+
+struct fan_out_state
+{
+    ::dsn::zlock lock;
+    std::vector<fan_out::sub_request> requests;
+    size_t next = 0;
+    size_t remaining = 0;
+    // The number of the sub requests which could be started.
+    size_t free_slots = 0;
+    // Whether a thread is starting the sub requests, in which case the others just leave their
+    // free slots to it, so that the sub requests which finish synchronously never start the next
+    // ones recursively.
+    bool starting = false;
+    std::function<void()> on_all_done;
+};
+
+void start_requests(const std::shared_ptr<fan_out_state> &state, size_t free_slots)
+{
+    {
+        ::dsn::zauto_lock l(state->lock);
+        state->free_slots += free_slots;
+        if (state->starting) {
+            return;
+        }
+        state->starting = true;
+    }
+
+    while (true) {
+        fan_out::sub_request request;
+        {
+            ::dsn::zauto_lock l(state->lock);
+            if (state->free_slots == 0 || state->next >= state->requests.size()) {
+                state->starting = false;
+                return;
+            }
+            --state->free_slots;
+            request = std::move(state->requests[state->next++]);
+        }
+
+        request([state]() {
+            bool all_done = false;
+            {
+                ::dsn::zauto_lock l(state->lock);
+                all_done = --state->remaining == 0;
+            }
+            if (all_done) {
+                state->on_all_done();
+            } else {
+                start_requests(state, 1);
+            }
+        });
+    }
+}
+
+} // anonymous namespace
+
+/*static*/ void fan_out::run(std::vector<sub_request> &&requests,
+                             int max_concurrency,
+                             std::function<void()> &&on_all_done)
+{
+    if (requests.empty()) {
+        on_all_done();
+        return;
+    }
+
+    auto state = std::make_shared<fan_out_state>();
+    state->requests = std::move(requests);
+    state->remaining = state->requests.size();
+    state->on_all_done = std::move(on_all_done);
+
+    const size_t concurrency =
+        std::min(state->requests.size(), static_cast<size_t>(std::max(max_concurrency, 1)));
+    start_requests(state, concurrency);
+}
+
+} // namespace client
+} // namespace pegasus
@@ -0,0 +1,45 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+
+namespace pegasus {
+namespace client {
+
+// Runs the asynchronous sub requests of a batch request with at most `max_concurrency` of them
+// in flight at the same time. Each sub request is passed a callback which should be invoked
+// exactly once when it finishes, and `on_all_done` is invoked once all of them have finished.
+//
+// The sub requests could finish on any thread.
+class fan_out
+{
+public:
+    using done_callback = std::function<void()>;
+    using sub_request = std::function<void(done_callback &&)>;
+
+    static void run(std::vector<sub_request> &&requests,
+                    int max_concurrency,
+                    std::function<void()> &&on_all_done);
+};
+
+} // namespace client
+} // namespace pegasus
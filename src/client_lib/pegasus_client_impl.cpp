@@ -19,32 +19,51 @@
 
 #include <fmt/core.h>
 #include <pegasus/error.h>
+#include <stddef.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
 
 #include "absl/strings/string_view.h"
+#include "client/partitioned_batch.h"
 #include "common/common.h"
 #include "common/replication_other_types.h"
 #include "common/serialization_helper/dsn.layer2_types.h"
+#include "fan_out.h"
 #include "pegasus/client.h"
 #include "pegasus_client_impl.h"
 #include "pegasus_key_schema.h"
 #include "pegasus_utils.h"
+#include "request_coalescer.h"
 #include "rrdb/rrdb.client.h"
 #include "runtime/rpc/dns_resolver.h"
 #include "runtime/rpc/group_host_port.h"
 #include "runtime/rpc/serialization.h"
 #include "runtime/task/async_calls.h"
 #include "runtime/task/task_code.h"
+#include "utils/blob.h"
 #include "utils/error_code.h"
+#include "utils/flags.h"
 #include "utils/fmt_logging.h"
+#include "utils/ports.h"
 #include "utils/synchronize.h"
 #include "utils/threadpool_code.h"
 
+DSN_DEFINE_uint32(pegasus.client,
+                  batch_any_max_keys_per_request,
+                  100,
+                  "The max number of keys sent in a single batch_get or multi_put by "
+                  "async_batch_get_any and async_batch_set_any");
+DSN_TAG_VARIABLE(batch_any_max_keys_per_request, FT_MUTABLE);
+DSN_DEFINE_validator(batch_any_max_keys_per_request,
+                     [](uint32_t value) -> bool { return value > 0; });
+
 namespace dsn {
 class message_ex;
 class task_tracker;
@@ -71,14 +90,26 @@ pegasus_client_impl::pegasus_client_impl(const char *cluster_name, const char *a
     _meta_server.group_host_port()->add_list(meta_servers);
 
     _client = new ::dsn::apps::rrdb_client(cluster_name, meta_servers, app_name);
+    _coalescer = std::make_shared<request_coalescer>(this);
 }
 
-pegasus_client_impl::~pegasus_client_impl() { delete _client; }
+pegasus_client_impl::~pegasus_client_impl()
+{
+    // The pending coalesced requests are sent by _client, while the coalescer may be still held
+    // by the callbacks of the in-flight batches until _client is deleted.
+    _coalescer->close();
+    delete _client;
+}
 
 const char *pegasus_client_impl::get_cluster_name() const { return _cluster_name.c_str(); }
 
 const char *pegasus_client_impl::get_app_name() const { return _app_name.c_str(); }
 
+void pegasus_client_impl::set_hedged_read_enabled(bool enabled)
+{
+    _client->set_hedged_read_enabled(enabled);
+}
+
 int pegasus_client_impl::set(const std::string &hash_key,
                              const std::string &sort_key,
                              const std::string &value,
@@ -114,6 +145,21 @@ void pegasus_client_impl::async_set(const std::string &hash_key,
             callback(PERR_INVALID_HASH_KEY, internal_info());
         return;
     }
+    if (_coalescer->add_set(
+            hash_key, sort_key, value, callback, timeout_milliseconds, ttl_seconds)) {
+        return;
+    }
+    async_set_uncoalesced(
+        hash_key, sort_key, value, std::move(callback), timeout_milliseconds, ttl_seconds);
+}
+
+void pegasus_client_impl::async_set_uncoalesced(const std::string &hash_key,
+                                                const std::string &sort_key,
+                                                const std::string &value,
+                                                async_set_callback_t &&callback,
+                                                int timeout_milliseconds,
+                                                int ttl_seconds)
+{
     ::dsn::apps::update_request req;
     pegasus_generate_key(req.key, hash_key, sort_key);
     req.value.assign(value.c_str(), 0, value.size());
@@ -271,6 +317,17 @@ void pegasus_client_impl::async_get(const std::string &hash_key,
             callback(PERR_INVALID_HASH_KEY, std::string(), internal_info());
         return;
     }
+    if (_coalescer->add_get(hash_key, sort_key, callback, timeout_milliseconds)) {
+        return;
+    }
+    async_get_uncoalesced(hash_key, sort_key, std::move(callback), timeout_milliseconds);
+}
+
+void pegasus_client_impl::async_get_uncoalesced(const std::string &hash_key,
+                                                const std::string &sort_key,
+                                                async_get_callback_t &&callback,
+                                                int timeout_milliseconds)
+{
     ::dsn::blob req;
     pegasus_generate_key(req, hash_key, sort_key);
     auto partition_hash = pegasus_key_hash(req);
@@ -1280,6 +1337,333 @@ int pegasus_client_impl::get_unordered_scanners(int max_split_count,
     return ret;
 }
 
+struct pegasus_client_impl::batch_get_any_context
+{
+    std::vector<std::pair<std::string, std::string>> keys;
+    std::vector<batch_any_result> results;
+    int timeout_milliseconds = 0;
+};
+
+struct pegasus_client_impl::batch_set_any_context
+{
+    std::vector<full_key_value> kvs;
+    std::vector<batch_any_result> results;
+    int timeout_milliseconds = 0;
+    int ttl_seconds = 0;
+};
+
+namespace {
+
+uint64_t get_key_hash(const std::string &hash_key, const std::string &sort_key)
+{
+    ::dsn::blob key;
+    pegasus_generate_key(key, hash_key, sort_key);
+    return pegasus_key_hash(key);
+}
+
+// Split each group into the chunks of at most FLAGS_batch_any_max_keys_per_request indexes.
+std::vector<std::vector<size_t>> split_into_chunks(std::vector<size_t> &&indexes)
+{
+    std::vector<std::vector<size_t>> chunks;
+    const size_t max_keys = FLAGS_batch_any_max_keys_per_request;
+    if (indexes.size() <= max_keys) {
+        chunks.emplace_back(std::move(indexes));
+        return chunks;
+    }
+    for (size_t i = 0; i < indexes.size(); i += max_keys) {
+        const auto end = std::min(indexes.size(), i + max_keys);
+        chunks.emplace_back(indexes.begin() + i, indexes.begin() + end);
+    }
+    return chunks;
+}
+
+// Returns the first error of the results, while `ignored_error` is regarded as a success.
+int get_batch_any_error(const std::vector<batch_any_result> &results, int ignored_error)
+{
+    for (const auto &result : results) {
+        if (result.error != PERR_OK && result.error != ignored_error) {
+            return result.error;
+        }
+    }
+    return PERR_OK;
+}
+
+} // anonymous namespace
+
+void pegasus_client_impl::async_batch_get_any(
+    const std::vector<std::pair<std::string, std::string>> &keys,
+    async_batch_any_callback_t &&callback,
+    int max_concurrency,
+    int timeout_milliseconds)
+{
+    // check params
+    if (max_concurrency <= 0) {
+        LOG_ERROR("invalid max_concurrency: which should be greater than 0, but {}",
+                  max_concurrency);
+        if (callback != nullptr)
+            callback(PERR_INVALID_ARGUMENT, std::vector<batch_any_result>());
+        return;
+    }
+    for (const auto &key : keys) {
+        if (key.first.size() >= UINT16_MAX) {
+            LOG_ERROR("invalid hash key: hash key length should be less than UINT16_MAX, but {}",
+                      key.first.size());
+            if (callback != nullptr)
+                callback(PERR_INVALID_HASH_KEY, std::vector<batch_any_result>());
+            return;
+        }
+    }
+
+    auto context = std::make_shared<batch_get_any_context>();
+    context->keys = keys;
+    context->results.resize(keys.size());
+    context->timeout_milliseconds = timeout_milliseconds;
+
+    // The keys are grouped by their partitions if the partition count has been resolved,
+    // otherwise by their hashes, since the keys of the same hash always belong to the same
+    // partition.
+    const int partition_count = _client->get_partition_count();
+    auto groups = dsn::replication::partitioned_batch::group(
+        keys.size(), partition_count, [&keys](size_t i) {
+            return get_key_hash(keys[i].first, keys[i].second);
+        });
+
+    std::vector<fan_out::sub_request> requests;
+    for (auto &group : groups) {
+        const int partition_index = partition_count > 0 ? static_cast<int>(group.first) : -1;
+        for (auto &chunk : split_into_chunks(std::move(group.second))) {
+            requests.emplace_back([this, context, partition_index, indexes = std::move(chunk)](
+                                      fan_out::done_callback &&on_done) mutable {
+                send_batch_get_any(
+                    context, std::move(indexes), partition_index, std::move(on_done));
+            });
+        }
+    }
+    fan_out::run(std::move(requests),
+                 max_concurrency,
+                 [context, user_callback = std::move(callback)]() {
+                     if (user_callback != nullptr) {
+                         const int ret = get_batch_any_error(context->results, PERR_NOT_FOUND);
+                         user_callback(ret, std::move(context->results));
+                     }
+                 });
+}
+
+void pegasus_client_impl::send_batch_get_any(const std::shared_ptr<batch_get_any_context> &context,
+                                             std::vector<size_t> &&indexes,
+                                             int partition_index,
+                                             std::function<void()> &&on_done)
+{
+    // The blobs refer to the keys held by the context, which outlives the request.
+    ::dsn::apps::batch_get_request req;
+    req.keys.reserve(indexes.size());
+    for (const auto index : indexes) {
+        const auto &key = context->keys[index];
+        ::dsn::apps::full_key full_key;
+        full_key.hash_key = ::dsn::blob(key.first.data(), 0, key.first.size());
+        full_key.sort_key = ::dsn::blob(key.second.data(), 0, key.second.size());
+        req.keys.emplace_back(std::move(full_key));
+    }
+    const auto &first_key = context->keys[indexes.front()];
+    const auto partition_hash = get_key_hash(first_key.first, first_key.second);
+
+    auto on_batch_get_reply =
+        [this, context, partition_index, indexes = std::move(indexes),
+         on_done = std::move(on_done)](
+            ::dsn::error_code err, dsn::message_ex *, dsn::message_ex *resp) mutable {
+            internal_info info;
+            ::dsn::apps::batch_get_response response;
+            int served_partition_index = -1;
+            if (err == ERR_OK) {
+                ::dsn::unmarshall(resp, response);
+                info.app_id = response.app_id;
+                info.partition_index = response.partition_index;
+                info.server = response.server;
+                if (response.error == 0) {
+                    served_partition_index = response.partition_index;
+                }
+            }
+
+            if (dsn_unlikely(dsn::replication::partitioned_batch::should_split(
+                    err, partition_index, served_partition_index))) {
+                LOG_INFO("batch_get of partition {} was served by partition {} with error {}, "
+                         "send the {} keys again by their hashes",
+                         partition_index,
+                         served_partition_index,
+                         err,
+                         indexes.size());
+                auto groups = dsn::replication::partitioned_batch::group(
+                    indexes.size(), -1, [&context, &indexes](size_t i) {
+                        const auto &key = context->keys[indexes[i]];
+                        return get_key_hash(key.first, key.second);
+                    });
+                auto remaining = std::make_shared<std::atomic<size_t>>(groups.size());
+                auto shared_on_done = std::make_shared<std::function<void()>>(std::move(on_done));
+                for (auto &group : groups) {
+                    std::vector<size_t> group_indexes;
+                    group_indexes.reserve(group.second.size());
+                    for (const auto i : group.second) {
+                        group_indexes.push_back(indexes[i]);
+                    }
+                    send_batch_get_any(
+                        context, std::move(group_indexes), -1, [remaining, shared_on_done]() {
+                            if (remaining->fetch_sub(1) == 1) {
+                                (*shared_on_done)();
+                            }
+                        });
+                }
+                return;
+            }
+
+            const int ret = get_client_error(
+                err == ERR_OK ? get_rocksdb_server_error(response.error) : int(err));
+            dsn::replication::partitioned_batch::match_in_order(
+                indexes,
+                response.data,
+                [&context](size_t index, const ::dsn::apps::full_data &data) {
+                    const auto &key = context->keys[index];
+                    return data.hash_key.to_string_view() == key.first &&
+                           data.sort_key.to_string_view() == key.second;
+                },
+                [&context, &info, ret](size_t index, const ::dsn::apps::full_data *data) {
+                    auto &result = context->results[index];
+                    result.error = ret;
+                    result.info = info;
+                    if (ret != PERR_OK) {
+                        return;
+                    }
+                    if (data != nullptr) {
+                        result.value.assign(data->value.data(), data->value.length());
+                    } else {
+                        result.error = PERR_NOT_FOUND;
+                    }
+                });
+            on_done();
+        };
+    _client->batch_get(req,
+                       std::move(on_batch_get_reply),
+                       std::chrono::milliseconds(context->timeout_milliseconds),
+                       partition_hash);
+}
+
+void pegasus_client_impl::async_batch_set_any(const std::vector<full_key_value> &kvs,
+                                              async_batch_any_callback_t &&callback,
+                                              int max_concurrency,
+                                              int timeout_milliseconds,
+                                              int ttl_seconds)
+{
+    // check params
+    if (max_concurrency <= 0) {
+        LOG_ERROR("invalid max_concurrency: which should be greater than 0, but {}",
+                  max_concurrency);
+        if (callback != nullptr)
+            callback(PERR_INVALID_ARGUMENT, std::vector<batch_any_result>());
+        return;
+    }
+    for (const auto &kv : kvs) {
+        if (kv.hash_key.size() >= UINT16_MAX) {
+            LOG_ERROR("invalid hash key: hash key length should be less than UINT16_MAX, but {}",
+                      kv.hash_key.size());
+            if (callback != nullptr)
+                callback(PERR_INVALID_HASH_KEY, std::vector<batch_any_result>());
+            return;
+        }
+    }
+
+    auto context = std::make_shared<batch_set_any_context>();
+    context->kvs = kvs;
+    context->results.resize(kvs.size());
+    context->timeout_milliseconds = timeout_milliseconds;
+    context->ttl_seconds = ttl_seconds;
+
+    // multi_put requires a non-empty hash key, thus the kvs of the empty hash key are set one
+    // by one.
+    std::map<std::string, std::vector<size_t>> groups;
+    std::vector<fan_out::sub_request> requests;
+    for (size_t i = 0; i < kvs.size(); ++i) {
+        if (!kvs[i].hash_key.empty()) {
+            groups[kvs[i].hash_key].push_back(i);
+            continue;
+        }
+        requests.emplace_back([this, context, i](fan_out::done_callback &&on_done) mutable {
+            const auto &kv = context->kvs[i];
+            async_set_uncoalesced(
+                kv.hash_key,
+                kv.sort_key,
+                kv.value,
+                [context, i, on_done = std::move(on_done)](int err, internal_info &&info) {
+                    context->results[i].error = err;
+                    context->results[i].info = std::move(info);
+                    on_done();
+                },
+                context->timeout_milliseconds,
+                context->ttl_seconds);
+        });
+    }
+    for (auto &group : groups) {
+        for (auto &chunk : split_into_chunks(std::move(group.second))) {
+            requests.emplace_back([this, context, indexes = std::move(chunk)](
+                                      fan_out::done_callback &&on_done) mutable {
+                send_batch_set_any(context, std::move(indexes), std::move(on_done));
+            });
+        }
+    }
+
+    fan_out::run(std::move(requests),
+                 max_concurrency,
+                 [context, user_callback = std::move(callback)]() {
+                     if (user_callback != nullptr) {
+                         const int ret = get_batch_any_error(context->results, PERR_OK);
+                         user_callback(ret, std::move(context->results));
+                     }
+                 });
+}
+
+void pegasus_client_impl::send_batch_set_any(const std::shared_ptr<batch_set_any_context> &context,
+                                             std::vector<size_t> &&indexes,
+                                             std::function<void()> &&on_done)
+{
+    // The blobs refer to the kvs held by the context, which outlives the request.
+    const auto &hash_key = context->kvs[indexes.front()].hash_key;
+    ::dsn::apps::multi_put_request req;
+    req.hash_key = ::dsn::blob(hash_key.data(), 0, hash_key.size());
+    req.kvs.reserve(indexes.size());
+    for (const auto index : indexes) {
+        const auto &kv = context->kvs[index];
+        ::dsn::apps::key_value key_value;
+        key_value.key = ::dsn::blob(kv.sort_key.data(), 0, kv.sort_key.size());
+        key_value.value = ::dsn::blob(kv.value.data(), 0, kv.value.size());
+        req.kvs.emplace_back(std::move(key_value));
+    }
+    req.expire_ts_seconds =
+        context->ttl_seconds == 0 ? 0 : context->ttl_seconds + utils::epoch_now();
+    const auto partition_hash = get_key_hash(hash_key, "");
+
+    auto on_multi_put_reply = [context, indexes = std::move(indexes), on_done = std::move(on_done)](
+        ::dsn::error_code err, dsn::message_ex *, dsn::message_ex *resp) {
+        internal_info info;
+        ::dsn::apps::update_response response;
+        if (err == ERR_OK) {
+            ::dsn::unmarshall(resp, response);
+            info.app_id = response.app_id;
+            info.partition_index = response.partition_index;
+            info.decree = response.decree;
+            info.server = response.server;
+        }
+        const int ret =
+            get_client_error(err == ERR_OK ? get_rocksdb_server_error(response.error) : int(err));
+        for (const auto index : indexes) {
+            context->results[index].error = ret;
+            context->results[index].info = info;
+        }
+        on_done();
+    };
+    _client->multi_put(req,
+                       std::move(on_multi_put_reply),
+                       std::chrono::milliseconds(context->timeout_milliseconds),
+                       partition_hash);
+}
+
 void pegasus_client_impl::async_duplicate(dsn::apps::duplicate_rpc rpc,
                                           std::function<void(dsn::error_code)> &&callback,
                                           dsn::task_tracker *tracker)
@@ -1342,3 +1726,98 @@ const char *pegasus_client_impl::get_error_string(int error_code) const
 }
 } // namespace client
 } // namespace pegasus
+
+namespace pegasus {
+
+// The default implementations of the batch requests of any keys, which send the keys one by one
+// by the single-key requests.
+
+void pegasus_client::async_batch_get_any(
+    const std::vector<std::pair<std::string, std::string>> &keys,
+    async_batch_any_callback_t &&callback,
+    int max_concurrency,
+    int timeout_milliseconds)
+{
+    if (max_concurrency <= 0) {
+        LOG_ERROR("invalid max_concurrency: which should be greater than 0, but {}",
+                  max_concurrency);
+        if (callback != nullptr)
+            callback(PERR_INVALID_ARGUMENT, std::vector<batch_any_result>());
+        return;
+    }
+
+    auto results = std::make_shared<std::vector<batch_any_result>>(keys.size());
+    std::vector<client::fan_out::sub_request> requests;
+    requests.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        requests.emplace_back([this, results, i, key = keys[i], timeout_milliseconds](
+                                  client::fan_out::done_callback &&on_done) {
+            async_get(key.first,
+                      key.second,
+                      [results, i, on_done = std::move(on_done)](
+                          int err, std::string &&value, internal_info &&info) {
+                          auto &result = (*results)[i];
+                          result.error = err;
+                          result.value = std::move(value);
+                          result.info = std::move(info);
+                          on_done();
+                      },
+                      timeout_milliseconds);
+        });
+    }
+    client::fan_out::run(std::move(requests),
+                         max_concurrency,
+                         [results, user_callback = std::move(callback)]() {
+                             if (user_callback != nullptr) {
+                                 const int ret =
+                                     client::get_batch_any_error(*results, PERR_NOT_FOUND);
+                                 user_callback(ret, std::move(*results));
+                             }
+                         });
+}
+
+void pegasus_client::async_batch_set_any(const std::vector<full_key_value> &kvs,
+                                         async_batch_any_callback_t &&callback,
+                                         int max_concurrency,
+                                         int timeout_milliseconds,
+                                         int ttl_seconds)
+{
+    if (max_concurrency <= 0) {
+        LOG_ERROR("invalid max_concurrency: which should be greater than 0, but {}",
+                  max_concurrency);
+        if (callback != nullptr)
+            callback(PERR_INVALID_ARGUMENT, std::vector<batch_any_result>());
+        return;
+    }
+
+    auto results = std::make_shared<std::vector<batch_any_result>>(kvs.size());
+    std::vector<client::fan_out::sub_request> requests;
+    requests.reserve(kvs.size());
+    for (size_t i = 0; i < kvs.size(); ++i) {
+        requests.emplace_back([this, results, i, kv = kvs[i], timeout_milliseconds, ttl_seconds](
+                                  client::fan_out::done_callback &&on_done) {
+            async_set(kv.hash_key,
+                      kv.sort_key,
+                      kv.value,
+                      [results, i, on_done = std::move(on_done)](int err,
+                                                                 internal_info &&info) {
+                          auto &result = (*results)[i];
+                          result.error = err;
+                          result.info = std::move(info);
+                          on_done();
+                      },
+                      timeout_milliseconds,
+                      ttl_seconds);
+        });
+    }
+    client::fan_out::run(std::move(requests),
+                         max_concurrency,
+                         [results, user_callback = std::move(callback)]() {
+                             if (user_callback != nullptr) {
+                                 const int ret = client::get_batch_any_error(*results, PERR_OK);
+                                 user_callback(ret, std::move(*results));
+                             }
+                         });
+}
+
+} // namespace pegasus
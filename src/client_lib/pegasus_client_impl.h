@@ -21,6 +21,7 @@
 
 #include <pegasus/client.h>
 #include <rrdb/rrdb.client.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <functional>
 #include <list>
@@ -29,6 +30,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "rrdb/rrdb_types.h"
@@ -44,6 +46,7 @@ class task_tracker;
 
 namespace pegasus {
 namespace client {
+class request_coalescer;
 
 class pegasus_client_impl : public pegasus_client
 {
@@ -55,6 +58,8 @@ public:
 
     virtual const char *get_app_name() const override;
 
+    virtual void set_hedged_read_enabled(bool enabled) override;
+
     virtual int set(const std::string &hashkey,
                     const std::string &sortkey,
                     const std::string &value,
@@ -252,6 +257,17 @@ public:
                                  const scan_options &options,
                                  async_get_unordered_scanners_callback_t &&callback) override;
 
+    virtual void async_batch_get_any(const std::vector<std::pair<std::string, std::string>> &keys,
+                                     async_batch_any_callback_t &&callback,
+                                     int max_concurrency = 8,
+                                     int timeout_milliseconds = 5000) override;
+
+    virtual void async_batch_set_any(const std::vector<full_key_value> &kvs,
+                                     async_batch_any_callback_t &&callback,
+                                     int max_concurrency = 8,
+                                     int timeout_milliseconds = 5000,
+                                     int ttl_seconds = 0) override;
+
     /// \internal
     /// This is an internal function for duplication.
     /// \see pegasus::server::pegasus_mutation_duplicator
@@ -273,6 +289,8 @@ public:
 
         int next(int32_t &count, internal_info *info = nullptr) override;
 
+        bool get_batch_stats(scan_stats &stats) const override;
+
         void async_next(async_scan_next_callback_t &&) override;
 
         bool safe_destructible() const override;
@@ -313,6 +331,8 @@ public:
         internal_info _info;
         int32_t _p;
         int32_t _kv_count;
+        bool _has_batch_stats;
+        scan_stats _batch_stats;
 
         int64_t _context;
         mutable ::dsn::zlock _lock;
@@ -352,6 +372,11 @@ private:
             return _p->next(count, info);
         }
 
+        bool get_batch_stats(scan_stats &stats) const override
+        {
+            return _p->get_batch_stats(stats);
+        }
+
         int next(std::string &hashkey,
                  std::string &sortkey,
                  std::string &value,
@@ -361,11 +386,41 @@ private:
         }
     };
 
+private:
+    friend class request_coalescer;
+
+    // Send the request without coalescing it, see request_coalescer.
+    void async_get_uncoalesced(const std::string &hashkey,
+                               const std::string &sortkey,
+                               async_get_callback_t &&callback,
+                               int timeout_milliseconds);
+    void async_set_uncoalesced(const std::string &hashkey,
+                               const std::string &sortkey,
+                               const std::string &value,
+                               async_set_callback_t &&callback,
+                               int timeout_milliseconds,
+                               int ttl_seconds);
+
+    struct batch_get_any_context;
+    struct batch_set_any_context;
+
+    // Send a batch_get of the keys at `indexes` of the context. `partition_index` is the
+    // partition which the keys are expected to belong to, or -1 if it is unknown.
+    void send_batch_get_any(const std::shared_ptr<batch_get_any_context> &context,
+                            std::vector<size_t> &&indexes,
+                            int partition_index,
+                            std::function<void()> &&on_done);
+    // Send a multi_put of the kvs at `indexes` of the context, which share the same hash key.
+    void send_batch_set_any(const std::shared_ptr<batch_set_any_context> &context,
+                            std::vector<size_t> &&indexes,
+                            std::function<void()> &&on_done);
+
 private:
     std::string _cluster_name;
     std::string _app_name;
     ::dsn::host_port _meta_server;
     ::dsn::apps::rrdb_client *_client;
+    std::shared_ptr<request_coalescer> _coalescer;
 
     ///
     /// \brief _client_error_to_string
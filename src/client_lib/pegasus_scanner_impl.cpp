@@ -84,6 +84,7 @@ pegasus_client_impl::pegasus_scanner_impl::pegasus_scanner_impl(::dsn::apps::rrd
       _splits_hash(std::move(hash)),
       _p(-1),
       _kv_count(-1),
+      _has_batch_stats(false),
       _context(SCAN_CONTEXT_ID_COMPLETED),
       _rpc_started(false),
       _validate_partition_hash(validate_partition_hash),
@@ -115,6 +116,16 @@ int pegasus_client_impl::pegasus_scanner_impl::next(int32_t &count, internal_inf
     return ret;
 }
 
+bool pegasus_client_impl::pegasus_scanner_impl::get_batch_stats(scan_stats &stats) const
+{
+    ::dsn::zauto_lock l(_lock);
+    if (!_has_batch_stats) {
+        return false;
+    }
+    stats = _batch_stats;
+    return true;
+}
+
 int pegasus_client_impl::pegasus_scanner_impl::next(std::string &hashkey,
                                                     std::string &sortkey,
                                                     std::string &value,
@@ -298,6 +309,9 @@ void pegasus_client_impl::pegasus_scanner_impl::_start_scan()
     req.__set_return_expire_ts(_options.return_expire_ts);
     req.__set_full_scan(_full_scan);
     req.__set_only_return_count(_options.only_return_count);
+    if (_options.only_return_count && _options.return_stat) {
+        req.__set_return_stat(true);
+    }
 
     CHECK(!_rpc_started, "");
     _rpc_started = true;
@@ -336,6 +350,16 @@ void pegasus_client_impl::pegasus_scanner_impl::_on_scan_response(::dsn::error_c
                 _type = async_scan_type::COUNT_ONLY;
                 _kv_count = response.kv_count;
             }
+            _has_batch_stats = response.__isset.stat;
+            if (_has_batch_stats) {
+                const auto &stat = response.stat;
+                _batch_stats.hash_key_count = stat.hash_key_count;
+                _batch_stats.hash_key_size_sum = stat.hash_key_size_sum;
+                _batch_stats.sort_key_size_sum = stat.sort_key_size_sum;
+                _batch_stats.value_size_sum = stat.value_size_sum;
+                _batch_stats.row_size_histogram = stat.row_size_histogram;
+                _batch_stats.ttl_histogram = stat.ttl_histogram;
+            }
             _async_next_internal();
             return;
         } else if (get_rocksdb_server_error(response.error) == PERR_NOT_FOUND) {
@@ -0,0 +1,402 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "request_coalescer.h"
+
+#include <pegasus/error.h>
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+
+#include "client/partition_resolver.h"
+#include "client/partitioned_batch.h"
+#include "pegasus_client_impl.h"
+#include "pegasus_key_schema.h"
+#include "pegasus_utils.h"
+#include "rrdb/rrdb.client.h"
+#include "rrdb/rrdb_types.h"
+#include "runtime/rpc/serialization.h"
+#include "runtime/task/async_calls.h"
+#include "runtime/task/task_code.h"
+#include "utils/blob.h"
+#include "utils/error_code.h"
+#include "utils/flags.h"
+#include "utils/fmt_logging.h"
+#include "utils/ports.h"
+#include "utils/threadpool_code.h"
+
+DSN_DEFINE_bool(pegasus.client,
+                coalesce_single_key_requests,
+                false,
+                "Whether to coalesce the concurrent single-key requests of a client: the gets of "
+                "the same partition are sent in a single batch_get, and the sets of the same "
+                "non-empty hash key are sent in a single multi_put");
+DSN_TAG_VARIABLE(coalesce_single_key_requests, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.client,
+                  coalesce_flush_delay_ms,
+                  1,
+                  "The max time in milliseconds that a coalesced request waits for the others "
+                  "before it is sent");
+DSN_TAG_VARIABLE(coalesce_flush_delay_ms, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.client,
+                  coalesce_max_batch_size,
+                  100,
+                  "The max number of requests coalesced into a single batch_get or multi_put");
+DSN_TAG_VARIABLE(coalesce_max_batch_size, FT_MUTABLE);
+DSN_DEFINE_validator(coalesce_max_batch_size, [](uint32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint64(pegasus.client,
+                  coalesce_max_batch_bytes,
+                  256 * 1024,
+                  "The max total size of the sort keys and values coalesced into a single "
+                  "multi_put, which should be less than the max allowed write size of the "
+                  "servers");
+DSN_TAG_VARIABLE(coalesce_max_batch_bytes, FT_MUTABLE);
+
+namespace pegasus {
+namespace client {
+
+DEFINE_TASK_CODE(LPC_PEGASUS_CLIENT_COALESCE_FLUSH,
+                 TASK_PRIORITY_COMMON,
+                 ::dsn::THREAD_POOL_DEFAULT)
+
+request_coalescer::request_coalescer(pegasus_client_impl *client)
+    : _client(client), _flush_scheduled(false), _closed(false)
+{
+    _pfc_coalesced_get_batch_size.init_global_counter(
+        "pegasus_client",
+        "app.pegasus",
+        "client.coalesced.get.batch.size",
+        COUNTER_TYPE_NUMBER_PERCENTILES,
+        "statistic the number of gets coalesced into each batch_get");
+    _pfc_coalesced_set_batch_size.init_global_counter(
+        "pegasus_client",
+        "app.pegasus",
+        "client.coalesced.set.batch.size",
+        COUNTER_TYPE_NUMBER_PERCENTILES,
+        "statistic the number of sets coalesced into each multi_put");
+}
+
+request_coalescer::~request_coalescer()
+{
+    _tracker.cancel_outstanding_tasks();
+    _pfc_coalesced_get_batch_size.clear();
+    _pfc_coalesced_set_batch_size.clear();
+}
+
+void request_coalescer::close()
+{
+    {
+        ::dsn::zauto_lock l(_lock);
+        _closed = true;
+    }
+    _tracker.cancel_outstanding_tasks();
+    flush();
+}
+
+bool request_coalescer::add_get(const std::string &hash_key,
+                                const std::string &sort_key,
+                                pegasus_client::async_get_callback_t &callback,
+                                int timeout_milliseconds)
+{
+    if (!FLAGS_coalesce_single_key_requests) {
+        return false;
+    }
+
+    // The partition count is unknown before the route cache of the table is filled.
+    const int partition_count = _client->_client->get_partition_count();
+    if (partition_count <= 0) {
+        return false;
+    }
+
+    pending_get get;
+    get.hash_key = hash_key;
+    get.sort_key = sort_key;
+    get.callback = std::move(callback);
+    ::dsn::blob key;
+    pegasus_generate_key(key, hash_key, sort_key);
+    const int partition_index = dsn::replication::partition_resolver::get_partition_index(
+        partition_count, pegasus_key_hash(key));
+    const get_batch_key batch_key(partition_index, timeout_milliseconds);
+
+    std::vector<pending_get> full_batch;
+    {
+        ::dsn::zauto_lock l(_lock);
+        if (_closed) {
+            callback = std::move(get.callback);
+            return false;
+        }
+        auto &gets = _pending_gets[batch_key];
+        gets.emplace_back(std::move(get));
+        if (gets.size() >= FLAGS_coalesce_max_batch_size) {
+            full_batch = std::move(gets);
+            _pending_gets.erase(batch_key);
+        } else {
+            schedule_flush();
+        }
+    }
+
+    if (!full_batch.empty()) {
+        send_gets(partition_index, timeout_milliseconds, std::move(full_batch));
+    }
+    return true;
+}
+
+bool request_coalescer::add_set(const std::string &hash_key,
+                                const std::string &sort_key,
+                                const std::string &value,
+                                pegasus_client::async_set_callback_t &callback,
+                                int timeout_milliseconds,
+                                int ttl_seconds)
+{
+    // multi_put requires a non-empty hash key.
+    if (!FLAGS_coalesce_single_key_requests || hash_key.empty()) {
+        return false;
+    }
+
+    pending_set set;
+    set.sort_key = sort_key;
+    set.value = value;
+    set.callback = std::move(callback);
+    const size_t bytes = sort_key.size() + value.size();
+    set_batch_key batch_key(hash_key, timeout_milliseconds, ttl_seconds);
+
+    std::vector<pending_set> full_batch;
+    {
+        ::dsn::zauto_lock l(_lock);
+        if (_closed) {
+            callback = std::move(set.callback);
+            return false;
+        }
+        auto &batch = _pending_sets[batch_key];
+        batch.sets.emplace_back(std::move(set));
+        batch.bytes += bytes;
+        if (batch.sets.size() >= FLAGS_coalesce_max_batch_size ||
+            batch.bytes >= FLAGS_coalesce_max_batch_bytes) {
+            full_batch = std::move(batch.sets);
+            _pending_sets.erase(batch_key);
+        } else {
+            schedule_flush();
+        }
+    }
+
+    if (!full_batch.empty()) {
+        send_sets(batch_key, std::move(full_batch));
+    }
+    return true;
+}
+
+void request_coalescer::schedule_flush()
+{
+    if (_flush_scheduled) {
+        return;
+    }
+
+    _flush_scheduled = true;
+    ::dsn::tasking::enqueue(LPC_PEGASUS_CLIENT_COALESCE_FLUSH,
+                            &_tracker,
+                            [this]() { flush(); },
+                            0,
+                            std::chrono::milliseconds(FLAGS_coalesce_flush_delay_ms));
+}
+
+void request_coalescer::flush()
+{
+    std::map<get_batch_key, std::vector<pending_get>> pending_gets;
+    std::map<set_batch_key, set_batch> pending_sets;
+    {
+        ::dsn::zauto_lock l(_lock);
+        pending_gets.swap(_pending_gets);
+        pending_sets.swap(_pending_sets);
+        _flush_scheduled = false;
+    }
+
+    for (auto &gets : pending_gets) {
+        send_gets(gets.first.first, gets.first.second, std::move(gets.second));
+    }
+    for (auto &sets : pending_sets) {
+        send_sets(sets.first, std::move(sets.second.sets));
+    }
+}
+
+void request_coalescer::send_gets(int partition_index,
+                                  int timeout_milliseconds,
+                                  std::vector<pending_get> gets)
+{
+    _pfc_coalesced_get_batch_size->set(gets.size());
+    if (gets.size() == 1) {
+        auto &get = gets.front();
+        _client->async_get_uncoalesced(
+            get.hash_key, get.sort_key, std::move(get.callback), timeout_milliseconds);
+        return;
+    }
+
+    ::dsn::apps::batch_get_request req;
+    req.keys.reserve(gets.size());
+    for (const auto &get : gets) {
+        ::dsn::apps::full_key key;
+        key.hash_key = ::dsn::blob::create_from_bytes(get.hash_key.data(), get.hash_key.size());
+        key.sort_key = ::dsn::blob::create_from_bytes(get.sort_key.data(), get.sort_key.size());
+        req.keys.emplace_back(std::move(key));
+    }
+    ::dsn::blob first_key;
+    pegasus_generate_key(first_key, gets.front().hash_key, gets.front().sort_key);
+    const auto partition_hash = pegasus_key_hash(first_key);
+
+    auto on_batch_get_reply =
+        [self = shared_from_this(), partition_index, timeout_milliseconds, gets = std::move(gets)](
+            ::dsn::error_code err, dsn::message_ex *, dsn::message_ex *resp) mutable {
+            pegasus_client::internal_info info;
+            ::dsn::apps::batch_get_response response;
+            int served_partition_index = -1;
+            if (err == ::dsn::ERR_OK) {
+                ::dsn::unmarshall(resp, response);
+                info.app_id = response.app_id;
+                info.partition_index = response.partition_index;
+                info.server = response.server;
+                if (response.error == 0) {
+                    served_partition_index = response.partition_index;
+                }
+            }
+
+            if (dsn_unlikely(dsn::replication::partitioned_batch::should_split(
+                    err, partition_index, served_partition_index))) {
+                LOG_INFO("batch_get of partition {} was served by partition {} with error {}, "
+                         "send the {} gets again by their hashes",
+                         partition_index,
+                         served_partition_index,
+                         err,
+                         gets.size());
+                auto groups = dsn::replication::partitioned_batch::group(
+                    gets.size(), -1, [&gets](size_t i) {
+                        ::dsn::blob key;
+                        pegasus_generate_key(key, gets[i].hash_key, gets[i].sort_key);
+                        return pegasus_key_hash(key);
+                    });
+                for (const auto &group : groups) {
+                    std::vector<pending_get> group_gets;
+                    group_gets.reserve(group.second.size());
+                    for (const auto i : group.second) {
+                        group_gets.emplace_back(std::move(gets[i]));
+                    }
+                    self->send_gets(-1, timeout_milliseconds, std::move(group_gets));
+                }
+                return;
+            }
+
+            const int ret = pegasus_client_impl::get_client_error(
+                err == ::dsn::ERR_OK
+                    ? pegasus_client_impl::get_rocksdb_server_error(response.error)
+                    : int(err));
+            dsn::replication::partitioned_batch::match_in_order(
+                gets,
+                response.data,
+                [](const pending_get &get, const ::dsn::apps::full_data &data) {
+                    return data.hash_key.to_string_view() == get.hash_key &&
+                           data.sort_key.to_string_view() == get.sort_key;
+                },
+                [ret, &info](const pending_get &get, const ::dsn::apps::full_data *data) {
+                    int get_ret = ret;
+                    std::string value;
+                    if (ret == PERR_OK) {
+                        if (data != nullptr) {
+                            value.assign(data->value.data(), data->value.length());
+                        } else {
+                            get_ret = PERR_NOT_FOUND;
+                        }
+                    }
+                    if (get.callback != nullptr) {
+                        get.callback(
+                            get_ret, std::move(value), pegasus_client::internal_info(info));
+                    }
+                });
+        };
+    _client->_client->batch_get(req,
+                                std::move(on_batch_get_reply),
+                                std::chrono::milliseconds(timeout_milliseconds),
+                                partition_hash);
+}
+
+void request_coalescer::send_sets(const set_batch_key &key, std::vector<pending_set> sets)
+{
+    const auto &hash_key = std::get<0>(key);
+    const int timeout_milliseconds = std::get<1>(key);
+    const int ttl_seconds = std::get<2>(key);
+
+    _pfc_coalesced_set_batch_size->set(sets.size());
+    if (sets.size() == 1) {
+        auto &set = sets.front();
+        _client->async_set_uncoalesced(hash_key,
+                                       set.sort_key,
+                                       set.value,
+                                       std::move(set.callback),
+                                       timeout_milliseconds,
+                                       ttl_seconds);
+        return;
+    }
+
+    // The sets of the same sort key are applied in order by the server.
+    ::dsn::apps::multi_put_request req;
+    req.hash_key = ::dsn::blob::create_from_bytes(hash_key.data(), hash_key.size());
+    req.kvs.reserve(sets.size());
+    std::vector<pegasus_client::async_set_callback_t> callbacks;
+    callbacks.reserve(sets.size());
+    for (auto &set : sets) {
+        ::dsn::apps::key_value kv;
+        kv.key = ::dsn::blob::create_from_bytes(std::move(set.sort_key));
+        kv.value = ::dsn::blob::create_from_bytes(std::move(set.value));
+        req.kvs.emplace_back(std::move(kv));
+        callbacks.emplace_back(std::move(set.callback));
+    }
+    req.expire_ts_seconds = ttl_seconds == 0 ? 0 : ttl_seconds + utils::epoch_now();
+
+    ::dsn::blob tmp_key;
+    pegasus_generate_key(tmp_key, req.hash_key, ::dsn::blob());
+    const auto partition_hash = pegasus_key_hash(tmp_key);
+
+    auto on_multi_put_reply = [callbacks = std::move(callbacks)](
+        ::dsn::error_code err, dsn::message_ex *, dsn::message_ex *resp) {
+        pegasus_client::internal_info info;
+        ::dsn::apps::update_response response;
+        if (err == ::dsn::ERR_OK) {
+            ::dsn::unmarshall(resp, response);
+            info.app_id = response.app_id;
+            info.partition_index = response.partition_index;
+            info.decree = response.decree;
+            info.server = response.server;
+        }
+        const int ret = pegasus_client_impl::get_client_error(
+            err == ::dsn::ERR_OK ? pegasus_client_impl::get_rocksdb_server_error(response.error)
+                                 : int(err));
+        for (const auto &callback : callbacks) {
+            if (callback != nullptr) {
+                callback(ret, pegasus_client::internal_info(info));
+            }
+        }
+    };
+    _client->_client->multi_put(req,
+                                std::move(on_multi_put_reply),
+                                std::chrono::milliseconds(timeout_milliseconds),
+                                partition_hash);
+}
+
+} // namespace client
+} // namespace pegasus
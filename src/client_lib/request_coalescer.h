@@ -0,0 +1,125 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#pragma once
+
+#include <pegasus/client.h>
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "perf_counter/perf_counter_wrapper.h"
+#include "runtime/task/task_tracker.h"
+#include "utils/zlocks.h"
+
+namespace pegasus {
+namespace client {
+class pegasus_client_impl;
+
+// Coalesces the concurrent single-key requests of a pegasus_client_impl, so that thousands of
+// tiny operations do not pay the full per-RPC overhead each:
+// - the gets of the same partition are sent in a single batch_get;
+// - the sets of the same non-empty hash key are sent in a single multi_put.
+//
+// The requests are grouped by their timeouts (and ttls of the sets) as well, so each of them is
+// sent with its own options. A group is flushed once it is full, or FLAGS_coalesce_flush_delay_ms
+// after the first request is added, and the callbacks of the requests are completed one by one
+// on the reply. A group with a single request is sent as it is.
+//
+// The coalesced sets of the same hash key are applied in the order they are added, while there
+// is no order between the coalesced requests and the others, just like the concurrent requests.
+//
+// The callbacks of the in-flight batches hold the coalescer by shared_ptr, thus it may outlive
+// close(), but never the client, whose RPCs are cancelled once it is destroyed.
+//
+// Thread safe.
+class request_coalescer : public std::enable_shared_from_this<request_coalescer>
+{
+public:
+    explicit request_coalescer(pegasus_client_impl *client);
+    ~request_coalescer();
+
+    // Send all the pending requests, and stop coalescing the following ones. It should be called
+    // before the client is destroyed.
+    void close();
+
+    // Returns false if the request is not coalesced, in which case `callback` is not moved and
+    // the request should be sent by the caller.
+    bool add_get(const std::string &hash_key,
+                 const std::string &sort_key,
+                 pegasus_client::async_get_callback_t &callback,
+                 int timeout_milliseconds);
+    bool add_set(const std::string &hash_key,
+                 const std::string &sort_key,
+                 const std::string &value,
+                 pegasus_client::async_set_callback_t &callback,
+                 int timeout_milliseconds,
+                 int ttl_seconds);
+
+    // Send all the pending requests at once.
+    void flush();
+
+private:
+    struct pending_get
+    {
+        std::string hash_key;
+        std::string sort_key;
+        pegasus_client::async_get_callback_t callback;
+    };
+    struct pending_set
+    {
+        std::string sort_key;
+        std::string value;
+        pegasus_client::async_set_callback_t callback;
+    };
+    struct set_batch
+    {
+        std::vector<pending_set> sets;
+        size_t bytes = 0;
+    };
+
+    // (partition index, timeout)
+    using get_batch_key = std::pair<int, int>;
+    // (hash key, timeout, ttl)
+    using set_batch_key = std::tuple<std::string, int, int>;
+
+    void schedule_flush();
+    void send_gets(int partition_index, int timeout_milliseconds, std::vector<pending_get> gets);
+    void send_sets(const set_batch_key &key, std::vector<pending_set> sets);
+
+    pegasus_client_impl *_client;
+
+    ::dsn::zlock _lock;
+    std::map<get_batch_key, std::vector<pending_get>> _pending_gets;
+    std::map<set_batch_key, set_batch> _pending_sets;
+    bool _flush_scheduled;
+    bool _closed;
+
+    ::dsn::task_tracker _tracker;
+
+    ::dsn::perf_counter_wrapper _pfc_coalesced_get_batch_size;
+    ::dsn::perf_counter_wrapper _pfc_coalesced_set_batch_size;
+};
+
+} // namespace client
+} // namespace pegasus
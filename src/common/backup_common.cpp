@@ -29,6 +29,7 @@ const std::string cold_backup_constant::APP_BACKUP_STATUS("app_backup_status");
 const std::string cold_backup_constant::CURRENT_CHECKPOINT("current_checkpoint");
 const std::string cold_backup_constant::BACKUP_METADATA("backup_metadata");
 const std::string cold_backup_constant::BACKUP_INFO("backup_info");
+const std::string cold_backup_constant::SHARED_FILES("shared_files");
 const int32_t cold_backup_constant::PROGRESS_FINISHED = 1000;
 
 const std::string backup_restore_constant::FORCE_RESTORE("restore.force_restore");
@@ -123,6 +124,20 @@ std::string get_remote_chkpt_meta_file(const std::string &root,
            cold_backup_constant::BACKUP_METADATA;
 }
 
+std::string get_replica_shared_files_dir(const std::string &root,
+                                         const std::string &app_name,
+                                         gpid pid)
+{
+    std::string str_app = app_name + "_" + std::to_string(pid.get_app_id());
+    return root + "/" + cold_backup_constant::SHARED_FILES + "/" + str_app + "/" +
+           std::to_string(pid.get_partition_index());
+}
+
+std::string get_shared_file_name(const std::string &name, int64_t size, const std::string &md5)
+{
+    return fmt::format("{}_{}_{}", name, size, md5);
+}
+
 } // namespace cold_backup
 } // namespace replication
 } // namespace dsn
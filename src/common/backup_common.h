@@ -19,7 +19,10 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
+#include "common/json_helper.h"
+#include "metadata_types.h"
 #include "runtime/rpc/rpc_holder.h"
 
 namespace dsn {
@@ -37,11 +40,25 @@ public:
     static const std::string CURRENT_CHECKPOINT;
     static const std::string BACKUP_METADATA;
     static const std::string BACKUP_INFO;
+    static const std::string SHARED_FILES;
     static const int32_t PROGRESS_FINISHED;
 };
 
 typedef rpc_holder<backup_request, backup_response> backup_rpc;
 
+struct cold_backup_metadata
+{
+    int64_t checkpoint_decree;
+    int64_t checkpoint_timestamp;
+    std::vector<file_meta> files;
+    int64_t checkpoint_total_size;
+    // names of the files which are stored content-addressed in the shared files dir rather than
+    // in the checkpoint dir, only set by incremental backup
+    std::vector<std::string> shared_files;
+    DEFINE_JSON_SERIALIZATION(
+        checkpoint_decree, checkpoint_timestamp, files, checkpoint_total_size, shared_files)
+};
+
 class backup_restore_constant
 {
 public:
@@ -80,6 +97,7 @@ namespace cold_backup {
 //                                        /partition_1/checkpoint@ip:port/backup_metadata
 //                                        /partition_1/current_checkpoint
 //      <root>/<backup_id>/backup_info
+//      <root>/shared_files/<appname_appid>/<partition_index>/<name>_<size>_<md5>
 //
 
 //
@@ -92,6 +110,10 @@ namespace cold_backup {
 //         file's name, size and md5
 //      4, current_checkpoint : specifing which checkpoint directory is valid
 //      5, backup_info : recording the information of this backup
+//      6, shared_files : the content-addressed sst files shared by all the backups under the root,
+//         only used by incremental backup, backup_metadata records which files are stored here,
+//         the files not referenced by any backup_metadata are removed once a policy removes an
+//         expired backup
 //
 
 // compose the path for app on block service
@@ -187,6 +209,23 @@ std::string get_remote_chkpt_meta_file(const std::string &root,
                                        gpid pid,
                                        int64_t backup_id);
 
+// compose the absolute path(AP) of the directory which holds the content-addressed files shared
+// by all the incremental backups of a replica on block service
+// input:
+//  -- root:       the prefix of the AP
+//  -- pid:          gpid of replcia
+// return:
+//      the AP of the shared files dir:
+//      <root>/shared_files/<appname_appid>/<partition_index>
+std::string get_replica_shared_files_dir(const std::string &root,
+                                         const std::string &app_name,
+                                         gpid pid);
+
+// compose the content-addressed name of a shared file on block service
+// return:
+//      the shared file name: <name>_<size>_<md5>
+std::string get_shared_file_name(const std::string &name, int64_t size, const std::string &md5);
+
 } // namespace cold_backup
 } // namespace replication
 } // namespace dsn
@@ -101,6 +101,12 @@ struct prepare_ack
     8:optional i64        response_timestamp;
 }
 
+// The reply of RPC_PREPARE_BATCH, which holds an ack for each of the batched mutations.
+struct prepare_batch_ack
+{
+    1:list<prepare_ack>   acks;
+}
+
 enum learn_type
 {
     LT_INVALID,
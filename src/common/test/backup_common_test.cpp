@@ -0,0 +1,40 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string>
+
+#include "common/backup_common.h"
+#include "common/gpid.h"
+#include "gtest/gtest.h"
+
+namespace dsn {
+namespace replication {
+
+TEST(backup_common, get_replica_shared_files_dir)
+{
+    ASSERT_EQ("root/shared_files/temp_2/3",
+              cold_backup::get_replica_shared_files_dir("root", "temp", gpid(2, 3)));
+}
+
+TEST(backup_common, get_shared_file_name)
+{
+    ASSERT_EQ("000012.sst_4096_0123abcd",
+              cold_backup::get_shared_file_name("000012.sst", 4096, "0123abcd"));
+}
+
+} // namespace replication
+} // namespace dsn
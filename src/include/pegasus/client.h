@@ -27,6 +27,7 @@
 #include <pegasus/error.h>
 #include <functional>
 #include <memory>
+#include <utility>
 
 #include "utils/fmt_utils.h"
 
@@ -256,6 +257,7 @@ public:
         bool no_value; // only fetch hash_key and sort_key, but not fetch value
         bool return_expire_ts;
         bool only_return_count;
+        bool return_stat; // only valid if only_return_count is true, see get_batch_stats()
         scan_options()
             : timeout_ms(5000),
               batch_size(100),
@@ -265,7 +267,8 @@ public:
               sort_key_filter_type(FT_NO_FILTER),
               no_value(false),
               return_expire_ts(false),
-              only_return_count(false)
+              only_return_count(false),
+              return_stat(false)
         {
         }
         scan_options(const scan_options &o)
@@ -279,11 +282,45 @@ public:
               sort_key_filter_pattern(o.sort_key_filter_pattern),
               no_value(o.no_value),
               return_expire_ts(o.return_expire_ts),
-              only_return_count(o.only_return_count)
+              only_return_count(o.only_return_count),
+              return_stat(o.return_stat)
         {
         }
     };
 
+    // The statistics aggregated by the server over the k-v pairs counted in a batch, the layout
+    // of the histograms is described in src/base/pegasus_scan_stat.h.
+    struct scan_stats
+    {
+        int64_t hash_key_count; // the hash keys whose first k-v pair is in this batch
+        int64_t hash_key_size_sum;
+        int64_t sort_key_size_sum;
+        int64_t value_size_sum;
+        std::vector<int64_t> row_size_histogram;
+        std::vector<int64_t> ttl_histogram;
+        scan_stats()
+            : hash_key_count(0), hash_key_size_sum(0), sort_key_size_sum(0), value_size_sum(0)
+        {
+        }
+    };
+
+    // A k-v pair of any hash key, see async_batch_set_any().
+    struct full_key_value
+    {
+        std::string hash_key;
+        std::string sort_key;
+        std::string value;
+    };
+
+    // The result of a key in async_batch_get_any() or async_batch_set_any().
+    struct batch_any_result
+    {
+        int error;         // the error of the request which the key was sent by
+        std::string value; // the value got by async_batch_get_any()
+        internal_info info;
+        batch_any_result() : error(0) {}
+    };
+
     class pegasus_scanner;
 
     // define callback function types for asynchronous operations.
@@ -325,6 +362,8 @@ public:
         async_get_scanner_callback_t;
     typedef std::function<void(int /*error_code*/, std::vector<pegasus_scanner *> && /*scanners*/)>
         async_get_unordered_scanners_callback_t;
+    typedef std::function<void(int /*error_code*/, std::vector<batch_any_result> && /*results*/)>
+        async_batch_any_callback_t;
 
     class abstract_pegasus_scanner
     {
@@ -365,6 +404,18 @@ public:
         ///
         virtual int next(int32_t &count, internal_info *info = nullptr) = 0;
 
+        ///
+        /// \brief get the statistics of the batch whose count is just got
+        /// only used for scanner which options only_return_count and return_stat are true,
+        /// and it should be called in the callback of async_next() or right after next(count)
+        /// returned, before the next batch is requested
+        /// \param stats
+        /// the statistics aggregated by the server
+        /// \return
+        /// bool, false if the server doesn't support aggregating statistics
+        ///
+        virtual bool get_batch_stats(scan_stats &stats) const = 0;
+
         ///
         /// \brief async get the next key-value pair of this scanner
         /// thread-safe
@@ -419,6 +470,20 @@ public:
     ///
     virtual const char *get_app_name() const = 0;
 
+    ///
+    /// \brief set_hedged_read_enabled
+    ///     opt the app in or out of the hedged reads, which is disabled by default.
+    ///     once enabled, the slow asynchronous point reads (async_get, async_multi_get,
+    ///     async_sortkey_count, async_ttl and async_batch_get_any) of the app are hedged by
+    ///     backup requests to the secondaries, see [hedged_read] in the config. the responses
+    ///     of the secondaries may be staler than the primaries.
+    ///     it applies to all the clients of the app in the process.
+    ///     the default implementation does nothing.
+    /// \param enabled
+    /// whether to hedge the reads of the app.
+    ///
+    virtual void set_hedged_read_enabled(bool enabled) {}
+
     ///
     /// \brief set
     ///     store the k-v to the cluster.
@@ -1179,6 +1244,61 @@ public:
                                  const scan_options &options,
                                  async_get_unordered_scanners_callback_t &&callback) = 0;
 
+    ///
+    /// \brief asynchronous batch get of any keys
+    ///     get the values of the <hashkey,sortkey> pairs which may belong to different partitions.
+    ///     the keys are split into a batch_get request per partition (of at most
+    ///     [pegasus.client] batch_any_max_keys_per_request keys), which are sent in parallel.
+    ///     the default implementation gets the keys one by one by async_get() instead.
+    ///     will not be blocked, return immediately.
+    /// \param keys
+    /// the <hashkey,sortkey> pairs to get.
+    /// \param callback
+    /// the callback function will be invoked after all the requests finished or error occurred.
+    /// the results are in the same order as the keys, the error of each one is PERR_OK if it is
+    /// found, PERR_NOT_FOUND if not, or the error of the request which it was sent by.
+    /// the error_code is PERR_OK if all the requests succeeded, otherwise the first error of
+    /// the results.
+    /// \param max_concurrency
+    /// max count of the requests in flight at the same time.
+    /// \param timeout_milliseconds
+    /// if wait longer than this value for a request, its keys will return time out error
+    ///
+    virtual void async_batch_get_any(const std::vector<std::pair<std::string, std::string>> &keys,
+                                     async_batch_any_callback_t &&callback,
+                                     int max_concurrency = 8,
+                                     int timeout_milliseconds = 5000);
+
+    ///
+    /// \brief asynchronous batch set of any k-v pairs
+    ///     store the k-v pairs which may belong to different partitions to the cluster.
+    ///     the pairs are split into a multi_put request per hash key (of at most
+    ///     [pegasus.client] batch_any_max_keys_per_request pairs), which are sent in parallel.
+    ///     there is no atomicity across the requests, and if a key is set more than once, which
+    ///     value is stored is undefined unless they are sent by the same request.
+    ///     the default implementation sets the pairs one by one by async_set() instead.
+    ///     will not be blocked, return immediately.
+    /// \param kvs
+    /// the k-v pairs to set.
+    /// \param callback
+    /// the callback function will be invoked after all the requests finished or error occurred.
+    /// the results are in the same order as the pairs, the error of each one is the error of
+    /// the request which it was sent by.
+    /// the error_code is PERR_OK if all the requests succeeded, otherwise the first error of
+    /// the results.
+    /// \param max_concurrency
+    /// max count of the requests in flight at the same time.
+    /// \param timeout_milliseconds
+    /// if wait longer than this value for a request, its pairs will return time out error
+    /// \param ttl_seconds
+    /// time to live of the values, if expired, will return not found; 0 means no ttl
+    ///
+    virtual void async_batch_set_any(const std::vector<full_key_value> &kvs,
+                                     async_batch_any_callback_t &&callback,
+                                     int max_concurrency = 8,
+                                     int timeout_milliseconds = 5000,
+                                     int ttl_seconds = 0);
+
     ///
     /// \brief get_error_string
     /// get error string
@@ -47,6 +47,12 @@ public:
     }
     ~rrdb_client() { _tracker.cancel_outstanding_tasks(); }
 
+    // The partition count of the app in the local route cache, -1 if it is unknown yet.
+    int get_partition_count() const { return _resolver->get_partition_count(); }
+
+    // Opts the app in or out of the hedged reads, see partition_resolver::call_task_hedged().
+    void set_hedged_read_enabled(bool enabled) { _resolver->set_hedged_read_enabled(enabled); }
+
     // ---------- call RPC_RRDB_RRDB_PUT ------------
     // - synchronous
     std::pair<::dsn::error_code, update_response>
@@ -268,13 +274,13 @@ public:
                         uint64_t request_partition_hash,
                         int reply_thread_hash = 0)
     {
-        return _resolver->call_op(RPC_RRDB_RRDB_GET,
-                                  args,
-                                  &_tracker,
-                                  std::forward<TCallback>(callback),
-                                  timeout,
-                                  request_partition_hash,
-                                  reply_thread_hash);
+        return _resolver->call_read_op(RPC_RRDB_RRDB_GET,
+                                       args,
+                                       &_tracker,
+                                       std::forward<TCallback>(callback),
+                                       timeout,
+                                       request_partition_hash,
+                                       reply_thread_hash);
     }
 
     // ---------- call RPC_RRDB_RRDB_MULTI_GET ------------
@@ -294,13 +300,13 @@ public:
                               uint64_t request_partition_hash,
                               int reply_thread_hash = 0)
     {
-        return _resolver->call_op(RPC_RRDB_RRDB_MULTI_GET,
-                                  args,
-                                  &_tracker,
-                                  std::forward<TCallback>(callback),
-                                  timeout,
-                                  request_partition_hash,
-                                  reply_thread_hash);
+        return _resolver->call_read_op(RPC_RRDB_RRDB_MULTI_GET,
+                                       args,
+                                       &_tracker,
+                                       std::forward<TCallback>(callback),
+                                       timeout,
+                                       request_partition_hash,
+                                       reply_thread_hash);
     }
 
     // ---------- call RPC_RRDB_RRDB_BATCH_GET ------------
@@ -320,13 +326,13 @@ public:
                               uint64_t request_partition_hash,
                               int reply_thread_hash = 0)
     {
-        return _resolver->call_op(RPC_RRDB_RRDB_BATCH_GET,
-                                  args,
-                                  &_tracker,
-                                  std::forward<TCallback>(callback),
-                                  timeout,
-                                  request_partition_hash,
-                                  reply_thread_hash);
+        return _resolver->call_read_op(RPC_RRDB_RRDB_BATCH_GET,
+                                       args,
+                                       &_tracker,
+                                       std::forward<TCallback>(callback),
+                                       timeout,
+                                       request_partition_hash,
+                                       reply_thread_hash);
     }
 
     // ---------- call RPC_RRDB_RRDB_SORTKEY_COUNT ------------
@@ -351,13 +357,13 @@ public:
                                   uint64_t request_partition_hash,
                                   int reply_thread_hash = 0)
     {
-        return _resolver->call_op(RPC_RRDB_RRDB_SORTKEY_COUNT,
-                                  args,
-                                  &_tracker,
-                                  std::forward<TCallback>(callback),
-                                  timeout,
-                                  request_partition_hash,
-                                  reply_thread_hash);
+        return _resolver->call_read_op(RPC_RRDB_RRDB_SORTKEY_COUNT,
+                                       args,
+                                       &_tracker,
+                                       std::forward<TCallback>(callback),
+                                       timeout,
+                                       request_partition_hash,
+                                       reply_thread_hash);
     }
 
     // ---------- call RPC_RRDB_RRDB_TTL ------------
@@ -377,13 +383,13 @@ public:
                         uint64_t request_partition_hash,
                         int reply_thread_hash = 0)
     {
-        return _resolver->call_op(RPC_RRDB_RRDB_TTL,
-                                  args,
-                                  &_tracker,
-                                  std::forward<TCallback>(callback),
-                                  timeout,
-                                  request_partition_hash,
-                                  reply_thread_hash);
+        return _resolver->call_read_op(RPC_RRDB_RRDB_TTL,
+                                       args,
+                                       &_tracker,
+                                       std::forward<TCallback>(callback),
+                                       timeout,
+                                       request_partition_hash,
+                                       reply_thread_hash);
     }
 
     // ---------- call RPC_RRDB_RRDB_GET_SCANNER ------------
@@ -39,6 +39,7 @@
 #include "app_balance_policy.h"
 #include "cluster_balance_policy.h"
 #include "greedy_load_balancer.h"
+#include "meta/load_aware_balance_policy.h"
 #include "meta/load_balance_policy.h"
 #include "meta/meta_service.h"
 #include "meta/server_load_balancer.h"
@@ -55,6 +56,12 @@
 
 DSN_DEFINE_bool(meta_server, balance_cluster, false, "whether to enable cluster balancer");
 DSN_TAG_VARIABLE(balance_cluster, FT_MUTABLE);
+DSN_DEFINE_bool(meta_server,
+                balance_by_load,
+                false,
+                "whether to balance the nodes by the read/write capacity units, network bytes and "
+                "storage bytes of their replicas rather than the replica counts");
+DSN_TAG_VARIABLE(balance_by_load, FT_MUTABLE);
 
 DSN_DECLARE_uint64(min_live_node_count_for_unfreeze);
 
@@ -67,6 +74,7 @@ greedy_load_balancer::greedy_load_balancer(meta_service *_svc) : server_load_bal
 {
     _app_balance_policy = std::make_unique<app_balance_policy>(_svc);
     _cluster_balance_policy = std::make_unique<cluster_balance_policy>(_svc);
+    _load_aware_balance_policy = std::make_unique<load_aware_balance_policy>(_svc);
     _all_replca_infos_collected = false;
 
     ::memset(t_operation_counters, 0, sizeof(t_operation_counters));
@@ -170,7 +178,9 @@ void greedy_load_balancer::greedy_balancer(const bool balance_checker)
     }
 
     load_balance_policy *balance_policy = nullptr;
-    if (!FLAGS_balance_cluster) {
+    if (FLAGS_balance_by_load) {
+        balance_policy = _load_aware_balance_policy.get();
+    } else if (!FLAGS_balance_cluster) {
         balance_policy = _app_balance_policy.get();
     } else if (!balance_checker) {
         balance_policy = _cluster_balance_policy.get();
@@ -0,0 +1,593 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "meta/load_aware_balance_policy.h"
+
+#include <nlohmann/json.hpp>
+#include <nlohmann/json_fwd.hpp>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include "common/replication_other_types.h"
+#include "dsn.layer2_types.h"
+#include "metadata_types.h"
+#include "runtime/api_layer1.h"
+#include "runtime/rpc/dns_resolver.h"
+#include "runtime/rpc/rpc_address.h"
+#include "utils/flags.h"
+#include "utils/fmt_logging.h"
+
+DSN_DEFINE_double(meta_server,
+                  load_balance_read_cu_weight,
+                  1.0,
+                  "The weight of the read capacity units per second in the load of replicas for "
+                  "the load-aware balancer");
+DSN_TAG_VARIABLE(load_balance_read_cu_weight, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_read_cu_weight, [](double value) -> bool { return value >= 0; });
+
+DSN_DEFINE_double(meta_server,
+                  load_balance_write_cu_weight,
+                  1.0,
+                  "The weight of the write capacity units per second in the load of replicas for "
+                  "the load-aware balancer");
+DSN_TAG_VARIABLE(load_balance_write_cu_weight, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_write_cu_weight, [](double value) -> bool { return value >= 0; });
+
+DSN_DEFINE_double(meta_server,
+                  load_balance_network_bytes_weight,
+                  0.5,
+                  "The weight of the request bytes per second in the load of replicas for the "
+                  "load-aware balancer");
+DSN_TAG_VARIABLE(load_balance_network_bytes_weight, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_network_bytes_weight,
+                     [](double value) -> bool { return value >= 0; });
+
+DSN_DEFINE_double(meta_server,
+                  load_balance_storage_bytes_weight,
+                  0.5,
+                  "The weight of the storage bytes in the load of replicas for the load-aware "
+                  "balancer");
+DSN_TAG_VARIABLE(load_balance_storage_bytes_weight, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_storage_bytes_weight,
+                     [](double value) -> bool { return value >= 0; });
+
+DSN_DEFINE_double(meta_server,
+                  load_balance_imbalance_ratio,
+                  0.1,
+                  "The load-aware balancer relieves the nodes whose loads exceed the mean by this "
+                  "ratio");
+DSN_TAG_VARIABLE(load_balance_imbalance_ratio, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_imbalance_ratio, [](double value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint32(meta_server,
+                  load_balance_max_moves_per_round,
+                  10,
+                  "The max number of the partitions moved by each round of the load-aware "
+                  "balancer");
+DSN_TAG_VARIABLE(load_balance_max_moves_per_round, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_max_moves_per_round,
+                     [](uint32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint64(meta_server,
+                  load_balance_max_copy_mb_per_round,
+                  10240,
+                  "The max total size in MB of the replicas copied by each round of the "
+                  "load-aware balancer");
+DSN_TAG_VARIABLE(load_balance_max_copy_mb_per_round, FT_MUTABLE);
+
+DSN_DEFINE_uint64(meta_server,
+                  load_balance_copy_cost_unit_mb,
+                  1024,
+                  "The size in MB of the copied replica which halves the benefit of a move for "
+                  "the load-aware balancer, moving a primary copies nothing and thus is preferred");
+DSN_TAG_VARIABLE(load_balance_copy_cost_unit_mb, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_copy_cost_unit_mb,
+                     [](uint64_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_double(meta_server,
+                  load_balance_min_copied_load_ratio,
+                  0.2,
+                  "A replica is copied by the load-aware balancer only if its load is at least "
+                  "this ratio of the mean load of the nodes, since copying data is expensive");
+DSN_TAG_VARIABLE(load_balance_min_copied_load_ratio, FT_MUTABLE);
+DSN_DEFINE_validator(load_balance_min_copied_load_ratio,
+                     [](double value) -> bool { return value >= 0; });
+
+namespace dsn {
+namespace replication {
+namespace {
+
+double weighted_load(double value, double mean, double weight)
+{
+    return mean > 0 ? weight * value / mean : 0;
+}
+
+} // anonymous namespace
+
+cluster_load::cluster_load(const meta_view &view)
+    : _mean_read_cu(0),
+      _mean_write_cu(0),
+      _mean_network_bytes(0),
+      _mean_storage_bytes(0),
+      _mean_node_load(0)
+{
+    struct raw_load
+    {
+        double read_cu = 0;
+        double write_cu = 0;
+        double network_bytes = 0;
+        double storage_bytes = 0;
+    };
+
+    std::map<host_port, raw_load> raw_loads;
+    raw_load total;
+    for (const auto &kv : *view.nodes) {
+        const node_state &ns = kv.second;
+        if (!ns.alive()) {
+            continue;
+        }
+
+        auto &raw = raw_loads[kv.first];
+        ns.for_each_partition([&](const gpid &pid) {
+            const config_context *cc = get_config_context(*view.apps, pid);
+            if (cc == nullptr) {
+                return true;
+            }
+            const auto iter = cc->find_from_serving(kv.first);
+            if (iter == cc->serving.end()) {
+                return true;
+            }
+            raw.read_cu += iter->load.read_cu;
+            raw.write_cu += iter->load.write_cu;
+            raw.network_bytes += iter->load.network_bytes;
+            raw.storage_bytes += iter->load.storage_bytes;
+            return true;
+        });
+
+        total.read_cu += raw.read_cu;
+        total.write_cu += raw.write_cu;
+        total.network_bytes += raw.network_bytes;
+        total.storage_bytes += raw.storage_bytes;
+    }
+
+    if (raw_loads.empty()) {
+        return;
+    }
+
+    const double node_count = raw_loads.size();
+    _mean_read_cu = total.read_cu / node_count;
+    _mean_write_cu = total.write_cu / node_count;
+    _mean_network_bytes = total.network_bytes / node_count;
+    _mean_storage_bytes = total.storage_bytes / node_count;
+
+    for (const auto &kv : raw_loads) {
+        const auto &raw = kv.second;
+        const double load =
+            weighted_load(raw.read_cu, _mean_read_cu, FLAGS_load_balance_read_cu_weight) +
+            weighted_load(raw.write_cu, _mean_write_cu, FLAGS_load_balance_write_cu_weight) +
+            weighted_load(
+                raw.network_bytes, _mean_network_bytes, FLAGS_load_balance_network_bytes_weight) +
+            weighted_load(
+                raw.storage_bytes, _mean_storage_bytes, FLAGS_load_balance_storage_bytes_weight);
+        _node_loads.emplace(kv.first, load);
+        _mean_node_load += load;
+    }
+    _mean_node_load /= node_count;
+}
+
+double cluster_load::get_replica_load(const replica_load &load) const
+{
+    return weighted_load(load.read_cu, _mean_read_cu, FLAGS_load_balance_read_cu_weight) +
+           weighted_load(load.write_cu, _mean_write_cu, FLAGS_load_balance_write_cu_weight) +
+           weighted_load(
+               load.network_bytes, _mean_network_bytes, FLAGS_load_balance_network_bytes_weight) +
+           weighted_load(
+               load.storage_bytes, _mean_storage_bytes, FLAGS_load_balance_storage_bytes_weight);
+}
+
+double cluster_load::get_node_load(const host_port &node) const
+{
+    const auto iter = _node_loads.find(node);
+    return iter == _node_loads.end() ? 0 : iter->second;
+}
+
+double cluster_load::max_to_median_ratio() const
+{
+    if (_node_loads.empty()) {
+        return 0;
+    }
+
+    std::vector<double> loads;
+    loads.reserve(_node_loads.size());
+    for (const auto &kv : _node_loads) {
+        loads.push_back(kv.second);
+    }
+    std::sort(loads.begin(), loads.end());
+
+    const size_t mid = loads.size() / 2;
+    const double median = loads.size() % 2 == 1 ? loads[mid] : (loads[mid - 1] + loads[mid]) / 2;
+    if (median <= 0) {
+        return loads.back() > 0 ? std::numeric_limits<double>::infinity() : 0;
+    }
+    return loads.back() / median;
+}
+
+std::string dump_cluster_load(const meta_view &view)
+{
+    nlohmann::json root;
+
+    std::map<host_port, int> node_indexes;
+    auto &nodes_json = root["nodes"] = nlohmann::json::array();
+    for (const auto &kv : *view.nodes) {
+        if (!kv.second.alive()) {
+            continue;
+        }
+        node_indexes.emplace(kv.first, node_indexes.size());
+        nodes_json.push_back(
+            {{"host_port", kv.first.to_string()},
+             {"address", dns_resolver::instance().resolve_address(kv.first).to_string()}});
+    }
+
+    auto &apps_json = root["apps"] = nlohmann::json::array();
+    for (const auto &kv : *view.apps) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE) {
+            continue;
+        }
+
+        nlohmann::json app_json = {{"app_id", app->app_id},
+                                   {"app_name", app->app_name},
+                                   {"app_type", app->app_type},
+                                   {"partition_count", app->partition_count},
+                                   {"max_replica_count", app->max_replica_count}};
+        auto &partitions_json = app_json["partitions"] = nlohmann::json::array();
+        for (int i = 0; i < app->partition_count; ++i) {
+            const partition_configuration &pc = app->partitions[i];
+            const config_context &cc = app->helpers->contexts[i];
+
+            nlohmann::json partition_json = {{"ballot", pc.ballot},
+                                             {"replicas", nlohmann::json::array()}};
+            auto &replicas_json = partition_json["replicas"];
+            auto dump_replica = [&](const host_port &node, bool is_primary) {
+                const auto node_index = node_indexes.find(node);
+                if (node_index == node_indexes.end()) {
+                    return;
+                }
+
+                nlohmann::json replica_json = {{"node", node_index->second},
+                                               {"primary", is_primary}};
+                const auto iter = cc.find_from_serving(node);
+                if (iter != cc.serving.end()) {
+                    replica_json["disk_tag"] = iter->disk_tag;
+                    replica_json["read_cu"] = iter->load.read_cu;
+                    replica_json["write_cu"] = iter->load.write_cu;
+                    replica_json["network_bytes"] = iter->load.network_bytes;
+                    replica_json["storage_bytes"] = iter->load.storage_bytes;
+                }
+                replicas_json.push_back(std::move(replica_json));
+            };
+
+            if (pc.hp_primary) {
+                dump_replica(pc.hp_primary, true);
+            }
+            for (const auto &secondary : pc.hp_secondaries) {
+                dump_replica(secondary, false);
+            }
+            partitions_json.push_back(std::move(partition_json));
+        }
+        apps_json.push_back(std::move(app_json));
+    }
+
+    return root.dump();
+}
+
+bool restore_cluster_load(const std::string &json, app_mapper &apps, node_mapper &nodes)
+{
+    apps.clear();
+    nodes.clear();
+
+    try {
+        const auto root = nlohmann::json::parse(json);
+
+        std::vector<host_port> node_list;
+        for (const auto &node_json : root.at("nodes")) {
+            const auto hp = host_port::from_string(node_json.at("address").get<std::string>());
+            if (!hp) {
+                LOG_ERROR("invalid node address: {}", node_json.dump());
+                return false;
+            }
+            node_list.push_back(hp);
+            get_node_state(nodes, hp, true)->set_alive(true);
+        }
+
+        for (const auto &app_json : root.at("apps")) {
+            app_info info;
+            info.status = app_status::AS_AVAILABLE;
+            info.is_stateful = true;
+            info.app_id = app_json.at("app_id").get<int32_t>();
+            info.app_name = app_json.at("app_name").get<std::string>();
+            info.app_type = app_json.at("app_type").get<std::string>();
+            info.partition_count = app_json.at("partition_count").get<int32_t>();
+            info.max_replica_count = app_json.at("max_replica_count").get<int32_t>();
+            const auto &partitions_json = app_json.at("partitions");
+            if (partitions_json.size() != static_cast<size_t>(info.partition_count)) {
+                LOG_ERROR("the partition count of app {} mismatches", info.app_name);
+                return false;
+            }
+
+            auto app = app_state::create(info);
+            for (int i = 0; i < info.partition_count; ++i) {
+                partition_configuration &pc = app->partitions[i];
+                config_context &cc = app->helpers->contexts[i];
+                pc.ballot = partitions_json[i].at("ballot").get<int64_t>();
+
+                for (const auto &replica_json : partitions_json[i].at("replicas")) {
+                    const auto &node = node_list.at(replica_json.at("node").get<size_t>());
+                    const bool is_primary = replica_json.at("primary").get<bool>();
+                    if (is_primary) {
+                        SET_IP_AND_HOST_PORT_BY_DNS(pc, primary, node);
+                    } else {
+                        ADD_IP_AND_HOST_PORT_BY_DNS(pc, secondaries, node);
+                    }
+                    nodes[node].put_partition(pc.pid, is_primary);
+
+                    serving_replica replica;
+                    replica.node = node;
+                    replica.disk_tag = replica_json.value("disk_tag", "");
+                    replica.compact_status = manual_compaction_status::IDLE;
+                    replica.load.read_cu = replica_json.value("read_cu", 0.0);
+                    replica.load.write_cu = replica_json.value("write_cu", 0.0);
+                    replica.load.network_bytes = replica_json.value("network_bytes", 0.0);
+                    replica.load.storage_bytes = replica_json.value("storage_bytes", int64_t(0));
+                    replica.load.measured_ballot = pc.ballot;
+                    replica.load.last_ballot = pc.ballot;
+                    replica.load.last_report_ms = dsn_now_ms();
+                    replica.storage_mb = replica.load.storage_bytes >> 20;
+                    cc.serving.push_back(std::move(replica));
+                }
+            }
+            apps.emplace(app->app_id, app);
+        }
+    } catch (const nlohmann::json::exception &exp) {
+        LOG_ERROR("restore cluster load from JSON failed: {}", exp.what());
+        return false;
+    } catch (const std::out_of_range &exp) {
+        LOG_ERROR("restore cluster load from JSON failed: {}", exp.what());
+        return false;
+    }
+
+    return true;
+}
+
+load_aware_balance_policy::load_aware_balance_policy(meta_service *svc) : load_balance_policy(svc)
+{
+}
+
+void load_aware_balance_policy::balance(bool checker,
+                                        const meta_view *global_view,
+                                        migration_list *list)
+{
+    init(global_view, list);
+    if (!all_loads_measured()) {
+        return;
+    }
+
+    const cluster_load loads(*_global_view);
+    if (loads.mean_node_load() <= 0) {
+        LOG_INFO("skip the load-aware balancer since no load has been reported");
+        return;
+    }
+
+    _node_loads.assign(_alive_nodes + 1, 0);
+    for (int id = 1; id <= _alive_nodes; ++id) {
+        _node_loads[id] = loads.get_node_load(host_port_vec[id]);
+    }
+
+    const double hot_load = loads.mean_node_load() * (1 + FLAGS_load_balance_imbalance_ratio);
+    int64_t remaining_copy_bytes = FLAGS_load_balance_max_copy_mb_per_round << 20;
+    std::set<int> exhausted_nodes;
+    while (_migration_result->size() < FLAGS_load_balance_max_moves_per_round) {
+        int hottest = 0;
+        for (int id = 1; id <= _alive_nodes; ++id) {
+            if (exhausted_nodes.count(id) == 0 &&
+                (hottest == 0 || _node_loads[id] > _node_loads[hottest])) {
+                hottest = id;
+            }
+        }
+        if (hottest == 0 || _node_loads[hottest] <= hot_load) {
+            break;
+        }
+
+        move_candidate move;
+        if (!find_best_move(loads, hottest, remaining_copy_bytes, move)) {
+            LOG_INFO("no move could relieve the hot node {} any more: load = {:.3f}, mean = {:.3f}",
+                     host_port_vec[hottest],
+                     _node_loads[hottest],
+                     loads.mean_node_load());
+            exhausted_nodes.insert(hottest);
+            continue;
+        }
+
+        const auto &pc = move.app->partitions[move.pid.get_partition_index()];
+        auto request = generate_balancer_request(*_global_view->apps,
+                                                 pc,
+                                                 move.type,
+                                                 host_port_vec[move.from],
+                                                 host_port_vec[move.to]);
+        if (request == nullptr) {
+            break;
+        }
+
+        LOG_INFO("{}: {} from {}(load = {:.3f}) to {}(load = {:.3f}), moved load = {:.3f}, "
+                 "copied bytes = {}",
+                 move.pid,
+                 enum_to_string(move.type),
+                 host_port_vec[move.from],
+                 _node_loads[move.from],
+                 host_port_vec[move.to],
+                 _node_loads[move.to],
+                 move.load,
+                 move.copied_bytes);
+        _migration_result->emplace(move.pid, std::move(request));
+        _node_loads[move.from] -= move.load;
+        _node_loads[move.to] += move.load;
+        remaining_copy_bytes -= move.copied_bytes;
+    }
+}
+
+bool load_aware_balance_policy::all_loads_measured() const
+{
+    for (const auto &kv : *_global_view->apps) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE) {
+            continue;
+        }
+
+        for (int i = 0; i < app->partition_count; ++i) {
+            const partition_configuration &pc = app->partitions[i];
+            for (const auto &replica : app->helpers->contexts[i].serving) {
+                // The replicas which have never reported their loads are ignored, so that the
+                // balancer is not blocked by the replica servers which do not collect loads.
+                if (!is_member(pc, replica.node) || replica.load.last_report_ms == 0) {
+                    continue;
+                }
+                if (replica.load.measured_ballot != pc.ballot) {
+                    LOG_INFO("skip the load-aware balancer since the load of {} on {} has not "
+                             "been measured under ballot {}",
+                             pc.pid,
+                             replica.node,
+                             pc.ballot);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool load_aware_balance_policy::can_move(const std::shared_ptr<app_state> &app)
+{
+    return app->status == app_status::AS_AVAILABLE && !app->is_bulk_loading &&
+           !app->splitting() && !is_ignored_app(app->app_id);
+}
+
+bool load_aware_balance_policy::find_best_move(const cluster_load &loads,
+                                               int hottest,
+                                               int64_t remaining_copy_bytes,
+                                               move_candidate &best)
+{
+    const app_mapper &apps = *_global_view->apps;
+    const host_port &from = host_port_vec[hottest];
+
+    // The coldest node which is not a member of the partition is the best target to copy a
+    // replica to.
+    std::vector<int> targets(_alive_nodes);
+    std::iota(targets.begin(), targets.end(), 1);
+    std::sort(targets.begin(), targets.end(), [this](int left, int right) {
+        return _node_loads[left] < _node_loads[right];
+    });
+
+    _global_view->nodes->at(from).for_each_partition([&](const gpid &pid) {
+        const auto app_iter = apps.find(pid.get_app_id());
+        if (app_iter == apps.end() || !can_move(app_iter->second)) {
+            return true;
+        }
+        if (_migration_result->find(pid) != _migration_result->end()) {
+            return true;
+        }
+
+        const std::shared_ptr<app_state> &app = app_iter->second;
+        const partition_configuration &pc = app->partitions[pid.get_partition_index()];
+        if (!pc.hp_primary || pc.hp_secondaries.size() + 1 != pc.max_replica_count) {
+            return true;
+        }
+
+        const config_context &cc = app->helpers->contexts[pid.get_partition_index()];
+        const auto from_replica = cc.find_from_serving(from);
+        if (from_replica == cc.serving.end()) {
+            return true;
+        }
+
+        move_candidate candidate;
+        candidate.app = app;
+        candidate.pid = pid;
+        candidate.from = hottest;
+        const double from_load = loads.get_replica_load(from_replica->load);
+        const bool is_primary = pc.hp_primary == from;
+        if (is_primary) {
+            // Moving the primary swaps the loads of the primary and the secondary.
+            for (const auto &secondary : pc.hp_secondaries) {
+                const auto to = host_port_id.find(secondary);
+                const auto to_replica = cc.find_from_serving(secondary);
+                if (to == host_port_id.end() || to_replica == cc.serving.end()) {
+                    continue;
+                }
+                candidate.type = balance_type::MOVE_PRIMARY;
+                candidate.to = to->second;
+                candidate.load = from_load - loads.get_replica_load(to_replica->load);
+                candidate.copied_bytes = 0;
+                consider_move(candidate, best);
+            }
+        }
+
+        if (from_replica->load.storage_bytes > remaining_copy_bytes ||
+            from_load < loads.mean_node_load() * FLAGS_load_balance_min_copied_load_ratio) {
+            return true;
+        }
+        for (const int to : targets) {
+            if (is_member(pc, host_port_vec[to])) {
+                continue;
+            }
+            candidate.type = is_primary ? balance_type::COPY_PRIMARY : balance_type::COPY_SECONDARY;
+            candidate.to = to;
+            candidate.load = from_load;
+            candidate.copied_bytes = from_replica->load.storage_bytes;
+            consider_move(candidate, best);
+            break;
+        }
+        return true;
+    });
+
+    return best.type != balance_type::INVALID;
+}
+
+void load_aware_balance_policy::consider_move(const move_candidate &candidate,
+                                              move_candidate &best) const
+{
+    // Moving `load` from `from` to `to` reduces the sum of the squared loads of the nodes by
+    // 2 * load * (gap - load), which is positive only if the load is less than the gap, i.e.
+    // the target would not be hotter than the source after the move.
+    const double gap = _node_loads[candidate.from] - _node_loads[candidate.to];
+    if (candidate.load <= 0 || candidate.load >= gap) {
+        return;
+    }
+
+    const double cost_unit_bytes = FLAGS_load_balance_copy_cost_unit_mb << 20;
+    const double score = candidate.load * (gap - candidate.load) /
+                         (1 + candidate.copied_bytes / cost_unit_bytes);
+    if (score > best.score) {
+        best = candidate;
+        best.score = score;
+    }
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/gpid.h"
+#include "load_balance_policy.h"
+#include "meta/meta_data.h"
+#include "runtime/rpc/rpc_host_port.h"
+
+namespace dsn {
+namespace replication {
+class meta_service;
+
+// The load of the alive nodes in a meta view. The load of a replica is the weighted sum of its
+// read/write capacity units, network bytes and storage bytes per second, each of which is
+// normalized by its mean on all the alive nodes, thus the mean load of the nodes is the sum of
+// the weights of the dimensions which have been reported.
+class cluster_load
+{
+public:
+    explicit cluster_load(const meta_view &view);
+
+    double get_replica_load(const replica_load &load) const;
+
+    // Returns 0 for the dead or unknown nodes.
+    double get_node_load(const host_port &node) const;
+    const std::map<host_port, double> &node_loads() const { return _node_loads; }
+    double mean_node_load() const { return _mean_node_load; }
+
+    // Returns the ratio of the load of the hottest node to the median.
+    double max_to_median_ratio() const;
+
+private:
+    double _mean_read_cu;
+    double _mean_write_cu;
+    double _mean_network_bytes;
+    double _mean_storage_bytes;
+
+    std::map<host_port, double> _node_loads;
+    double _mean_node_load;
+};
+
+// Dump the partitions and the replica loads of the alive nodes in `view` as a JSON string, which
+// could be restored by restore_cluster_load() to simulate the load-aware balancer offline.
+std::string dump_cluster_load(const meta_view &view);
+
+// Restore the apps and the alive nodes dumped by dump_cluster_load(). The nodes are restored by
+// their IP addresses, so that the dump could be restored without resolving the hostnames.
+bool restore_cluster_load(const std::string &json,
+                          /*out*/ app_mapper &apps,
+                          /*out*/ node_mapper &nodes);
+
+// Balance the alive nodes by their loads rather than their replica counts, see cluster_load.
+//
+// In each step, the hottest node is relieved by the move which reduces the sum of the squared
+// node loads the most per cost: moving a primary to a secondary copies no data, while copying a
+// replica to another node costs its storage bytes. A node is hot once its load exceeds the mean
+// by FLAGS_load_balance_imbalance_ratio.
+//
+// The balancer waits until the loads of all the replicas have been measured under their current
+// configurations, so that a partition would never be moved again before the loads moved by the
+// previous round have been reported.
+class load_aware_balance_policy : public load_balance_policy
+{
+public:
+    explicit load_aware_balance_policy(meta_service *svc);
+    ~load_aware_balance_policy() = default;
+
+    void balance(bool checker, const meta_view *global_view, migration_list *list) override;
+
+private:
+    struct move_candidate
+    {
+        std::shared_ptr<app_state> app;
+        gpid pid;
+        balance_type type = balance_type::INVALID;
+        int from = 0;
+        int to = 0;
+        // The load moved from `from` to `to`.
+        double load = 0;
+        int64_t copied_bytes = 0;
+        double score = 0;
+    };
+
+    bool all_loads_measured() const;
+    bool can_move(const std::shared_ptr<app_state> &app);
+    bool find_best_move(const cluster_load &loads,
+                        int hottest,
+                        int64_t remaining_copy_bytes,
+                        /*out*/ move_candidate &best);
+    void consider_move(const move_candidate &candidate, /*in-out*/ move_candidate &best) const;
+
+    // The loads of the alive nodes indexed by their ids, see load_balance_policy::host_port_id.
+    std::vector<double> _node_loads;
+};
+
+} // namespace replication
+} // namespace dsn
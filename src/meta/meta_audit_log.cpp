@@ -0,0 +1,62 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "meta_audit_log.h"
+
+#include "runtime/api_layer1.h"
+#include "utils/flags.h"
+#include "utils/fmt_logging.h"
+
+DSN_DEFINE_uint32(meta_server,
+                  max_audit_record_count,
+                  1000,
+                  "The max count of the audit records of the operations requested by the "
+                  "automatic tools, e.g. the hotspot remediation of the collector, which are "
+                  "kept in memory to be queried through the http service");
+DSN_TAG_VARIABLE(max_audit_record_count, FT_MUTABLE);
+
+namespace dsn {
+namespace replication {
+
+void meta_audit_log::append(const std::string &operation,
+                            const std::string &target,
+                            const std::string &detail,
+                            const std::string &reason,
+                            error_code result)
+{
+    LOG_INFO("audit: operation = {}, target = {}, detail = {}, reason = {}, result = {}",
+             operation,
+             target,
+             detail,
+             reason,
+             result);
+
+    zauto_lock l(_lock);
+    _records.push_back({_next_id++, dsn_now_ms(), operation, target, detail, reason, result});
+    while (_records.size() > FLAGS_max_audit_record_count) {
+        _records.pop_front();
+    }
+}
+
+std::vector<audit_record> meta_audit_log::records() const
+{
+    zauto_lock l(_lock);
+    return std::vector<audit_record>(_records.begin(), _records.end());
+}
+
+} // namespace replication
+} // namespace dsn
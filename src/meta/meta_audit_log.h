@@ -0,0 +1,65 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "utils/error_code.h"
+#include "utils/zlocks.h"
+
+namespace dsn {
+namespace replication {
+
+// An operation requested by some automatic tool, e.g. the hotspot remediation of the collector,
+// which has tagged its request with a reason.
+struct audit_record
+{
+    uint64_t id;
+    uint64_t timestamp_ms;
+    std::string operation;
+    std::string target;
+    std::string detail;
+    std::string reason;
+    error_code result;
+};
+
+// The recent audit records kept in memory by the meta server, which could be queried through
+// the http service. Only the latest FLAGS_max_audit_record_count records are kept.
+class meta_audit_log
+{
+public:
+    void append(const std::string &operation,
+                const std::string &target,
+                const std::string &detail,
+                const std::string &reason,
+                error_code result);
+
+    // Returns the records from the oldest to the latest.
+    std::vector<audit_record> records() const;
+
+private:
+    mutable zlock _lock;
+    uint64_t _next_id = 1;
+    std::deque<audit_record> _records;
+};
+
+} // namespace replication
+} // namespace dsn
@@ -51,6 +51,7 @@
 #include "utils/defer.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
+#include "utils/string_conv.h"
 #include "utils/time_utils.h"
 
 DSN_DECLARE_int32(cold_backup_checkpoint_reserve_minutes);
@@ -96,6 +97,54 @@ bool validate_backup_interval(int64_t backup_interval_seconds, std::string &hint
     return true;
 }
 
+// The synchronous list_dir() of the block service, only used by the background gc.
+error_code list_dir_sync(dist::block_service::block_filesystem *fs,
+                         const std::string &dir,
+                         /*out*/ std::vector<dist::block_service::ls_entry> &entries)
+{
+    dist::block_service::ls_response ls_resp;
+    fs->list_dir(dist::block_service::ls_request{dir},
+                 TASK_CODE_EXEC_INLINED,
+                 [&ls_resp](const dist::block_service::ls_response &resp) { ls_resp = resp; })
+        ->wait();
+    if (ls_resp.err == ERR_OK) {
+        entries = std::move(*ls_resp.entries);
+    }
+    return ls_resp.err;
+}
+
+// The synchronous read of the whole file from the block service, only used by the background
+// gc.
+error_code read_file_sync(dist::block_service::block_filesystem *fs,
+                          const std::string &path,
+                          /*out*/ blob &buffer)
+{
+    dist::block_service::create_file_response cf_resp;
+    dist::block_service::create_file_request cf_req;
+    cf_req.file_name = path;
+    cf_req.ignore_metadata = true;
+    fs->create_file(cf_req,
+                    TASK_CODE_EXEC_INLINED,
+                    [&cf_resp](const dist::block_service::create_file_response &resp) {
+                        cf_resp = resp;
+                    })
+        ->wait();
+    if (cf_resp.err != ERR_OK) {
+        return cf_resp.err;
+    }
+
+    dist::block_service::read_response r_resp;
+    cf_resp.file_handle
+        ->read(dist::block_service::read_request{0, -1},
+               TASK_CODE_EXEC_INLINED,
+               [&r_resp](const dist::block_service::read_response &resp) { r_resp = resp; })
+        ->wait();
+    if (r_resp.err == ERR_OK) {
+        buffer = std::move(r_resp.buffer);
+    }
+    return r_resp.err;
+}
+
 } // anonymous namespace
 
 backup_policy_metrics::backup_policy_metrics(const std::string &policy_name)
@@ -1005,6 +1054,7 @@ void policy_context::gc_backup_info_unlocked(const backup_info &info_to_gc)
                     if (resp.err == ERR_OK || resp.err == ERR_OBJECT_NOT_FOUND) {
                         dsn::task_ptr remove_local_backup_info_task = tasking::create_task(
                             LPC_DEFAULT_CALLBACK, &_tracker, [this, info_to_gc]() {
+                                gc_shared_files(info_to_gc);
                                 zauto_lock l(_lock);
                                 _backup_history.erase(info_to_gc.backup_id);
                                 issue_gc_backup_info_task_unlocked();
@@ -1023,6 +1073,163 @@ void policy_context::gc_backup_info_unlocked(const backup_info &info_to_gc)
     sync_backup_to_remote_storage_unlocked(info_to_gc, sync_callback, false);
 }
 
+bool policy_context::collect_referenced_shared_files(
+    const std::string &app_name,
+    int32_t app_id,
+    const std::vector<int64_t> &backup_ids,
+    int32_t partition_index,
+    /*out*/ std::set<std::string> &referenced_files)
+{
+    const gpid pid(app_id, partition_index);
+    for (const auto backup_id : backup_ids) {
+        const auto replica_path = cold_backup::get_replica_backup_path(
+            _backup_service->backup_root(), app_name, pid, backup_id);
+        std::vector<dist::block_service::ls_entry> entries;
+        auto err = list_dir_sync(_block_service, replica_path, entries);
+        if (err == ERR_OBJECT_NOT_FOUND) {
+            continue;
+        }
+        if (err != ERR_OK) {
+            LOG_WARNING(
+                "{}: list dir({}) failed, err = {}", _policy.policy_name, replica_path, err);
+            return false;
+        }
+
+        // All the checkpoint dirs are taken into account, even if some of them are not the
+        // current one, since it's safe to keep more files.
+        for (const auto &entry : entries) {
+            if (!entry.is_directory) {
+                continue;
+            }
+            const auto metadata_path = fmt::format(
+                "{}/{}/{}", replica_path, entry.entry_name, cold_backup_constant::BACKUP_METADATA);
+            blob buffer;
+            err = read_file_sync(_block_service, metadata_path, buffer);
+            if (err == ERR_OBJECT_NOT_FOUND) {
+                continue;
+            }
+            if (err != ERR_OK) {
+                LOG_WARNING(
+                    "{}: read file({}) failed, err = {}", _policy.policy_name, metadata_path, err);
+                return false;
+            }
+            cold_backup_metadata metadata;
+            if (!json::json_forwarder<cold_backup_metadata>::decode(buffer, metadata)) {
+                LOG_WARNING("{}: file({}) is damaged", _policy.policy_name, metadata_path);
+                return false;
+            }
+            const std::set<std::string> shared_files(metadata.shared_files.begin(),
+                                                     metadata.shared_files.end());
+            for (const auto &f_meta : metadata.files) {
+                if (shared_files.count(f_meta.name) > 0) {
+                    referenced_files.insert(
+                        cold_backup::get_shared_file_name(f_meta.name, f_meta.size, f_meta.md5));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void policy_context::gc_shared_files(const backup_info &gced_info)
+{
+    // The files uploaded by the backups in progress are not referenced by any backup_metadata
+    // until they finish, thus the gc is skipped meanwhile, and the files unreferenced now would
+    // be removed by the gc of the next expired backup.
+    if (_backup_service->is_backup_in_progress()) {
+        LOG_INFO("{}: skip gc shared files after backup({}) is removed since there are backups "
+                 "in progress",
+                 _policy.policy_name,
+                 gced_info.backup_id);
+        return;
+    }
+
+    // The shared files are referenced by the backup_metadata of the remaining backups under the
+    // backup root, which may be made by any policy.
+    const auto &root = _backup_service->backup_root();
+    std::vector<dist::block_service::ls_entry> entries;
+    auto err = list_dir_sync(_block_service, root, entries);
+    if (err != ERR_OK) {
+        LOG_WARNING("{}: list dir({}) failed, err = {}", _policy.policy_name, root, err);
+        return;
+    }
+    std::vector<int64_t> backup_ids;
+    for (const auto &entry : entries) {
+        int64_t backup_id = 0;
+        if (entry.is_directory && buf2int64(entry.entry_name, backup_id)) {
+            backup_ids.push_back(backup_id);
+        }
+    }
+
+    for (const auto &app : gced_info.app_names) {
+        const auto app_shared_files_dir = fmt::format(
+            "{}/{}/{}_{}", root, cold_backup_constant::SHARED_FILES, app.second, app.first);
+        std::vector<dist::block_service::ls_entry> partition_entries;
+        err = list_dir_sync(_block_service, app_shared_files_dir, partition_entries);
+        if (err == ERR_OBJECT_NOT_FOUND) {
+            continue;
+        }
+        if (err != ERR_OK) {
+            LOG_WARNING("{}: list dir({}) failed, err = {}",
+                        _policy.policy_name,
+                        app_shared_files_dir,
+                        err);
+            continue;
+        }
+
+        for (const auto &partition_entry : partition_entries) {
+            int32_t partition_index = 0;
+            if (!partition_entry.is_directory ||
+                !buf2int32(partition_entry.entry_name, partition_index)) {
+                continue;
+            }
+
+            // Mark the files referenced by any remaining backup.
+            std::set<std::string> referenced_files;
+            if (!collect_referenced_shared_files(
+                    app.second, app.first, backup_ids, partition_index, referenced_files)) {
+                continue;
+            }
+
+            // Sweep the files which are not referenced.
+            const auto shared_files_dir = cold_backup::get_replica_shared_files_dir(
+                root, app.second, gpid(app.first, partition_index));
+            std::vector<dist::block_service::ls_entry> file_entries;
+            err = list_dir_sync(_block_service, shared_files_dir, file_entries);
+            if (err != ERR_OK) {
+                LOG_WARNING("{}: list dir({}) failed, err = {}",
+                            _policy.policy_name,
+                            shared_files_dir,
+                            err);
+                continue;
+            }
+            for (const auto &file_entry : file_entries) {
+                if (file_entry.is_directory || referenced_files.count(file_entry.entry_name) > 0) {
+                    continue;
+                }
+                dist::block_service::remove_path_request req;
+                req.path = fmt::format("{}/{}", shared_files_dir, file_entry.entry_name);
+                req.recursive = false;
+                _block_service
+                    ->remove_path(req,
+                                  TASK_CODE_EXEC_INLINED,
+                                  [&err](const dist::block_service::remove_path_response &resp) {
+                                      err = resp.err;
+                                  })
+                    ->wait();
+                if (err != ERR_OK && err != ERR_OBJECT_NOT_FOUND) {
+                    LOG_WARNING("{}: remove shared file({}) failed, err = {}",
+                                _policy.policy_name,
+                                req.path,
+                                err);
+                    continue;
+                }
+                LOG_INFO("{}: remove unreferenced shared file({})", _policy.policy_name, req.path);
+            }
+        }
+    }
+}
+
 void policy_context::issue_gc_backup_info_task_unlocked()
 {
     if (_backup_history.size() > _policy.backup_history_count_to_keep) {
@@ -1090,6 +1297,22 @@ void policy_context::sync_remove_backup_info(const backup_info &info, dsn::task_
         backup_info_path, true, LPC_DEFAULT_CALLBACK, callback, nullptr);
 }
 
+bool backup_service::is_backup_in_progress()
+{
+    zauto_lock l(_lock);
+    for (const auto &policy : _policy_states) {
+        if (policy.second->is_under_backuping()) {
+            return true;
+        }
+    }
+    for (const auto &engine : _backup_states) {
+        if (engine->is_in_progress()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 backup_service::backup_service(meta_service *meta_svc,
                                const std::string &policy_meta_root,
                                const std::string &backup_root,
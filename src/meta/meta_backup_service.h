@@ -329,6 +329,16 @@ mock_private :
                                       const host_port &primary);
 
     mock_virtual void gc_backup_info_unlocked(const backup_info &info_to_gc);
+    // Remove the files in the shared files dirs of the apps of the removed backup, which are not
+    // referenced by the backup_metadata of any remaining backup under the backup root.
+    mock_virtual void gc_shared_files(const backup_info &gced_info);
+    // Collect the names of the shared files referenced by the backups of the partition.
+    // Return false if failed to read any backup_metadata.
+    bool collect_referenced_shared_files(const std::string &app_name,
+                                         int32_t app_id,
+                                         const std::vector<int64_t> &backup_ids,
+                                         int32_t partition_index,
+                                         /*out*/ std::set<std::string> &referenced_files);
     mock_virtual void issue_gc_backup_info_task_unlocked();
     mock_virtual void sync_remove_backup_info(const backup_info &info, dsn::task_ptr sync_callback);
 
@@ -387,6 +397,8 @@ public:
     void modify_backup_policy(configuration_modify_backup_policy_rpc rpc);
     void start_backup_app(start_backup_app_rpc rpc);
     void query_backup_status(query_backup_status_rpc rpc);
+    // Whether there is any backup in progress, either by a policy or a one-time backup.
+    bool is_backup_in_progress();
 
     // compose the absolute path(AP) for policy
     // input:
@@ -34,6 +34,9 @@
 #include "runtime/rpc/dns_resolver.h" // IWYU pragma: keep
 #include "runtime/rpc/rpc_address.h"
 #include "runtime/rpc/rpc_message.h"
+#include "runtime/rpc/serialization.h"
+#include "utils/binary_reader.h"
+#include "utils/binary_writer.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
 
@@ -73,9 +76,65 @@ DSN_DEFINE_uint32(meta_server,
                   "max reserved number allowed for dropped replicas");
 DSN_TAG_VARIABLE(max_reserved_dropped_replicas, FT_MUTABLE);
 
+DSN_DEFINE_bool(meta_server,
+                encode_partition_configuration_in_binary,
+                false,
+                "Whether to store the partition configurations in the remote storage in the "
+                "compact binary format rather than JSON, which are much faster to be loaded "
+                "when the meta server starts. Both formats could always be loaded, however the "
+                "older versions of meta server could only load JSON, thus do not enable it "
+                "until they would never be rolled back to");
+DSN_TAG_VARIABLE(encode_partition_configuration_in_binary, FT_MUTABLE);
+
 namespace dsn {
 namespace replication {
 
+namespace {
+
+// A JSON object always starts with '{', thus the binary format starts with a zero byte.
+const uint8_t kPartitionConfigurationBinaryMagic = 0;
+const uint8_t kPartitionConfigurationBinaryVersion = 1;
+const int kPartitionConfigurationBinaryHeaderSize = 2;
+
+} // anonymous namespace
+
+blob encode_partition_configuration(const partition_configuration &pc)
+{
+    if (!FLAGS_encode_partition_configuration_in_binary) {
+        return dsn::json::json_forwarder<partition_configuration>::encode(pc);
+    }
+
+    binary_writer writer;
+    writer.write(kPartitionConfigurationBinaryMagic);
+    writer.write(kPartitionConfigurationBinaryVersion);
+    marshall(writer, pc, DSF_THRIFT_BINARY);
+    return writer.get_buffer();
+}
+
+bool decode_partition_configuration(const blob &value, /*out*/ partition_configuration &pc)
+{
+    if (value.length() > 0 &&
+        static_cast<uint8_t>(value.data()[0]) == kPartitionConfigurationBinaryMagic) {
+        if (value.length() < kPartitionConfigurationBinaryHeaderSize ||
+            static_cast<uint8_t>(value.data()[1]) != kPartitionConfigurationBinaryVersion) {
+            LOG_ERROR("unsupported binary format of partition configuration, size = {}",
+                      value.length());
+            return false;
+        }
+
+        binary_reader reader(value.range(kPartitionConfigurationBinaryHeaderSize));
+        unmarshall(reader, pc, DSF_THRIFT_BINARY);
+        return true;
+    }
+
+    // TODO(yingchun): when upgrade from old version, check if the fields will be filled.
+    // TODO(yingchun): check if the fields will be set after decoding.
+    pc.__isset.hp_secondaries = true;
+    pc.__isset.hp_last_drops = true;
+    pc.__isset.hp_primary = true;
+    return dsn::json::json_forwarder<partition_configuration>::decode(value, pc);
+}
+
 void when_update_replicas(config_type::type t, const std::function<void(bool)> &func)
 {
     switch (t) {
@@ -435,17 +494,47 @@ bool config_context::remove_from_serving(const host_port &node)
     return false;
 }
 
+void replica_load::update(const replica_load_stats &stats, ballot current_ballot, uint64_t now_ms)
+{
+    storage_bytes = stats.storage_bytes;
+
+    // The cumulative stats restart from 0 once the replica is reopened, in which case the load
+    // is left unchanged but marked as unmeasured until the next report.
+    if (last_report_ms != 0 && now_ms > last_report_ms) {
+        if (stats.read_cu >= last_stats.read_cu && stats.write_cu >= last_stats.write_cu &&
+            stats.network_bytes >= last_stats.network_bytes) {
+            const double elapsed_s = (now_ms - last_report_ms) / 1000.0;
+            read_cu = (stats.read_cu - last_stats.read_cu) / elapsed_s;
+            write_cu = (stats.write_cu - last_stats.write_cu) / elapsed_s;
+            network_bytes = (stats.network_bytes - last_stats.network_bytes) / elapsed_s;
+            measured_ballot = current_ballot == last_ballot ? current_ballot : invalid_ballot;
+        } else {
+            measured_ballot = invalid_ballot;
+        }
+    }
+
+    last_stats = stats;
+    last_ballot = current_ballot;
+    last_report_ms = now_ms;
+}
+
 void config_context::collect_serving_replica(const host_port &node, const replica_info &info)
 {
     auto iter = find_from_serving(node);
     auto compact_status = info.__isset.manual_compact_status ? info.manual_compact_status
                                                              : manual_compaction_status::IDLE;
-    if (iter != serving.end()) {
-        iter->disk_tag = info.disk_tag;
-        iter->storage_mb = 0;
-        iter->compact_status = compact_status;
-    } else {
-        serving.emplace_back(serving_replica{node, 0, info.disk_tag, compact_status});
+    if (iter == serving.end()) {
+        serving.emplace_back();
+        iter = serving.end() - 1;
+        iter->node = node;
+    }
+
+    iter->disk_tag = info.disk_tag;
+    iter->storage_mb = 0;
+    iter->compact_status = compact_status;
+    if (info.__isset.load_stats) {
+        iter->load.update(info.load_stats, info.ballot, dsn_now_ms());
+        iter->storage_mb = info.load_stats.storage_bytes >> 20;
     }
 }
 
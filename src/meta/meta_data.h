@@ -182,15 +182,37 @@ inline int dropped_cmp(const dropped_replica &d1, const dropped_replica &d2)
     return 0;
 }
 
+// The load of a serving replica, which is derived from the replica_load_stats reported by
+// config-sync of RS.
+struct replica_load
+{
+    // The load per second, which is derived from the increments of the cumulative stats between
+    // 2 successive reports.
+    double read_cu = 0;
+    double write_cu = 0;
+    double network_bytes = 0;
+    int64_t storage_bytes = 0;
+    // The ballot during which the load per second was measured, or invalid_ballot if the
+    // configuration was changed between the 2 reports.
+    ballot measured_ballot = invalid_ballot;
+
+    // The cumulative stats of the last report, and when it was received.
+    replica_load_stats last_stats;
+    ballot last_ballot = invalid_ballot;
+    uint64_t last_report_ms = 0;
+
+    void update(const replica_load_stats &stats, ballot current_ballot, uint64_t now_ms);
+};
+
 // Represent a replica that is serving. Info in this structure can only from config-sync of RS.
 // Load balancer may use this to do balance decisions.
 struct serving_replica
 {
     dsn::host_port node;
-    // TODO: report the storage size of replica
     int64_t storage_mb;
     std::string disk_tag;
     manual_compaction_status::type compact_status;
+    replica_load load;
 };
 
 class config_context
@@ -586,6 +608,16 @@ bool construct_replica(meta_view view, const gpid &pid, int max_replica_count);
 //   WARNING: if false is returned, the replica on node may be garbage-collected
 bool collect_replica(meta_view view, const host_port &node, const replica_info &info);
 
+// Encode the configuration of a partition to be stored in the remote storage. It's encoded in
+// JSON, or in the compact binary format if FLAGS_encode_partition_configuration_in_binary is
+// enabled, which is a version byte (kPartitionConfigurationBinaryVersion) after a zero byte,
+// followed by the configuration serialized in thrift binary protocol.
+blob encode_partition_configuration(const partition_configuration &pc);
+
+// Decode the configuration of a partition encoded by encode_partition_configuration() in either
+// format. Return false if it is neither valid JSON nor a supported version of the binary format.
+bool decode_partition_configuration(const blob &value, /*out*/ partition_configuration &pc);
+
 inline bool has_seconds_expired(uint64_t second_ts) { return second_ts * 1000 < dsn_now_ms(); }
 
 inline bool has_milliseconds_expired(uint64_t milliseconds_ts)
@@ -836,6 +836,39 @@ void meta_http_service::update_scenario_handler(const http_request &req, http_re
     update_app_env(info.app_name, keys, values, resp);
 }
 
+void meta_http_service::query_audit_log_handler(const http_request &req, http_response &resp)
+{
+    // the audit log is only kept by the primary meta server
+    if (!redirect_if_not_primary(req, resp)) {
+        return;
+    }
+
+    dsn::utils::table_printer tp;
+    tp.add_title("id");
+    tp.add_column("time");
+    tp.add_column("operation");
+    tp.add_column("target");
+    tp.add_column("detail");
+    tp.add_column("reason");
+    tp.add_column("result");
+    for (const auto &record : _service->get_audit_log().records()) {
+        std::string time;
+        dsn::utils::time_ms_to_string(record.timestamp_ms, time);
+        tp.add_row(record.id);
+        tp.append_data(time);
+        tp.append_data(record.operation);
+        tp.append_data(record.target);
+        tp.append_data(record.detail);
+        tp.append_data(record.reason);
+        tp.append_data(record.result.to_string());
+    }
+
+    std::ostringstream out;
+    tp.output(out, dsn::utils::table_printer::output_format::kJsonCompact);
+    resp.body = out.str();
+    resp.status_code = http_status_code::kOk;
+}
+
 bool meta_http_service::redirect_if_not_primary(const http_request &req, http_response &resp)
 {
 #ifdef MOCK_TEST
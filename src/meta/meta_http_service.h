@@ -141,6 +141,13 @@ public:
                                    std::placeholders::_2),
                          "A JSON format of usage_scenario_info structure",
                          "Update usage scenario of an app.");
+        register_handler("audit_log",
+                         std::bind(&meta_http_service::query_audit_log_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2),
+                         "Query the recent operations requested by the automatic tools, e.g. the "
+                         "hotspot remediation of the collector.");
     }
 
     std::string path() const override { return "meta"; }
@@ -156,6 +163,7 @@ public:
     void query_bulk_load_handler(const http_request &req, http_response &resp);
     void start_compaction_handler(const http_request &req, http_response &resp);
     void update_scenario_handler(const http_request &req, http_response &resp);
+    void query_audit_log_handler(const http_request &req, http_response &resp);
 
 private:
     // set redirect location if current server is not primary
@@ -40,6 +40,7 @@
 #include "common/common.h"
 #include "common/gpid.h"
 #include "common/replication.codes.h"
+#include "common/replication_enums.h"
 #include "dsn.layer2_types.h"
 #include "duplication_types.h"
 #include "meta/duplication/meta_duplication_service.h"
@@ -856,6 +857,22 @@ void meta_service::on_propose_balancer(configuration_balancer_rpc rpc)
     const configuration_balancer_request &request = rpc.request();
     LOG_INFO("get proposal balancer request, gpid({})", request.gpid);
     _state->on_propose_balancer(request, rpc.response());
+
+    if (request.__isset.reason) {
+        std::string actions;
+        for (const auto &act : request.action_list) {
+            if (!actions.empty()) {
+                actions += ", ";
+            }
+            actions += fmt::format(
+                "{} on {}", enum_to_string(act.type), FMT_HOST_PORT_AND_IP(act, node));
+        }
+        _audit_log.append("propose_balancer",
+                          request.gpid.to_string(),
+                          actions,
+                          request.reason,
+                          rpc.response().err);
+    }
 }
 
 void meta_service::on_start_recovery(configuration_recovery_rpc rpc)
@@ -1115,7 +1132,22 @@ void meta_service::on_start_partition_split(start_split_rpc rpc)
     }
     tasking::enqueue(LPC_META_STATE_NORMAL,
                      tracker(),
-                     [this, rpc]() { _split_svc->start_partition_split(std::move(rpc)); },
+                     [this, rpc]() {
+                         _split_svc->start_partition_split(rpc);
+
+                         // The response is ERR_OK once the split has been accepted, even if the
+                         // new partition count has not been written to the remote storage yet.
+                         const auto &request = rpc.request();
+                         if (request.__isset.reason) {
+                             _audit_log.append(
+                                 "start_partition_split",
+                                 request.app_name,
+                                 fmt::format("new_partition_count = {}",
+                                             request.new_partition_count),
+                                 request.reason,
+                                 rpc.response().err);
+                         }
+                     },
                      server_state::sStateHash);
 }
 
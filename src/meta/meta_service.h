@@ -43,6 +43,7 @@
 #include "common/partition_split_common.h"
 #include "common/replication_common.h"
 #include "meta_admin_types.h"
+#include "meta_audit_log.h"
 #include "meta_options.h"
 #include "meta_rpc_types.h"
 #include "meta_server_failure_detector.h"
@@ -144,6 +145,7 @@ public:
     server_state *get_server_state() { return _state.get(); }
     security::access_controller *get_access_controller() { return _access_controller.get(); }
     server_load_balancer *get_balancer() { return _balancer.get(); }
+    meta_audit_log &get_audit_log() { return _audit_log; }
     partition_guardian *get_partition_guardian() { return _partition_guardian.get(); }
     dist::block_service::block_service_manager &get_block_service_manager()
     {
@@ -358,6 +360,9 @@ private:
 
     std::unique_ptr<bulk_load_service> _bulk_load_svc;
 
+    // The operations requested by the automatic tools with a reason, for auditing.
+    meta_audit_log _audit_log;
+
     // handle all the block filesystems for current meta service
     // (in other words, current service node)
     dist::block_service::block_service_manager _block_service_manager;
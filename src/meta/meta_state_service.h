@@ -166,6 +166,20 @@ public:
                               task_code cb_code,
                               const err_callback &cb_set_data,
                               dsn::task_tracker *tracker = nullptr) = 0;
+    /*
+     * set the data of the node like set_data, while the provider may delay the request for
+     * a short while to commit it together with other batched ones in a single transaction.
+     * the batched requests are not ordered with the other requests, thus it should only be used
+     * for the nodes which are never updated concurrently through other interfaces.
+     */
+    virtual task_ptr set_data_batched(const std::string &node,
+                                      const blob &value,
+                                      task_code cb_code,
+                                      const err_callback &cb_set_data,
+                                      dsn::task_tracker *tracker = nullptr)
+    {
+        return set_data(node, value, cb_code, cb_set_data, tracker);
+    }
     /*
      * get all childrens of a node
      * node: dir name with full path
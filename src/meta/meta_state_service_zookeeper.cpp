@@ -30,11 +30,15 @@
 #include <zookeeper/zookeeper.jute.h>
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <utility>
 
+#include "common/replication.codes.h"
 #include "meta_state_service_zookeeper.h"
+#include "runtime/api_layer1.h"
 #include "runtime/service_app.h"
+#include "runtime/task/async_calls.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
 #include "utils/utils.h"
@@ -42,8 +46,51 @@
 #include "zookeeper/zookeeper_session.h"
 #include "zookeeper/zookeeper_session_mgr.h"
 
+METRIC_DEFINE_percentile_int64(server,
+                               zookeeper_batched_set_data_size,
+                               dsn::metric_unit::kRequests,
+                               "The number of the set-data requests committed to ZooKeeper in a "
+                               "batch");
+
+METRIC_DEFINE_percentile_int64(server,
+                               zookeeper_batched_set_data_commit_latency_ns,
+                               dsn::metric_unit::kNanoSeconds,
+                               "The latency of committing a batch of set-data requests to "
+                               "ZooKeeper");
+
+METRIC_DEFINE_counter(server,
+                      zookeeper_batched_set_data_failures,
+                      dsn::metric_unit::kRequests,
+                      "The number of the failed batches of set-data requests, whose requests are "
+                      "resubmitted one by one");
+
 DSN_DECLARE_int32(timeout_ms);
 
+DSN_DEFINE_uint32(zookeeper,
+                  batched_set_data_window_ms,
+                  2,
+                  "The time window in milliseconds in which the batched set-data requests, such "
+                  "as the updates of the partition configurations, are committed to ZooKeeper "
+                  "in one multi-op transaction. 0 means committing each request separately");
+DSN_TAG_VARIABLE(batched_set_data_window_ms, FT_MUTABLE);
+
+DSN_DEFINE_uint32(zookeeper,
+                  max_batched_set_data_count,
+                  100,
+                  "The maximum number of the set-data requests committed in one transaction");
+DSN_TAG_VARIABLE(max_batched_set_data_count, FT_MUTABLE);
+DSN_DEFINE_validator(max_batched_set_data_count,
+                     [](uint32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint32(zookeeper,
+                  max_batched_set_data_bytes,
+                  512 * 1024,
+                  "The maximum total bytes of the set-data requests committed in one transaction, "
+                  "which should be less than the jute.maxbuffer of ZooKeeper");
+DSN_TAG_VARIABLE(max_batched_set_data_bytes, FT_MUTABLE);
+DSN_DEFINE_validator(max_batched_set_data_bytes,
+                     [](uint32_t value) -> bool { return value > 0; });
+
 namespace dsn {
 namespace dist {
 
@@ -145,7 +192,15 @@ error_code zoo_transaction::get_result(unsigned int entry_index)
     return from_zerror(_pkt->_results[entry_index].err);
 }
 
-meta_state_service_zookeeper::meta_state_service_zookeeper() : ref_counter() { _first_call = true; }
+meta_state_service_zookeeper::meta_state_service_zookeeper()
+    : ref_counter(),
+      _batched_set_bytes(0),
+      METRIC_VAR_INIT_server(zookeeper_batched_set_data_size),
+      METRIC_VAR_INIT_server(zookeeper_batched_set_data_commit_latency_ns),
+      METRIC_VAR_INIT_server(zookeeper_batched_set_data_failures)
+{
+    _first_call = true;
+}
 
 meta_state_service_zookeeper::~meta_state_service_zookeeper()
 {
@@ -331,13 +386,127 @@ task_ptr meta_state_service_zookeeper::set_data(const std::string &node,
     error_code_future_ptr tsk(new error_code_future(cb_code, cb_set_data, 0));
     tsk->set_tracker(tracker);
     LOG_DEBUG("call set, node({})", node);
-    VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_SET, node);
+    visit_set_data(node, value, tsk);
+    return tsk;
+}
 
+void meta_state_service_zookeeper::visit_set_data(const std::string &node,
+                                                  const blob &value,
+                                                  error_code_future_ptr tsk)
+{
+    VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_SET, node);
     input->_value = value;
     _session->visit(op);
+}
+
+task_ptr meta_state_service_zookeeper::set_data_batched(const std::string &node,
+                                                        const blob &value,
+                                                        task_code cb_code,
+                                                        const err_callback &cb_set_data,
+                                                        dsn::task_tracker *tracker)
+{
+    const auto window_ms = FLAGS_batched_set_data_window_ms;
+    if (window_ms == 0) {
+        return set_data(node, value, cb_code, cb_set_data, tracker);
+    }
+
+    error_code_future_ptr tsk(new error_code_future(cb_code, cb_set_data, 0));
+    tsk->set_tracker(tracker);
+    LOG_DEBUG("call batched set, node({})", node);
+
+    std::vector<batched_set_request> requests;
+    {
+        zauto_lock l(_batch_lock);
+        _batched_set_requests.push_back({node, value, tsk});
+        _batched_set_bytes += node.size() + value.length();
+        if (_batched_set_requests.size() >= FLAGS_max_batched_set_data_count ||
+            _batched_set_bytes >= FLAGS_max_batched_set_data_bytes) {
+            requests.swap(_batched_set_requests);
+            _batched_set_bytes = 0;
+        } else if (_batched_set_requests.size() == 1) {
+            // The first request of a batch schedules the commit of the batch. A flush scheduled
+            // for a batch that has already been committed due to its size would just commit the
+            // next batch earlier.
+            tasking::enqueue(LPC_META_STATE_HIGH,
+                             &_tracker,
+                             [ptr = ref_this(this)]() { ptr->flush_batched_set_requests(); },
+                             0,
+                             std::chrono::milliseconds(window_ms));
+        }
+    }
+
+    if (!requests.empty()) {
+        commit_batched_set_requests(std::move(requests));
+    }
     return tsk;
 }
 
+void meta_state_service_zookeeper::flush_batched_set_requests()
+{
+    std::vector<batched_set_request> requests;
+    {
+        zauto_lock l(_batch_lock);
+        requests.swap(_batched_set_requests);
+        _batched_set_bytes = 0;
+    }
+
+    if (!requests.empty()) {
+        commit_batched_set_requests(std::move(requests));
+    }
+}
+
+void meta_state_service_zookeeper::commit_batched_set_requests(
+    std::vector<batched_set_request> &&requests)
+{
+    METRIC_VAR_SET(zookeeper_batched_set_data_size, requests.size());
+    if (requests.size() == 1) {
+        // There is no need to start a transaction for a single request.
+        auto &request = requests.front();
+        visit_set_data(request.node, request.value, std::move(request.tsk));
+        return;
+    }
+
+    auto entries = std::make_shared<zoo_transaction>(static_cast<unsigned int>(requests.size()));
+    for (const auto &request : requests) {
+        CHECK_EQ(ERR_OK, entries->set_data(request.node, request.value));
+    }
+
+    auto batch = std::make_shared<std::vector<batched_set_request>>(std::move(requests));
+    const auto start_ns = dsn_now_ns();
+    submit_transaction(
+        entries,
+        LPC_META_STATE_HIGH,
+        [ptr = ref_this(this), entries, batch, start_ns](error_code err) {
+            ptr->on_batched_set_requests_committed(err, *batch, start_ns);
+        },
+        &_tracker);
+}
+
+void meta_state_service_zookeeper::on_batched_set_requests_committed(
+    error_code err, std::vector<batched_set_request> &requests, uint64_t start_ns)
+{
+    METRIC_VAR_SET(zookeeper_batched_set_data_commit_latency_ns, dsn_now_ns() - start_ns);
+    if (err == ERR_OK) {
+        for (auto &request : requests) {
+            request.tsk->enqueue_with(ERR_OK);
+        }
+        return;
+    }
+
+    // Resubmit the requests one by one, so that each of them gets its own result as if it had
+    // never been batched. Since the transaction is atomic, either none of them has been applied,
+    // or the result is unknown (e.g. the connection is lost), in which case setting the same data
+    // again is harmless.
+    LOG_WARNING("failed to commit {} batched set-data requests to zookeeper, resubmit them "
+                "separately: {}",
+                requests.size(),
+                err);
+    METRIC_VAR_INCREMENT(zookeeper_batched_set_data_failures);
+    for (auto &request : requests) {
+        visit_set_data(request.node, request.value, std::move(request.tsk));
+    }
+}
+
 task_ptr meta_state_service_zookeeper::node_exist(const std::string &node,
                                                   task_code cb_code,
                                                   const err_callback &cb_exist,
@@ -39,7 +39,9 @@
 #include "utils/autoref_ptr.h"
 #include "utils/blob.h"
 #include "utils/error_code.h"
+#include "utils/metrics.h"
 #include "utils/synchronize.h"
+#include "utils/zlocks.h"
 
 namespace dsn {
 namespace dist {
@@ -93,6 +95,15 @@ public:
                               const err_callback &cb_set_data,
                               dsn::task_tracker *tracker = nullptr) override;
 
+    // The requests arriving in a window of FLAGS_batched_set_data_window_ms are
+    // committed in one multi-op transaction. Once the transaction fails, the requests are
+    // resubmitted one by one, thus each of them is called back with its own result.
+    virtual task_ptr set_data_batched(const std::string &node,
+                                      const blob &value,
+                                      task_code cb_code,
+                                      const err_callback &cb_set_data,
+                                      dsn::task_tracker *tracker = nullptr) override;
+
     virtual task_ptr get_children(const std::string &node,
                                   task_code cb_code,
                                   const err_stringv_callback &cb_get_children,
@@ -107,6 +118,23 @@ public:
 private:
     typedef ref_ptr<meta_state_service_zookeeper> ref_this;
 
+    struct batched_set_request
+    {
+        std::string node;
+        blob value;
+        error_code_future_ptr tsk;
+    };
+
+    // Set the data of the node and call back `tsk` with the result.
+    void visit_set_data(const std::string &node, const blob &value, error_code_future_ptr tsk);
+
+    // Commit the pending batched requests if there are any.
+    void flush_batched_set_requests();
+    void commit_batched_set_requests(std::vector<batched_set_request> &&requests);
+    void on_batched_set_requests_committed(error_code err,
+                                           std::vector<batched_set_request> &requests,
+                                           uint64_t start_ns);
+
     bool _first_call;
     int _zoo_state;
     zookeeper_session *_session;
@@ -114,6 +142,15 @@ private:
 
     dsn::task_tracker _tracker;
 
+    // The requests of set_data_batched() which are waiting to be committed.
+    zlock _batch_lock;
+    std::vector<batched_set_request> _batched_set_requests;
+    size_t _batched_set_bytes;
+
+    METRIC_VAR_DECLARE_percentile_int64(zookeeper_batched_set_data_size);
+    METRIC_VAR_DECLARE_percentile_int64(zookeeper_batched_set_data_commit_latency_ns);
+    METRIC_VAR_DECLARE_counter(zookeeper_batched_set_data_failures);
+
     static void on_zoo_session_evt(ref_this ptr, int zoo_state);
     static void visit_zookeeper_internal(ref_this ptr,
                                          task_ptr callback,
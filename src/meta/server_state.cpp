@@ -50,6 +50,7 @@
 #include "common/replication_other_types.h"
 #include "dump_file.h"
 #include "meta/app_env_validator.h"
+#include "meta/load_aware_balance_policy.h"
 #include "meta/meta_data.h"
 #include "meta/meta_service.h"
 #include "meta/meta_state_service.h"
@@ -79,9 +80,11 @@
 #include "utils/config_api.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
+#include "utils/load_dump_object.h"
 #include "utils/metrics.h"
 #include "utils/string_conv.h"
 #include "utils/strings.h"
+#include "utils/synchronize.h"
 #include "utils/utils.h"
 
 DSN_DEFINE_bool(meta_server,
@@ -126,6 +129,14 @@ DSN_DEFINE_int32(meta_server,
                  10,
                  "add secondary max count for one node when flow control enabled");
 
+DSN_DEFINE_uint32(meta_server,
+                  max_concurrent_partition_loads,
+                  1000,
+                  "The maximum number of the partition nodes read concurrently from the remote "
+                  "storage while loading the apps");
+DSN_DEFINE_validator(max_concurrent_partition_loads,
+                     [](uint32_t value) -> bool { return value > 0; });
+
 DSN_DECLARE_bool(recover_from_replica_server);
 
 namespace dsn {
@@ -157,6 +168,18 @@ void server_state::register_cli_commands()
             return dump_from_remote_storage(args[0].c_str(), false).to_string();
         }));
 
+    _cmds.emplace_back(dsn::command_manager::instance().register_single_command(
+        "meta.lb.dump_cluster_load",
+        "Dump the partitions and the replica loads of meta server to a local file",
+        "<target_file>",
+        [this](const std::vector<std::string> &args) {
+            if (args.size() != 1) {
+                return ERR_INVALID_PARAMETERS.to_string();
+            }
+
+            return dump_cluster_load(args[0]).to_string();
+        }));
+
     _cmds.emplace_back(dsn::command_manager::instance().register_bool_command(
         _add_secondary_enable_flow_control,
         "meta.lb.add_secondary_enable_flow_control",
@@ -294,6 +317,16 @@ error_code server_state::dump_app_states(const char *local_path,
     return ERR_OK;
 }
 
+error_code server_state::dump_cluster_load(const std::string &local_path)
+{
+    std::string data;
+    {
+        zauto_read_lock l(_lock);
+        data = replication::dump_cluster_load({&_all_apps, &_nodes});
+    }
+    return utils::write_data_to_file(local_path, data, utils::FileDataType::kNonSensitive);
+}
+
 error_code server_state::dump_from_remote_storage(const char *local_path, bool sync_immediately)
 {
     error_code ec;
@@ -559,127 +592,42 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
 {
     dsn::error_code err;
     dsn::task_tracker tracker;
+    // Protect `err` and `apps` which are updated by the callbacks.
+    zlock sync_lock;
 
-    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
-    auto sync_partition = [this, storage, &err, &tracker](
-        std::shared_ptr<app_state> &app, int partition_id, const std::string &partition_path) {
-        storage->get_data(
-            partition_path,
-            LPC_META_CALLBACK,
-            [this, app, partition_id, partition_path, &err](error_code ec,
-                                                            const blob &value) mutable {
-                if (ec == ERR_OK) {
-                    partition_configuration pc;
-                    // TODO(yingchun): when upgrade from old version, check if the fields will be
-                    //  filled.
-                    // TODO(yingchun): check if the fields will be set after decoding.
-                    pc.__isset.hp_secondaries = true;
-                    pc.__isset.hp_last_drops = true;
-                    pc.__isset.hp_primary = true;
-                    dsn::json::json_forwarder<partition_configuration>::decode(value, pc);
-
-                    CHECK(pc.pid.get_app_id() == app->app_id &&
-                              pc.pid.get_partition_index() == partition_id,
-                          "invalid partition config");
-                    {
-                        zauto_write_lock l(_lock);
-                        app->partitions[partition_id] = pc;
-                        for (const auto &hp : pc.hp_last_drops) {
-                            app->helpers->contexts[partition_id].record_drop_history(hp);
-                        }
-
-                        if (app->status == app_status::AS_CREATING &&
-                            (pc.partition_flags & pc_flags::dropped) != 0) {
-                            recall_partition(app, partition_id);
-                        } else if (app->status == app_status::AS_DROPPING &&
-                                   (pc.partition_flags & pc_flags::dropped) == 0) {
-                            drop_partition(app, partition_id);
-                        } else
-                            process_one_partition(app);
-                        // check consistency between app bulk_loading flag and app bulk load dir
-                        if (app->helpers->partitions_in_progress.load() == 0 &&
-                            app->status == app_status::AS_AVAILABLE &&
-                            _meta_svc->get_bulk_load_service()) {
-                            bool is_bulk_loading = app->is_bulk_loading;
-                            _meta_svc->get_bulk_load_service()->check_app_bulk_load_states(
-                                std::move(app), is_bulk_loading);
-                        }
-                    }
-                } else if (ec == ERR_OBJECT_NOT_FOUND) {
-                    auto init_partition_count = app->init_partition_count > 0
-                                                    ? app->init_partition_count
-                                                    : app->partition_count;
-                    if (partition_id < init_partition_count) {
-                        LOG_WARNING(
-                            "partition node {} not exist on remote storage, may half create before",
-                            partition_path);
-                        init_app_partition_node(app, partition_id, nullptr);
-                    } else if (partition_id >= app->partition_count / 2) {
-                        LOG_WARNING(
-                            "partition node {} not exist on remote storage, may half split before",
-                            partition_path);
-                        zauto_write_lock l(_lock);
-                        app->helpers->split_states.status[partition_id - app->partition_count / 2] =
-                            split_status::SPLITTING;
-                        app->helpers->split_states.splitting_count++;
-                        app->partitions[partition_id].ballot = invalid_ballot;
-                        app->partitions[partition_id].pid = gpid(app->app_id, partition_id);
-                        process_one_partition(app);
-                    }
-
-                } else {
-                    LOG_ERROR("get partition node failed, reason({})", ec);
-                    err = ec;
-                }
-            },
-            &tracker);
-    };
+    // The apps are built without holding `_lock` since they are invisible to others until they
+    // are published in one step after all of their partitions are loaded.
+    std::vector<std::shared_ptr<app_state>> apps;
 
+    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
     auto sync_app = [&](const std::string &app_path) {
         storage->get_data(
             app_path,
             LPC_META_CALLBACK,
-            [this, app_path, &err, &sync_partition](error_code ec, const blob &value) {
+            [app_path, &err, &apps, &sync_lock](error_code ec, const blob &value) {
                 if (ec == ERR_OK) {
                     app_info info;
                     CHECK(dsn::json::json_forwarder<app_info>::decode(value, info),
                           "invalid json data");
-                    std::shared_ptr<app_state> app = app_state::create(info);
-                    {
-                        zauto_write_lock l(_lock);
-                        _all_apps.emplace(app->app_id, app);
-                        if (app->status == app_status::AS_AVAILABLE) {
-                            app->status = app_status::AS_CREATING;
-                            _exist_apps.emplace(app->app_name, app);
-                            _table_metric_entities.create_entity(app->app_id, app->partition_count);
-                        } else if (app->status == app_status::AS_DROPPED) {
-                            app->status = app_status::AS_DROPPING;
-                        } else {
-                            CHECK(false,
-                                  "invalid status({}) for app({}) in remote storage",
-                                  enum_to_string(app->status),
-                                  app->get_logname());
-                        }
-                    }
-                    app->helpers->split_states.splitting_count = 0;
-                    for (int i = 0; i < app->partition_count; i++) {
-                        std::string partition_path =
-                            app_path + "/" + boost::lexical_cast<std::string>(i);
-                        sync_partition(app, i, partition_path);
-                    }
+                    zauto_lock l(sync_lock);
+                    apps.push_back(app_state::create(info));
                 } else {
                     LOG_ERROR("get app info from meta state service failed, path = {}, err = {}",
                               app_path,
                               ec);
+                    zauto_lock l(sync_lock);
                     err = ec;
                 }
             },
             &tracker);
     };
 
-    _all_apps.clear();
-    _exist_apps.clear();
-    _table_metric_entities.clear_entities();
+    {
+        zauto_write_lock l(_lock);
+        _all_apps.clear();
+        _exist_apps.clear();
+        _table_metric_entities.clear_entities();
+    }
 
     std::string transaction_state;
     storage
@@ -703,26 +651,148 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
     storage->get_children(
         _apps_root,
         LPC_META_CALLBACK,
-        [&](error_code ec, const std::vector<std::string> &apps) {
+        [&](error_code ec, const std::vector<std::string> &app_ids) {
             if (ec == ERR_OK) {
-                for (const auto &appid_str : apps) {
+                for (const auto &appid_str : app_ids) {
                     sync_app(_apps_root + "/" + appid_str);
                 }
             } else {
                 LOG_ERROR("get app list from meta state service failed, path = {}, err = {}",
                           _apps_root,
                           ec);
+                zauto_lock l(sync_lock);
                 err = ec;
             }
         },
         &tracker);
     tracker.wait_outstanding_tasks();
+    if (err != ERR_OK) {
+        return err;
+    }
+
+    // Load the partition nodes of all the apps, at most FLAGS_max_concurrent_partition_loads of
+    // which are read concurrently. Each callback decodes the configuration into its own slot,
+    // thus no lock is needed.
+    std::vector<std::vector<error_code>> load_results(apps.size());
+    utils::semaphore load_slots(FLAGS_max_concurrent_partition_loads);
+    for (size_t i = 0; i < apps.size(); ++i) {
+        const auto &app = apps[i];
+        auto &results = load_results[i];
+        results.resize(app->partition_count);
+        for (int pidx = 0; pidx < app->partition_count; ++pidx) {
+            load_slots.wait();
+            storage->get_data(
+                get_partition_path(*app, pidx),
+                LPC_META_CALLBACK,
+                [app, pidx, &results, &load_slots](error_code ec, const blob &value) {
+                    if (ec == ERR_OK) {
+                        partition_configuration pc;
+                        CHECK(decode_partition_configuration(value, pc),
+                              "invalid partition config of {}.{}",
+                              app->app_id,
+                              pidx);
+                        CHECK(pc.pid.get_app_id() == app->app_id &&
+                                  pc.pid.get_partition_index() == pidx,
+                              "invalid partition config");
+                        app->partitions[pidx] = std::move(pc);
+                    }
+                    results[pidx] = ec;
+                    load_slots.signal();
+                },
+                &tracker);
+        }
+    }
+    tracker.wait_outstanding_tasks();
+
+    // Publish the apps and process their partitions in one step.
+    std::vector<std::pair<std::shared_ptr<app_state>, int>> missing_partitions;
+    {
+        zauto_write_lock l(_lock);
+        for (size_t i = 0; i < apps.size(); ++i) {
+            auto &app = apps[i];
+            _all_apps.emplace(app->app_id, app);
+            if (app->status == app_status::AS_AVAILABLE) {
+                app->status = app_status::AS_CREATING;
+                _exist_apps.emplace(app->app_name, app);
+                _table_metric_entities.create_entity(app->app_id, app->partition_count);
+            } else if (app->status == app_status::AS_DROPPED) {
+                app->status = app_status::AS_DROPPING;
+            } else {
+                CHECK(false,
+                      "invalid status({}) for app({}) in remote storage",
+                      enum_to_string(app->status),
+                      app->get_logname());
+            }
+
+            app->helpers->split_states.splitting_count = 0;
+            for (int pidx = 0; pidx < app->partition_count; ++pidx) {
+                const error_code ec = load_results[i][pidx];
+                if (ec == ERR_OK) {
+                    on_partition_loaded_from_remote_storage(app, pidx);
+                } else if (ec == ERR_OBJECT_NOT_FOUND) {
+                    auto init_partition_count = app->init_partition_count > 0
+                                                    ? app->init_partition_count
+                                                    : app->partition_count;
+                    if (pidx < init_partition_count) {
+                        LOG_WARNING("partition node {} not exist on remote storage, may half "
+                                    "create before",
+                                    get_partition_path(*app, pidx));
+                        // The node is created after `_lock` is released.
+                        missing_partitions.emplace_back(app, pidx);
+                    } else if (pidx >= app->partition_count / 2) {
+                        LOG_WARNING("partition node {} not exist on remote storage, may half "
+                                    "split before",
+                                    get_partition_path(*app, pidx));
+                        app->helpers->split_states.status[pidx - app->partition_count / 2] =
+                            split_status::SPLITTING;
+                        app->helpers->split_states.splitting_count++;
+                        app->partitions[pidx].ballot = invalid_ballot;
+                        app->partitions[pidx].pid = gpid(app->app_id, pidx);
+                        process_one_partition(app);
+                    }
+                } else {
+                    LOG_ERROR("get partition node failed, reason({})", ec);
+                    err = ec;
+                }
+            }
+        }
+    }
+
+    for (auto &partition : missing_partitions) {
+        init_app_partition_node(partition.first, partition.second, nullptr);
+    }
+
     if (err == ERR_OK) {
         return _all_apps.empty() ? ERR_OBJECT_NOT_FOUND : ERR_OK;
     }
     return err;
 }
 
+void server_state::on_partition_loaded_from_remote_storage(std::shared_ptr<app_state> &app,
+                                                           int pidx)
+{
+    const partition_configuration &pc = app->partitions[pidx];
+    for (const auto &hp : pc.hp_last_drops) {
+        app->helpers->contexts[pidx].record_drop_history(hp);
+    }
+
+    if (app->status == app_status::AS_CREATING && (pc.partition_flags & pc_flags::dropped) != 0) {
+        recall_partition(app, pidx);
+    } else if (app->status == app_status::AS_DROPPING &&
+               (pc.partition_flags & pc_flags::dropped) == 0) {
+        drop_partition(app, pidx);
+    } else {
+        process_one_partition(app);
+    }
+
+    // check consistency between app bulk_loading flag and app bulk load dir
+    if (app->helpers->partitions_in_progress.load() == 0 &&
+        app->status == app_status::AS_AVAILABLE && _meta_svc->get_bulk_load_service()) {
+        bool is_bulk_loading = app->is_bulk_loading;
+        _meta_svc->get_bulk_load_service()->check_app_bulk_load_states(app, is_bulk_loading);
+    }
+}
+
 void server_state::initialize_node_state()
 {
     zauto_write_lock l(_lock);
@@ -1044,8 +1114,7 @@ void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
     };
 
     std::string app_partition_path = get_partition_path(*app, pidx);
-    dsn::blob value =
-        dsn::json::json_forwarder<partition_configuration>::encode(app->partitions[pidx]);
+    dsn::blob value = encode_partition_configuration(app->partitions[pidx]);
     _meta_svc->get_remote_storage()->create_node(
         app_partition_path, LPC_META_STATE_HIGH, on_create_app_partition, value);
 }
@@ -1689,8 +1758,10 @@ task_ptr server_state::update_configuration_on_remote(
     partition_configuration &pc = config_request->config;
     std::string storage_path = get_partition_path(pc.pid);
 
-    blob json_config = dsn::json::json_forwarder<partition_configuration>::encode(pc);
-    return _meta_svc->get_remote_storage()->set_data(
+    blob json_config = encode_partition_configuration(pc);
+    // The configuration of a partition is updated only once the previous update has been
+    // replied, thus the updates of many partitions could be committed in batches.
+    return _meta_svc->get_remote_storage()->set_data_batched(
         storage_path,
         json_config,
         LPC_META_STATE_HIGH,
@@ -1784,7 +1855,7 @@ void server_state::recall_partition(std::shared_ptr<app_state> &app, int pidx)
     CHECK((pc.partition_flags & pc_flags::dropped), "");
 
     pc.partition_flags = 0;
-    blob json_partition = dsn::json::json_forwarder<partition_configuration>::encode(pc);
+    blob json_partition = encode_partition_configuration(pc);
     std::string partition_path = get_partition_path(pc.pid);
     _meta_svc->get_remote_storage()->set_data(
         partition_path, json_partition, LPC_META_STATE_HIGH, on_recall_partition);
@@ -3725,8 +3796,7 @@ task_ptr server_state::update_partition_max_replica_count_on_remote(
              new_ballot);
 
     auto partition_path = get_partition_path(gpid);
-    auto json_config =
-        dsn::json::json_forwarder<partition_configuration>::encode(new_partition_config);
+    auto json_config = encode_partition_configuration(new_partition_config);
     return _meta_svc->get_remote_storage()->set_data(
         partition_path,
         json_config,
@@ -3929,7 +3999,7 @@ void server_state::recover_all_partitions_max_replica_count(std::shared_ptr<app_
         new_pc.max_replica_count = new_max_replica_count;
         ++(new_pc.ballot);
         auto partition_path = get_partition_path(new_pc.pid);
-        auto value = dsn::json::json_forwarder<partition_configuration>::encode(new_pc);
+        auto value = encode_partition_configuration(new_pc);
         _meta_svc->get_remote_storage()->set_data(
             partition_path,
             value,
@@ -182,6 +182,9 @@ public:
     // dump & restore
     error_code dump_from_remote_storage(const char *local_path, bool sync_immediately);
     error_code restore_from_local_storage(const char *local_path);
+    // Dump the partitions and the replica loads to a local file, which could be loaded by the
+    // balancer simulator to validate the load-aware balancer offline.
+    error_code dump_cluster_load(const std::string &local_path);
 
     void on_change_node_state(const host_port &node, bool is_alive);
     void on_propose_balancer(const configuration_balancer_request &request,
@@ -229,6 +232,9 @@ private:
     error_code dump_app_states(const char *local_path,
                                const std::function<app_state *()> &iterator);
     error_code sync_apps_from_remote_storage();
+    // Process the partition whose configuration has been loaded into `app` by
+    // sync_apps_from_remote_storage(), should be called with _lock held.
+    void on_partition_loaded_from_remote_storage(std::shared_ptr<app_state> &app, int pidx);
     // sync local state to remote storage,
     // if return OK, all states are synced correctly, and all apps are in stable state
     // else indicate error that remote storage responses
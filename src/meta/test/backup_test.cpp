@@ -30,7 +30,10 @@
 #include <vector>
 
 #include "backup_types.h"
+#include "block_service/block_service.h"
+#include "common/backup_common.h"
 #include "common/gpid.h"
+#include "common/json_helper.h"
 #include "common/replication.codes.h"
 #include "dsn.layer2_types.h"
 #include "gtest/gtest.h"
@@ -52,12 +55,14 @@
 #include "runtime/task/task.h"
 #include "runtime/task/task_code.h"
 #include "utils/autoref_ptr.h"
+#include "utils/blob.h"
 #include "utils/chrono_literals.h"
 #include "utils/error_code.h"
 #include "utils/fail_point.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
 #include "utils/synchronize.h"
+#include "utils/test_macros.h"
 #include "utils/time_utils.h"
 #include "utils/zlocks.h"
 
@@ -279,6 +284,49 @@ protected:
         ASSERT_EQ(dsn::ERR_OK, ec);
     }
 
+    void write_remote_file(const std::string &path, const std::string &content)
+    {
+        dist::block_service::create_file_request cf_req;
+        cf_req.file_name = path;
+        cf_req.ignore_metadata = true;
+        dist::block_service::block_file_ptr file;
+        _mp._block_service
+            ->create_file(cf_req,
+                          TASK_CODE_EXEC_INLINED,
+                          [&file](const dist::block_service::create_file_response &resp) {
+                              ASSERT_EQ(ERR_OK, resp.err);
+                              file = resp.file_handle;
+                          })
+            ->wait();
+        ASSERT_NE(nullptr, file);
+
+        dist::block_service::write_request w_req;
+        w_req.buffer = blob::create_from_bytes(std::string(content));
+        file->write(w_req,
+                    TASK_CODE_EXEC_INLINED,
+                    [](const dist::block_service::write_response &resp) {
+                        ASSERT_EQ(ERR_OK, resp.err);
+                    })
+            ->wait();
+    }
+
+    std::set<std::string> list_remote_files(const std::string &dir)
+    {
+        std::set<std::string> files;
+        _mp._block_service
+            ->list_dir(dist::block_service::ls_request{dir},
+                       TASK_CODE_EXEC_INLINED,
+                       [&files](const dist::block_service::ls_response &resp) {
+                           for (const auto &entry : *resp.entries) {
+                               if (!entry.is_directory) {
+                                   files.insert(entry.entry_name);
+                               }
+                           }
+                       })
+            ->wait();
+        return files;
+    }
+
     const std::string policy_root = "/test";
     const std::string policy_dir = "/test/" + test_policy_name;
 
@@ -633,6 +681,64 @@ TEST_F(policy_context_test, test_backup_failed)
     fail::teardown();
 }
 
+TEST_F(policy_context_test, test_gc_shared_files)
+{
+    const std::string app_name("app1");
+    const gpid pid(1, 0);
+    const auto &root = _service->_backup_handler->backup_root();
+    std::vector<file_meta> files;
+    for (const auto &name : {"a.sst", "b.sst", "c.sst"}) {
+        file_meta f_meta;
+        f_meta.name = name;
+        f_meta.size = 10;
+        f_meta.md5 = fmt::format("md5_{}", name);
+        files.emplace_back(f_meta);
+    }
+    const auto shared_files_dir = cold_backup::get_replica_shared_files_dir(root, app_name, pid);
+    for (const auto &f_meta : files) {
+        NO_FATALS(write_remote_file(
+            fmt::format("{}/{}",
+                        shared_files_dir,
+                        cold_backup::get_shared_file_name(f_meta.name, f_meta.size, f_meta.md5)),
+            "data"));
+    }
+
+    // Backup 1 has been removed, and the remaining backup 2 references a.sst and c.sst only.
+    cold_backup_metadata metadata;
+    metadata.files = {files[0], files[2]};
+    metadata.shared_files = {files[0].name, files[2].name};
+    const auto buffer = json::json_forwarder<cold_backup_metadata>::encode(metadata);
+    NO_FATALS(write_remote_file(cold_backup::get_remote_chkpt_meta_file(root, app_name, pid, 2),
+                                buffer.to_string()));
+
+    backup_info gced_info;
+    gced_info.backup_id = 1;
+    gced_info.app_ids = {pid.get_app_id()};
+    gced_info.app_names[pid.get_app_id()] = app_name;
+    _mp.gc_shared_files(gced_info);
+
+    ASSERT_EQ(
+        std::set<std::string>(
+            {cold_backup::get_shared_file_name(files[0].name, files[0].size, files[0].md5),
+             cold_backup::get_shared_file_name(files[2].name, files[2].size, files[2].md5)}),
+        list_remote_files(shared_files_dir));
+
+    for (const auto &path :
+         {cold_backup::get_backup_path(root, 2),
+          fmt::format("{}/{}", root, cold_backup_constant::SHARED_FILES)}) {
+        dist::block_service::remove_path_request req;
+        req.path = path;
+        req.recursive = true;
+        _mp._block_service
+            ->remove_path(req,
+                          TASK_CODE_EXEC_INLINED,
+                          [](const dist::block_service::remove_path_response &resp) {
+                              ASSERT_EQ(ERR_OK, resp.err);
+                          })
+            ->wait();
+    }
+}
+
 // test should_start_backup_unlock()
 TEST_F(policy_context_test, test_should_start_backup)
 {
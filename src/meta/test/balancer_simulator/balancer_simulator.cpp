@@ -24,10 +24,15 @@
  * THE SOFTWARE.
  */
 
+#include <fmt/core.h>
+#include <stdint.h>
 #include <algorithm>
+#include <fstream>
+#include <iostream>
 #include <map>
 #include <memory>
 #include <queue>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -37,6 +42,7 @@
 #include "common/replication_other_types.h"
 #include "dsn.layer2_types.h"
 #include "meta/greedy_load_balancer.h"
+#include "meta/load_aware_balance_policy.h"
 #include "meta/meta_data.h"
 #include "meta/server_load_balancer.h"
 #include "meta/test/misc/misc.h"
@@ -193,9 +199,139 @@ void greedy_balancer_perfect_move_primary()
     }
 }
 
-int main(int, char **)
+// Apply the moves decided by the load-aware balancer to the simulated cluster, where the loads of
+// the replicas are moved along with them. Returns the bytes copied by the moves.
+int64_t apply_load_migration(app_mapper &apps, node_mapper &nodes, const migration_list &ml)
+{
+    int64_t copied_bytes = 0;
+    for (const auto &kv : ml) {
+        const configuration_balancer_request &req = *kv.second;
+        const auto &app = apps.at(req.gpid.get_app_id());
+        dsn::partition_configuration &pc = app->partitions[req.gpid.get_partition_index()];
+        config_context &cc = app->helpers->contexts[req.gpid.get_partition_index()];
+
+        std::vector<dsn::host_port> members;
+        members.push_back(pc.hp_primary);
+        members.insert(members.end(), pc.hp_secondaries.begin(), pc.hp_secondaries.end());
+
+        dsn::host_port from, to;
+        switch (req.balance_type) {
+        case balancer_request_type::move_primary: {
+            GET_HOST_PORT(req.action_list[0], node, from);
+            GET_HOST_PORT(req.action_list[1], node, to);
+            std::swap(cc.find_from_serving(from)->load, cc.find_from_serving(to)->load);
+            std::swap(members[0], *std::find(members.begin(), members.end(), to));
+            nodes[from].remove_partition(pc.pid, true);
+            nodes[to].put_partition(pc.pid, true);
+            break;
+        }
+        case balancer_request_type::copy_primary:
+        case balancer_request_type::copy_secondary: {
+            GET_HOST_PORT(req.action_list[0], node, to);
+            GET_HOST_PORT(req.action_list.back(), node, from);
+            auto replica = cc.find_from_serving(from);
+            copied_bytes += replica->load.storage_bytes;
+            replica->node = to;
+            *std::find(members.begin(), members.end(), from) = to;
+            nodes[from].remove_partition(pc.pid, false);
+            nodes[to].put_partition(pc.pid, members[0] == to);
+            break;
+        }
+        default:
+            CHECK(false, "invalid balance type");
+        }
+
+        RESET_IP_AND_HOST_PORT(pc, primary);
+        CLEAR_IP_AND_HOST_PORT(pc, secondaries);
+        SET_IP_AND_HOST_PORT_BY_DNS(pc, primary, members[0]);
+        for (size_t i = 1; i < members.size(); ++i) {
+            ADD_IP_AND_HOST_PORT_BY_DNS(pc, secondaries, members[i]);
+        }
+
+        // The loads are moved instantly in the simulation, thus have been measured under the
+        // new configuration.
+        ++pc.ballot;
+        for (auto &replica : cc.serving) {
+            replica.load.measured_ballot = pc.ballot;
+        }
+    }
+    return copied_bytes;
+}
+
+void print_cluster_load(const std::string &stage, app_mapper &apps, node_mapper &nodes)
+{
+    const cluster_load loads({&apps, &nodes});
+    std::cout << fmt::format("{}: mean load = {:.3f}, max/median = {:.3f}",
+                             stage,
+                             loads.mean_node_load(),
+                             loads.max_to_median_ratio())
+              << std::endl;
+    for (const auto &kv : loads.node_loads()) {
+        std::cout << fmt::format("  {}: {:.3f}", kv.first, kv.second) << std::endl;
+    }
+}
+
+// Simulate the load-aware balancer round by round over the cluster load dumped by the remote
+// command "meta.lb.dump_cluster_load", until no more move could be decided.
+bool simulate_load_aware_balancer(const char *dump_file)
+{
+    std::ifstream in(dump_file);
+    if (!in) {
+        std::cerr << "failed to open " << dump_file << std::endl;
+        return false;
+    }
+    std::stringstream json;
+    json << in.rdbuf();
+
+    app_mapper apps;
+    node_mapper nodes;
+    if (!restore_cluster_load(json.str(), apps, nodes)) {
+        std::cerr << "failed to restore the cluster load from " << dump_file << std::endl;
+        return false;
+    }
+    print_cluster_load("before balance", apps, nodes);
+
+    static const int kMaxRounds = 1000;
+    load_aware_balance_policy policy(nullptr);
+    size_t total_moves = 0;
+    int64_t total_copied_bytes = 0;
+    for (int round = 1; round <= kMaxRounds; ++round) {
+        migration_list ml;
+        const meta_view view = {&apps, &nodes};
+        policy.balance(false, &view, &ml);
+        if (ml.empty()) {
+            break;
+        }
+
+        const int64_t copied_bytes = apply_load_migration(apps, nodes, ml);
+        total_moves += ml.size();
+        total_copied_bytes += copied_bytes;
+        const cluster_load loads(view);
+        std::cout << fmt::format("round {}: moves = {}, copied MB = {}, max/median = {:.3f}",
+                                 round,
+                                 ml.size(),
+                                 copied_bytes >> 20,
+                                 loads.max_to_median_ratio())
+                  << std::endl;
+    }
+
+    print_cluster_load("after balance", apps, nodes);
+    std::cout << fmt::format("total moves = {}, total copied MB = {}",
+                             total_moves,
+                             total_copied_bytes >> 20)
+              << std::endl;
+    return true;
+}
+
+// Usage: sim_lb [<cluster_load_dump_file>]
+// Without arguments, the greedy balancer is simulated over a randomly generated cluster.
+int main(int argc, char **argv)
 {
     dsn_run_config("config.ini", false);
+    if (argc > 1) {
+        return simulate_load_aware_balancer(argv[1]) ? 0 : 1;
+    }
+
     greedy_balancer_perfect_move_primary();
     return 0;
 }
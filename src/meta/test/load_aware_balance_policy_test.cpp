@@ -0,0 +1,200 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <fmt/core.h>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json_fwd.hpp>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/gpid.h"
+#include "common/replication_other_types.h"
+#include "gtest/gtest.h"
+#include "meta/load_aware_balance_policy.h"
+#include "meta/meta_data.h"
+#include "meta_admin_types.h"
+#include "metadata_types.h"
+#include "runtime/rpc/rpc_host_port.h"
+
+namespace dsn {
+namespace replication {
+
+TEST(load_aware_balance_policy, replica_load_update)
+{
+    replica_load load;
+    replica_load_stats stats;
+    stats.read_cu = 100;
+    stats.write_cu = 10;
+    stats.network_bytes = 1000;
+    stats.storage_bytes = 4096;
+
+    // The first report only records the cumulative stats.
+    load.update(stats, 1, 1000);
+    ASSERT_EQ(0, load.read_cu);
+    ASSERT_EQ(4096, load.storage_bytes);
+    ASSERT_EQ(invalid_ballot, load.measured_ballot);
+
+    stats.read_cu += 200;
+    stats.write_cu += 20;
+    stats.network_bytes += 2000;
+    load.update(stats, 1, 3000);
+    ASSERT_DOUBLE_EQ(100, load.read_cu);
+    ASSERT_DOUBLE_EQ(10, load.write_cu);
+    ASSERT_DOUBLE_EQ(1000, load.network_bytes);
+    ASSERT_EQ(1, load.measured_ballot);
+
+    // The configuration was changed between the 2 reports.
+    stats.read_cu += 200;
+    load.update(stats, 2, 5000);
+    ASSERT_DOUBLE_EQ(100, load.read_cu);
+    ASSERT_EQ(invalid_ballot, load.measured_ballot);
+
+    // The cumulative stats were reset by reopening the replica.
+    stats.read_cu = 0;
+    load.update(stats, 2, 7000);
+    ASSERT_DOUBLE_EQ(100, load.read_cu);
+    ASSERT_EQ(invalid_ballot, load.measured_ballot);
+
+    stats.read_cu = 400;
+    load.update(stats, 2, 9000);
+    ASSERT_DOUBLE_EQ(200, load.read_cu);
+    ASSERT_EQ(2, load.measured_ballot);
+}
+
+class load_aware_balance_policy_test : public testing::Test
+{
+protected:
+    static constexpr int kNodeCount = 4;
+
+    // Build the dump of a cluster whose replica counts are balanced, while the primaries of
+    // partition 0 and 1 on node 0 are much hotter than the others.
+    static nlohmann::json build_cluster_load()
+    {
+        nlohmann::json root;
+        for (int i = 0; i < kNodeCount; ++i) {
+            const auto address = fmt::format("127.0.0.1:{}", 34801 + i);
+            root["nodes"].push_back({{"host_port", address}, {"address", address}});
+        }
+
+        const std::vector<std::vector<int>> members = {{0, 1, 2}, {0, 2, 3}, {1, 2, 3}, {3, 0, 1}};
+        const std::vector<double> primary_read_cu = {1000, 1000, 100, 100};
+        nlohmann::json app = {{"app_id", 1},
+                              {"app_name", "test"},
+                              {"app_type", "pegasus"},
+                              {"partition_count", members.size()},
+                              {"max_replica_count", 3}};
+        for (size_t i = 0; i < members.size(); ++i) {
+            nlohmann::json partition = {{"ballot", 3}};
+            for (size_t j = 0; j < members[i].size(); ++j) {
+                partition["replicas"].push_back({{"node", members[i][j]},
+                                                 {"primary", j == 0},
+                                                 {"read_cu", j == 0 ? primary_read_cu[i] : 0},
+                                                 {"write_cu", 0},
+                                                 {"network_bytes", 0},
+                                                 {"storage_bytes", 1L << 30}});
+            }
+            app["partitions"].push_back(partition);
+        }
+        root["apps"].push_back(app);
+        return root;
+    }
+
+    void restore(const nlohmann::json &root)
+    {
+        ASSERT_TRUE(restore_cluster_load(root.dump(), _apps, _nodes));
+        ASSERT_EQ(kNodeCount, _nodes.size());
+        ASSERT_EQ(1, _apps.size());
+    }
+
+    migration_list balance()
+    {
+        migration_list ml;
+        const meta_view view = {&_apps, &_nodes};
+        load_aware_balance_policy policy(nullptr);
+        policy.balance(false, &view, &ml);
+        return ml;
+    }
+
+    host_port node(int i) const { return host_port("127.0.0.1", 34801 + i); }
+
+    app_mapper _apps;
+    node_mapper _nodes;
+};
+
+TEST_F(load_aware_balance_policy_test, dump_and_restore)
+{
+    ASSERT_NO_FATAL_FAILURE(restore(build_cluster_load()));
+    const cluster_load loads({&_apps, &_nodes});
+    ASSERT_GT(loads.get_node_load(node(0)), loads.mean_node_load());
+    ASSERT_GT(loads.max_to_median_ratio(), 2);
+
+    const auto dumped = dump_cluster_load({&_apps, &_nodes});
+    app_mapper apps;
+    node_mapper nodes;
+    ASSERT_TRUE(restore_cluster_load(dumped, apps, nodes));
+    const cluster_load restored_loads({&apps, &nodes});
+    ASSERT_EQ(loads.node_loads(), restored_loads.node_loads());
+
+    ASSERT_FALSE(restore_cluster_load("{}", apps, nodes));
+    ASSERT_FALSE(restore_cluster_load("not a json", apps, nodes));
+}
+
+TEST_F(load_aware_balance_policy_test, move_primary_from_hot_node)
+{
+    ASSERT_NO_FATAL_FAILURE(restore(build_cluster_load()));
+
+    // Moving the primary of partition 0 to the coldest secondary relieves node 0 without
+    // copying any data, after which no move could reduce the imbalance any more.
+    const auto ml = balance();
+    ASSERT_EQ(1, ml.size());
+    const auto &req = *ml.begin()->second;
+    ASSERT_EQ(gpid(1, 0), req.gpid);
+    ASSERT_EQ(balancer_request_type::move_primary, req.balance_type);
+    ASSERT_EQ(node(0), req.action_list[0].hp_node);
+    ASSERT_EQ(node(2), req.action_list[1].hp_node);
+}
+
+TEST_F(load_aware_balance_policy_test, skip_balanced_cluster)
+{
+    auto root = build_cluster_load();
+    for (auto &partition : root["apps"][0]["partitions"]) {
+        for (auto &replica : partition["replicas"]) {
+            replica["read_cu"] = 100;
+        }
+    }
+    ASSERT_NO_FATAL_FAILURE(restore(root));
+    ASSERT_TRUE(balance().empty());
+}
+
+TEST_F(load_aware_balance_policy_test, wait_for_measured_loads)
+{
+    ASSERT_NO_FATAL_FAILURE(restore(build_cluster_load()));
+
+    // The configuration of partition 3 has been changed since its loads were measured.
+    ++_apps[1]->partitions[3].ballot;
+    ASSERT_TRUE(balance().empty());
+
+    for (auto &replica : _apps[1]->helpers->contexts[3].serving) {
+        replica.load.measured_ballot = _apps[1]->partitions[3].ballot;
+    }
+    ASSERT_EQ(1, balance().size());
+}
+
+} // namespace replication
+} // namespace dsn
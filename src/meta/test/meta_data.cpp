@@ -38,6 +38,12 @@
 #include "runtime/rpc/dns_resolver.h" // IWYU pragma: keep
 #include "runtime/rpc/rpc_address.h"
 #include "runtime/rpc/rpc_host_port.h"
+#include "test_util/test_util.h"
+#include "utils/blob.h"
+#include "utils/flags.h"
+#include "utils/test_macros.h"
+
+DSN_DECLARE_bool(encode_partition_configuration_in_binary);
 
 using namespace dsn::replication;
 
@@ -464,3 +470,41 @@ TEST(meta_data, construct_replica)
         ASSERT_EQ(2, cc.prefered_dropped);
     }
 }
+
+TEST(meta_data, encode_partition_configuration)
+{
+    PRESERVE_FLAG(encode_partition_configuration_in_binary);
+
+    dsn::partition_configuration pc;
+    pc.pid = dsn::gpid(1, 2);
+    pc.ballot = 10;
+    pc.max_replica_count = 3;
+    pc.last_committed_decree = 100;
+    pc.partition_flags = pc_flags::dropped;
+    const dsn::host_port primary("localhost", 34801);
+    const dsn::host_port secondary("localhost", 34802);
+    SET_IP_AND_HOST_PORT_BY_DNS(pc, primary, primary);
+    SET_IPS_AND_HOST_PORTS_BY_DNS(pc, secondaries, secondary);
+    SET_IPS_AND_HOST_PORTS_BY_DNS(pc, last_drops, primary, secondary);
+
+    for (const auto binary : {false, true}) {
+        FLAGS_encode_partition_configuration_in_binary = binary;
+        const auto value = encode_partition_configuration(pc);
+        // The binary format could be distinguished from JSON by its leading byte.
+        ASSERT_EQ(binary, value.data()[0] != '{');
+
+        // Both formats could always be decoded.
+        for (const auto decode_binary : {false, true}) {
+            FLAGS_encode_partition_configuration_in_binary = decode_binary;
+            dsn::partition_configuration decoded_pc;
+            ASSERT_TRUE(decode_partition_configuration(value, decoded_pc));
+            ASSERT_EQ(pc, decoded_pc);
+        }
+    }
+
+    // The unsupported versions of the binary format are rejected.
+    dsn::partition_configuration decoded_pc;
+    const std::string unknown_version("\0\x7f", 2);
+    ASSERT_FALSE(decode_partition_configuration(dsn::blob::create_from_bytes(unknown_version),
+                                                decoded_pc));
+}
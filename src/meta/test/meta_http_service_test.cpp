@@ -33,6 +33,7 @@
 #include "http/http_status_code.h"
 #include "meta/meta_backup_service.h"
 #include "meta/meta_bulk_load_service.h"
+#include "meta/meta_audit_log.h"
 #include "meta/meta_data.h"
 #include "meta/meta_http_service.h"
 #include "meta/meta_service.h"
@@ -48,6 +49,10 @@
 #include "utils/chrono_literals.h"
 #include "utils/error_code.h"
 #include "utils/fail_point.h"
+#include "utils/flags.h"
+#include "utils/test_macros.h"
+
+DSN_DECLARE_uint32(max_audit_record_count);
 
 namespace dsn {
 namespace replication {
@@ -100,6 +105,34 @@ public:
         ASSERT_EQ(fake_json, fake_resp.body);
     }
 
+    void test_query_audit_log()
+    {
+        PRESERVE_FLAG(max_audit_record_count);
+        FLAGS_max_audit_record_count = 2;
+
+        auto &audit_log = _ms->get_audit_log();
+        audit_log.append("propose_balancer", "2.0", "", "read hotspot", ERR_OK);
+        audit_log.append("propose_balancer", "2.1", "", "read hotspot", ERR_INVALID_PARAMETERS);
+        audit_log.append("start_partition_split", test_app, "", "write hotspot", ERR_OK);
+
+        // Only the latest records are kept.
+        const auto records = audit_log.records();
+        ASSERT_EQ(2, records.size());
+        ASSERT_EQ(2, records[0].id);
+        ASSERT_EQ(ERR_INVALID_PARAMETERS, records[0].result);
+        ASSERT_EQ("start_partition_split", records[1].operation);
+
+        http_request fake_req;
+        http_response fake_resp;
+        _mhs->query_audit_log_handler(fake_req, fake_resp);
+        ASSERT_EQ(http_status_code::kOk, fake_resp.status_code)
+            << get_http_status_message(fake_resp.status_code);
+        ASSERT_EQ(std::string::npos, fake_resp.body.find(R"("2.0")"));
+        ASSERT_NE(std::string::npos, fake_resp.body.find(R"("2.1")"));
+        ASSERT_NE(std::string::npos, fake_resp.body.find(R"("write hotspot")"));
+        ASSERT_NE(std::string::npos, fake_resp.body.find(R"("ERR_INVALID_PARAMETERS")"));
+    }
+
     std::unique_ptr<meta_http_service> _mhs;
     std::string test_app = "test_meta_http";
 };
@@ -177,6 +210,8 @@ TEST_F(meta_http_service_test, get_app_from_primary) { test_get_app_from_primary
 
 TEST_F(meta_http_service_test, get_app_envs) { test_get_app_envs(); }
 
+TEST_F(meta_http_service_test, query_audit_log) { test_query_audit_log(); }
+
 TEST_F(meta_backup_test_base, get_backup_policy)
 {
     struct http_backup_policy_test
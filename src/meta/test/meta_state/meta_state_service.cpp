@@ -28,6 +28,8 @@
 
 #include <boost/lexical_cast.hpp>
 #include <chrono>
+#include <string>
+#include <vector>
 #include <thread>
 
 #include "gtest/gtest.h"
@@ -235,6 +237,52 @@ void provider_basic_test(const service_creator_func &service_creator,
     service_deleter(service);
 }
 
+void provider_batched_set_data_test(const service_creator_func &service_creator,
+                                    const service_deleter_func &service_deleter)
+{
+    auto service = service_creator();
+    service->create_node("/b", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+    const int node_count = 10;
+    for (int i = 0; i < node_count; ++i) {
+        service
+            ->create_node(
+                "/b/" + std::to_string(i), META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)
+            ->wait();
+    }
+
+    // The requests in a batch are called back with their own results, even if one of them
+    // fails the whole batch.
+    std::vector<task_ptr> tasks;
+    for (int i = 0; i <= node_count; ++i) {
+        // The last node does not exist.
+        const auto node = "/b/" + std::to_string(i);
+        const auto expected_err = i < node_count ? ERR_OK : ERR_OBJECT_NOT_FOUND;
+        tasks.push_back(service->set_data_batched(
+            node,
+            blob::create_from_bytes(node),
+            META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+            [expected_err](error_code ec) { CHECK_EQ(expected_err, ec); }));
+    }
+    for (const auto &tsk : tasks) {
+        tsk->wait();
+    }
+
+    for (int i = 0; i < node_count; ++i) {
+        const auto node = "/b/" + std::to_string(i);
+        service
+            ->get_data(node,
+                       META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                       [node](error_code ec, const blob &value) {
+                           CHECK_EQ(ERR_OK, ec);
+                           CHECK_EQ(node, value.to_string());
+                       })
+            ->wait();
+    }
+
+    service->delete_node("/b", true, META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+    service_deleter(service);
+}
+
 void recursively_create_node_callback(meta_state_service *service,
                                       dsn::task_tracker *tracker,
                                       const std::string &root,
@@ -303,6 +351,7 @@ TEST_P(meta_state_service_test, simple)
 
     provider_basic_test(simple_service_creator, simple_service_deleter);
     provider_recursively_create_delete_test(simple_service_creator, simple_service_deleter);
+    provider_batched_set_data_test(simple_service_creator, simple_service_deleter);
 
     std::string log_path = dsn::utils::filesystem::path_combine(
         service_app::current_service_app_info().data_dir, "meta_state_service.log");
@@ -323,4 +372,5 @@ TEST_P(meta_state_service_test, zookeeper)
 
     provider_basic_test(zookeeper_service_creator, zookeeper_service_deleter);
     provider_recursively_create_delete_test(zookeeper_service_creator, zookeeper_service_deleter);
+    provider_batched_set_data_test(zookeeper_service_creator, zookeeper_service_deleter);
 }
@@ -31,8 +31,15 @@
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "client/partitioned_batch.h"
 #include "common/common.h"
 #include "common/replication_other_types.h"
 #include "pegasus/client.h"
@@ -43,6 +50,7 @@
 #include "utils/api_utilities.h"
 #include "utils/binary_writer.h"
 #include "utils/error_code.h"
+#include "utils/flags.h"
 #include "utils/fmt_logging.h"
 #include "utils/ports.h"
 #include "utils/string_conv.h"
@@ -52,6 +60,22 @@
 namespace pegasus {
 namespace proxy {
 
+DSN_DEFINE_bool(pegasus.rproxy,
+                coalesce_pipelined_reads,
+                true,
+                "Whether to coalesce the reads of the GET/HGET/MGET/EXISTS commands parsed from "
+                "the same received message into one batch_get per partition. If false, only the "
+                "keys of a single MGET/EXISTS command are batched");
+DSN_TAG_VARIABLE(coalesce_pipelined_reads, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.rproxy,
+                  rpc_timeout_ms,
+                  2000,
+                  "The timeout in milliseconds of the requests sent to the Pegasus cluster for "
+                  "the Redis commands");
+DSN_TAG_VARIABLE(rpc_timeout_ms, FT_MUTABLE);
+DSN_DEFINE_validator(rpc_timeout_ms, [](uint32_t value) -> bool { return value > 0; });
+
 std::atomic_llong redis_parser::s_next_seqid(0);
 const char redis_parser::CR = '\015';
 const char redis_parser::LF = '\012';
@@ -72,6 +96,13 @@ std::unordered_map<std::string, redis_parser::redis_call_handler> redis_parser::
     {"INCRBY", redis_parser::g_incr_by},
     {"DECR", redis_parser::g_decr},
     {"DECRBY", redis_parser::g_decr_by},
+    {"MGET", redis_parser::g_mget},
+    {"MSET", redis_parser::g_mset},
+    {"EXISTS", redis_parser::g_exists},
+    {"HGET", redis_parser::g_hget},
+    {"HSET", redis_parser::g_hset},
+    {"HMGET", redis_parser::g_hmget},
+    {"HGETALL", redis_parser::g_hgetall},
 };
 
 redis_parser::redis_call_handler redis_parser::get_handler(const char *command, unsigned int length)
@@ -90,8 +121,7 @@ redis_parser::redis_parser(proxy_stub *op, dsn::message_ex *first_msg)
       _status(kStartArray),
       _current_size(),
       _total_length(0),
-      _current_buffer(nullptr),
-      _current_buffer_length(0),
+      _reading_buffer(false),
       _current_cursor(0)
 {
     ::dsn::apps::rrdb_client *r;
@@ -119,30 +149,23 @@ redis_parser::~redis_parser()
 
 void redis_parser::prepare_current_buffer()
 {
-    void *msg_buffer;
-    if (_current_buffer == nullptr) {
+    // move to the next non-empty buffer once the current one is consumed
+    while (_current_cursor >= _current_buffer.length()) {
+        CHECK_PREFIX_MSG(!_recv_buffers.empty(), "no more received data to parse");
         dsn::message_ex *first_msg = _recv_buffers.front();
-        CHECK_PREFIX_MSG(
-            first_msg->read_next(&msg_buffer, &_current_buffer_length),
-            "read dsn::message_ex* failed, msg from_address = {}, to_address = {}, rpc_name = {}",
-            first_msg->header->from_address,
-            first_msg->to_address,
-            first_msg->header->rpc_name);
-        _current_buffer = static_cast<char *>(msg_buffer);
+        if (_reading_buffer) {
+            first_msg->read_commit(_current_buffer.length());
+            _reading_buffer = false;
+        }
+
         _current_cursor = 0;
-    } else if (_current_cursor >= _current_buffer_length) {
-        dsn::message_ex *first_msg = _recv_buffers.front();
-        first_msg->read_commit(_current_buffer_length);
-        if (first_msg->read_next(&msg_buffer, &_current_buffer_length)) {
-            _current_buffer = static_cast<char *>(msg_buffer);
-            _current_cursor = 0;
+        if (first_msg->read_next(_current_buffer)) {
+            _reading_buffer = true;
         } else {
             // we have consume this message all over
             // reference is added in append message
             first_msg->release_ref();
             _recv_buffers.pop();
-            _current_buffer = nullptr;
-            prepare_current_buffer();
         }
     }
 }
@@ -157,11 +180,11 @@ void redis_parser::reset_parser()
 
     // clear the data stream
     _total_length = 0;
-    if (_current_buffer) {
-        _recv_buffers.front()->read_commit(_current_buffer_length);
+    if (_reading_buffer) {
+        _recv_buffers.front()->read_commit(_current_buffer.length());
+        _reading_buffer = false;
     }
-    _current_buffer = nullptr;
-    _current_buffer_length = 0;
+    _current_buffer = dsn::blob();
     _current_cursor = 0;
     while (!_recv_buffers.empty()) {
         _recv_buffers.front()->release_ref();
@@ -172,7 +195,13 @@ void redis_parser::reset_parser()
 char redis_parser::peek()
 {
     prepare_current_buffer();
-    return _current_buffer[_current_cursor];
+    return _current_buffer.data()[_current_cursor];
+}
+
+void redis_parser::skip(size_t length)
+{
+    _current_cursor += length;
+    _total_length -= length;
 }
 
 bool redis_parser::eat(char c)
@@ -182,8 +211,7 @@ bool redis_parser::eat(char c)
         return false;
     }
 
-    ++_current_cursor;
-    --_total_length;
+    skip(1);
     return true;
 }
 
@@ -193,11 +221,11 @@ void redis_parser::eat_all(char *dest, size_t length)
     while (length > 0) {
         prepare_current_buffer();
 
-        size_t eat_size = _current_buffer_length - _current_cursor;
+        size_t eat_size = _current_buffer.length() - _current_cursor;
         if (eat_size > length) {
             eat_size = length;
         }
-        memcpy(dest, _current_buffer + _current_cursor, eat_size);
+        memcpy(dest, _current_buffer.data() + _current_cursor, eat_size);
         dest += eat_size;
         _current_cursor += eat_size;
         length -= eat_size;
@@ -273,10 +301,60 @@ void redis_parser::append_message(dsn::message_ex *msg)
     LOG_DEBUG_PREFIX("recv message, currently total length: {}", _total_length);
 }
 
+bool redis_parser::parse_size_line(bool &completed)
+{
+    completed = false;
+    prepare_current_buffer();
+
+    // scan the whole span of the current buffer for CR rather than byte by byte
+    const char *begin = _current_buffer.data() + _current_cursor;
+    const size_t span = _current_buffer.length() - _current_cursor;
+    const auto *cr = static_cast<const char *>(memchr(begin, CR, span));
+    if (cr == nullptr) {
+        // the size line straddles the received buffers
+        _current_size.append(begin, span);
+        skip(span);
+        return true;
+    }
+
+    _current_size.append(begin, cr - begin);
+    skip(cr - begin);
+    if (_total_length <= 1) {
+        // wait for the LF
+        return true;
+    }
+
+    dverify(eat(CR));
+    dverify(eat(LF));
+    completed = true;
+    return true;
+}
+
+void redis_parser::parse_bulk_string_data()
+{
+    if (_current_str.length <= 0) {
+        return;
+    }
+
+    prepare_current_buffer();
+    const auto length = static_cast<size_t>(_current_str.length);
+    if (_current_buffer.length() - _current_cursor >= length) {
+        // the data lies in a single received buffer, which is referenced without copying
+        _current_str.data = _current_buffer.range(static_cast<int>(_current_cursor), length);
+        skip(length);
+        return;
+    }
+
+    // the data straddles the received buffers
+    std::string str_data(length, '\0');
+    eat_all(const_cast<char *>(str_data.data()), length);
+    _current_str.data = dsn::blob::create_from_bytes(std::move(str_data));
+}
+
 // refererence: http://redis.io/topics/protocol
 bool redis_parser::parse_stream()
 {
-    char t;
+    bool completed = false;
     while (_total_length > 0) {
         switch (_status) {
         case kStartArray:
@@ -289,32 +367,25 @@ bool redis_parser::parse_stream()
             break;
         case kInArraySize:
         case kInBulkStringSize:
-            t = peek();
-            if (t == CR) {
-                if (_total_length > 1) {
-                    dverify(eat(CR));
-                    dverify(eat(LF));
-                    if (kInArraySize == _status) {
-                        dverify(end_array_size());
-                    } else {
-                        dverify(end_bulk_string_size());
-                    }
-                } else {
+            dverify(parse_size_line(completed));
+            if (!completed) {
+                // wait for more data if only the CR of the size line is left, otherwise go on
+                // parsing the size line in the next received buffer
+                if (_total_length <= 1) {
                     return true;
                 }
+                break;
+            }
+            if (kInArraySize == _status) {
+                dverify(end_array_size());
             } else {
-                _current_size.push_back(t);
-                dverify(eat(t));
+                dverify(end_bulk_string_size());
             }
             break;
         case kStartBulkStringData:
             // string content + CR + LF
             if (_total_length >= _current_str.length + 2) {
-                if (_current_str.length > 0) {
-                    std::string str_data(_current_str.length, '\0');
-                    eat_all(const_cast<char *>(str_data.data()), _current_str.length);
-                    _current_str.data = dsn::blob::create_from_bytes(std::move(str_data));
-                }
+                parse_bulk_string_data();
                 dverify(eat(CR));
                 dverify(eat(LF));
                 append_current_bulk_string();
@@ -332,7 +403,13 @@ bool redis_parser::parse_stream()
 bool redis_parser::parse(dsn::message_ex *msg)
 {
     append_message(msg);
-    if (parse_stream()) {
+    const bool succeed = parse_stream();
+
+    // the commands parsed before a failure have been in the pending responses queue,
+    // so their reads should be sent anyway.
+    flush_pending_reads();
+
+    if (succeed) {
         return true;
     } else {
         // when parse a new message failed, we only reset the parser.
@@ -487,8 +564,11 @@ void redis_parser::set_internal(redis_parser::message_entry &entry)
         else
             req.expire_ts_seconds = ttl_seconds + utils::epoch_now();
         auto partition_hash = pegasus_key_hash(req.key);
-        // TODO: set the timeout
-        client->put(req, on_set_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        client->put(req,
+                    on_set_reply,
+                    std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                    0,
+                    partition_hash);
     }
 }
 
@@ -526,7 +606,7 @@ void redis_parser::set_geo_internal(message_entry &entry)
                                std::string(),                                  // ""  => sort_key
                                redis_request.sub_requests[2].data.to_string(), // value
                                set_callback,
-                               2000, // TODO: set the timeout
+                               FLAGS_rpc_timeout_ms,
                                ttl_seconds);
     }
 }
@@ -585,8 +665,11 @@ void redis_parser::setex(message_entry &entry)
 
         auto partition_hash = pegasus_key_hash(req.key);
 
-        // TODO: set the timeout
-        client->put(req, on_setex_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        client->put(req,
+                    on_setex_reply,
+                    std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                    0,
+                    partition_hash);
     }
 }
 
@@ -598,40 +681,8 @@ void redis_parser::get(message_entry &entry)
         simple_error_reply(entry, "wrong number of arguments for 'get' command");
     } else {
         LOG_DEBUG_PREFIX("send GET command seqid({})", entry.sequence_id);
-        std::shared_ptr<proxy_session> ref_this = shared_from_this();
-        auto on_get_reply = [ref_this, this, &entry](
-            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
-            if (_is_session_reset.load(std::memory_order_acquire)) {
-                LOG_INFO_PREFIX("GET command({}) got reply, but session has reset",
-                                entry.sequence_id);
-                return;
-            }
-
-            if (::dsn::ERR_OK != ec) {
-                LOG_INFO_PREFIX(
-                    "GET command seqid({}) got reply with error = {}", entry.sequence_id, ec);
-                simple_error_reply(entry, ec.to_string());
-            } else {
-                ::dsn::apps::read_response rrdb_response;
-                ::dsn::unmarshall(response, rrdb_response);
-                if (rrdb_response.error != 0) {
-                    if (rrdb_response.error == rocksdb::Status::kNotFound) {
-                        reply_message(entry, redis_bulk_string());
-                    } else {
-                        simple_error_reply(entry,
-                                           "internal error " + std::to_string(rrdb_response.error));
-                    }
-                } else {
-                    reply_message(entry, redis_bulk_string(rrdb_response.value));
-                }
-            }
-        };
-        ::dsn::blob req;
-        ::dsn::blob null_blob;
-        pegasus_generate_key(req, redis_req.sub_requests[1].data, null_blob);
-        auto partition_hash = pegasus_key_hash(req);
-        // TODO: set the timeout
-        client->get(req, on_get_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        add_pending_reads(
+            entry, multi_read_context::kGet, {{redis_req.sub_requests[1].data, ::dsn::blob()}});
     }
 }
 
@@ -686,8 +737,11 @@ void redis_parser::del_internal(message_entry &entry)
         ::dsn::blob null_blob;
         pegasus_generate_key(req, redis_req.sub_requests[1].data, null_blob);
         auto partition_hash = pegasus_key_hash(req);
-        // TODO: set the timeout
-        client->remove(req, on_del_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        client->remove(req,
+                       on_del_reply,
+                       std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                       0,
+                       partition_hash);
     }
 }
 
@@ -722,7 +776,7 @@ void redis_parser::del_geo_internal(message_entry &entry)
                                std::string(),                                  // ""  => sort_key
                                false,
                                del_callback,
-                               2000); // TODO: set the timeout
+                               FLAGS_rpc_timeout_ms);
     }
 }
 
@@ -772,8 +826,11 @@ void redis_parser::ttl(message_entry &entry)
         ::dsn::blob null_blob;
         pegasus_generate_key(req, redis_req.sub_requests[1].data, null_blob);
         auto partition_hash = pegasus_key_hash(req);
-        // TODO: set the timeout
-        client->ttl(req, on_ttl_reply, std::chrono::milliseconds(2000), 0, partition_hash);
+        client->ttl(req,
+                    on_ttl_reply,
+                    std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                    0,
+                    partition_hash);
     }
 }
 
@@ -837,8 +894,13 @@ void redis_parser::geo_radius(message_entry &entry)
             entry, unit, WITHCOORD, WITHDIST, WITHHASH, ec, std::move(results));
     };
 
-    _geo_client->async_search_radial(
-        lat_degrees, lng_degrees, radius_m, count, sort_type, 2000, search_callback);
+    _geo_client->async_search_radial(lat_degrees,
+                                     lng_degrees,
+                                     radius_m,
+                                     count,
+                                     sort_type,
+                                     FLAGS_rpc_timeout_ms,
+                                     search_callback);
 }
 
 // command format:
@@ -892,7 +954,7 @@ void redis_parser::geo_radius_by_member(message_entry &entry)
     };
 
     _geo_client->async_search_radial(
-        hash_key, "", radius_m, count, sort_type, 2000, search_callback);
+        hash_key, "", radius_m, count, sort_type, FLAGS_rpc_timeout_ms, search_callback);
 }
 
 void redis_parser::incr(message_entry &entry) { counter_internal(entry); }
@@ -970,7 +1032,11 @@ void redis_parser::counter_internal(message_entry &entry)
     dsn::apps::incr_request req;
     pegasus_generate_key(req.key, entry.request.sub_requests[1].data, dsn::blob());
     req.increment = increment;
-    client->incr(req, on_incr_reply, std::chrono::milliseconds(2000), 0, pegasus_key_hash(req.key));
+    client->incr(req,
+                 on_incr_reply,
+                 std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                 0,
+                 pegasus_key_hash(req.key));
 }
 
 void redis_parser::parse_set_parameters(const std::vector<redis_bulk_string> &opts,
@@ -1171,7 +1237,12 @@ void redis_parser::geo_add(message_entry &entry)
             dsn::buf2double(redis_request.sub_requests[2 + i * 3 + 1].data.to_string_view(),
                             lat_degree)) {
             const std::string &hashkey = redis_request.sub_requests[2 + i * 3 + 2].data.to_string();
-            _geo_client->async_set(hashkey, "", lat_degree, lng_degree, set_latlng_callback, 2000);
+            _geo_client->async_set(hashkey,
+                                   "",
+                                   lat_degree,
+                                   lng_degree,
+                                   set_latlng_callback,
+                                   FLAGS_rpc_timeout_ms);
         } else if (set_count->fetch_sub(1) == 1) {
             reply_message(entry, *result);
         }
@@ -1189,7 +1260,6 @@ void redis_parser::geo_dist(message_entry &entry)
     if (redis_request.sub_requests.size() < 4) {
         simple_error_reply(entry, "wrong number of arguments for 'geodist' command");
     } else {
-        // TODO: set the timeout
         std::string hash_key1 =
             redis_request.sub_requests[2].data.to_string(); // member1 => hash_key1
         std::string hash_key2 =
@@ -1220,7 +1290,8 @@ void redis_parser::geo_dist(message_entry &entry)
                 reply_message(entry, redis_bulk_string(std::to_string(distance)));
             }
         };
-        _geo_client->async_distance(hash_key1, "", hash_key2, "", 2000, get_callback);
+        _geo_client->async_distance(
+            hash_key1, "", hash_key2, "", FLAGS_rpc_timeout_ms, get_callback);
     }
 }
 
@@ -1272,8 +1343,595 @@ void redis_parser::geo_pos(message_entry &entry)
     };
 
     for (int i = 0; i < member_count; ++i) {
-        _geo_client->async_get(
-            redis_request.sub_requests[i + 2].data.to_string(), "", i, get_latlng_callback, 2000);
+        _geo_client->async_get(redis_request.sub_requests[i + 2].data.to_string(),
+                               "",
+                               i,
+                               get_latlng_callback,
+                               FLAGS_rpc_timeout_ms);
+    }
+}
+
+// MGET key [key ...]
+void redis_parser::mget(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 2) {
+        LOG_INFO_PREFIX("MGET command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'mget' command");
+    } else {
+        LOG_DEBUG_PREFIX("send MGET command seqid({})", entry.sequence_id);
+        std::vector<std::pair<::dsn::blob, ::dsn::blob>> keys;
+        keys.reserve(redis_req.sub_requests.size() - 1);
+        for (size_t i = 1; i < redis_req.sub_requests.size(); ++i) {
+            keys.emplace_back(redis_req.sub_requests[i].data, ::dsn::blob());
+        }
+        add_pending_reads(entry, multi_read_context::kMultiGet, keys);
+    }
+}
+
+// EXISTS key [key ...]
+void redis_parser::exists(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 2) {
+        LOG_INFO_PREFIX("EXISTS command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'exists' command");
+    } else {
+        LOG_DEBUG_PREFIX("send EXISTS command seqid({})", entry.sequence_id);
+        std::vector<std::pair<::dsn::blob, ::dsn::blob>> keys;
+        keys.reserve(redis_req.sub_requests.size() - 1);
+        for (size_t i = 1; i < redis_req.sub_requests.size(); ++i) {
+            keys.emplace_back(redis_req.sub_requests[i].data, ::dsn::blob());
+        }
+        add_pending_reads(entry, multi_read_context::kExists, keys);
+    }
+}
+
+// HGET key field
+// NOTE: the field of a hash is stored as the sort key, i.e. a hash is a hash key in pegasus.
+void redis_parser::hget(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 3) {
+        LOG_INFO_PREFIX("HGET command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hget' command");
+    } else {
+        LOG_DEBUG_PREFIX("send HGET command seqid({})", entry.sequence_id);
+        add_pending_reads(entry,
+                          multi_read_context::kGet,
+                          {{redis_req.sub_requests[1].data, redis_req.sub_requests[2].data}});
+    }
+}
+
+// MSET key value [key value ...]
+// NOTE: unlike Redis, MSET is NOT atomic. There is no RPC to write several hash keys at once,
+// so the pairs are put concurrently by separate requests, and the command is replied once all
+// of them are done. If some of the puts fail, the error is replied while the other pairs may
+// have been written, and a concurrent reader may see some of the pairs before the others.
+void redis_parser::mset(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 3 || redis_req.sub_requests.size() % 2 == 0) {
+        LOG_INFO_PREFIX("MSET command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'mset' command");
+    } else {
+        LOG_DEBUG_PREFIX("send MSET command seqid({})", entry.sequence_id);
+        struct mset_context
+        {
+            std::atomic_int pending_count{0};
+            dsn::zlock lock;
+            std::string error;
+        };
+        auto context = std::make_shared<mset_context>();
+        context->pending_count.store(static_cast<int>(redis_req.sub_requests.size() / 2),
+                                     std::memory_order_relaxed);
+
+        std::shared_ptr<proxy_session> ref_this = shared_from_this();
+        auto on_set_reply = [ref_this, this, &entry, context](
+            ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+            if (_is_session_reset.load(std::memory_order_acquire)) {
+                LOG_INFO_PREFIX("MSET command seqid({}) got reply, but session has reset",
+                                entry.sequence_id);
+                return;
+            }
+
+            std::string error;
+            if (::dsn::ERR_OK != ec) {
+                LOG_INFO_PREFIX(
+                    "MSET command seqid({}) got reply with error = {}", entry.sequence_id, ec);
+                error = ec.to_string();
+            } else {
+                ::dsn::apps::update_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                if (rrdb_response.error != 0) {
+                    error = "internal error " + std::to_string(rrdb_response.error);
+                }
+            }
+            if (!error.empty()) {
+                dsn::zauto_lock l(context->lock);
+                if (context->error.empty()) {
+                    context->error = std::move(error);
+                }
+            }
+
+            if (context->pending_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            if (context->error.empty()) {
+                simple_ok_reply(entry);
+            } else {
+                simple_error_reply(entry, context->error);
+            }
+        };
+
+        for (size_t i = 1; i < redis_req.sub_requests.size(); i += 2) {
+            ::dsn::apps::update_request req;
+            ::dsn::blob null_blob;
+            pegasus_generate_key(req.key, redis_req.sub_requests[i].data, null_blob);
+            req.value = redis_req.sub_requests[i + 1].data;
+            req.expire_ts_seconds = 0;
+            auto partition_hash = pegasus_key_hash(req.key);
+            client->put(req,
+                        on_set_reply,
+                        std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                        0,
+                        partition_hash);
+        }
+    }
+}
+
+// HSET key field value [field value ...]
+// NOTE: the fields which have existed are found by a multi_get before they are written by a
+// multi_put, so that the count of the newly added fields is returned like Redis does. The two
+// requests are not atomic, thus the count may be inaccurate if the hash is written concurrently.
+void redis_parser::hset(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 4 || redis_req.sub_requests.size() % 2 != 0) {
+        LOG_INFO_PREFIX("HSET command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hset' command");
+    } else {
+        LOG_DEBUG_PREFIX("send HSET command seqid({})", entry.sequence_id);
+        ::dsn::apps::multi_put_request put_req;
+        put_req.hash_key = redis_req.sub_requests[1].data;
+        put_req.expire_ts_seconds = 0;
+        put_req.kvs.reserve(redis_req.sub_requests.size() / 2 - 1);
+
+        // A field specified more than once is counted once.
+        std::set<std::string> fields;
+        ::dsn::apps::multi_get_request get_req;
+        get_req.hash_key = put_req.hash_key;
+        get_req.no_value = true;
+        for (size_t i = 2; i < redis_req.sub_requests.size(); i += 2) {
+            ::dsn::apps::key_value kv;
+            kv.key = redis_req.sub_requests[i].data;
+            kv.value = redis_req.sub_requests[i + 1].data;
+            if (fields.insert(kv.key.to_string()).second) {
+                get_req.sort_keys.emplace_back(kv.key);
+            }
+            put_req.kvs.emplace_back(std::move(kv));
+        }
+
+        std::shared_ptr<proxy_session> ref_this = shared_from_this();
+        auto on_multi_get_reply =
+            [ref_this, this, &entry, put_req = std::move(put_req), fields = std::move(fields)](
+                ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) mutable {
+                if (_is_session_reset.load(std::memory_order_acquire)) {
+                    LOG_INFO_PREFIX("HSET command seqid({}) got reply, but session has reset",
+                                    entry.sequence_id);
+                    return;
+                }
+
+                if (::dsn::ERR_OK != ec) {
+                    LOG_INFO_PREFIX("HSET command seqid({}) got multi_get reply with error = {}",
+                                    entry.sequence_id,
+                                    ec);
+                    simple_error_reply(entry, ec.to_string());
+                    return;
+                }
+
+                ::dsn::apps::multi_get_response rrdb_response;
+                ::dsn::unmarshall(response, rrdb_response);
+                if (rrdb_response.error != 0) {
+                    simple_error_reply(entry,
+                                       "internal error " + std::to_string(rrdb_response.error));
+                    return;
+                }
+
+                for (const auto &kv : rrdb_response.kvs) {
+                    fields.erase(kv.key.to_string());
+                }
+                hset_internal(entry, put_req, static_cast<int64_t>(fields.size()));
+            };
+
+        auto partition_hash = pegasus_hash_key_hash(get_req.hash_key);
+        client->multi_get(get_req,
+                          on_multi_get_reply,
+                          std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                          0,
+                          partition_hash);
+    }
+}
+
+void redis_parser::hset_internal(message_entry &entry,
+                                 const ::dsn::apps::multi_put_request &req,
+                                 int64_t added_count)
+{
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_hset_reply = [ref_this, this, &entry, added_count](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            LOG_INFO_PREFIX("HSET command seqid({}) got reply, but session has reset",
+                            entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            LOG_INFO_PREFIX(
+                "HSET command seqid({}) got reply with error = {}", entry.sequence_id, ec);
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+
+        ::dsn::apps::update_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+            return;
+        }
+
+        simple_integer_reply(entry, added_count);
+    };
+
+    auto partition_hash = pegasus_hash_key_hash(req.hash_key);
+    client->multi_put(req,
+                      on_hset_reply,
+                      std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                      0,
+                      partition_hash);
+}
+
+// HMGET key field [field ...]
+void redis_parser::hmget(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() < 3) {
+        LOG_INFO_PREFIX("HMGET command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hmget' command");
+    } else {
+        LOG_DEBUG_PREFIX("send HMGET command seqid({})", entry.sequence_id);
+        ::dsn::apps::multi_get_request req;
+        req.hash_key = redis_req.sub_requests[1].data;
+        req.sort_keys.reserve(redis_req.sub_requests.size() - 2);
+        for (size_t i = 2; i < redis_req.sub_requests.size(); ++i) {
+            req.sort_keys.emplace_back(redis_req.sub_requests[i].data);
+        }
+        multi_get_internal(entry, std::move(req));
+    }
+}
+
+// HGETALL key
+void redis_parser::hgetall(message_entry &entry)
+{
+    redis_request &redis_req = entry.request;
+    if (redis_req.sub_requests.size() != 2) {
+        LOG_INFO_PREFIX("HGETALL command seqid({}) with invalid arguments", entry.sequence_id);
+        simple_error_reply(entry, "wrong number of arguments for 'hgetall' command");
+    } else {
+        LOG_DEBUG_PREFIX("send HGETALL command seqid({})", entry.sequence_id);
+        ::dsn::apps::multi_get_request req;
+        req.hash_key = redis_req.sub_requests[1].data;
+        req.max_kv_count = -1;
+        req.max_kv_size = -1;
+        req.start_inclusive = true;
+        req.stop_inclusive = false;
+        multi_get_internal(entry, std::move(req));
+    }
+}
+
+// Sends a multi_get for HMGET (with the sort keys specified) or HGETALL (without the sort keys
+// specified).
+void redis_parser::multi_get_internal(message_entry &entry, ::dsn::apps::multi_get_request &&req)
+{
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_multi_get_reply = [ref_this, this, &entry, sort_keys = req.sort_keys](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            LOG_INFO_PREFIX("multi_get of seqid({}) got reply, but session has reset",
+                            entry.sequence_id);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            LOG_INFO_PREFIX(
+                "multi_get of seqid({}) got reply with error = {}", entry.sequence_id, ec);
+            simple_error_reply(entry, ec.to_string());
+            return;
+        }
+
+        ::dsn::apps::multi_get_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error == rocksdb::Status::kIncomplete) {
+            // the hash is too large to be fetched by a single multi_get
+            simple_error_reply(entry, "too many fields in the hash");
+            return;
+        }
+        if (rrdb_response.error != 0) {
+            simple_error_reply(entry, "internal error " + std::to_string(rrdb_response.error));
+            return;
+        }
+
+        redis_array result;
+        if (sort_keys.empty()) {
+            // HGETALL: field1, value1, field2, value2, ...
+            result.resize(rrdb_response.kvs.size() * 2);
+            for (size_t i = 0; i < rrdb_response.kvs.size(); ++i) {
+                const auto &kv = rrdb_response.kvs[i];
+                result.array[2 * i] = std::make_shared<redis_bulk_string>(kv.key);
+                result.array[2 * i + 1] = std::make_shared<redis_bulk_string>(kv.value);
+            }
+        } else {
+            // HMGET: the values in the order of the requested fields, nil if not found
+            std::map<absl::string_view, const ::dsn::blob *> values;
+            for (const auto &kv : rrdb_response.kvs) {
+                values.emplace(kv.key.to_string_view(), &kv.value);
+            }
+            result.resize(sort_keys.size());
+            for (size_t i = 0; i < sort_keys.size(); ++i) {
+                auto iter = values.find(sort_keys[i].to_string_view());
+                if (iter == values.end()) {
+                    result.array[i] = std::make_shared<redis_bulk_string>();
+                } else {
+                    result.array[i] = std::make_shared<redis_bulk_string>(*iter->second);
+                }
+            }
+        }
+        reply_message(entry, result);
+    };
+
+    auto partition_hash = pegasus_hash_key_hash(req.hash_key);
+    client->multi_get(req,
+                      on_multi_get_reply,
+                      std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                      0,
+                      partition_hash);
+}
+
+void redis_parser::add_pending_reads(message_entry &entry,
+                                     multi_read_context::read_type type,
+                                     const std::vector<std::pair<dsn::blob, dsn::blob>> &keys)
+{
+    auto context = std::make_shared<multi_read_context>();
+    context->entry = &entry;
+    context->type = type;
+    context->pending_count.store(static_cast<int>(keys.size()), std::memory_order_relaxed);
+    context->values.resize(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        context->values.array[i] = std::make_shared<redis_bulk_string>();
+
+        read_row row;
+        row.context = context;
+        row.index = i;
+        row.hash_key = keys[i].first;
+        row.sort_key = keys[i].second;
+        // keep the same as pegasus_key_hash(): hash by sort key if hash key is empty
+        row.partition_hash = pegasus_hash_key_hash(row.hash_key.length() > 0 ? row.hash_key
+                                                                              : row.sort_key);
+        _pending_reads.emplace_back(std::move(row));
+    }
+
+    if (!FLAGS_coalesce_pipelined_reads) {
+        flush_pending_reads();
+    }
+}
+
+/*static*/ std::map<uint64_t, std::vector<size_t>>
+redis_parser::group_reads_by_partition(const std::vector<read_row> &rows, int partition_count)
+{
+    return dsn::replication::partitioned_batch::group(
+        rows.size(), partition_count, [&rows](size_t i) { return rows[i].partition_hash; });
+}
+
+void redis_parser::flush_pending_reads()
+{
+    if (_pending_reads.empty()) {
+        return;
+    }
+
+    std::vector<read_row> rows;
+    rows.swap(_pending_reads);
+
+    // the partition count is unknown before the route cache of the table is filled, in which
+    // case the keys are read one by one.
+    const int partition_count = rows.size() > 1 ? client->get_partition_count() : -1;
+    if (partition_count <= 0) {
+        for (const auto &row : rows) {
+            send_single_read(row);
+        }
+        return;
+    }
+
+    send_grouped_reads(std::move(rows), partition_count);
+}
+
+void redis_parser::send_grouped_reads(std::vector<read_row> &&rows, int partition_count)
+{
+    for (auto &group : group_reads_by_partition(rows, partition_count)) {
+        if (group.second.size() == 1) {
+            send_single_read(rows[group.second.front()]);
+            continue;
+        }
+
+        std::vector<read_row> batch;
+        batch.reserve(group.second.size());
+        for (size_t i : group.second) {
+            batch.emplace_back(std::move(rows[i]));
+        }
+        send_batch_read(std::move(batch),
+                        partition_count > 0 ? static_cast<int>(group.first) : -1);
+    }
+}
+
+void redis_parser::send_single_read(const read_row &row)
+{
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_get_reply = [ref_this, this, row](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) {
+        const int64_t seqid = row.context->entry->sequence_id;
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            LOG_INFO_PREFIX("get of seqid({}) got reply, but session has reset", seqid);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            LOG_INFO_PREFIX("get of seqid({}) got reply with error = {}", seqid, ec);
+            on_row_read(row, nullptr, ec.to_string());
+            return;
+        }
+
+        ::dsn::apps::read_response rrdb_response;
+        ::dsn::unmarshall(response, rrdb_response);
+        if (rrdb_response.error == 0) {
+            on_row_read(row, &rrdb_response.value, "");
+        } else if (rrdb_response.error == rocksdb::Status::kNotFound) {
+            on_row_read(row, nullptr, "");
+        } else {
+            on_row_read(row, nullptr, "internal error " + std::to_string(rrdb_response.error));
+        }
+    };
+
+    ::dsn::blob req;
+    pegasus_generate_key(req, row.hash_key, row.sort_key);
+    client->get(req,
+                on_get_reply,
+                std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                0,
+                row.partition_hash);
+}
+
+void redis_parser::send_batch_read(std::vector<read_row> &&rows, int partition_index)
+{
+    ::dsn::apps::batch_get_request req;
+    req.keys.reserve(rows.size());
+    for (const auto &row : rows) {
+        ::dsn::apps::full_key key;
+        key.hash_key = row.hash_key;
+        key.sort_key = row.sort_key;
+        req.keys.emplace_back(std::move(key));
+    }
+    const uint64_t partition_hash = rows.front().partition_hash;
+    LOG_DEBUG_PREFIX("send batch_get of {} keys to partition {}", rows.size(), partition_index);
+
+    std::shared_ptr<proxy_session> ref_this = shared_from_this();
+    auto on_batch_get_reply = [ref_this, this, partition_index, rows = std::move(rows)](
+        ::dsn::error_code ec, dsn::message_ex *, dsn::message_ex *response) mutable {
+        if (_is_session_reset.load(std::memory_order_acquire)) {
+            LOG_INFO_PREFIX("batch_get of partition {} got reply, but session has reset",
+                            partition_index);
+            return;
+        }
+
+        ::dsn::apps::batch_get_response rrdb_response;
+        int served_partition_index = -1;
+        if (::dsn::ERR_OK == ec) {
+            ::dsn::unmarshall(response, rrdb_response);
+            if (rrdb_response.error == 0) {
+                served_partition_index = rrdb_response.partition_index;
+            }
+        }
+
+        if (dsn_unlikely(dsn::replication::partitioned_batch::should_split(
+                ec, partition_index, served_partition_index))) {
+            LOG_INFO_PREFIX("batch_get of partition {} was served by partition {} with error = "
+                            "{}, read the {} keys again by their hashes",
+                            partition_index,
+                            served_partition_index,
+                            ec,
+                            rows.size());
+            send_grouped_reads(std::move(rows), -1);
+            return;
+        }
+
+        if (::dsn::ERR_OK != ec) {
+            LOG_INFO_PREFIX(
+                "batch_get of partition {} got reply with error = {}", partition_index, ec);
+            for (const auto &row : rows) {
+                on_row_read(row, nullptr, ec.to_string());
+            }
+            return;
+        }
+
+        if (rrdb_response.error != 0) {
+            const std::string error = "internal error " + std::to_string(rrdb_response.error);
+            for (const auto &row : rows) {
+                on_row_read(row, nullptr, error);
+            }
+            return;
+        }
+
+        dsn::replication::partitioned_batch::match_in_order(
+            rows,
+            rrdb_response.data,
+            [](const read_row &row, const ::dsn::apps::full_data &data) {
+                return data.hash_key.to_string_view() == row.hash_key.to_string_view() &&
+                       data.sort_key.to_string_view() == row.sort_key.to_string_view();
+            },
+            [this](const read_row &row, const ::dsn::apps::full_data *data) {
+                on_row_read(row, data == nullptr ? nullptr : &data->value, "");
+            });
+    };
+
+    client->batch_get(req,
+                      on_batch_get_reply,
+                      std::chrono::milliseconds(FLAGS_rpc_timeout_ms),
+                      0,
+                      partition_hash);
+}
+
+void redis_parser::on_row_read(const read_row &row,
+                               const ::dsn::blob *value,
+                               const std::string &error)
+{
+    multi_read_context &context = *row.context;
+    {
+        dsn::zauto_lock l(context.lock);
+        if (!error.empty()) {
+            if (context.error.empty()) {
+                context.error = error;
+            }
+        } else if (value != nullptr) {
+            context.values.array[row.index] = std::make_shared<redis_bulk_string>(*value);
+            ++context.found_count;
+        }
+    }
+
+    // reply once all the keys of the command are read
+    if (context.pending_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        reply_multi_read(context);
+    }
+}
+
+void redis_parser::reply_multi_read(multi_read_context &context)
+{
+    message_entry &entry = *context.entry;
+    if (!context.error.empty()) {
+        simple_error_reply(entry, context.error);
+        return;
+    }
+
+    switch (context.type) {
+    case multi_read_context::kGet:
+        reply_message(entry, *context.values.array.front());
+        break;
+    case multi_read_context::kMultiGet:
+        reply_message(entry, context.values);
+        break;
+    case multi_read_context::kExists:
+        simple_integer_reply(entry, context.found_count);
+        break;
+    default:
+        CHECK_PREFIX_MSG(false, "invalid read type {}", static_cast<int>(context.type));
     }
 }
 
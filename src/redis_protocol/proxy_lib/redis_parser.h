@@ -24,6 +24,7 @@
 #include <atomic>
 #include <deque>
 #include <list>
+#include <map>
 #include <memory>
 #include <queue>
 #include <string>
@@ -42,6 +43,8 @@ namespace dsn {
 class binary_writer;
 
 namespace apps {
+class multi_get_request;
+class multi_put_request;
 class rrdb_client;
 }
 }
@@ -126,6 +129,39 @@ protected:
         int64_t sequence_id = 0;
     };
 
+    // The reading context of a command whose keys may be fetched by several RPCs, i.e. a
+    // GET coalesced with other pipelined reads, or a MGET/EXISTS. The command is replied
+    // once the last of its keys is read.
+    struct multi_read_context
+    {
+        enum read_type
+        {
+            kGet,
+            kMultiGet,
+            kExists,
+        };
+
+        message_entry *entry = nullptr;
+        read_type type = kGet;
+        std::atomic_int pending_count{0};
+
+        dsn::zlock lock; // [
+        // One bulk string per key, which is nil if the key is not found.
+        redis_array values;
+        int64_t found_count = 0;
+        std::string error;
+        // ]
+    };
+    // A single key to read for a multi_read_context.
+    struct read_row
+    {
+        std::shared_ptr<multi_read_context> context;
+        size_t index = 0;
+        dsn::blob hash_key;
+        dsn::blob sort_key;
+        uint64_t partition_hash = 0;
+    };
+
     bool parse(dsn::message_ex *msg) override;
 
     // this is virtual only because we can override and test other modules
@@ -155,11 +191,17 @@ private:
     // data stream content
     std::queue<dsn::message_ex *> _recv_buffers;
     size_t _total_length;
-    char *_current_buffer;
-    size_t _current_buffer_length;
+    // the unread part of the buffer under read in the first received message, from which the
+    // bulk strings are referenced without copying
+    dsn::blob _current_buffer;
+    bool _reading_buffer;
     size_t _current_cursor;
     // ]
 
+    // the keys read by the commands parsed from the current received message, which are
+    // grouped by partition and sent in batches once the message is parsed
+    std::vector<read_row> _pending_reads;
+
     // for rrdb
     std::unique_ptr<::dsn::apps::rrdb_client> client;
     std::unique_ptr<geo::geo_client> _geo_client;
@@ -169,6 +211,7 @@ protected:
     void append_message(dsn::message_ex *msg);
     void prepare_current_buffer();
     char peek();
+    void skip(size_t length);
     bool eat(char c);
     void eat_all(char *dest, size_t length);
     void reset_parser();
@@ -177,6 +220,10 @@ protected:
     bool end_array_size();
     bool end_bulk_string_size();
     void append_current_bulk_string();
+    // Parses the size line of an array or a bulk string, and `completed` is set once the
+    // ending CRLF is consumed.
+    bool parse_size_line(bool &completed);
+    void parse_bulk_string_data();
     bool parse_stream();
 
 // function for rrdb operation
@@ -201,6 +248,13 @@ protected:
     DECLARE_REDIS_HANDLER(incr_by)
     DECLARE_REDIS_HANDLER(decr)
     DECLARE_REDIS_HANDLER(decr_by)
+    DECLARE_REDIS_HANDLER(mget)
+    DECLARE_REDIS_HANDLER(mset)
+    DECLARE_REDIS_HANDLER(exists)
+    DECLARE_REDIS_HANDLER(hget)
+    DECLARE_REDIS_HANDLER(hset)
+    DECLARE_REDIS_HANDLER(hmget)
+    DECLARE_REDIS_HANDLER(hgetall)
     DECLARE_REDIS_HANDLER(default_handler)
 
     void set_internal(message_entry &entry);
@@ -208,6 +262,32 @@ protected:
     void del_internal(message_entry &entry);
     void del_geo_internal(message_entry &entry);
     void counter_internal(message_entry &entry);
+    void multi_get_internal(message_entry &entry, ::dsn::apps::multi_get_request &&req);
+    // Sends the multi_put of HSET, and replies `added_count` once it succeeds.
+    void hset_internal(message_entry &entry,
+                       const ::dsn::apps::multi_put_request &req,
+                       int64_t added_count);
+
+    // functions for the reads which may be coalesced
+    // Each key is a pair of hash key and sort key. The writes of SET/DEL/MSET are never
+    // coalesced, since a multi_put or multi_remove only writes the sort keys of a single hash
+    // key, while each of their keys is a hash key of its own.
+    void add_pending_reads(message_entry &entry,
+                           multi_read_context::read_type type,
+                           const std::vector<std::pair<dsn::blob, dsn::blob>> &keys);
+    void flush_pending_reads();
+    // Sends `rows` grouped by their partitions if `partition_count` > 0, otherwise by their
+    // hashes.
+    void send_grouped_reads(std::vector<read_row> &&rows, int partition_count);
+    void send_single_read(const read_row &row);
+    // `partition_index` is -1 if `rows` are grouped by their hashes.
+    void send_batch_read(std::vector<read_row> &&rows, int partition_index);
+    void on_row_read(const read_row &row, const ::dsn::blob *value, const std::string &error);
+    void reply_multi_read(multi_read_context &context);
+    // Groups the indexes of `rows` by the partition index of their keys if `partition_count` > 0,
+    // otherwise by their hashes.
+    static std::map<uint64_t, std::vector<size_t>>
+    group_reads_by_partition(const std::vector<read_row> &rows, int partition_count);
     static void parse_set_parameters(const std::vector<redis_bulk_string> &opts, int &ttl_seconds);
     static void parse_geo_radius_parameters(const std::vector<redis_bulk_string> &opts,
                                             int base_index,
@@ -0,0 +1,195 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <fmt/core.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "proxy_layer.h"
+#include "redis_parser.h"
+#include "runtime/api_layer1.h"
+#include "runtime/rpc/rpc_address.h"
+#include "runtime/rpc/rpc_message.h"
+#include "utils/string_conv.h"
+
+namespace pegasus {
+namespace proxy {
+
+// A parser which only counts the parsed commands rather than executing them, so that only
+// the cost of parsing is measured.
+class bench_redis_parser : public redis_parser
+{
+public:
+    explicit bench_redis_parser(dsn::message_ex *first_msg) : redis_parser(nullptr, first_msg) {}
+
+    bool parse_message(dsn::message_ex *msg) { return parse(msg); }
+
+    uint64_t parsed_command_count() const { return _parsed_command_count; }
+
+protected:
+    void handle_command(std::unique_ptr<message_entry> &&entry) override
+    {
+        ++_parsed_command_count;
+    }
+
+private:
+    uint64_t _parsed_command_count = 0;
+};
+
+} // namespace proxy
+} // namespace pegasus
+
+namespace {
+
+void print_usage(const char *cmd)
+{
+    fmt::print(stderr,
+               "USAGE: {} <num_operations> <pipeline_size> <value_size> [segment_size]\n",
+               cmd);
+    fmt::print(stderr, "Run a simple benchmark that parses pipelined redis SET commands.\n\n");
+
+    fmt::print(stderr, "    <num_operations>       the number of operations.\n");
+    fmt::print(stderr,
+               "    <pipeline_size>        the number of SET commands pipelined in each \n"
+               "                           operation.\n");
+    fmt::print(stderr, "    <value_size>           the size of the value of each SET command.\n");
+    fmt::print(stderr,
+               "    [segment_size]         the size of each received message that the \n"
+               "                           pipelined commands are split into, to simulate \n"
+               "                           the commands straddling the received messages; \n"
+               "                           if this arg is missing, all the commands of an \n"
+               "                           operation are received as a single message.\n");
+}
+
+std::string generate_pipelined_commands(uint64_t pipeline_size, uint64_t value_size)
+{
+    const std::string value(value_size, 'v');
+    std::string commands;
+    for (uint64_t i = 0; i < pipeline_size; ++i) {
+        const std::string key = fmt::format("key_{}", i);
+        commands += fmt::format(
+            "*3\r\n$3\r\nSET\r\n${}\r\n{}\r\n${}\r\n{}\r\n", key.size(), key, value.size(), value);
+    }
+    return commands;
+}
+
+dsn::message_ex *create_message(const char *data, size_t length)
+{
+    return dsn::message_ex::create_received_request(
+        RPC_CALL_RAW_MESSAGE, dsn::DSF_THRIFT_BINARY, (void *)data, static_cast<int>(length));
+}
+
+void run_bench(uint64_t num_operations,
+               uint64_t pipeline_size,
+               uint64_t value_size,
+               uint64_t segment_size)
+{
+    const std::string commands = generate_pipelined_commands(pipeline_size, value_size);
+    if (segment_size == 0) {
+        segment_size = commands.size();
+    }
+
+    dsn::message_ex *first_msg = create_message(nullptr, 0);
+    first_msg->header->from_address = dsn::rpc_address::from_ip_port("127.0.0.1", 123);
+    auto parser = std::make_shared<pegasus::proxy::bench_redis_parser>(first_msg);
+
+    uint64_t parse_time_ns = 0;
+    for (uint64_t i = 0; i < num_operations; ++i) {
+        for (size_t offset = 0; offset < commands.size(); offset += segment_size) {
+            dsn::message_ex *msg = create_message(
+                commands.data() + offset, std::min<size_t>(segment_size, commands.size() - offset));
+
+            const auto start = dsn_now_ns();
+            const bool succeed = parser->parse_message(msg);
+            parse_time_ns += dsn_now_ns() - start;
+
+            // added in create_received_request
+            msg->release_ref();
+            if (!succeed) {
+                fmt::print(stderr, "failed to parse the pipelined commands\n");
+                ::exit(-1);
+            }
+        }
+    }
+
+    const uint64_t expected_command_count = num_operations * pipeline_size;
+    if (parser->parsed_command_count() != expected_command_count) {
+        fmt::print(stderr,
+                   "parsed_command_count({}) != expected_command_count({})\n",
+                   parser->parsed_command_count(),
+                   expected_command_count);
+        ::exit(-1);
+    }
+
+    const double parse_time_s = parse_time_ns / 1e9;
+    fmt::print(stdout,
+               "Parsed {} commands ({} bytes) in {:.3f} seconds, {:.0f} commands/s, {:.2f} MB/s\n",
+               expected_command_count,
+               num_operations * commands.size(),
+               parse_time_s,
+               expected_command_count / parse_time_s,
+               num_operations * commands.size() / parse_time_s / (1 << 20));
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    uint64_t num_operations;
+    if (!dsn::buf2uint64(argv[1], num_operations) || num_operations == 0) {
+        fmt::print(stderr, "Invalid num_operations: {}\n\n", argv[1]);
+
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    uint64_t pipeline_size;
+    if (!dsn::buf2uint64(argv[2], pipeline_size) || pipeline_size == 0) {
+        fmt::print(stderr, "Invalid pipeline_size: {}\n\n", argv[2]);
+
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    uint64_t value_size;
+    if (!dsn::buf2uint64(argv[3], value_size)) {
+        fmt::print(stderr, "Invalid value_size: {}\n\n", argv[3]);
+
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    uint64_t segment_size = 0;
+    if (argc > 4 && !dsn::buf2uint64(argv[4], segment_size)) {
+        fmt::print(stderr, "Invalid segment_size: {}\n\n", argv[4]);
+
+        print_usage(argv[0]);
+        ::exit(-1);
+    }
+
+    run_bench(num_operations, pipeline_size, value_size, segment_size);
+    return 0;
+}
@@ -33,7 +33,10 @@
 #include <boost/system/error_code.hpp>
 #include <gtest/gtest_prod.h>
 #include <string.h>
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -43,6 +46,7 @@
 
 #include "geo/lib/geo_client.h"
 #include "gtest/gtest.h"
+#include "pegasus_key_schema.h"
 #include "proxy_layer.h"
 #include "redis_parser.h"
 #include "runtime/app_model.h"
@@ -174,6 +178,7 @@ private:
     FRIEND_TEST(proxy_test, test_nil_bulk_string);
     FRIEND_TEST(proxy_test, test_random_cases);
     FRIEND_TEST(proxy_test, test_parse_parameters);
+    FRIEND_TEST(proxy_test, test_group_reads_by_partition);
 
     std::vector<std::unique_ptr<message_entry>> _reserved_entry;
     int _entry_index;
@@ -227,6 +232,36 @@ TEST_F(proxy_test, test_segmented_cases)
     ASSERT_TRUE(got_message());
 }
 
+TEST_F(proxy_test, test_size_line_segmented_cases)
+{
+    const std::string request_data = "*3\r\n$3\r\nSET\r\n$3\r\nfoo\r\n$3\r\nbar\r\n";
+    // split the request between the CR and LF of each size line, as well as in the middle of
+    // each size line
+    for (const auto &pos : {1, 2, 3, 5, 6, 7, 14, 15, 16, 23, 24, 25}) {
+        reset();
+        set_msg(0, redis_test_parser::redis_request(3, {{"SET"}, {"foo"}, {"bar"}}));
+        const auto request_data1 = request_data.substr(0, pos);
+        const auto request_data2 = request_data.substr(pos);
+        ASSERT_TRUE(parse(redis_test_parser::create_message(request_data1.data(),
+                                                            request_data1.length())))
+            << pos;
+        ASSERT_FALSE(got_message()) << pos;
+        ASSERT_TRUE(parse(redis_test_parser::create_message(request_data2.data(),
+                                                            request_data2.length())))
+            << pos;
+        ASSERT_TRUE(got_message()) << pos;
+    }
+
+    // the size line is split into 3 segments
+    reset();
+    set_msg(0, redis_test_parser::redis_request(3, {{"SET"}, {"foo"}, {"bar"}}));
+    ASSERT_TRUE(parse(redis_test_parser::create_message("*")));
+    ASSERT_TRUE(parse(redis_test_parser::create_message("3\r")));
+    ASSERT_TRUE(
+        parse(redis_test_parser::create_message("\n$3\r\nSET\r\n$3\r\nfoo\r\n$3\r\nbar\r\n")));
+    ASSERT_TRUE(got_message());
+}
+
 TEST_F(proxy_test, test_georadius)
 {
     set_msg(0,
@@ -526,6 +561,33 @@ TEST_F(proxy_test, test_parse_parameters)
     }
 }
 
+TEST_F(proxy_test, test_group_reads_by_partition)
+{
+    const int partition_count = 8;
+    std::vector<redis_test_parser::read_row> rows(6);
+    const std::vector<uint64_t> partition_hashes({3, 11, 5, 19, 8, 13});
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i].index = i;
+        rows[i].partition_hash = partition_hashes[i];
+    }
+
+    const auto groups = redis_test_parser::group_reads_by_partition(rows, partition_count);
+    const std::map<uint64_t, std::vector<size_t>> expected_groups(
+        {{0, {4}}, {3, {0, 1, 3}}, {5, {2, 5}}});
+    ASSERT_EQ(expected_groups, groups);
+
+    // The keys with the same hash key always fall into the same group.
+    const auto hash_key = dsn::blob::create_from_bytes(std::string("hash_key"));
+    rows[0].partition_hash = pegasus::pegasus_hash_key_hash(hash_key);
+    rows[1].partition_hash = pegasus::pegasus_hash_key_hash(hash_key);
+    for (const auto &group : redis_test_parser::group_reads_by_partition(rows, partition_count)) {
+        const auto &indexes = group.second;
+        const bool has_0 = std::find(indexes.begin(), indexes.end(), 0) != indexes.end();
+        const bool has_1 = std::find(indexes.begin(), indexes.end(), 1) != indexes.end();
+        ASSERT_EQ(has_0, has_1);
+    }
+}
+
 TEST(proxy, connection)
 {
     const auto redis_address = dsn::rpc_address::from_ip_port("127.0.0.1", 12345);
@@ -17,6 +17,8 @@
 
 #include "cold_backup_context.h"
 
+#include <time.h>
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <memory>
@@ -24,18 +26,89 @@
 
 #include "common/backup_common.h"
 #include "common/replication.codes.h"
+#include "fmt/core.h"
 #include "replica/replica.h"
 #include "runtime/api_layer1.h"
 #include "runtime/task/async_calls.h"
+#include "runtime/task/task_code.h"
 #include "utils/blob.h"
 #include "utils/error_code.h"
 #include "utils/filesystem.h"
+#include "utils/flags.h"
 #include "utils/metrics.h"
 #include "utils/utils.h"
 
+DSN_DEFINE_bool(replication,
+                cold_backup_incremental_enabled,
+                false,
+                "whether to upload the sst files of a checkpoint content-addressed to the shared "
+                "files dir, so that the sst files which have been uploaded by the previous backups "
+                "are referenced rather than uploaded again");
+DSN_TAG_VARIABLE(cold_backup_incremental_enabled, FT_MUTABLE);
+
+DSN_DEFINE_uint32(replication,
+                  cold_backup_checksum_concurrency,
+                  4,
+                  "the max count of checkpoint files whose md5 is computed concurrently by a "
+                  "cold backup");
+DSN_DEFINE_validator(cold_backup_checksum_concurrency,
+                     [](uint32_t value) -> bool { return value > 0; });
+
 namespace dsn {
 namespace replication {
 
+DEFINE_TASK_CODE(LPC_COLD_BACKUP_CHECKSUM, TASK_PRIORITY_COMMON, THREAD_POOL_BLOCK_SERVICE)
+
+namespace {
+
+bool is_sst_file(const std::string &filename)
+{
+    static const std::string kSstSuffix(".sst");
+    return filename.size() > kSstSuffix.size() &&
+           filename.compare(filename.size() - kSstSuffix.size(), kSstSuffix.size(), kSstSuffix) ==
+               0;
+}
+
+// The md5 of the checkpoint files computed by the previous incremental backups of each replica.
+// Sst files are immutable, thus a file with the same name, size and last write time needn't be
+// read again. Only the files of the latest checkpoint of a replica are kept.
+class checkpoint_md5_cache
+{
+public:
+    bool get(gpid pid, const std::string &key, std::string &md5)
+    {
+        zauto_lock l(_lock);
+        const auto &iter = _md5s.find(pid);
+        if (iter == _md5s.end()) {
+            return false;
+        }
+        const auto &md5_iter = iter->second.find(key);
+        if (md5_iter == iter->second.end()) {
+            return false;
+        }
+        md5 = md5_iter->second;
+        return true;
+    }
+
+    void reset(gpid pid, std::map<std::string, std::string> &&md5s)
+    {
+        zauto_lock l(_lock);
+        _md5s[pid] = std::move(md5s);
+    }
+
+private:
+    zlock _lock;
+    std::map<gpid, std::map<std::string, std::string>> _md5s;
+};
+
+checkpoint_md5_cache &get_checkpoint_md5_cache()
+{
+    static checkpoint_md5_cache cache;
+    return cache;
+}
+
+} // anonymous namespace
+
 const char *cold_backup_status_to_string(cold_backup_status status)
 {
     switch (status) {
@@ -566,13 +639,10 @@ void cold_backup_context::on_upload_chkpt_dir()
         return;
     }
 
-    prepare_upload();
-
-    // prepare_upload maybe fail, so here check status
-    if (!is_ready_for_upload()) {
-        LOG_ERROR("{}: backup status has changed to {}, stop upload checkpoint dir",
-                  name,
-                  cold_backup_status_to_string(status()));
+    if (!checkpoint_files.empty() && !is_upload_prepared()) {
+        // the md5 of the checkpoint files is computed asynchronously, after which this function
+        // is called again
+        prepare_upload();
         return;
     }
 
@@ -609,45 +679,168 @@ void cold_backup_context::on_upload_chkpt_dir()
     }
 }
 
-void cold_backup_context::prepare_upload()
+bool cold_backup_context::is_upload_prepared()
 {
     zauto_lock l(_lock);
-    // only need initialize once
-    if (_metadata.files.size() > 0) {
+    return !_metadata.files.empty();
+}
+
+struct cold_backup_context::checksum_context
+{
+    // md5s[i] is the md5 of checkpoint_files[i]
+    std::vector<std::string> md5s;
+    std::vector<std::string> cache_keys;
+    std::vector<size_t> uncached_indexes;
+    std::atomic<size_t> next_index{0};
+    std::atomic<size_t> running_workers{0};
+    std::atomic_bool failed{false};
+};
+
+void cold_backup_context::prepare_upload()
+{
+    bool old_status = false;
+    if (!_preparing_upload.compare_exchange_strong(old_status, true)) {
+        LOG_INFO("{}: md5 of checkpoint files is being computed, wait for it", name);
+        return;
+    }
+    if (is_upload_prepared()) {
+        // prepared by the previous computation, which has been finished right now
+        _preparing_upload.store(false);
+        on_upload_chkpt_dir();
         return;
     }
-    _file_remain_cnt = checkpoint_files.size();
-
-    _metadata.checkpoint_decree = checkpoint_decree;
-    _metadata.checkpoint_timestamp = checkpoint_timestamp;
-    _metadata.checkpoint_total_size = checkpoint_file_total_size;
-    for (int32_t idx = 0; idx < checkpoint_files.size(); idx++) {
-        std::string &file = checkpoint_files[idx];
-        file_meta f_meta;
-        f_meta.name = file;
-        std::string file_full_path = ::dsn::utils::filesystem::path_combine(checkpoint_dir, file);
-        int64_t file_size = checkpoint_file_sizes[idx];
-        std::string file_md5;
-        if (::dsn::utils::filesystem::md5sum(file_full_path, file_md5) != ERR_OK) {
+
+    auto context = std::make_shared<checksum_context>();
+    const bool use_cache = FLAGS_cold_backup_incremental_enabled;
+    context->md5s.assign(checkpoint_files.size(), std::string());
+    context->cache_keys.assign(checkpoint_files.size(), std::string());
+    for (size_t idx = 0; idx < checkpoint_files.size(); ++idx) {
+        time_t mtime = 0;
+        const std::string file_full_path =
+            utils::filesystem::path_combine(checkpoint_dir, checkpoint_files[idx]);
+        if (use_cache && utils::filesystem::last_write_time(file_full_path, mtime)) {
+            context->cache_keys[idx] = fmt::format(
+                "{}:{}:{}", checkpoint_files[idx], checkpoint_file_sizes[idx], mtime);
+            if (get_checkpoint_md5_cache().get(
+                    request.pid, context->cache_keys[idx], context->md5s[idx])) {
+                continue;
+            }
+        }
+        context->uncached_indexes.push_back(idx);
+    }
+
+    if (context->uncached_indexes.empty()) {
+        on_checkpoint_files_md5_computed(context);
+        return;
+    }
+
+    // each worker picks the next uncomputed file until all of them are done, and the last
+    // finished worker continues the upload, thus no thread is blocked to wait for them
+    const size_t worker_count =
+        std::min(static_cast<size_t>(FLAGS_cold_backup_checksum_concurrency),
+                 context->uncached_indexes.size());
+    context->running_workers.store(worker_count);
+    cold_backup_context_ptr self(this);
+    for (size_t i = 0; i < worker_count; ++i) {
+        tasking::enqueue(LPC_COLD_BACKUP_CHECKSUM, nullptr, [self, context]() {
+            self->compute_checkpoint_files_md5(context);
+        });
+    }
+}
+
+void cold_backup_context::compute_checkpoint_files_md5(
+    const std::shared_ptr<checksum_context> &context)
+{
+    for (size_t pos = context->next_index.fetch_add(1);
+         pos < context->uncached_indexes.size() && !context->failed.load();
+         pos = context->next_index.fetch_add(1)) {
+        const size_t idx = context->uncached_indexes[pos];
+        const std::string file_full_path =
+            utils::filesystem::path_combine(checkpoint_dir, checkpoint_files[idx]);
+        if (utils::filesystem::md5sum(file_full_path, context->md5s[idx]) != ERR_OK) {
             LOG_ERROR("{}: get local file size or md5 fail, file = {}", name, file_full_path);
-            fail_upload("compute local file size or md5 failed");
-            return;
+            context->failed.store(true);
         }
-        f_meta.md5 = file_md5;
-        f_meta.size = file_size;
-        _metadata.files.emplace_back(f_meta);
-        _file_status.insert(std::make_pair(file, FileUploadUncomplete));
-        _file_infos.insert(std::make_pair(file, std::make_pair(file_size, file_md5)));
     }
-    _upload_file_size.store(0);
+
+    if (context->running_workers.fetch_sub(1) == 1) {
+        on_checkpoint_files_md5_computed(context);
+    }
 }
 
-void cold_backup_context::upload_file(const std::string &local_filename)
+void cold_backup_context::on_checkpoint_files_md5_computed(
+    const std::shared_ptr<checksum_context> &context)
 {
+    if (context->failed.load()) {
+        _preparing_upload.store(false);
+        fail_upload("compute local file size or md5 failed");
+        return;
+    }
+
+    const bool incremental = FLAGS_cold_backup_incremental_enabled;
+    if (incremental) {
+        std::map<std::string, std::string> cached_md5s;
+        for (size_t idx = 0; idx < checkpoint_files.size(); ++idx) {
+            if (!context->cache_keys[idx].empty()) {
+                cached_md5s.emplace(context->cache_keys[idx], context->md5s[idx]);
+            }
+        }
+        get_checkpoint_md5_cache().reset(request.pid, std::move(cached_md5s));
+    }
+    LOG_INFO("{}: compute md5 of checkpoint files complete, total_file_cnt = {}, "
+             "computed_file_cnt = {}",
+             name,
+             checkpoint_files.size(),
+             context->uncached_indexes.size());
+
+    {
+        zauto_lock l(_lock);
+        CHECK(_metadata.files.empty(), "{}: upload has been prepared", name);
+        _file_remain_cnt = checkpoint_files.size();
+        _metadata.checkpoint_decree = checkpoint_decree;
+        _metadata.checkpoint_timestamp = checkpoint_timestamp;
+        _metadata.checkpoint_total_size = checkpoint_file_total_size;
+        for (int32_t idx = 0; idx < checkpoint_files.size(); idx++) {
+            std::string &file = checkpoint_files[idx];
+            file_meta f_meta;
+            f_meta.name = file;
+            f_meta.md5 = context->md5s[idx];
+            f_meta.size = checkpoint_file_sizes[idx];
+            _metadata.files.emplace_back(f_meta);
+            _file_status.insert(std::make_pair(file, FileUploadUncomplete));
+            _file_infos.insert(std::make_pair(file, std::make_pair(f_meta.size, f_meta.md5)));
+            if (incremental && is_sst_file(file)) {
+                _metadata.shared_files.emplace_back(file);
+                _shared_files.insert(file);
+            }
+        }
+        _upload_file_size.store(0);
+    }
+    _preparing_upload.store(false);
+
+    cold_backup_context_ptr self(this);
+    tasking::enqueue(
+        LPC_BACKGROUND_COLD_BACKUP, nullptr, [self]() { self->on_upload_chkpt_dir(); });
+}
+
+std::string cold_backup_context::get_remote_file_path(const std::string &local_filename) const
+{
+    if (_shared_files.find(local_filename) != _shared_files.end()) {
+        const auto &file_info = _file_infos.at(local_filename);
+        return utils::filesystem::path_combine(
+            cold_backup::get_replica_shared_files_dir(backup_root, request.app_name, request.pid),
+            cold_backup::get_shared_file_name(
+                local_filename, file_info.first, file_info.second));
+    }
     std::string remote_chkpt_dir = cold_backup::get_remote_chkpt_dir(
         backup_root, request.app_name, request.pid, request.backup_id);
+    return ::dsn::utils::filesystem::path_combine(remote_chkpt_dir, local_filename);
+}
+
+void cold_backup_context::upload_file(const std::string &local_filename)
+{
     dist::block_service::create_file_request req;
-    req.file_name = ::dsn::utils::filesystem::path_combine(remote_chkpt_dir, local_filename);
+    req.file_name = get_remote_file_path(local_filename);
     req.ignore_metadata = false;
 
     add_ref();
@@ -867,8 +1060,10 @@ void cold_backup_context::write_current_chkpt_file(const std::string &value)
     // _file_status and _file_infos, because even if write current checkpoint file failed, the
     // backup_metadata is uploading succeed, so we will not re-upload
     _metadata.files.clear();
+    _metadata.shared_files.clear();
     _file_infos.clear();
     _file_status.clear();
+    _shared_files.clear();
 
     if (!is_ready_for_upload()) {
         LOG_INFO("{}: backup status has changed to {}, stop write current checkpoint file",
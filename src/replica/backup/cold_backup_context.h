@@ -23,6 +23,8 @@
 #include <atomic>
 #include <functional>
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -88,15 +90,6 @@ enum cold_backup_status
 };
 const char *cold_backup_status_to_string(cold_backup_status status);
 
-struct cold_backup_metadata
-{
-    int64_t checkpoint_decree;
-    int64_t checkpoint_timestamp;
-    std::vector<file_meta> files;
-    int64_t checkpoint_total_size;
-    DEFINE_JSON_SERIALIZATION(checkpoint_decree, checkpoint_timestamp, files, checkpoint_total_size)
-};
-
 //
 // the process of uploading the checkpoint directory to block filesystem:
 //      1, upload all the file of the checkpoint to block filesystem
@@ -105,6 +98,10 @@ struct cold_backup_metadata
 //      3, write a current_checkpoint file to block filesystem, which is used to mark which
 //         checkpoint is invalid
 //
+// if incremental backup is enabled, the sst files are uploaded to the shared files dir named by
+// their content(name, size and md5) instead of the checkpoint dir, so that the sst files which
+// have been uploaded by the previous backups are not uploaded again
+//
 
 //
 // the process of check whether uploading is finished on block filesystem:
@@ -132,6 +129,7 @@ public:
           _upload_file_size(0),
           _have_check_upload_status(false),
           _have_write_backup_metadata(false),
+          _preparing_upload(false),
           _upload_status(UploadInvalid),
           _max_concurrent_uploading_file_cnt(max_upload_file_cnt),
           _cur_upload_file_cnt(0),
@@ -306,7 +304,16 @@ private:
     void on_write(const dist::block_service::block_file_ptr &file_handle,
                   const blob &value,
                   const std::function<void(bool)> &callback);
+    struct checksum_context;
+
+    bool is_upload_prepared();
+    // compute md5 of all the checkpoint files by several workers concurrently, after which the
+    // upload is continued by on_upload_chkpt_dir()
     void prepare_upload();
+    void compute_checkpoint_files_md5(const std::shared_ptr<checksum_context> &context);
+    void on_checkpoint_files_md5_computed(const std::shared_ptr<checksum_context> &context);
+    // the remote path which the local checkpoint file will be uploaded to
+    std::string get_remote_file_path(const std::string &local_filename) const;
     void on_upload_chkpt_dir();
     void upload_file(const std::string &local_filename);
     void on_upload(const dist::block_service::block_file_ptr &file_handle,
@@ -368,12 +375,16 @@ private:
     // executed once
     std::atomic_bool _have_check_upload_status;
     std::atomic_bool _have_write_backup_metadata;
+    // whether the md5 of the checkpoint files is being computed
+    std::atomic_bool _preparing_upload;
 
     std::atomic_int _upload_status;
 
     int32_t _max_concurrent_uploading_file_cnt;
     // filename -> <filesize, md5>
     std::map<std::string, std::pair<int64_t, std::string>> _file_infos;
+    // files which are uploaded to the shared files dir
+    std::set<std::string> _shared_files;
 
     zlock _lock; // lock the structure below
     std::map<std::string, file_status> _file_status;
@@ -86,6 +86,34 @@ METRIC_DEFINE_counter(replica,
                       dsn::metric_unit::kBytes,
                       "The size of files that have been downloaded successfully for bulk loads");
 
+METRIC_DEFINE_percentile_int64(replica,
+                               bulk_load_download_file_latency_ms,
+                               dsn::metric_unit::kMilliSeconds,
+                               "The latency of downloading a file for bulk loads");
+
+METRIC_DEFINE_gauge_int64(replica,
+                          bulk_load_download_duration_ms,
+                          dsn::metric_unit::kMilliSeconds,
+                          "The duration of downloading all the files of the latest bulk load");
+
+METRIC_DEFINE_gauge_int64(replica,
+                          bulk_load_ingestion_duration_ms,
+                          dsn::metric_unit::kMilliSeconds,
+                          "The duration of the ingestion of the latest bulk load on the primary, "
+                          "during which the write requests are rejected");
+
+METRIC_DEFINE_gauge_int64(replica,
+                          bulk_load_duration_ms,
+                          dsn::metric_unit::kMilliSeconds,
+                          "The duration of the latest successful bulk load");
+
+DSN_DEFINE_uint32(replication,
+                  max_concurrent_bulk_load_downloading_file_count,
+                  4,
+                  "The max count of files downloaded concurrently by a bulk loading replica");
+DSN_DEFINE_validator(max_concurrent_bulk_load_downloading_file_count,
+                     [](uint32_t value) -> bool { return value > 0; });
+
 DSN_DECLARE_int32(max_concurrent_bulk_load_downloading_count);
 
 namespace dsn {
@@ -107,7 +135,11 @@ replica_bulk_loader::replica_bulk_loader(replica *r)
       METRIC_VAR_INIT_replica(bulk_load_failed_count),
       METRIC_VAR_INIT_replica(bulk_load_download_file_successful_count),
       METRIC_VAR_INIT_replica(bulk_load_download_file_failed_count),
-      METRIC_VAR_INIT_replica(bulk_load_download_file_bytes)
+      METRIC_VAR_INIT_replica(bulk_load_download_file_bytes),
+      METRIC_VAR_INIT_replica(bulk_load_download_file_latency_ms),
+      METRIC_VAR_INIT_replica(bulk_load_download_duration_ms),
+      METRIC_VAR_INIT_replica(bulk_load_ingestion_duration_ms),
+      METRIC_VAR_INIT_replica(bulk_load_duration_ms)
 {
 }
 
@@ -346,9 +378,11 @@ error_code replica_bulk_loader::do_bulk_load(const std::string &app_name,
     case bulk_load_status::BLS_INGESTING:
         if (local_status == bulk_load_status::BLS_DOWNLOADED) {
             start_ingestion();
-        } else if (local_status == bulk_load_status::BLS_INGESTING &&
-                   status() == partition_status::PS_PRIMARY) {
-            check_ingestion_finish();
+        } else if (local_status == bulk_load_status::BLS_INGESTING) {
+            ec = check_ingestion_failure();
+            if (ec == ERR_OK && status() == partition_status::PS_PRIMARY) {
+                check_ingestion_finish();
+            }
         }
         break;
     case bulk_load_status::BLS_SUCCEED:
@@ -515,16 +549,37 @@ void replica_bulk_loader::download_files(const std::string &provider_name,
             LOG_ERROR_PREFIX("parse bulk load metadata failed, error = {}", err);
             return;
         }
+
+        // download sst files asynchronously, several files are downloaded concurrently and
+        // each finished one starts the download of the next file
+        for (uint32_t i = 0; i < FLAGS_max_concurrent_bulk_load_downloading_file_count; ++i) {
+            download_next_sst_file(remote_dir, local_dir, fs);
+        }
     }
+}
 
-    // download sst files asynchronously
-    if (!_metadata.files.empty()) {
-        const file_meta &f_meta = _metadata.files[0];
-        _download_files_task[f_meta.name] = tasking::enqueue(
-            LPC_BACKGROUND_BULK_LOAD,
-            tracker(),
-            std::bind(&replica_bulk_loader::download_sst_file, this, remote_dir, local_dir, 0, fs));
+// ThreadPool: THREAD_POOL_DEFAULT
+// need to acquire write lock while calling it
+void replica_bulk_loader::download_next_sst_file(const std::string &remote_dir,
+                                                 const std::string &local_dir,
+                                                 dist::block_service::block_filesystem *fs)
+{
+    // stop downloading if any file failed or bulk load is paused
+    if (!_is_downloading.load() || _download_status.load() != ERR_OK ||
+        _next_download_file_index >= _metadata.files.size()) {
+        return;
     }
+
+    const int32_t file_index = _next_download_file_index++;
+    _download_files_task[_metadata.files[file_index].name] =
+        tasking::enqueue(LPC_BACKGROUND_BULK_LOAD,
+                         tracker(),
+                         std::bind(&replica_bulk_loader::download_sst_file,
+                                   this,
+                                   remote_dir,
+                                   local_dir,
+                                   file_index,
+                                   fs));
 }
 
 // ThreadPool: THREAD_POOL_DEFAULT
@@ -534,6 +589,7 @@ void replica_bulk_loader::download_sst_file(const std::string &remote_dir,
                                             dist::block_service::block_filesystem *fs)
 {
     const file_meta &f_meta = _metadata.files[file_index];
+    const uint64_t start_time_ms = dsn_now_ms();
     uint64_t f_size = 0;
     std::string f_md5;
     error_code ec = _stub->_block_service_manager.download_file(
@@ -584,23 +640,14 @@ void replica_bulk_loader::download_sst_file(const std::string &remote_dir,
         return;
     }
     // download file succeed, update progress
+    METRIC_VAR_SET(bulk_load_download_file_latency_ms, dsn_now_ms() - start_time_ms);
     update_bulk_load_download_progress(f_size, f_meta.name);
     METRIC_VAR_INCREMENT(bulk_load_download_file_successful_count);
     METRIC_VAR_INCREMENT_BY(bulk_load_download_file_bytes, f_size);
 
     // download next file
-    if (file_index + 1 < _metadata.files.size()) {
-        const file_meta &next_f_meta = _metadata.files[file_index + 1];
-        _download_files_task[next_f_meta.name] =
-            tasking::enqueue(LPC_BACKGROUND_BULK_LOAD,
-                             tracker(),
-                             std::bind(&replica_bulk_loader::download_sst_file,
-                                       this,
-                                       remote_dir,
-                                       local_dir,
-                                       file_index + 1,
-                                       fs));
-    }
+    zauto_write_lock l(_lock);
+    download_next_sst_file(remote_dir, local_dir, fs);
 }
 
 // ThreadPool: THREAD_POOL_DEFAULT
@@ -674,7 +721,8 @@ void replica_bulk_loader::check_download_finish()
 {
     if (_download_progress.load() == bulk_load_constant::PROGRESS_FINISHED &&
         _status == bulk_load_status::BLS_DOWNLOADING) {
-        LOG_INFO_PREFIX("download all files succeed");
+        LOG_INFO_PREFIX("download all files succeed, elapsed_ms = {}", duration_ms());
+        METRIC_VAR_SET(bulk_load_download_duration_ms, duration_ms());
         _status = bulk_load_status::BLS_DOWNLOADED;
         {
             zauto_write_lock l(_lock);
@@ -694,6 +742,23 @@ void replica_bulk_loader::start_ingestion()
     }
 }
 
+// ThreadPool: THREAD_POOL_REPLICATION
+error_code replica_bulk_loader::check_ingestion_failure()
+{
+    if (_replica->_app->get_ingestion_status() != ingestion_status::IS_FAILED ||
+        !_replica->_app->is_ingestion_partially_applied()) {
+        return ERR_OK;
+    }
+
+    // Some of the files have been ingested before the ingestion failed, which could not be rolled
+    // back, thus the data of this replica may have diverged from the other replicas. Fail this
+    // replica, so that it would be removed from the group and learn from the others later.
+    LOG_ERROR_PREFIX("ingestion failed after some of the files have been ingested, fail the "
+                     "replica since its data may diverge from the other replicas");
+    _replica->handle_local_failure(ERR_INGESTION_FAILED);
+    return ERR_INGESTION_FAILED;
+}
+
 // ThreadPool: THREAD_POOL_REPLICATION
 void replica_bulk_loader::check_ingestion_finish()
 {
@@ -722,6 +787,7 @@ void replica_bulk_loader::handle_bulk_load_succeed()
     _replica->_app->set_ingestion_status(ingestion_status::IS_INVALID);
     _status = bulk_load_status::BLS_SUCCEED;
     METRIC_VAR_INCREMENT(bulk_load_successful_count);
+    METRIC_VAR_SET(bulk_load_duration_ms, duration_ms());
 
     // send an empty prepare again to gurantee that learner should learn from checkpoint
     if (status() == partition_status::PS_PRIMARY) {
@@ -810,6 +876,7 @@ void replica_bulk_loader::clear_bulk_load_states()
         zauto_write_lock l(_lock);
         cleanup_download_tasks();
         _download_files_task.clear();
+        _next_download_file_index = 0;
         _download_task = nullptr;
         _metadata.files.clear();
         _metadata.file_total_size = 0;
@@ -997,7 +1064,9 @@ void replica_bulk_loader::report_group_ingestion_status(/*out*/ bulk_load_respon
 
     // if group ingestion finish, recover wirte immediately
     if (is_group_ingestion_finish) {
-        LOG_INFO_PREFIX("finish ingestion, recover write");
+        LOG_INFO_PREFIX("finish ingestion, recover write, elapsed_ms = {}",
+                        ingestion_duration_ms());
+        METRIC_VAR_SET(bulk_load_ingestion_duration_ms, ingestion_duration_ms());
         _replica->_is_bulk_load_ingestion = false;
         _replica->_bulk_load_ingestion_start_time_ms = 0;
     }
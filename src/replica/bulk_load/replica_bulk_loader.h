@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <atomic>
 #include <map>
@@ -86,6 +87,12 @@ private:
                         const std::string &remote_dir,
                         const std::string &local_dir);
 
+    // start to download the next sst file if no file failed and there are files left
+    // need to acquire write lock while calling it
+    void download_next_sst_file(const std::string &remote_dir,
+                                const std::string &local_dir,
+                                dist::block_service::block_filesystem *fs);
+
     // download sst files from remote provider
     void download_sst_file(const std::string &remote_dir,
                            const std::string &local_dir,
@@ -105,6 +112,7 @@ private:
     void try_decrease_bulk_load_download_count();
     void check_download_finish();
     void start_ingestion();
+    error_code check_ingestion_failure();
     void check_ingestion_finish();
     void handle_bulk_load_succeed();
     // called when bulk load succeed or failed or canceled
@@ -192,6 +200,8 @@ private:
     // }
     // file_name -> downloading task
     std::map<std::string, task_ptr> _download_files_task;
+    // the index of the next file to be downloaded in _metadata.files
+    size_t _next_download_file_index{0};
     // download metadata and create download file tasks
     task_ptr _download_task;
 
@@ -205,6 +215,10 @@ private:
     METRIC_VAR_DECLARE_counter(bulk_load_download_file_successful_count);
     METRIC_VAR_DECLARE_counter(bulk_load_download_file_failed_count);
     METRIC_VAR_DECLARE_counter(bulk_load_download_file_bytes);
+    METRIC_VAR_DECLARE_percentile_int64(bulk_load_download_file_latency_ms);
+    METRIC_VAR_DECLARE_gauge_int64(bulk_load_download_duration_ms);
+    METRIC_VAR_DECLARE_gauge_int64(bulk_load_ingestion_duration_ms);
+    METRIC_VAR_DECLARE_gauge_int64(bulk_load_duration_ms);
 };
 
 } // namespace replication
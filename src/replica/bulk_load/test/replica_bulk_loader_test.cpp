@@ -111,6 +111,15 @@ public:
 
     void test_start_ingestion() { _bulk_loader->start_ingestion(); }
 
+    error_code test_check_ingestion_failure(ingestion_status::type istatus,
+                                            bool is_partially_applied)
+    {
+        mock_replica_config(partition_status::PS_SECONDARY);
+        mock_replica_bulk_load_varieties(bulk_load_status::BLS_INGESTING, 100, istatus);
+        _replica->set_ingestion_partially_applied(is_partially_applied);
+        return _bulk_loader->check_ingestion_failure();
+    }
+
     void test_handle_bulk_load_finish(bulk_load_status::type status,
                                       int32_t download_progress,
                                       ingestion_status::type istatus,
@@ -557,6 +566,33 @@ TEST_P(replica_bulk_loader_test, start_ingestion_test)
     ASSERT_EQ(get_bulk_load_status(), bulk_load_status::BLS_INGESTING);
 }
 
+// check_ingestion_failure unit tests
+TEST_P(replica_bulk_loader_test, check_ingestion_failure_test)
+{
+    // Test cases:
+    // - ingestion is running
+    // - ingestion succeed
+    // - ingestion failed before any file has been ingested
+    // - ingestion failed after some of the files have been ingested
+    struct check_ingestion_failure_test
+    {
+        ingestion_status::type istatus;
+        bool is_partially_applied;
+        error_code expected_err;
+        partition_status::type expected_status;
+    } tests[] = {
+        {ingestion_status::IS_RUNNING, false, ERR_OK, partition_status::PS_SECONDARY},
+        {ingestion_status::IS_SUCCEED, false, ERR_OK, partition_status::PS_SECONDARY},
+        {ingestion_status::IS_FAILED, false, ERR_OK, partition_status::PS_SECONDARY},
+        {ingestion_status::IS_FAILED, true, ERR_INGESTION_FAILED, partition_status::PS_ERROR},
+    };
+    for (const auto &test : tests) {
+        ASSERT_EQ(test.expected_err,
+                  test_check_ingestion_failure(test.istatus, test.is_partially_applied));
+        ASSERT_EQ(test.expected_status, _replica->status());
+    }
+}
+
 // handle_bulk_load_finish unit tests
 TEST_P(replica_bulk_loader_test, bulk_load_finish_test)
 {
@@ -20,23 +20,67 @@
 #include "consensus_types.h"
 #include "replica/mutation.h"
 #include "utils/binary_writer.h"
+#include "utils/flags.h"
+#include "utils/strings.h"
+
+DSN_DEFINE_string(replication,
+                  plog_compression_type,
+                  "none",
+                  "The algorithm to compress the updates of the mutations in the private logs, "
+                  "should be 'none', 'lz4' or 'zstd'. The private logs written with compression "
+                  "could not be read by the versions without it");
+DSN_DEFINE_validator(plog_compression_type, [](const char *value) -> bool {
+    return dsn::utils::equals(value, "none") || dsn::utils::equals(value, "lz4") ||
+           dsn::utils::equals(value, "zstd");
+});
 
 namespace dsn {
 namespace replication {
+namespace {
+
+mutation_compression_type get_plog_compression_type()
+{
+    static const auto type = [] {
+        if (utils::equals(FLAGS_plog_compression_type, "lz4")) {
+            return mutation_compression_type::kLZ4;
+        }
+        if (utils::equals(FLAGS_plog_compression_type, "zstd")) {
+            return mutation_compression_type::kZSTD;
+        }
+        return mutation_compression_type::kNone;
+    }();
+    return type;
+}
+
+} // anonymous namespace
 
 log_block::log_block(int64_t start_offset) : _start_offset(start_offset) { init(); }
 
+log_block::log_block(int64_t start_offset, mutation_compression_type compression_type)
+    : _start_offset(start_offset), _compression_type(compression_type)
+{
+    init();
+}
+
 log_block::log_block() { init(); }
 
 void log_block::init()
 {
     log_block_header hdr;
+    if (_compression_type != mutation_compression_type::kNone) {
+        hdr.magic = kCompressedLogBlockMagic;
+    }
 
     binary_writer temp_writer;
     temp_writer.write_pod(hdr);
     add(temp_writer.get_buffer());
 }
 
+log_appender::log_appender(int64_t start_offset)
+{
+    _blocks.emplace_back(start_offset, get_plog_compression_type());
+}
+
 void log_appender::append_mutation(const mutation_ptr &mu, const aio_task_ptr &cb)
 {
     _mutations.push_back(mu);
@@ -48,11 +92,11 @@ void log_appender::append_mutation(const mutation_ptr &mu, const aio_task_ptr &c
         _full_blocks_size += blk->size();
         _full_blocks_blob_cnt += blk->data().size();
         int64_t new_block_start_offset = blk->start_offset() + blk->size();
-        _blocks.emplace_back(new_block_start_offset);
+        _blocks.emplace_back(new_block_start_offset, blk->compression_type());
         blk = &_blocks.back();
     }
     mu->data.header.log_offset = blk->start_offset() + blk->size();
-    mu->write_to([blk](const blob &bb) { blk->add(bb); });
+    mu->write_to([blk](const blob &bb) { blk->add(bb); }, blk->compression_type());
 }
 
 } // namespace replication
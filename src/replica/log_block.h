@@ -31,10 +31,21 @@
 namespace dsn {
 namespace replication {
 
+// The magic of the log blocks whose mutations are never compressed.
+constexpr int32_t kLogBlockMagic = static_cast<int32_t>(0xdeadbeef);
+// The magic of the log blocks whose mutations may be compressed, see mutation::write_to(). The
+// versions which could not decompress the mutations reject these blocks as invalid data.
+constexpr int32_t kCompressedLogBlockMagic = static_cast<int32_t>(0xdeadbef0);
+
+inline bool is_valid_log_block_magic(int32_t magic)
+{
+    return magic == kLogBlockMagic || magic == kCompressedLogBlockMagic;
+}
+
 // each block in log file has a log_block_header
 struct log_block_header
 {
-    int32_t magic{static_cast<int32_t>(0xdeadbeef)}; // 0xdeadbeef
+    int32_t magic{kLogBlockMagic}; // kLogBlockMagic or kCompressedLogBlockMagic
     int32_t length{0};   // block data length (not including log_block_header)
     int32_t body_crc{0}; // block data crc (not including log_block_header)
 
@@ -55,6 +66,9 @@ public:
 
     explicit log_block(int64_t start_offset);
 
+    // The mutations in the block may be compressed by `compression_type`.
+    log_block(int64_t start_offset, mutation_compression_type compression_type);
+
     // get all blobs in the block
     const std::vector<blob> &data() const { return _data; }
 
@@ -86,9 +100,13 @@ public:
     // global offset to start writting this block
     int64_t start_offset() const { return _start_offset; }
 
+    mutation_compression_type compression_type() const { return _compression_type; }
+
 private:
     friend class log_appender;
     void init();
+
+    mutation_compression_type _compression_type{mutation_compression_type::kNone};
 };
 
 // Append writes into a buffer which consists of one or more fixed-size log blocks,
@@ -97,7 +115,8 @@ private:
 class log_appender
 {
 public:
-    explicit log_appender(int64_t start_offset) { _blocks.emplace_back(start_offset); }
+    // The mutations are compressed by FLAGS_plog_compression_type.
+    explicit log_appender(int64_t start_offset);
 
     log_appender(int64_t start_offset, log_block &block)
     {
@@ -231,7 +231,7 @@ error_code log_file::read_next_log_block(/*out*/ ::dsn::blob &bb)
     }
     log_block_header hdr = *reinterpret_cast<const log_block_header *>(bb.data());
 
-    if (hdr.magic != 0xdeadbeef) {
+    if (!is_valid_log_block_magic(hdr.magic)) {
         LOG_ERROR("invalid data header magic: {:#x}", static_cast<uint32_t>(hdr.magic));
         return ERR_INVALID_DATA;
     }
@@ -293,7 +293,7 @@ aio_task_ptr log_file::commit_log_blocks(log_appender &pending,
         int64_t local_offset = block.start_offset() - start_offset();
         auto hdr = reinterpret_cast<log_block_header *>(const_cast<char *>(block.front().data()));
 
-        CHECK_EQ(hdr->magic, 0xdeadbeef);
+        CHECK(is_valid_log_block_magic(hdr->magic), "invalid log block magic");
         hdr->local_offset = local_offset;
         hdr->length = static_cast<int32_t>(block.size() - sizeof(log_block_header));
         hdr->body_crc = _crc32;
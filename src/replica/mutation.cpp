@@ -27,7 +27,9 @@
 #include "mutation.h"
 
 #include <inttypes.h>
+#include <lz4.h>
 #include <string.h>
+#include <zstd.h>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -40,9 +42,11 @@
 #include "utils/binary_reader.h"
 #include "utils/binary_writer.h"
 #include "utils/blob.h"
+#include "utils/error_code.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
 #include "utils/latency_tracer.h"
+#include "utils/metrics.h"
 #include "utils/ports.h"
 
 DSN_DEFINE_uint64(
@@ -52,8 +56,164 @@ DSN_DEFINE_uint64(
     "Latency trace will be logged when exceed the write latency threshold, in nanoseconds");
 DSN_TAG_VARIABLE(abnormal_write_trace_latency_threshold, FT_MUTABLE);
 
+DSN_DEFINE_uint32(replication,
+                  plog_compression_min_bytes,
+                  256,
+                  "The updates of a mutation are compressed in the private log only if their "
+                  "total size is at least this many bytes");
+DSN_TAG_VARIABLE(plog_compression_min_bytes, FT_MUTABLE);
+
+DSN_DEFINE_bool(replication,
+                adaptive_write_pipeline_enabled,
+                false,
+                "Whether to tune the number of concurrent two-phase commit rounds and hold new "
+                "mutations for more client writes to be batched into them, by the latencies "
+                "measured on the write path of the primary replicas");
+DSN_TAG_VARIABLE(adaptive_write_pipeline_enabled, FT_MUTABLE);
+
+METRIC_DEFINE_counter(server,
+                      plog_compression_input_bytes,
+                      dsn::metric_unit::kBytes,
+                      "The number of bytes of the updates compressed in the private logs");
+
+METRIC_DEFINE_counter(server,
+                      plog_compression_output_bytes,
+                      dsn::metric_unit::kBytes,
+                      "The number of bytes of the compressed updates in the private logs");
+
 namespace dsn {
 namespace replication {
+namespace {
+
+// The version of the mutation headers whose updates are compressed.
+constexpr int64_t kCompressedMutationVersion = 1;
+
+class mutation_compression_metrics
+{
+public:
+    static mutation_compression_metrics &instance()
+    {
+        static mutation_compression_metrics metrics;
+        return metrics;
+    }
+
+    void on_compressed(size_t input_bytes, size_t output_bytes)
+    {
+        METRIC_VAR_INCREMENT_BY(plog_compression_input_bytes, input_bytes);
+        METRIC_VAR_INCREMENT_BY(plog_compression_output_bytes, output_bytes);
+    }
+
+private:
+    mutation_compression_metrics()
+        : METRIC_VAR_INIT_server(plog_compression_input_bytes),
+          METRIC_VAR_INIT_server(plog_compression_output_bytes)
+    {
+    }
+
+    METRIC_VAR_DECLARE_counter(plog_compression_input_bytes);
+    METRIC_VAR_DECLARE_counter(plog_compression_output_bytes);
+
+    DISALLOW_COPY_AND_ASSIGN(mutation_compression_metrics);
+};
+
+// Compress the data of all the updates as a whole. Return an empty blob if the updates are too
+// small or incompressible.
+blob compress_updates(const std::vector<mutation_update> &updates,
+                      mutation_compression_type compression_type)
+{
+    size_t raw_size = 0;
+    for (const auto &update : updates) {
+        raw_size += update.data.length();
+    }
+    if (raw_size == 0 || raw_size < FLAGS_plog_compression_min_bytes) {
+        return blob();
+    }
+
+    std::string merged;
+    const char *raw = updates.front().data.data();
+    if (updates.size() > 1) {
+        merged.reserve(raw_size);
+        for (const auto &update : updates) {
+            merged.append(update.data.data(), update.data.length());
+        }
+        raw = merged.data();
+    }
+
+    size_t compressed_size = 0;
+    std::shared_ptr<char> buffer;
+    switch (compression_type) {
+    case mutation_compression_type::kLZ4: {
+        const int bound = LZ4_compressBound(static_cast<int>(raw_size));
+        buffer.reset(new char[bound], std::default_delete<char[]>());
+        const int size = LZ4_compress_default(raw, buffer.get(), static_cast<int>(raw_size), bound);
+        if (size <= 0) {
+            return blob();
+        }
+        compressed_size = static_cast<size_t>(size);
+        break;
+    }
+    case mutation_compression_type::kZSTD: {
+        const size_t bound = ZSTD_compressBound(raw_size);
+        buffer.reset(new char[bound], std::default_delete<char[]>());
+        compressed_size = ZSTD_compress(buffer.get(), bound, raw, raw_size, 1);
+        if (ZSTD_isError(compressed_size)) {
+            return blob();
+        }
+        break;
+    }
+    default:
+        return blob();
+    }
+
+    if (compressed_size >= raw_size) {
+        return blob();
+    }
+
+    mutation_compression_metrics::instance().on_compressed(raw_size, compressed_size);
+    return blob(std::move(buffer), 0, static_cast<unsigned int>(compressed_size));
+}
+
+// Return ERR_INVALID_DATA if the updates are corrupted or compressed by an unknown algorithm.
+error_code decompress_updates(mutation_compression_type compression_type,
+                              const blob &compressed,
+                              size_t raw_size,
+                              /*out*/ blob &raw)
+{
+    std::shared_ptr<char> buffer(new char[raw_size], std::default_delete<char[]>());
+    size_t size = 0;
+    switch (compression_type) {
+    case mutation_compression_type::kLZ4: {
+        const int ret = LZ4_decompress_safe(compressed.data(),
+                                            buffer.get(),
+                                            static_cast<int>(compressed.length()),
+                                            static_cast<int>(raw_size));
+        if (ret < 0) {
+            LOG_ERROR("LZ4 decompression failed: {}", ret);
+            return ERR_INVALID_DATA;
+        }
+        size = static_cast<size_t>(ret);
+        break;
+    }
+    case mutation_compression_type::kZSTD:
+        size = ZSTD_decompress(buffer.get(), raw_size, compressed.data(), compressed.length());
+        if (ZSTD_isError(size)) {
+            LOG_ERROR("ZSTD decompression failed: {}", ZSTD_getErrorName(size));
+            return ERR_INVALID_DATA;
+        }
+        break;
+    default:
+        LOG_ERROR("invalid mutation compression type: {}", static_cast<int32_t>(compression_type));
+        return ERR_INVALID_DATA;
+    }
+    if (size != raw_size) {
+        LOG_ERROR("the decompressed size of the updates mismatches: {} vs {}", size, raw_size);
+        return ERR_INVALID_DATA;
+    }
+    raw = blob(std::move(buffer), 0, static_cast<unsigned int>(raw_size));
+    return ERR_OK;
+}
+
+} // anonymous namespace
 std::atomic<uint64_t> mutation::s_tid(0);
 
 mutation::mutation()
@@ -61,7 +221,7 @@ mutation::mutation()
     next = nullptr;
     _private0 = 0;
     _not_logged = 1;
-    _prepare_ts_ms = 0;
+    _prepare_ts_us = 0;
     strcpy(_name, "0.0.0.0");
     _appro_data_bytes = sizeof(mutation_header);
     _create_ts_ns = dsn_now_ns();
@@ -108,6 +268,7 @@ void mutation::set_id(ballot b, decree c)
 {
     data.header.ballot = b;
     data.header.decree = c;
+    _prepare_buffers.clear();
 
     snprintf_p(_name,
                sizeof(_name),
@@ -180,10 +341,16 @@ void mutation::add_client_request(task_code code, dsn::message_ex *request)
     CHECK_EQ(client_requests.size(), data.updates.size());
 }
 
-void mutation::write_to(const std::function<void(const blob &)> &inserter) const
+void mutation::write_to(const std::function<void(const blob &)> &inserter,
+                        mutation_compression_type compression_type) const
 {
+    blob compressed;
+    if (compression_type != mutation_compression_type::kNone && !data.updates.empty()) {
+        compressed = compress_updates(data.updates, compression_type);
+    }
+
     binary_writer writer(1024);
-    write_mutation_header(writer, data.header);
+    write_mutation_header(writer, data.header, compressed.empty() ? 0 : kCompressedMutationVersion);
     writer.write_pod(static_cast<int>(data.updates.size()));
     for (const mutation_update &update : data.updates) {
         // write task_code as string to make it cross-process compatible.
@@ -198,6 +365,15 @@ void mutation::write_to(const std::function<void(const blob &)> &inserter) const
 
         writer.write_pod(static_cast<int>(update.data.length()));
     }
+
+    if (!compressed.empty()) {
+        writer.write_pod(static_cast<int32_t>(compression_type));
+        writer.write_pod(static_cast<int32_t>(compressed.length()));
+        inserter(writer.get_buffer());
+        inserter(compressed);
+        return;
+    }
+
     inserter(writer.get_buffer());
     for (const mutation_update &update : data.updates) {
         inserter(update.data);
@@ -227,10 +403,29 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
     }
 }
 
+const std::vector<blob> &mutation::prepare_buffers()
+{
+    if (_prepare_buffers.empty()) {
+        write_to([this](const blob &bb) { _prepare_buffers.push_back(bb); });
+    }
+    return _prepare_buffers;
+}
+
 /*static*/ mutation_ptr mutation::read_from(binary_reader &reader, dsn::message_ex *from)
 {
+    error_code err;
+    auto mu = read_from(reader, from, err);
+    CHECK_EQ_MSG(err, ERR_OK, "failed to read mutation");
+    return mu;
+}
+
+/*static*/ mutation_ptr mutation::read_from(binary_reader &reader,
+                                            dsn::message_ex *from,
+                                            /*out*/ error_code &err)
+{
+    err = ERR_OK;
     mutation_ptr mu(new mutation());
-    read_mutation_header(reader, mu->data.header);
+    const auto version = read_mutation_header(reader, mu->data.header);
 
     int size = 0;
     reader.read_pod(size);
@@ -249,8 +444,33 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
 
         reader.read_pod(lengths[i]);
     }
-    for (int i = 0; i < size; ++i) {
-        reader.read(mu->data.updates[i].data, lengths[i]);
+    if (version == kCompressedMutationVersion) {
+        int32_t compression_type = 0;
+        reader.read_pod(compression_type);
+        int32_t compressed_length = 0;
+        reader.read_pod(compressed_length);
+        blob compressed;
+        reader.read(compressed, compressed_length);
+
+        size_t raw_size = 0;
+        for (int i = 0; i < size; ++i) {
+            raw_size += lengths[i];
+        }
+        blob raw;
+        err = decompress_updates(
+            static_cast<mutation_compression_type>(compression_type), compressed, raw_size, raw);
+        if (err != ERR_OK) {
+            return nullptr;
+        }
+        size_t offset = 0;
+        for (int i = 0; i < size; ++i) {
+            mu->data.updates[i].data = raw.range(static_cast<int>(offset), lengths[i]);
+            offset += lengths[i];
+        }
+    } else {
+        for (int i = 0; i < size; ++i) {
+            reader.read(mu->data.updates[i].data, lengths[i]);
+        }
     }
 
     mu->client_requests.resize(mu->data.updates.size());
@@ -268,9 +488,10 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
 }
 
 /*static*/ void mutation::write_mutation_header(binary_writer &writer,
-                                                const mutation_header &header)
+                                                const mutation_header &header,
+                                                int64_t version)
 {
-    writer.write_pod((int64_t)0);
+    writer.write_pod(version);
     writer.write_pod(header.pid.value());
     writer.write_pod(header.ballot);
     writer.write_pod(header.decree);
@@ -279,7 +500,8 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
     writer.write_pod(header.timestamp);
 }
 
-/*static*/ void mutation::read_mutation_header(binary_reader &reader, mutation_header &header)
+/*static*/ int64_t mutation::read_mutation_header(binary_reader &reader,
+                                                  mutation_header &header)
 {
     // original code:
     //   reader.read_pod(mu->data.header);
@@ -300,6 +522,8 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
     //   - log_offset
     //   - last_committed_decree
     //   - timestamp
+    //
+    // the updates of version 1 are compressed, see write_to().
     int64_t version = 0;
     reader.read_pod(version);
     uint64_t pid_value = 0;
@@ -309,7 +533,7 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
     reader.read_pod(header.decree);
     reader.read_pod(header.log_offset);
     reader.read_pod(header.last_committed_decree);
-    if (version == 0) {
+    if (version == 0 || version == kCompressedMutationVersion) {
         reader.read_pod(header.timestamp);
     } else if (version > 64) {
         // version is vptr, we need read '__isset', and ignore it
@@ -319,6 +543,7 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
     } else {
         CHECK(false, "invalid mutation log version: {:#018x}", version);
     }
+    return version;
 }
 
 int mutation::clear_prepare_or_commit_tasks()
@@ -344,7 +569,11 @@ void mutation::wait_log_task() const
 mutation_queue::mutation_queue(gpid gpid,
                                int max_concurrent_op /*= 2*/,
                                bool batch_write_disabled /*= false*/)
-    : _max_concurrent_op(max_concurrent_op), _batch_write_disabled(batch_write_disabled)
+    : _max_concurrent_op(max_concurrent_op),
+      _batch_write_disabled(batch_write_disabled),
+      _controller(max_concurrent_op),
+      _hold_start_us(0),
+      _hold_window_us(0)
 {
     _current_op_count = 0;
     _pending_mutation = nullptr;
@@ -356,11 +585,14 @@ mutation_ptr mutation_queue::add_work(task_code code, dsn::message_ex *request,
 {
     task_spec *spec = task_spec::get(code);
 
+    if (FLAGS_adaptive_write_pipeline_enabled) {
+        _controller.on_client_write(dsn_now_us());
+    }
+
     // if not allow write batch, switch work queue
     if (_pending_mutation && !spec->rpc_request_is_write_allow_batch) {
         _pending_mutation->add_ref(); // released when unlink
-        _hdr.add(_pending_mutation);
-        _pending_mutation = nullptr;
+        _hdr.add(pop_pending_mutation());
         ++(*_pcount);
     }
 
@@ -376,32 +608,31 @@ mutation_ptr mutation_queue::add_work(task_code code, dsn::message_ex *request,
     _pending_mutation->add_client_request(code, request);
 
     // short-cut
-    if (_current_op_count < _max_concurrent_op && _hdr.is_empty()) {
-        auto ret = _pending_mutation;
-        _pending_mutation = nullptr;
+    if (_current_op_count < max_concurrent_op() && _hdr.is_empty()) {
+        if (hold_pending_mutation(spec)) {
+            return nullptr;
+        }
+
         _current_op_count++;
-        return ret;
+        return pop_pending_mutation();
     }
 
     // check if need to switch work queue
     if (_batch_write_disabled || !spec->rpc_request_is_write_allow_batch ||
         _pending_mutation->is_full()) {
         _pending_mutation->add_ref(); // released when unlink
-        _hdr.add(_pending_mutation);
-        _pending_mutation = nullptr;
+        _hdr.add(pop_pending_mutation());
         ++(*_pcount);
     }
 
     // get next work item
-    if (_current_op_count >= _max_concurrent_op)
+    if (_current_op_count >= max_concurrent_op())
         return nullptr;
     else if (_hdr.is_empty()) {
         CHECK_NOTNULL(_pending_mutation, "pending mutation cannot be null");
 
-        auto ret = _pending_mutation;
-        _pending_mutation = nullptr;
         _current_op_count++;
-        return ret;
+        return pop_pending_mutation();
     } else {
         _current_op_count++;
         return unlink_next_workload();
@@ -412,16 +643,14 @@ mutation_ptr mutation_queue::check_possible_work(int current_running_count)
 {
     _current_op_count = current_running_count;
 
-    if (_current_op_count >= _max_concurrent_op)
+    if (_current_op_count >= max_concurrent_op())
         return nullptr;
 
     // no further workload
     if (_hdr.is_empty()) {
         if (_pending_mutation != nullptr) {
-            auto ret = _pending_mutation;
-            _pending_mutation = nullptr;
             _current_op_count++;
-            return ret;
+            return pop_pending_mutation();
         } else {
             return nullptr;
         }
@@ -434,10 +663,66 @@ mutation_ptr mutation_queue::check_possible_work(int current_running_count)
     }
 }
 
+int mutation_queue::max_concurrent_op() const
+{
+    return FLAGS_adaptive_write_pipeline_enabled ? _controller.depth() : _max_concurrent_op;
+}
+
+void mutation_queue::on_log_appended(const mutation &mu)
+{
+    if (FLAGS_adaptive_write_pipeline_enabled) {
+        _controller.on_log_appended(dsn_now_us() - mu.prepare_ts_us());
+    }
+}
+
+void mutation_queue::on_prepare_acked(const mutation &mu)
+{
+    if (FLAGS_adaptive_write_pipeline_enabled) {
+        _controller.on_prepare_acked(dsn_now_us() - mu.prepare_ts_us());
+    }
+}
+
+void mutation_queue::on_committed()
+{
+    if (FLAGS_adaptive_write_pipeline_enabled) {
+        _controller.on_committed(!_hdr.is_empty());
+    }
+}
+
+bool mutation_queue::hold_pending_mutation(const task_spec *spec)
+{
+    // Like Nagle's algorithm, a mutation is only held while some others are in flight, whose
+    // commits would release it.
+    if (!FLAGS_adaptive_write_pipeline_enabled || _batch_write_disabled ||
+        _current_op_count == 0 || !spec->rpc_request_is_write_allow_batch ||
+        _pending_mutation->is_full()) {
+        return false;
+    }
+
+    if (_hold_start_us == 0) {
+        const auto window_us = _controller.batch_window_us();
+        if (window_us == 0) {
+            return false;
+        }
+        _hold_start_us = dsn_now_us();
+        _hold_window_us = window_us;
+        return true;
+    }
+
+    return dsn_now_us() < _hold_start_us + _hold_window_us;
+}
+
+mutation_ptr mutation_queue::pop_pending_mutation()
+{
+    _hold_start_us = 0;
+    _hold_window_us = 0;
+    return std::move(_pending_mutation);
+}
+
 void mutation_queue::clear()
 {
     if (_pending_mutation != nullptr) {
-        _pending_mutation = nullptr;
+        pop_pending_mutation();
     }
 
     mutation_ptr r;
@@ -454,8 +739,7 @@ void mutation_queue::clear(std::vector<mutation_ptr> &queued_mutations)
     }
 
     if (_pending_mutation != nullptr) {
-        queued_mutations.emplace_back(std::move(_pending_mutation));
-        _pending_mutation = nullptr;
+        queued_mutations.emplace_back(pop_pending_mutation());
     }
 
     // we don't reset the current_op_count, coz this is handled by
@@ -35,19 +35,22 @@
 #include "common/replication_common.h"
 #include "common/replication_other_types.h"
 #include "consensus_types.h"
+#include "replica/write_pipeline_controller.h"
 #include "runtime/api_layer1.h"
 #include "runtime/rpc/rpc_message.h"
 #include "runtime/task/task.h"
 #include "runtime/task/task_code.h"
 #include "utils/autoref_ptr.h"
+#include "utils/blob.h"
+#include "utils/error_code.h"
 #include "utils/fmt_logging.h"
 #include "utils/link.h"
 
 namespace dsn {
 class binary_reader;
 class binary_writer;
-class blob;
 class gpid;
+class task_spec;
 namespace utils {
 class latency_tracer;
 } // namespace utils
@@ -58,6 +61,14 @@ class mutation;
 
 typedef dsn::ref_ptr<mutation> mutation_ptr;
 
+// The algorithms to compress the updates of the mutations written into the private logs.
+enum class mutation_compression_type : int32_t
+{
+    kNone = 0,
+    kLZ4 = 1,
+    kZSTD = 2,
+};
+
 // mutation is the 2pc unit of PacificA, which wraps one or more client requests and add
 // header informations related to PacificA algorithm for them.
 // both header and client request content are put into "data" member.
@@ -95,7 +106,7 @@ public:
     node_tasks &remote_tasks() { return _prepare_or_commit_tasks; }
     bool is_prepare_close_to_timeout(int gap_ms, int timeout_ms)
     {
-        return dsn_now_ms() + gap_ms >= _prepare_ts_ms + timeout_ms;
+        return dsn_now_ms() + gap_ms >= prepare_ts_ms() + timeout_ms;
     }
     uint64_t create_ts_ns() const { return _create_ts_ns; }
     ballot get_ballot() const { return data.header.ballot; }
@@ -103,7 +114,11 @@ public:
 
     // state change
     void set_id(ballot b, decree c);
-    void set_timestamp(int64_t timestamp) { data.header.timestamp = timestamp; }
+    void set_timestamp(int64_t timestamp)
+    {
+        data.header.timestamp = timestamp;
+        _prepare_buffers.clear();
+    }
     void add_client_request(task_code code, dsn::message_ex *request);
     void copy_from(mutation_ptr &old);
     void set_logged()
@@ -126,8 +141,9 @@ public:
     void set_error_acked() { _is_error_acked = true; }
     int clear_prepare_or_commit_tasks();
     void wait_log_task() const;
-    uint64_t prepare_ts_ms() const { return _prepare_ts_ms; }
-    void set_prepare_ts() { _prepare_ts_ms = dsn_now_ms(); }
+    uint64_t prepare_ts_ms() const { return _prepare_ts_us / 1000; }
+    uint64_t prepare_ts_us() const { return _prepare_ts_us; }
+    void set_prepare_ts() { _prepare_ts_us = dsn_now_us(); }
 
     // >= 1 MB
     bool is_full() const { return _appro_data_bytes >= 1024 * 1024; }
@@ -139,12 +155,29 @@ public:
     // because:
     //   - the private log may be transfered to other node with different program
     //   - the private/shared log may be replayed by different program when server restart
-    void write_to(const std::function<void(const blob &)> &inserter) const;
+    //
+    // The updates written by the inserter are compressed by `compression_type` as a whole if
+    // they are large enough and compressible, which is marked by the version of the header, and
+    // decompressed transparently by read_from().
+    void write_to(const std::function<void(const blob &)> &inserter,
+                  mutation_compression_type compression_type =
+                      mutation_compression_type::kNone) const;
     void write_to(binary_writer &writer, dsn::message_ex *to) const;
+    // The buffers written by write_to() without compression, which reference the data of the
+    // client requests rather than copying them. They are encoded once for each round of prepare
+    // and shared by all the prepare requests sent to the other replicas.
+    const std::vector<blob> &prepare_buffers();
+    // Return nullptr with `err` set to ERR_INVALID_DATA if the updates failed to be
+    // decompressed, e.g. corrupted in the private log.
+    static mutation_ptr
+    read_from(binary_reader &reader, dsn::message_ex *from, /*out*/ error_code &err);
+    // The updates must be valid, e.g. never compressed in the requests.
     static mutation_ptr read_from(binary_reader &reader, dsn::message_ex *from);
 
-    static void write_mutation_header(binary_writer &writer, const mutation_header &header);
-    static void read_mutation_header(binary_reader &reader, mutation_header &header);
+    static void write_mutation_header(binary_writer &writer,
+                                      const mutation_header &header,
+                                      int64_t version = 0);
+    static int64_t read_mutation_header(binary_reader &reader, mutation_header &header);
 
     // data
     mutation_data data;
@@ -180,10 +213,11 @@ private:
         uint32_t _private0;
     };
 
-    uint64_t _prepare_ts_ms;
+    uint64_t _prepare_ts_us;
     ::dsn::task_ptr _log_task;
     node_tasks _prepare_or_commit_tasks;
     std::vector<dsn::message_ex *> _prepare_requests; // may combine duplicate requests
+    std::vector<blob> _prepare_buffers;               // cleared once the header is changed
     char _name[60];                                   // app_id.partition_index.ballot.decree
     int _appro_data_bytes;
     uint64_t _create_ts_ns; // for profiling
@@ -228,6 +262,22 @@ public:
     // which triggers further round of operations as returned
     mutation_ptr check_possible_work(int current_running_count);
 
+    // Whether the pending mutation is held by the batching window of the adaptive write pipeline,
+    // which should be released by check_possible_work() once the window elapses.
+    bool is_holding() const { return _hold_start_us != 0; }
+    uint64_t hold_window_us() const { return _hold_window_us; }
+
+    // The max number of concurrent two-phase commit rounds, which is tuned by the adaptive write
+    // pipeline if enabled.
+    int max_concurrent_op() const;
+
+    // Feedbacks of the write path for the adaptive write pipeline.
+    void on_log_appended(const mutation &mu);
+    void on_prepare_acked(const mutation &mu);
+    void on_committed();
+
+    const write_pipeline_controller &controller() const { return _controller; }
+
 private:
     mutation_ptr unlink_next_workload()
     {
@@ -241,6 +291,10 @@ private:
 
     void reset_max_concurrent_ops(int max_c) { _max_concurrent_op = max_c; }
 
+    // Returns true if the pending mutation should be held for more requests to be batched into it.
+    bool hold_pending_mutation(const task_spec *spec);
+    mutation_ptr pop_pending_mutation();
+
 private:
     int _current_op_count;
     int _max_concurrent_op;
@@ -249,6 +303,10 @@ private:
     volatile int *_pcount;
     mutation_ptr _pending_mutation;
     slist<mutation> _hdr;
+
+    write_pipeline_controller _controller;
+    uint64_t _hold_start_us;
+    uint64_t _hold_window_us;
 };
 }
 } // namespace
@@ -271,7 +271,7 @@ void mutation_log_private::commit_pending_mutations(log_file_ptr &lf,
 
                               for (auto &block : pending->all_blocks()) {
                                   auto hdr = (log_block_header *)block.front().data();
-                                  CHECK_EQ(hdr->magic, 0xdeadbeef);
+                                  CHECK(is_valid_log_block_magic(hdr->magic), "");
                               }
 
                               if (dsn_unlikely(FLAGS_enable_latency_tracer)) {
@@ -17,31 +17,324 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iterator>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "common/replication.codes.h"
 #include "consensus_types.h"
 #include "mutation_log.h"
 #include "mutation_log_utils.h"
 #include "replica/log_block.h"
 #include "replica/log_file.h"
 #include "replica/mutation.h"
+#include "runtime/api_layer1.h"
+#include "runtime/task/async_calls.h"
+#include "runtime/task/task_tracker.h"
 #include "utils/autoref_ptr.h"
 #include "utils/binary_reader.h"
 #include "utils/blob.h"
 #include "utils/error_code.h"
 #include "utils/errors.h"
 #include "utils/fail_point.h"
+#include "utils/flags.h"
 #include "utils/fmt_logging.h"
+#include "utils/metrics.h"
+#include "utils/ports.h"
 #include "absl/strings/string_view.h"
 
+METRIC_DEFINE_counter(server,
+                      plog_replayed_bytes,
+                      dsn::metric_unit::kBytes,
+                      "The number of bytes replayed from the private log files");
+
+METRIC_DEFINE_counter(server,
+                      plog_replayed_mutations,
+                      dsn::metric_unit::kMutations,
+                      "The number of mutations replayed from the private log files");
+
+DSN_DEFINE_uint32(replication,
+                  plog_replay_decode_threads,
+                  0,
+                  "The max number of tasks decoding the blocks of a private log file in parallel "
+                  "on THREAD_POOL_REPLICATION_LONG while replaying it, while the replaying thread "
+                  "reads the blocks ahead. 0 means the blocks are read, decoded and replayed one "
+                  "by one by the replaying thread");
+
+DSN_DEFINE_uint32(replication,
+                  plog_replay_prefetch_blocks,
+                  16,
+                  "The max number of the blocks which have been read ahead but not replayed yet "
+                  "while replaying a private log file with plog_replay_decode_threads > 0");
+DSN_DEFINE_validator(plog_replay_prefetch_blocks, [](uint32_t value) -> bool { return value > 0; });
+
 namespace dsn {
 namespace replication {
+namespace {
+
+class plog_replay_metrics
+{
+public:
+    static plog_replay_metrics &instance()
+    {
+        static plog_replay_metrics metrics;
+        return metrics;
+    }
+
+    void on_replayed(int64_t bytes, int64_t mutations)
+    {
+        METRIC_VAR_INCREMENT_BY(plog_replayed_bytes, bytes);
+        METRIC_VAR_INCREMENT_BY(plog_replayed_mutations, mutations);
+    }
+
+private:
+    plog_replay_metrics()
+        : METRIC_VAR_INIT_server(plog_replayed_bytes),
+          METRIC_VAR_INIT_server(plog_replayed_mutations)
+    {
+    }
+
+    METRIC_VAR_DECLARE_counter(plog_replayed_bytes);
+    METRIC_VAR_DECLARE_counter(plog_replayed_mutations);
+
+    DISALLOW_COPY_AND_ASSIGN(plog_replay_metrics);
+};
+
+// A block read ahead by the replay_pipeline.
+struct replay_block
+{
+    // The global offset of the first mutation in the block.
+    int64_t start_offset = 0;
+    blob data;
+    // The error of reading the block or decoding its mutations. The mutations decoded before
+    // the error are still replayed.
+    error_s err = error_s::ok();
+    std::vector<std::pair<int, mutation_ptr>> mutations;
+    bool decoded = false;
+};
+
+// Replay a log file in 3 stages:
+// - the replaying thread reads the blocks ahead and checks their checksums, which are chained
+//   thus must be checked in order;
+// - the decoding tasks on THREAD_POOL_REPLICATION_LONG decode the mutations of the blocks in
+//   parallel, while the replaying thread also decodes the oldest undecoded block rather than
+//   waiting for the tasks, which may be queued behind the other replays;
+// - the replaying thread delivers the mutations to the callback in the order of the blocks.
+class replay_pipeline
+{
+public:
+    replay_pipeline(log_file_ptr log, uint32_t decode_tasks, uint32_t prefetch_blocks)
+        : _log(std::move(log)),
+          _max_decode_tasks(decode_tasks),
+          _prefetch_blocks(prefetch_blocks),
+          _next_offset(_log->start_offset())
+    {
+    }
+
+    // The decoding tasks never block, thus those running finish soon, while those not started
+    // are cancelled.
+    ~replay_pipeline() { _tracker.cancel_outstanding_tasks(); }
+
+    // The stream of the log file should have been reset. Return the error which stops the
+    // replay, with `end_offset` set just like mutation_log::replay_block().
+    error_s run(mutation_log::replay_callback &callback, /*out*/ int64_t &end_offset)
+    {
+        while (true) {
+            read_blocks();
+
+            std::shared_ptr<replay_block> block;
+            {
+                std::unique_lock<std::mutex> l(_mtx);
+                while (!_blocks.front()->decoded) {
+                    if (_undecoded_blocks.empty()) {
+                        // The front block is being decoded by a task.
+                        _cv.wait(l);
+                        continue;
+                    }
+
+                    auto undecoded = std::move(_undecoded_blocks.front());
+                    _undecoded_blocks.pop_front();
+                    l.unlock();
+                    decode(*undecoded);
+                    l.lock();
+                    undecoded->decoded = true;
+                }
+                block = std::move(_blocks.front());
+                _blocks.pop_front();
+            }
+
+            end_offset = block->start_offset;
+            for (auto &mu : block->mutations) {
+                callback(mu.first, mu.second);
+                end_offset += mu.first;
+            }
+
+            // The reading always stops with an error, including ERR_HANDLE_EOF.
+            if (!block->err.is_ok()) {
+                return block->err;
+            }
+        }
+    }
+
+private:
+    // Read the blocks until plog_replay_prefetch_blocks blocks are read ahead or an error
+    // occurs, and start the decoding tasks for them.
+    void read_blocks()
+    {
+        while (!_read_finished) {
+            {
+                std::lock_guard<std::mutex> l(_mtx);
+                if (_blocks.size() >= _prefetch_blocks) {
+                    return;
+                }
+            }
+
+            auto block = std::make_shared<replay_block>();
+            block->start_offset = _next_offset;
+            block->err = read_block(*block);
+            _read_finished = !block->err.is_ok();
+            block->decoded = _read_finished;
+
+            bool start_decode_task = false;
+            {
+                std::lock_guard<std::mutex> l(_mtx);
+                _blocks.push_back(block);
+                if (!_read_finished) {
+                    _undecoded_blocks.push_back(block);
+                    if (_decode_tasks < _max_decode_tasks) {
+                        ++_decode_tasks;
+                        start_decode_task = true;
+                    }
+                }
+            }
+
+            if (start_decode_task) {
+                tasking::enqueue(LPC_REPLICATION_LONG_COMMON, &_tracker, [this]() {
+                    decode_blocks();
+                });
+            }
+        }
+    }
+
+    // Read the next block into `block`, whose start_offset is the offset of the block header.
+    error_s read_block(replay_block &block)
+    {
+        FAIL_POINT_INJECT_F("mutation_log_replay_block", [](absl::string_view) -> error_s {
+            return error_s::make(ERR_INCOMPLETE_DATA, "mutation_log_replay_block");
+        });
+
+        const bool is_first_block = _next_offset == _log->start_offset();
+        blob bb;
+        const auto err = _log->read_next_log_block(bb);
+        if (err != ERR_OK) {
+            return error_s::make(err, "failed to read log block");
+        }
+
+        block.start_offset += sizeof(log_block_header);
+        _next_offset += sizeof(log_block_header) + bb.length();
+
+        // The block may refer to the buffer of the stream, which would be overwritten by
+        // reading the following blocks.
+        if (bb.buffer() == nullptr) {
+            bb = blob::create_from_bytes(bb.data(), bb.length());
+        }
+
+        // The first block is log_file_header.
+        if (is_first_block) {
+            binary_reader reader(bb);
+            const int header_length = _log->read_file_header(reader);
+            block.start_offset += header_length;
+            if (!_log->is_right_header()) {
+                return error_s::make(ERR_INVALID_DATA, "failed to read log file header");
+            }
+            bb = bb.range(header_length);
+        }
+        block.data = std::move(bb);
+        return error_s::ok();
+    }
+
+    // Decode the blocks read ahead until there is none left undecoded, then quit rather than
+    // waiting for more, so that the task never blocks the thread pool.
+    void decode_blocks()
+    {
+        while (true) {
+            std::shared_ptr<replay_block> block;
+            {
+                std::lock_guard<std::mutex> l(_mtx);
+                if (_undecoded_blocks.empty()) {
+                    --_decode_tasks;
+                    return;
+                }
+                block = std::move(_undecoded_blocks.front());
+                _undecoded_blocks.pop_front();
+            }
+
+            decode(*block);
+            {
+                std::lock_guard<std::mutex> l(_mtx);
+                block->decoded = true;
+            }
+            _cv.notify_all();
+        }
+    }
+
+    static void decode(replay_block &block)
+    {
+        binary_reader reader(block.data);
+        int64_t offset = block.start_offset;
+        while (!reader.is_eof()) {
+            auto old_size = reader.get_remaining_size();
+            error_code err;
+            mutation_ptr mu = mutation::read_from(reader, nullptr, err);
+            if (err != ERR_OK) {
+                block.err = FMT_ERR(err, "failed to read mutation at offset {}", offset);
+                return;
+            }
+            mu->set_logged();
+
+            if (mu->data.header.log_offset != offset) {
+                block.err = FMT_ERR(ERR_INVALID_DATA,
+                                    "offset mismatch in log entry and mutation {} vs {}",
+                                    offset,
+                                    mu->data.header.log_offset);
+                return;
+            }
+
+            int log_length = old_size - reader.get_remaining_size();
+            block.mutations.emplace_back(log_length, std::move(mu));
+            offset += log_length;
+        }
+    }
+
+    const log_file_ptr _log;
+    const uint32_t _max_decode_tasks;
+    const uint32_t _prefetch_blocks;
+
+    // Only accessed by the replaying thread.
+    int64_t _next_offset;
+    bool _read_finished = false;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    // The blocks read ahead in the order of their offsets, including the undecoded ones.
+    std::deque<std::shared_ptr<replay_block>> _blocks;
+    std::deque<std::shared_ptr<replay_block>> _undecoded_blocks;
+    uint32_t _decode_tasks = 0;
+
+    task_tracker _tracker;
+
+    DISALLOW_COPY_AND_ASSIGN(replay_pipeline);
+};
+
+} // anonymous namespace
 
 /*static*/ error_code mutation_log::replay(log_file_ptr log,
                                            replay_callback callback,
@@ -54,21 +347,44 @@ namespace replication {
              log->end_offset(),
              log->end_offset() - log->start_offset());
 
-    ::dsn::blob bb;
+    const uint64_t start_time_ms = dsn_now_ms();
+    int64_t mutation_count = 0;
+    replay_callback counted_callback = [&callback, &mutation_count](int log_length,
+                                                                    mutation_ptr &mu) {
+        ++mutation_count;
+        return callback(log_length, mu);
+    };
+
     log->reset_stream();
     error_s err;
-    size_t start_offset = 0;
-    while (true) {
-        err = replay_block(log, callback, start_offset, end_offset);
-        if (!err.is_ok()) {
-            // Stop immediately if failed
-            break;
-        }
+    if (FLAGS_plog_replay_decode_threads > 0) {
+        replay_pipeline pipeline(
+            log, FLAGS_plog_replay_decode_threads, FLAGS_plog_replay_prefetch_blocks);
+        err = pipeline.run(counted_callback, end_offset);
+    } else {
+        size_t start_offset = 0;
+        while (true) {
+            err = replay_block(log, counted_callback, start_offset, end_offset);
+            if (!err.is_ok()) {
+                // Stop immediately if failed
+                break;
+            }
 
-        start_offset = static_cast<size_t>(end_offset - log->start_offset());
+            start_offset = static_cast<size_t>(end_offset - log->start_offset());
+        }
     }
 
-    LOG_INFO("finish to replay mutation log ({}) [err: {}]", log->path(), err);
+    const int64_t replayed_bytes = end_offset - log->start_offset();
+    const uint64_t time_used_ms = std::max<uint64_t>(dsn_now_ms() - start_time_ms, 1);
+    plog_replay_metrics::instance().on_replayed(replayed_bytes, mutation_count);
+    LOG_INFO("finish to replay mutation log ({}) [err: {}], replayed_bytes = {}, "
+             "mutation_count = {}, time_used = {} ms, throughput = {:.2f} MB/s",
+             log->path(),
+             err,
+             replayed_bytes,
+             mutation_count,
+             time_used_ms,
+             replayed_bytes * 1000.0 / time_used_ms / (1024 * 1024));
     return err.code();
 }
 
@@ -108,8 +424,10 @@ namespace replication {
 
     while (!reader->is_eof()) {
         auto old_size = reader->get_remaining_size();
-        mutation_ptr mu = mutation::read_from(*reader, nullptr);
-        CHECK_NOTNULL(mu, "");
+        mutation_ptr mu = mutation::read_from(*reader, nullptr, err);
+        if (err != ERR_OK) {
+            return FMT_ERR(err, "failed to read mutation at offset {}", end_offset);
+        }
         mu->set_logged();
 
         if (mu->data.header.log_offset != end_offset) {
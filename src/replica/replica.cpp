@@ -213,6 +213,28 @@ METRIC_DEFINE_counter(replica,
                       dsn::metric_unit::kRequests,
                       "The number of failed RPC_PREPARE requests");
 
+METRIC_DEFINE_counter(replica,
+                      prepare_batch_requests,
+                      dsn::metric_unit::kRequests,
+                      "The number of RPC_PREPARE_BATCH requests sent by primary replicas");
+
+METRIC_DEFINE_counter(replica,
+                      batched_prepare_mutations,
+                      dsn::metric_unit::kMutations,
+                      "The number of mutations sent by RPC_PREPARE_BATCH requests");
+
+METRIC_DEFINE_gauge_int64(replica,
+                          write_pipeline_depth,
+                          dsn::metric_unit::kMutations,
+                          "The max number of concurrent two-phase commit rounds of the primary "
+                          "replica, tuned by the adaptive write pipeline");
+
+METRIC_DEFINE_gauge_int64(replica,
+                          write_batch_window_us,
+                          dsn::metric_unit::kMicroSeconds,
+                          "The time that the adaptive write pipeline holds a new mutation for more "
+                          "client writes to be batched into it, 0 if not held");
+
 METRIC_DEFINE_counter(replica,
                       group_check_failed_requests,
                       dsn::metric_unit::kRequests,
@@ -263,6 +285,26 @@ METRIC_DEFINE_counter(replica,
                       dsn::metric_unit::kBytes,
                       "The total size of uploaded files for backups");
 
+METRIC_DEFINE_counter(replica,
+                      restore_download_file_successful_count,
+                      dsn::metric_unit::kFiles,
+                      "The number of files that have been downloaded successfully for restores");
+
+METRIC_DEFINE_counter(replica,
+                      restore_download_file_failed_count,
+                      dsn::metric_unit::kFiles,
+                      "The number of files that have failed to be downloaded for restores");
+
+METRIC_DEFINE_counter(replica,
+                      restore_download_file_bytes,
+                      dsn::metric_unit::kBytes,
+                      "The size of files that have been downloaded successfully for restores");
+
+METRIC_DEFINE_gauge_int64(replica,
+                          restore_download_bytes_per_sec,
+                          dsn::metric_unit::kBytesPerSec,
+                          "The throughput of downloading checkpoint files for the latest restore");
+
 namespace dsn {
 namespace replication {
 
@@ -310,6 +352,10 @@ replica::replica(replica_stub *stub,
       METRIC_VAR_INIT_replica(learn_failed_count),
       METRIC_VAR_INIT_replica(learn_successful_count),
       METRIC_VAR_INIT_replica(prepare_failed_requests),
+      METRIC_VAR_INIT_replica(prepare_batch_requests),
+      METRIC_VAR_INIT_replica(batched_prepare_mutations),
+      METRIC_VAR_INIT_replica(write_pipeline_depth),
+      METRIC_VAR_INIT_replica(write_batch_window_us),
       METRIC_VAR_INIT_replica(group_check_failed_requests),
       METRIC_VAR_INIT_replica(emergency_checkpoints),
       METRIC_VAR_INIT_replica(write_size_exceed_threshold_requests),
@@ -319,7 +365,11 @@ replica::replica(replica_stub *stub,
       METRIC_VAR_INIT_replica(backup_cancelled_count),
       METRIC_VAR_INIT_replica(backup_file_upload_failed_count),
       METRIC_VAR_INIT_replica(backup_file_upload_successful_count),
-      METRIC_VAR_INIT_replica(backup_file_upload_total_bytes)
+      METRIC_VAR_INIT_replica(backup_file_upload_total_bytes),
+      METRIC_VAR_INIT_replica(restore_download_file_successful_count),
+      METRIC_VAR_INIT_replica(restore_download_file_failed_count),
+      METRIC_VAR_INIT_replica(restore_download_file_bytes),
+      METRIC_VAR_INIT_replica(restore_download_bytes_per_sec)
 {
     init_plog_gc_enabled();
 
@@ -560,7 +610,12 @@ void replica::execute_mutation(mutation_ptr &mu)
     }
 
     ADD_CUSTOM_POINT(mu->_tracer, "completed");
-    auto next = _primary_states.write_queue.check_possible_work(
+    auto &write_queue = _primary_states.write_queue;
+    write_queue.on_committed();
+    METRIC_VAR_SET(write_pipeline_depth, write_queue.max_concurrent_op());
+    METRIC_VAR_SET(write_batch_window_us, write_queue.controller().batch_window_us());
+
+    auto next = write_queue.check_possible_work(
         static_cast<int>(_prepare_list->max_decree() - d));
 
     if (next != nullptr) {
@@ -33,7 +33,9 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "common/replication_other_types.h"
 #include "dsn.layer2_types.h"
@@ -166,6 +168,10 @@ public:
     bool replay_mutation(mutation_ptr &mu, bool is_private);
     void reset_prepare_list_after_replay();
 
+    // Skip the sync checkpoint after replaying the private log on startup, the replica would
+    // trigger an emergency checkpoint instead once it is assigned as primary or secondary.
+    void defer_startup_checkpoint() { _startup_checkpoint_deferred = true; }
+
     // return false when update fails or replica is going to be closed
     bool update_local_configuration_with_no_ballot_change(partition_status::type status);
     void set_inactive_state_transient(bool t);
@@ -194,6 +200,7 @@ public:
     //    messages from peers (primary or secondary)
     //
     void on_prepare(dsn::message_ex *request);
+    void on_prepare_batch(dsn::message_ex *request);
     void on_learn(dsn::message_ex *msg, const learn_request &request);
     void on_learn_completion_notification(const group_check_response &report,
                                           /*out*/ learn_notify_response &response);
@@ -332,13 +339,42 @@ private:
                               int timeout_milliseconds,
                               bool pop_all_committed_mutations = false,
                               int64_t learn_signature = invalid_signature);
+    // A prepare request to be sent by send_prepare_batch().
+    struct pending_prepare
+    {
+        partition_status::type status;
+        mutation_ptr mu;
+        int timeout_milliseconds;
+        bool pop_all_committed_mutations;
+        int64_t learn_signature;
+    };
+    void send_prepare_batch(const ::dsn::host_port &hp, std::vector<pending_prepare> batch);
+    void flush_prepare_batches();
+    // Release the mutation held by the batching window of the write queue once the window
+    // elapses, see FLAGS_adaptive_write_pipeline_enabled.
+    void schedule_release_held_writes();
+    void release_held_writes();
+    void prepare_mutation(dsn::message_ex *request,
+                          const replica_configuration &rconfig,
+                          mutation_ptr &mu,
+                          bool pop_all_committed_mutations);
     void on_append_log_completed(mutation_ptr &mu, error_code err, size_t size);
     void on_prepare_reply(std::pair<mutation_ptr, partition_status::type> pr,
                           error_code err,
                           dsn::message_ex *request,
                           dsn::message_ex *reply);
+    void on_prepare_batch_reply(
+        const std::vector<std::pair<mutation_ptr, partition_status::type>> &prs,
+        error_code err,
+        dsn::message_ex *request,
+        dsn::message_ex *reply);
+    void handle_prepare_ack(mutation_ptr mu,
+                            partition_status::type target_status,
+                            const ::dsn::host_port &node,
+                            const prepare_ack &resp);
     void do_possible_commit_on_primary(mutation_ptr &mu);
     void ack_prepare_message(error_code err, mutation_ptr &mu);
+    void reply_prepare_ack(dsn::message_ex *request, const prepare_ack &resp);
     void cleanup_preparing_mutations(bool wait);
 
     /////////////////////////////////////////////////////////////////
@@ -474,6 +510,14 @@ private:
     error_code download_checkpoint(const configuration_restore_request &req,
                                    const std::string &remote_chkpt_dir,
                                    const std::string &local_chkpt_dir);
+    // download the file `remote_file_name` under `remote_dir` as the local checkpoint file
+    // described by `f_meta`, and verify it by the md5 computed from the downloaded bytes.
+    error_code download_checkpoint_file(dist::block_service::block_filesystem *fs,
+                                        const std::string &remote_dir,
+                                        const std::string &remote_file_name,
+                                        const std::string &local_chkpt_dir,
+                                        const file_meta &f_meta,
+                                        /*out*/ uint64_t &f_size);
     dsn::error_code find_valid_checkpoint(const configuration_restore_request &req,
                                           /*out*/ std::string &remote_chkpt_dir);
     dsn::error_code restore_checkpoint();
@@ -617,6 +661,23 @@ private:
     std::map<std::string, cold_backup_context_ptr> _cold_backup_contexts;
     partition_split_context _split_states;
 
+    // The prepare requests waiting to be sent to each replica in a batch by the primary, which
+    // are flushed once the current task of the replica finishes, see FLAGS_prepare_batch_size.
+    std::map<::dsn::host_port, std::vector<pending_prepare>> _pending_prepares;
+    bool _prepare_batch_flush_scheduled{false};
+    bool _held_writes_release_scheduled{false};
+
+    // The acks of the batched prepare requests received by a secondary, which are replied once
+    // all the batched mutations are acked.
+    struct prepare_batch_context
+    {
+        message_ptr request;
+        std::vector<prepare_ack> acks;
+        size_t left_ack_count;
+        uint64_t expire_time_ms;
+    };
+    std::unordered_map<dsn::message_ex *, prepare_batch_context> _prepare_batches;
+
     // record the progress of restore
     int64_t _chkpt_total_size;
     std::atomic<int64_t> _cur_download_size;
@@ -642,6 +703,7 @@ private:
     // duplication
     std::shared_ptr<replica_duplicator_manager> _duplication_mgr;
     bool _is_manual_emergency_checkpointing{false};
+    bool _startup_checkpoint_deferred{false};
     bool _is_duplication_master{false};
     bool _is_duplication_follower{false};
     // Indicate whether the replica is during finding out some private logs to
@@ -692,6 +754,10 @@ private:
     METRIC_VAR_DECLARE_counter(learn_successful_count);
 
     METRIC_VAR_DECLARE_counter(prepare_failed_requests);
+    METRIC_VAR_DECLARE_counter(prepare_batch_requests);
+    METRIC_VAR_DECLARE_counter(batched_prepare_mutations);
+    METRIC_VAR_DECLARE_gauge_int64(write_pipeline_depth);
+    METRIC_VAR_DECLARE_gauge_int64(write_batch_window_us);
 
     METRIC_VAR_DECLARE_counter(group_check_failed_requests);
 
@@ -707,6 +773,11 @@ private:
     METRIC_VAR_DECLARE_counter(backup_file_upload_successful_count);
     METRIC_VAR_DECLARE_counter(backup_file_upload_total_bytes);
 
+    METRIC_VAR_DECLARE_counter(restore_download_file_successful_count);
+    METRIC_VAR_DECLARE_counter(restore_download_file_failed_count);
+    METRIC_VAR_DECLARE_counter(restore_download_file_bytes);
+    METRIC_VAR_DECLARE_gauge_int64(restore_download_bytes_per_sec);
+
     dsn::task_tracker _tracker;
     // the thread access checker
     dsn::thread_access_checker _checker;
@@ -27,6 +27,7 @@
 #include <fmt/core.h>
 #include <inttypes.h>
 #include <stddef.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <functional>
@@ -98,6 +99,17 @@ DSN_DEFINE_int32(replication,
                  prepare_decree_gap_for_debug_logging,
                  10000,
                  "if greater than 0, then print debug log every decree gap of preparing");
+DSN_DEFINE_uint32(replication,
+                  prepare_batch_size,
+                  1,
+                  "The max number of mutations sent by the primary replicas to another replica in "
+                  "a single RPC_PREPARE_BATCH request, which are batched until the current task of "
+                  "the replica finishes. 1 means each mutation is sent by its own RPC_PREPARE "
+                  "request, which should be kept until all the replica servers support "
+                  "RPC_PREPARE_BATCH");
+DSN_TAG_VARIABLE(prepare_batch_size, FT_MUTABLE);
+DSN_DEFINE_validator(prepare_batch_size, [](uint32_t value) -> bool { return value > 0; });
+
 DSN_DEFINE_uint64(
     replication,
     max_allowed_write_size,
@@ -223,6 +235,46 @@ void replica::on_client_write(dsn::message_ex *request, bool ignore_throttling)
     auto mu = _primary_states.write_queue.add_work(request->rpc_code(), request, this);
     if (mu) {
         init_prepare(mu, false);
+    } else if (_primary_states.write_queue.is_holding()) {
+        schedule_release_held_writes();
+    }
+}
+
+void replica::schedule_release_held_writes()
+{
+    if (_held_writes_release_scheduled) {
+        return;
+    }
+
+    // The timer is in milliseconds, while the held mutation is usually released earlier by the
+    // commit of an in-flight mutation.
+    _held_writes_release_scheduled = true;
+    const auto window_ms = (_primary_states.write_queue.hold_window_us() + 999) / 1000;
+    tasking::enqueue(LPC_RELEASE_HELD_WRITES,
+                     &_tracker,
+                     [this]() { release_held_writes(); },
+                     get_gpid().thread_hash(),
+                     std::chrono::milliseconds(window_ms));
+}
+
+void replica::release_held_writes()
+{
+    _checker.only_one_thread_access();
+
+    _held_writes_release_scheduled = false;
+    if (status() != partition_status::PS_PRIMARY) {
+        return;
+    }
+
+    auto next = _primary_states.write_queue.check_possible_work(
+        static_cast<int>(_prepare_list->max_decree() - last_committed_decree()));
+    if (next != nullptr) {
+        init_prepare(next, false);
+    }
+
+    // A new mutation may have been held since the timer was scheduled.
+    if (_primary_states.write_queue.is_holding()) {
+        schedule_release_held_writes();
     }
 }
 
@@ -367,35 +419,151 @@ void replica::send_prepare_message(const ::dsn::host_port &hp,
     mu->_tracer->add_sub_tracer(hp.to_string());
     ADD_POINT(mu->_tracer->sub_tracer(hp.to_string()));
 
-    dsn::message_ex *msg = dsn::message_ex::create_request(
-        RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
-    replica_configuration rconfig;
-    _primary_states.get_replica_config(status, rconfig, learn_signature);
-    rconfig.__set_pop_all(pop_all_committed_mutations);
-    if (status == partition_status::PS_SECONDARY && _primary_states.sync_send_write_request) {
-        rconfig.__set_split_sync_to_child(true);
+    pending_prepare pp{
+        status, mu, timeout_milliseconds, pop_all_committed_mutations, learn_signature};
+    if (FLAGS_prepare_batch_size <= 1) {
+        send_prepare_batch(hp, {std::move(pp)});
+        return;
+    }
+
+    auto &pending = _pending_prepares[hp];
+    pending.push_back(std::move(pp));
+    if (pending.size() >= FLAGS_prepare_batch_size) {
+        auto batch = std::move(pending);
+        _pending_prepares.erase(hp);
+        send_prepare_batch(hp, std::move(batch));
+        return;
+    }
+
+    if (!_prepare_batch_flush_scheduled) {
+        _prepare_batch_flush_scheduled = true;
+        tasking::enqueue(LPC_FLUSH_PREPARE_BATCH,
+                         &_tracker,
+                         [this]() { flush_prepare_batches(); },
+                         get_gpid().thread_hash());
+    }
+}
+
+void replica::flush_prepare_batches()
+{
+    _checker.only_one_thread_access();
+
+    _prepare_batch_flush_scheduled = false;
+    auto pending_prepares = std::move(_pending_prepares);
+    _pending_prepares.clear();
+    if (status() != partition_status::PS_PRIMARY) {
+        return;
     }
 
+    for (auto &pending : pending_prepares) {
+        auto &batch = pending.second;
+        // The configuration may have been changed or the mutations may have been committed
+        // before the batch is flushed.
+        batch.erase(std::remove_if(batch.begin(),
+                                   batch.end(),
+                                   [this](const pending_prepare &pp) {
+                                       return pp.mu->data.header.ballot != get_ballot() ||
+                                              pp.mu->get_decree() <= last_committed_decree();
+                                   }),
+                    batch.end());
+        if (!batch.empty()) {
+            send_prepare_batch(pending.first, std::move(batch));
+        }
+    }
+}
+
+void replica::send_prepare_batch(const ::dsn::host_port &hp, std::vector<pending_prepare> batch)
+{
+    CHECK(!batch.empty(), "");
+
+    const auto get_prepare_config = [this](const pending_prepare &pp) {
+        replica_configuration rconfig;
+        _primary_states.get_replica_config(pp.status, rconfig, pp.learn_signature);
+        rconfig.__set_pop_all(pp.pop_all_committed_mutations);
+        if (pp.status == partition_status::PS_SECONDARY &&
+            _primary_states.sync_send_write_request) {
+            rconfig.__set_split_sync_to_child(true);
+        }
+        return rconfig;
+    };
+
+    // The mutations are encoded once and shared by the prepare requests to all the replicas.
+    if (batch.size() == 1) {
+        const auto &mu = batch.front().mu;
+        dsn::message_ex *msg = dsn::message_ex::create_request(
+            RPC_PREPARE, batch.front().timeout_milliseconds, get_gpid().thread_hash());
+        const auto rconfig = get_prepare_config(batch.front());
+        {
+            rpc_write_stream writer(msg);
+            marshall(writer, get_gpid(), DSF_THRIFT_BINARY);
+            marshall(writer, rconfig, DSF_THRIFT_BINARY);
+        }
+        for (const auto &buffer : mu->prepare_buffers()) {
+            msg->write_append(buffer);
+        }
+
+        mu->remote_tasks()[hp] =
+            rpc::call(dsn::dns_resolver::instance().resolve_address(hp),
+                      msg,
+                      &_tracker,
+                      [=](error_code err, dsn::message_ex *request, dsn::message_ex *reply) {
+                          on_prepare_reply(
+                              std::make_pair(mu, rconfig.status), err, request, reply);
+                      },
+                      get_gpid().thread_hash());
+
+        LOG_DEBUG_PREFIX("mutation {} send_prepare_message to {} as {}",
+                         mu->name(),
+                         hp,
+                         enum_to_string(rconfig.status));
+        return;
+    }
+
+    int timeout_milliseconds = batch.front().timeout_milliseconds;
+    for (const auto &pp : batch) {
+        timeout_milliseconds = std::min(timeout_milliseconds, pp.timeout_milliseconds);
+    }
+    dsn::message_ex *msg = dsn::message_ex::create_request(
+        RPC_PREPARE_BATCH, timeout_milliseconds, get_gpid().thread_hash());
     {
         rpc_write_stream writer(msg);
         marshall(writer, get_gpid(), DSF_THRIFT_BINARY);
-        marshall(writer, rconfig, DSF_THRIFT_BINARY);
-        mu->write_to(writer, msg);
-    }
-
-    mu->remote_tasks()[hp] =
-        rpc::call(dsn::dns_resolver::instance().resolve_address(hp),
-                  msg,
-                  &_tracker,
-                  [=](error_code err, dsn::message_ex *request, dsn::message_ex *reply) {
-                      on_prepare_reply(std::make_pair(mu, rconfig.status), err, request, reply);
-                  },
-                  get_gpid().thread_hash());
-
-    LOG_DEBUG_PREFIX("mutation {} send_prepare_message to {} as {}",
-                     mu->name(),
-                     hp,
-                     enum_to_string(rconfig.status));
+        writer.write_pod(static_cast<int32_t>(batch.size()));
+    }
+
+    std::vector<std::pair<mutation_ptr, partition_status::type>> prs;
+    prs.reserve(batch.size());
+    for (const auto &pp : batch) {
+        const auto rconfig = get_prepare_config(pp);
+        {
+            rpc_write_stream writer(msg);
+            marshall(writer, rconfig, DSF_THRIFT_BINARY);
+        }
+        for (const auto &buffer : pp.mu->prepare_buffers()) {
+            msg->write_append(buffer);
+        }
+        prs.emplace_back(pp.mu, rconfig.status);
+    }
+
+    auto task = rpc::call(dsn::dns_resolver::instance().resolve_address(hp),
+                          msg,
+                          &_tracker,
+                          [this, prs](error_code err,
+                                      dsn::message_ex *request,
+                                      dsn::message_ex *reply) {
+                              on_prepare_batch_reply(prs, err, request, reply);
+                          },
+                          get_gpid().thread_hash());
+    for (const auto &pp : batch) {
+        pp.mu->remote_tasks()[hp] = task;
+    }
+
+    METRIC_VAR_INCREMENT(prepare_batch_requests);
+    METRIC_VAR_INCREMENT_BY(batched_prepare_mutations, batch.size());
+    LOG_DEBUG_PREFIX("mutations {} ~ {} send_prepare_batch to {}",
+                     batch.front().mu->name(),
+                     batch.back().mu->name(),
+                     hp);
 }
 
 void replica::do_possible_commit_on_primary(mutation_ptr &mu)
@@ -426,6 +594,63 @@ void replica::on_prepare(dsn::message_ex *request)
         rconfig.pop_all = false;
     }
 
+    prepare_mutation(request, rconfig, mu, pop_all_committed_mutations);
+}
+
+void replica::on_prepare_batch(dsn::message_ex *request)
+{
+    _checker.only_one_thread_access();
+
+    // The batches which are never fully acked, e.g. whose mutations have been discarded by a
+    // reconfiguration, are dropped once the primary has stopped waiting for them.
+    const auto now_ms = dsn_now_ms();
+    for (auto it = _prepare_batches.begin(); it != _prepare_batches.end();) {
+        if (it->second.expire_time_ms <= now_ms) {
+            it = _prepare_batches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::vector<std::pair<replica_configuration, mutation_ptr>> entries;
+    {
+        rpc_read_stream reader(request);
+        int32_t count = 0;
+        reader.read_pod(count);
+        entries.resize(count);
+        for (auto &entry : entries) {
+            unmarshall(reader, entry.first, DSF_THRIFT_BINARY);
+            entry.second = mutation::read_from(reader, request);
+        }
+    }
+
+    auto &batch = _prepare_batches[request];
+    batch.request = request;
+    batch.acks.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        batch.acks[i].decree = entries[i].second->data.header.decree;
+        batch.acks[i].err = ERR_IO_PENDING;
+    }
+    batch.left_ack_count = entries.size();
+    batch.expire_time_ms = now_ms + request->header->client.timeout_ms;
+
+    // The batch may be replied and erased once all of its mutations are acked.
+    for (auto &entry : entries) {
+        auto &rconfig = entry.first;
+        auto &mu = entry.second;
+        mu->set_is_sync_to_child(rconfig.split_sync_to_child);
+        const bool pop_all_committed_mutations = rconfig.pop_all;
+        rconfig.split_sync_to_child = false;
+        rconfig.pop_all = false;
+        prepare_mutation(request, rconfig, mu, pop_all_committed_mutations);
+    }
+}
+
+void replica::prepare_mutation(dsn::message_ex *request,
+                               const replica_configuration &rconfig,
+                               mutation_ptr &mu,
+                               bool pop_all_committed_mutations)
+{
     decree decree = mu->data.header.decree;
 
     LOG_DEBUG_PREFIX("mutation {} on_prepare", mu->name());
@@ -572,6 +797,7 @@ void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t s
         switch (status()) {
         case partition_status::PS_PRIMARY:
             if (err == ERR_OK) {
+                _primary_states.write_queue.on_log_appended(*mu);
                 do_possible_commit_on_primary(mu);
             } else {
                 handle_local_failure(err);
@@ -614,19 +840,6 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
 {
     _checker.only_one_thread_access();
 
-    mutation_ptr mu = pr.first;
-    partition_status::type target_status = pr.second;
-
-    // skip callback for old mutations
-    if (partition_status::PS_PRIMARY != status() || mu->data.header.ballot < get_ballot() ||
-        mu->get_decree() <= last_committed_decree())
-        return;
-
-    CHECK_EQ_MSG(mu->data.header.ballot, get_ballot(), "{}: invalid mutation ballot", mu->name());
-
-    const auto &node = request->to_host_port;
-    partition_status::type st = _primary_states.get_node_status(node);
-
     // handle reply
     prepare_ack resp;
 
@@ -637,7 +850,55 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
         ::dsn::unmarshall(reply, resp);
     }
 
-    auto send_prepare_tracer = mu->_tracer->sub_tracer(request->to_host_port.to_string());
+    handle_prepare_ack(pr.first, pr.second, request->to_host_port, resp);
+}
+
+void replica::on_prepare_batch_reply(
+    const std::vector<std::pair<mutation_ptr, partition_status::type>> &prs,
+    error_code err,
+    dsn::message_ex *request,
+    dsn::message_ex *reply)
+{
+    _checker.only_one_thread_access();
+
+    prepare_batch_ack resp;
+    if (err == ERR_OK) {
+        ::dsn::unmarshall(reply, resp);
+    }
+
+    for (const auto &pr : prs) {
+        prepare_ack ack;
+        ack.err = err;
+        if (err == ERR_OK) {
+            // The batch is rejected as a whole with a single ack, e.g. if the replica is not
+            // found on the remote node.
+            ack.err = resp.acks.empty() ? ERR_INVALID_DATA : resp.acks.front().err;
+            for (const auto &a : resp.acks) {
+                if (a.decree == pr.first->get_decree()) {
+                    ack = a;
+                    break;
+                }
+            }
+        }
+        handle_prepare_ack(pr.first, pr.second, request->to_host_port, ack);
+    }
+}
+
+void replica::handle_prepare_ack(mutation_ptr mu,
+                                 partition_status::type target_status,
+                                 const ::dsn::host_port &node,
+                                 const prepare_ack &resp)
+{
+    // skip callback for old mutations
+    if (partition_status::PS_PRIMARY != status() || mu->data.header.ballot < get_ballot() ||
+        mu->get_decree() <= last_committed_decree())
+        return;
+
+    CHECK_EQ_MSG(mu->data.header.ballot, get_ballot(), "{}: invalid mutation ballot", mu->name());
+
+    partition_status::type st = _primary_states.get_node_status(node);
+
+    auto send_prepare_tracer = mu->_tracer->sub_tracer(node.to_string());
     APPEND_EXTERN_POINT(send_prepare_tracer, resp.receive_timestamp, "remote_receive");
     APPEND_EXTERN_POINT(send_prepare_tracer, resp.response_timestamp, "remote_reply");
     ADD_CUSTOM_POINT(send_prepare_tracer, resp.err.to_string());
@@ -670,6 +931,7 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
                   "invalid secondary node address, address = {}",
                   node);
             CHECK_GT(mu->left_secondary_ack_count(), 0);
+            _primary_states.write_queue.on_prepare_acked(*mu);
             if (0 == mu->decrease_left_secondary_ack_count()) {
                 do_possible_commit_on_primary(mu);
             }
@@ -777,7 +1039,7 @@ void replica::ack_prepare_message(error_code err, mutation_ptr &mu)
         if (mu->is_child_acked()) {
             LOG_DEBUG_PREFIX("mutation {} ack_prepare_message, err = {}", mu->name(), err);
             for (auto &request : prepare_requests) {
-                reply(request, resp);
+                reply_prepare_ack(request, resp);
             }
         }
         return;
@@ -793,12 +1055,50 @@ void replica::ack_prepare_message(error_code err, mutation_ptr &mu)
         mu->set_error_acked();
     }
     for (auto &request : prepare_requests) {
+        reply_prepare_ack(request, resp);
+    }
+}
+
+void replica::reply_prepare_ack(dsn::message_ex *request, const prepare_ack &resp)
+{
+    if (request->rpc_code() != RPC_PREPARE_BATCH) {
         reply(request, resp);
+        return;
+    }
+
+    // The batch has expired.
+    auto it = _prepare_batches.find(request);
+    if (it == _prepare_batches.end()) {
+        return;
+    }
+
+    auto &batch = it->second;
+    for (auto &ack : batch.acks) {
+        if (ack.decree == resp.decree) {
+            if (ack.err == ERR_IO_PENDING) {
+                ack = resp;
+                --batch.left_ack_count;
+            }
+            break;
+        }
     }
+    if (batch.left_ack_count > 0) {
+        return;
+    }
+
+    prepare_batch_ack batch_ack;
+    batch_ack.acks = std::move(batch.acks);
+    reply(request, batch_ack);
+    _prepare_batches.erase(it);
 }
 
 void replica::cleanup_preparing_mutations(bool wait)
 {
+    // The batched prepare requests would never be fully acked once their mutations are cleaned
+    // up, thus release them now rather than waiting for the next batch to sweep them, which
+    // may never come, e.g. once the replica is closed.
+    _prepare_batches.clear();
+
     decree start = last_committed_decree() + 1;
     decree end = _prepare_list->max_decree();
 
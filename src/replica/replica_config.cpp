@@ -1033,6 +1033,15 @@ bool replica::update_local_configuration(const replica_configuration &config,
         _stub->notify_replica_state_update(config, false);
     }
 
+    // The replayed mutations are made durable once the replica is in service, see
+    // defer_startup_checkpoint().
+    if (_startup_checkpoint_deferred && (status() == partition_status::PS_PRIMARY ||
+                                         status() == partition_status::PS_SECONDARY)) {
+        _startup_checkpoint_deferred = false;
+        LOG_INFO_PREFIX("trigger the checkpoint deferred on startup");
+        init_checkpoint(true);
+    }
+
     // start pending mutations if necessary
     if (status() == partition_status::PS_PRIMARY) {
         mutation_ptr next = _primary_states.write_queue.check_possible_work(
@@ -23,14 +23,17 @@
 #include <stdint.h>
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "common/duplication_common.h"
 #include "common/gpid.h"
 #include "duplication/duplication_sync_timer.h"
 #include "http/http_server.h"
 #include "http/http_status_code.h"
+#include "replica_admin_types.h"
 #include "replica/replica_stub.h"
 #include "utils/string_conv.h"
 
@@ -166,6 +169,55 @@ void replica_http_service::query_manual_compaction_handler(const http_request &r
     resp.body = json.dump();
 }
 
+void replica_http_service::query_hotkeys_handler(const http_request &req, http_response &resp)
+{
+    auto it = req.query_args.find("app_id");
+    if (it == req.query_args.end()) {
+        resp.body = "app_id should not be empty";
+        resp.status_code = http_status_code::kBadRequest;
+        return;
+    }
+    int32_t app_id = -1;
+    if (!buf2int32(it->second, app_id) || app_id < 0) {
+        resp.body = fmt::format("invalid app_id={}", it->second);
+        resp.status_code = http_status_code::kBadRequest;
+        return;
+    }
+
+    auto type = hotkey_type::READ;
+    it = req.query_args.find("type");
+    if (it != req.query_args.end()) {
+        if (it->second == "write") {
+            type = hotkey_type::WRITE;
+        } else if (it->second != "read") {
+            resp.body = fmt::format("invalid type={}, should be 'read' or 'write'", it->second);
+            resp.status_code = http_status_code::kBadRequest;
+            return;
+        }
+    }
+
+    int32_t count = 10;
+    it = req.query_args.find("top");
+    if (it != req.query_args.end() && (!buf2int32(it->second, count) || count <= 0)) {
+        resp.body = fmt::format("invalid top={}", it->second);
+        resp.status_code = http_status_code::kBadRequest;
+        return;
+    }
+
+    std::map<int32_t, std::vector<std::pair<std::string, double>>> hotkeys;
+    _stub->query_app_top_hotkeys(app_id, type, count, hotkeys);
+    nlohmann::json json = nlohmann::json::object();
+    for (const auto &kv : hotkeys) {
+        auto &partition = json[std::to_string(kv.first)];
+        partition = nlohmann::json::array();
+        for (const auto &hotkey : kv.second) {
+            partition.push_back(nlohmann::json{{"hash_key", hotkey.first}, {"qps", hotkey.second}});
+        }
+    }
+    resp.status_code = http_status_code::kOk;
+    resp.body = json.dump();
+}
+
 void replica_http_service::update_config(const std::string &name) { _stub->update_config(name); }
 
 } // namespace replication
@@ -53,6 +53,14 @@ public:
                                    std::placeholders::_2),
                          "app_id=<app_id>",
                          "Query the manual compaction status of an app.");
+        register_handler("hotkeys",
+                         std::bind(&replica_http_service::query_hotkeys_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2),
+                         "app_id=<app_id>[&type=<read|write>][&top=<count>]",
+                         "Query the hottest hash keys with their estimated qps of the primary "
+                         "partitions of an app.");
     }
 
     ~replica_http_service()
@@ -60,6 +68,7 @@ public:
         deregister_http_call("replica/duplication");
         deregister_http_call("replica/data_version");
         deregister_http_call("replica/manual_compaction");
+        deregister_http_call("replica/hotkeys");
     }
 
     std::string path() const override { return replication_options::kReplicaAppType; }
@@ -67,6 +76,7 @@ public:
     void query_duplication_handler(const http_request &req, http_response &resp);
     void query_app_data_version_handler(const http_request &req, http_response &resp);
     void query_manual_compaction_handler(const http_request &req, http_response &resp);
+    void query_hotkeys_handler(const http_request &req, http_response &resp);
 
     inline const char *manual_compaction_status_to_string(manual_compaction_status::type status)
     {
@@ -787,7 +787,16 @@ void replica::on_learn_reply(error_code err, learn_request &&req, learn_response
         std::pair<decree, decree> cache_range;
         binary_reader reader(resp.state.meta);
         while (!reader.is_eof()) {
-            auto mu = mutation::read_from(reader, nullptr);
+            auto mu = mutation::read_from(reader, nullptr, err);
+            if (mu == nullptr) {
+                LOG_ERROR_PREFIX("on_learn_reply[{:#018x}]: learnee = {}, read the learned "
+                                 "mutation failed, err = {}",
+                                 req.signature,
+                                 FMT_HOST_PORT_AND_IP(resp.config, primary),
+                                 err);
+                handle_learning_error(err, false);
+                return;
+            }
             if (mu->data.header.decree > last_committed_decree()) {
                 LOG_DEBUG_PREFIX("on_learn_reply[{:#018x}]: apply learned mutation {}",
                                  req.signature,
@@ -1578,7 +1587,15 @@ error_code replica::apply_learned_state_from_private_log(learn_state &state)
         int replay_count = 0;
         binary_reader reader(state.meta);
         while (!reader.is_eof()) {
-            auto mu = mutation::read_from(reader, nullptr);
+            auto mu = mutation::read_from(reader, nullptr, err);
+            if (mu == nullptr) {
+                LOG_ERROR_PREFIX("apply_learned_state_from_private_log[{}]: learnee = {}, read "
+                                 "the in-buffer mutation failed, err = {}",
+                                 _potential_secondary_states.learning_version,
+                                 FMT_HOST_PORT_AND_IP(_config, primary),
+                                 err);
+                break;
+            }
             auto d = mu->data.header.decree;
             if (d <= plist.last_committed_decree())
                 continue;
@@ -1592,7 +1609,7 @@ error_code replica::apply_learned_state_from_private_log(learn_state &state)
             ++replay_count;
         }
 
-        if (state.to_decree_included > last_committed_decree()) {
+        if (err == ERR_OK && state.to_decree_included > last_committed_decree()) {
             LOG_INFO_PREFIX("apply_learned_state_from_private_log[{}]: learnee ={}, "
                             "learned_to_decree_included({}) > last_committed_decree({}), commit to "
                             "to_decree_included",
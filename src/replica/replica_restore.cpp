@@ -18,10 +18,12 @@
 #include <boost/cstdint.hpp>
 #include <boost/lexical_cast.hpp>
 #include <stdint.h>
+#include <algorithm>
 #include <atomic>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -39,6 +41,7 @@
 #include "metadata_types.h"
 #include "replica.h"
 #include "replica_stub.h"
+#include "runtime/api_layer1.h"
 #include "runtime/rpc/dns_resolver.h"
 #include "runtime/rpc/rpc_message.h"
 #include "runtime/rpc/serialization.h"
@@ -52,13 +55,72 @@
 #include "utils/error_code.h"
 #include "utils/filesystem.h"
 #include "utils/fmt_logging.h"
+#include "utils/flags.h"
 #include "utils/load_dump_object.h"
+#include "utils/metrics.h"
+#include "utils/zlocks.h"
 
 using namespace dsn::dist::block_service;
 
+DSN_DEFINE_uint32(replication,
+                  max_concurrent_restore_downloading_file_count,
+                  4,
+                  "The max count of checkpoint files downloaded concurrently by a restoring "
+                  "replica");
+DSN_DEFINE_validator(max_concurrent_restore_downloading_file_count,
+                     [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_uint32(replication,
+                  max_restore_downloading_block_service_workers,
+                  4,
+                  "The max count of THREAD_POOL_BLOCK_SERVICE workers occupied by downloading the "
+                  "checkpoint files of all the restoring replicas, which should be less than the "
+                  "worker_count of THREAD_POOL_BLOCK_SERVICE, since the downloading workers wait "
+                  "for the block service calls executed in the same pool");
+DSN_TAG_VARIABLE(max_restore_downloading_block_service_workers, FT_MUTABLE);
+
 namespace dsn {
 namespace replication {
 
+DEFINE_TASK_CODE(LPC_RESTORE_DOWNLOAD_FILE, TASK_PRIORITY_COMMON, THREAD_POOL_BLOCK_SERVICE)
+
+namespace {
+
+// the count of THREAD_POOL_BLOCK_SERVICE workers occupied by all the restoring replicas
+std::atomic<uint32_t> restore_downloading_block_service_workers(0);
+
+// try to occupy at most `expected` THREAD_POOL_BLOCK_SERVICE workers for downloading, returns
+// the count of the occupied ones, each of which should be released after finished
+uint32_t acquire_restore_downloading_workers(uint32_t expected)
+{
+    uint32_t current = restore_downloading_block_service_workers.load();
+    uint32_t acquired = 0;
+    do {
+        const uint32_t limit = FLAGS_max_restore_downloading_block_service_workers;
+        acquired = current >= limit ? 0 : std::min(expected, limit - current);
+        if (acquired == 0) {
+            return 0;
+        }
+    } while (!restore_downloading_block_service_workers.compare_exchange_weak(
+        current, current + acquired));
+    return acquired;
+}
+
+// the root of the backup on block service, which is composed by
+// [<restore_path>/]<cluster_name>[/<policy_name>]
+std::string get_restore_backup_root(const configuration_restore_request &req)
+{
+    std::string backup_root = req.cluster_name;
+    if (!req.restore_path.empty()) {
+        backup_root = dsn::utils::filesystem::path_combine(req.restore_path, backup_root);
+    }
+    if (!req.policy_name.empty()) {
+        backup_root = dsn::utils::filesystem::path_combine(backup_root, req.policy_name);
+    }
+    return backup_root;
+}
+
+} // anonymous namespace
+
 bool replica::remove_useless_file_under_chkpt(const std::string &chkpt_dir,
                                               const cold_backup_metadata &metadata)
 {
@@ -107,47 +169,93 @@ error_code replica::download_checkpoint(const configuration_restore_request &req
         return err;
     }
 
-    // download checkpoint files
-    task_tracker tracker;
-    for (const auto &f_meta : backup_metadata.files) {
-        tasking::enqueue(
-            TASK_CODE_EXEC_INLINED,
-            &tracker,
-            [this, &err, remote_chkpt_dir, local_chkpt_dir, f_meta, fs]() {
-                uint64_t f_size = 0;
-                error_code download_err = _stub->_block_service_manager.download_file(
-                    remote_chkpt_dir, local_chkpt_dir, f_meta.name, fs, f_size);
-                const std::string file_name =
-                    utils::filesystem::path_combine(local_chkpt_dir, f_meta.name);
-                if (download_err == ERR_OK || download_err == ERR_PATH_ALREADY_EXIST) {
-                    if (!utils::filesystem::verify_file(
-                            file_name, utils::FileDataType::kSensitive, f_meta.md5, f_meta.size)) {
-                        download_err = ERR_CORRUPTION;
-                    } else if (download_err == ERR_PATH_ALREADY_EXIST) {
-                        download_err = ERR_OK;
-                        f_size = f_meta.size;
-                    }
+    // files of an incremental backup are stored content-addressed in the shared files dir
+    dsn::gpid old_gpid(req.app_id, _config.pid.get_partition_index());
+    const std::string shared_files_dir = cold_backup::get_replica_shared_files_dir(
+        get_restore_backup_root(req), req.app_name, old_gpid);
+    const std::set<std::string> shared_files(backup_metadata.shared_files.begin(),
+                                             backup_metadata.shared_files.end());
+
+    // download checkpoint files by several workers concurrently, each of which picks the next
+    // file until all the files are downloaded or any error occurs. The current thread is always
+    // one of the workers, and the others run in THREAD_POOL_BLOCK_SERVICE, whose total count is
+    // bounded to keep the pool from being exhausted by the blocking downloads
+    const auto &files = backup_metadata.files;
+    std::atomic<size_t> next_index(0);
+    std::atomic<uint64_t> downloaded_bytes(0);
+    zlock err_lock;
+    const uint64_t start_time_ms = dsn_now_ms();
+    const size_t worker_count = std::max<size_t>(
+        std::min(static_cast<size_t>(FLAGS_max_concurrent_restore_downloading_file_count),
+                 files.size()),
+        1);
+    auto download_files = [&]() {
+        for (size_t idx = next_index.fetch_add(1); idx < files.size();
+             idx = next_index.fetch_add(1)) {
+            {
+                zauto_lock l(err_lock);
+                if (err != ERR_OK) {
+                    return;
                 }
-
-                if (download_err != ERR_OK) {
-                    LOG_ERROR_PREFIX(
-                        "failed to download file({}), error = {}", f_meta.name, download_err);
-                    // ERR_CORRUPTION means we should rollback restore, so we can't change err if it
-                    // is ERR_CORRUPTION now, otherwise it will be overridden by other errors
-                    if (err != ERR_CORRUPTION) {
-                        err = download_err;
-                        return;
-                    }
+            }
+
+            const auto &f_meta = files[idx];
+            const bool is_shared = shared_files.count(f_meta.name) > 0;
+            uint64_t f_size = 0;
+            error_code download_err = download_checkpoint_file(
+                fs,
+                is_shared ? shared_files_dir : remote_chkpt_dir,
+                is_shared
+                    ? cold_backup::get_shared_file_name(f_meta.name, f_meta.size, f_meta.md5)
+                    : f_meta.name,
+                local_chkpt_dir,
+                f_meta,
+                f_size);
+            if (download_err != ERR_OK) {
+                LOG_ERROR_PREFIX(
+                    "failed to download file({}), error = {}", f_meta.name, download_err);
+                METRIC_VAR_INCREMENT(restore_download_file_failed_count);
+                // ERR_CORRUPTION means we should rollback restore, so we can't change err if it
+                // is ERR_CORRUPTION now, otherwise it will be overridden by other errors
+                zauto_lock l(err_lock);
+                if (err != ERR_CORRUPTION) {
+                    err = download_err;
                 }
-
-                // update progress if download file succeed
-                update_restore_progress(f_size);
-                // report current status to meta server
-                report_restore_status_to_meta();
-            });
+                return;
+            }
+
+            METRIC_VAR_INCREMENT(restore_download_file_successful_count);
+            METRIC_VAR_INCREMENT_BY(restore_download_file_bytes, f_size);
+            downloaded_bytes.fetch_add(f_size);
+            // update progress if download file succeed
+            update_restore_progress(f_size);
+            // report current status to meta server
+            report_restore_status_to_meta();
+        }
+    };
+    const uint32_t background_worker_count =
+        acquire_restore_downloading_workers(static_cast<uint32_t>(worker_count) - 1);
+    task_tracker tracker;
+    for (uint32_t i = 0; i < background_worker_count; ++i) {
+        tasking::enqueue(LPC_RESTORE_DOWNLOAD_FILE, &tracker, [&]() {
+            download_files();
+            restore_downloading_block_service_workers.fetch_sub(1);
+        });
     }
+    download_files();
     tracker.wait_outstanding_tasks();
 
+    const uint64_t elapsed_ms = std::max<uint64_t>(dsn_now_ms() - start_time_ms, 1);
+    const int64_t bytes_per_sec = downloaded_bytes.load() * 1000 / elapsed_ms;
+    METRIC_VAR_SET(restore_download_bytes_per_sec, bytes_per_sec);
+    LOG_INFO_PREFIX("download checkpoint files finished, err = {}, file_count = {}, "
+                    "downloaded_bytes = {}, elapsed_ms = {}, throughput = {} bytes/s",
+                    err,
+                    files.size(),
+                    downloaded_bytes.load(),
+                    elapsed_ms,
+                    bytes_per_sec);
+
     // clear useless files for restore.
     // if err != ERR_OK, the entire directory of this replica will be deleted later.
     // so in this situation, there is no need to clear restore.
@@ -158,6 +266,59 @@ error_code replica::download_checkpoint(const configuration_restore_request &req
     return err;
 }
 
+error_code replica::download_checkpoint_file(block_filesystem *fs,
+                                             const std::string &remote_dir,
+                                             const std::string &remote_file_name,
+                                             const std::string &local_chkpt_dir,
+                                             const file_meta &f_meta,
+                                             /*out*/ uint64_t &f_size)
+{
+    const std::string file_name = utils::filesystem::path_combine(local_chkpt_dir, f_meta.name);
+    if (utils::filesystem::file_exists(file_name)) {
+        // the file has been downloaded by the previous restore
+        if (!utils::filesystem::verify_file(
+                file_name, utils::FileDataType::kSensitive, f_meta.md5, f_meta.size)) {
+            return ERR_CORRUPTION;
+        }
+        f_size = f_meta.size;
+        return ERR_OK;
+    }
+
+    std::string f_md5;
+    error_code err = _stub->_block_service_manager.download_file(
+        remote_dir, local_chkpt_dir, remote_file_name, fs, f_size, f_md5);
+    const std::string downloaded_file_name =
+        utils::filesystem::path_combine(local_chkpt_dir, remote_file_name);
+    if (err == ERR_PATH_ALREADY_EXIST) {
+        if (!utils::filesystem::verify_file(
+                downloaded_file_name, utils::FileDataType::kSensitive, f_meta.md5, f_meta.size)) {
+            return ERR_CORRUPTION;
+        }
+        f_size = f_meta.size;
+    } else if (err != ERR_OK) {
+        return err;
+    } else if (f_md5 != f_meta.md5 ||
+               !utils::filesystem::verify_file_size(
+                   downloaded_file_name, utils::FileDataType::kSensitive, f_meta.size)) {
+        // md5 is calculated from the downloaded bytes, thus the file needn't be read again
+        LOG_ERROR_PREFIX("file({}) is damaged, md5 = {} vs {}, size = {} vs {}",
+                         downloaded_file_name,
+                         f_md5,
+                         f_meta.md5,
+                         f_size,
+                         f_meta.size);
+        return ERR_CORRUPTION;
+    }
+
+    // files of an incremental backup are downloaded by their content-addressed names
+    if (remote_file_name != f_meta.name &&
+        !utils::filesystem::rename_path(downloaded_file_name, file_name)) {
+        LOG_ERROR_PREFIX("rename file({}) to {} failed", downloaded_file_name, file_name);
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    return ERR_OK;
+}
+
 error_code replica::get_backup_metadata(block_filesystem *fs,
                                         const std::string &remote_chkpt_dir,
                                         const std::string &local_chkpt_dir,
@@ -226,13 +387,7 @@ dsn::error_code replica::find_valid_checkpoint(const configuration_restore_reque
     dsn::gpid old_gpid;
     old_gpid.set_app_id(req.app_id);
     old_gpid.set_partition_index(_config.pid.get_partition_index());
-    std::string backup_root = req.cluster_name;
-    if (!req.restore_path.empty()) {
-        backup_root = dsn::utils::filesystem::path_combine(req.restore_path, backup_root);
-    }
-    if (!req.policy_name.empty()) {
-        backup_root = dsn::utils::filesystem::path_combine(backup_root, req.policy_name);
-    }
+    const std::string backup_root = get_restore_backup_root(req);
     int64_t backup_id = req.time_stamp;
 
     std::string manifest_file =
@@ -129,6 +129,17 @@ METRIC_DEFINE_gauge_int64(
     dsn::metric_unit::kBytes,
     "The max size of files that are copied from learnee among all learning replicas");
 
+METRIC_DEFINE_gauge_int64(server,
+                          replicas_load_duration_ms,
+                          dsn::metric_unit::kMilliSeconds,
+                          "The duration of loading all replicas on startup");
+
+METRIC_DEFINE_gauge_int64(server,
+                          replicas_post_load_duration_ms,
+                          dsn::metric_unit::kMilliSeconds,
+                          "The duration of syncing checkpoints and resetting prepare lists for "
+                          "all replicas after they are loaded on startup");
+
 METRIC_DEFINE_counter(server,
                       moved_error_replicas,
                       dsn::metric_unit::kReplicas,
@@ -260,6 +271,12 @@ DSN_DEFINE_bool(
     false,
     "Whether to disable replica statistics. The name contains 'gc' is for legacy reason");
 DSN_DEFINE_bool(replication, disk_stat_disabled, false, "whether to disable disk stat");
+DSN_DEFINE_bool(replication,
+                lazy_open_replicas,
+                false,
+                "Whether to defer the sync checkpoints of the replicas on startup until they are "
+                "assigned as primary or secondary, which shortens the restart of the nodes with "
+                "many replicas, while the replayed private logs are kept longer");
 DSN_DEFINE_bool(
     replication,
     delay_for_fd_timeout_on_start,
@@ -368,6 +385,8 @@ replica_stub::replica_stub(replica_state_subscriber subscriber /*= nullptr*/,
       METRIC_VAR_INIT_server(learning_replicas),
       METRIC_VAR_INIT_server(learning_replicas_max_duration_ms),
       METRIC_VAR_INIT_server(learning_replicas_max_copy_file_bytes),
+      METRIC_VAR_INIT_server(replicas_load_duration_ms),
+      METRIC_VAR_INIT_server(replicas_post_load_duration_ms),
       METRIC_VAR_INIT_server(moved_error_replicas),
       METRIC_VAR_INIT_server(moved_garbage_replicas),
       METRIC_VAR_INIT_server(replica_removed_dirs),
@@ -559,33 +578,78 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
     LOG_INFO("load replicas succeed, replica_count = {}, time_used = {} ms",
              rps.size(),
              finish_time - start_time);
+    METRIC_VAR_SET(replicas_load_duration_ms, finish_time - start_time);
+
+    // Sync the checkpoints and reset the prepare lists of the loaded replicas in parallel. The
+    // replicas are interleaved among the dir_nodes, so that the checkpoints flushed concurrently
+    // are spread over the disks.
+    std::map<const dir_node *, std::vector<replica_ptr>> rps_by_dn;
+    size_t max_rps_per_dn = 0;
+    for (const auto &rp : rps) {
+        auto &dn_rps = rps_by_dn[rp.second->get_dir_node()];
+        dn_rps.push_back(rp.second);
+        max_rps_per_dn = std::max(max_rps_per_dn, dn_rps.size());
+    }
+
+    start_time = dsn_now_ms();
+    for (size_t i = 0; i < max_rps_per_dn; ++i) {
+        for (const auto &dn_rps : rps_by_dn) {
+            if (i >= dn_rps.second.size()) {
+                continue;
+            }
 
-    bool is_log_complete = true;
-    for (auto it = rps.begin(); it != rps.end(); ++it) {
-        CHECK_EQ_MSG(it->second->background_sync_checkpoint(), ERR_OK, "sync checkpoint failed");
+            load_tasks.push_back(tasking::create_task(
+                LPC_REPLICATION_INIT_LOAD,
+                &_tracker,
+                [r = dn_rps.second[i]] {
+                    if (FLAGS_lazy_open_replicas) {
+                        r->defer_startup_checkpoint();
+                    } else {
+                        CHECK_EQ_MSG(r->background_sync_checkpoint(),
+                                     ERR_OK,
+                                     "{}: sync checkpoint failed",
+                                     r->name());
+                    }
 
-        it->second->reset_prepare_list_after_replay();
+                    r->reset_prepare_list_after_replay();
 
-        decree pmax = invalid_decree;
-        decree pmax_commit = invalid_decree;
-        if (it->second->private_log()) {
-            pmax = it->second->private_log()->max_decree(it->first);
-            pmax_commit = it->second->private_log()->max_commit_on_disk();
-        }
+                    decree pmax = invalid_decree;
+                    decree pmax_commit = invalid_decree;
+                    if (r->private_log()) {
+                        pmax = r->private_log()->max_decree(r->get_gpid());
+                        pmax_commit = r->private_log()->max_commit_on_disk();
+                    }
 
-        LOG_INFO(
-            "{}: load replica done, durable = {}, committed = {}, "
-            "prepared = {}, ballot = {}, "
-            "valid_offset_in_plog = {}, max_decree_in_plog = {}, max_commit_on_disk_in_plog = {}",
-            it->second->name(),
-            it->second->last_durable_decree(),
-            it->second->last_committed_decree(),
-            it->second->max_prepared_decree(),
-            it->second->get_ballot(),
-            it->second->get_app()->init_info().init_offset_in_private_log,
-            pmax,
-            pmax_commit);
+                    LOG_INFO("{}: load replica done, durable = {}, committed = {}, "
+                             "prepared = {}, ballot = {}, valid_offset_in_plog = {}, "
+                             "max_decree_in_plog = {}, max_commit_on_disk_in_plog = {}",
+                             r->name(),
+                             r->last_durable_decree(),
+                             r->last_committed_decree(),
+                             r->max_prepared_decree(),
+                             r->get_ballot(),
+                             r->get_app()->init_info().init_offset_in_private_log,
+                             pmax,
+                             pmax_commit);
+                },
+                load_tasks.size()));
+            load_tasks.back()->enqueue();
+        }
+    }
+    for (auto &tsk : load_tasks) {
+        tsk->wait();
     }
+    finish_time = dsn_now_ms();
+
+    rps_by_dn.clear();
+    load_tasks.clear();
+    LOG_INFO("post-load replicas succeed, replica_count = {}, lazy_open = {}, time_used = {} ms",
+             rps.size(),
+             FLAGS_lazy_open_replicas,
+             finish_time - start_time);
+    METRIC_VAR_SET(replicas_post_load_duration_ms, finish_time - start_time);
+
+    bool is_log_complete = true;
 
     // we will mark all replicas inactive not transient unless all logs are complete
     if (!is_log_complete) {
@@ -1091,6 +1155,23 @@ void replica_stub::on_prepare(dsn::message_ex *request)
     }
 }
 
+void replica_stub::on_prepare_batch(dsn::message_ex *request)
+{
+    gpid id;
+    dsn::unmarshall(request, id);
+    replica_ptr rep = get_replica(id);
+    if (rep != nullptr) {
+        rep->on_prepare_batch(request);
+    } else {
+        prepare_ack ack;
+        ack.pid = id;
+        ack.err = ERR_OBJECT_NOT_FOUND;
+        prepare_batch_ack resp;
+        resp.acks.push_back(ack);
+        reply(request, resp);
+    }
+}
+
 void replica_stub::on_group_check(group_check_rpc rpc)
 {
     const group_check_request &request = rpc.request();
@@ -1210,6 +1291,11 @@ void replica_stub::get_replica_info(replica_info &info, replica_ptr r)
     info.last_durable_decree = r->last_durable_decree();
     info.disk_tag = r->get_dir_node()->tag;
     info.__set_manual_compact_status(r->get_manual_compact_status());
+
+    replica_load_stats load_stats;
+    if (r->get_app()->query_load_stats(load_stats)) {
+        info.__set_load_stats(load_stats);
+    }
 }
 
 void replica_stub::get_local_replicas(std::vector<replica_info> &replicas)
@@ -2141,6 +2227,7 @@ void replica_stub::open_service()
 {
     register_rpc_handler(RPC_CONFIG_PROPOSAL, "ProposeConfig", &replica_stub::on_config_proposal);
     register_rpc_handler(RPC_PREPARE, "prepare", &replica_stub::on_prepare);
+    register_rpc_handler(RPC_PREPARE_BATCH, "prepare_batch", &replica_stub::on_prepare_batch);
     register_rpc_handler(RPC_LEARN, "Learn", &replica_stub::on_learn);
     register_rpc_handler_with_rpc_holder(RPC_LEARN_COMPLETION_NOTIFY,
                                          "LearnNotify",
@@ -2839,6 +2926,26 @@ void replica_stub::query_app_manual_compact_status(
     }
 }
 
+void replica_stub::query_app_top_hotkeys(
+    int32_t app_id,
+    hotkey_type::type type,
+    size_t count,
+    std::map<int32_t, std::vector<std::pair<std::string, double>>> &hotkeys)
+{
+    zauto_read_lock l(_replicas_lock);
+    for (const auto &kv : _replicas) {
+        if (kv.first.get_app_id() != app_id) {
+            continue;
+        }
+        const auto &rep = kv.second;
+        if (rep == nullptr || rep->status() != partition_status::PS_PRIMARY ||
+            rep->get_app() == nullptr) {
+            continue;
+        }
+        rep->get_app()->query_top_hotkeys(type, count, hotkeys[kv.first.get_partition_index()]);
+    }
+}
+
 void replica_stub::update_config(const std::string &name)
 {
     // The new value has been validated and FLAGS_* has been updated, it's safety to use it
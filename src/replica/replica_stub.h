@@ -170,6 +170,7 @@ public:
     //        - bulk_load
     //
     void on_prepare(dsn::message_ex *request);
+    void on_prepare_batch(dsn::message_ex *request);
     void on_learn(dsn::message_ex *msg);
     void on_learn_completion_notification(learn_completion_notification_rpc rpc);
     void on_add_learner(const group_check_request &request);
@@ -269,6 +270,14 @@ public:
     void query_app_manual_compact_status(
         int32_t app_id, /*out*/ std::unordered_map<gpid, manual_compaction_status::type> &status);
 
+    // query the hottest hash keys with their estimated qps of the primary partitions by app_id
+    void query_app_top_hotkeys(
+        int32_t app_id,
+        hotkey_type::type type,
+        size_t count,
+        /*pidx => hotkeys*/ std::map<int32_t, std::vector<std::pair<std::string, double>>>
+            &hotkeys);
+
     void on_add_new_disk(add_new_disk_rpc rpc);
 
     // query last checkpoint info for follower in duplication process
@@ -530,6 +539,9 @@ private:
     METRIC_VAR_DECLARE_gauge_int64(learning_replicas_max_duration_ms);
     METRIC_VAR_DECLARE_gauge_int64(learning_replicas_max_copy_file_bytes);
 
+    METRIC_VAR_DECLARE_gauge_int64(replicas_load_duration_ms);
+    METRIC_VAR_DECLARE_gauge_int64(replicas_post_load_duration_ms);
+
     METRIC_VAR_DECLARE_counter(moved_error_replicas);
     METRIC_VAR_DECLARE_counter(moved_garbage_replicas);
     METRIC_VAR_DECLARE_counter(replica_removed_dirs);
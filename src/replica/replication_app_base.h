@@ -30,6 +30,8 @@
 #include <cstdint>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "bulk_load_types.h"
 #include "common/json_helper.h"
@@ -278,6 +280,10 @@ public:
 
     virtual ingestion_status::type get_ingestion_status() { return ingestion_status::IS_INVALID; }
 
+    // Whether the failed ingestion has ingested some of the files before it failed, which could
+    // not be rolled back.
+    virtual bool is_ingestion_partially_applied() { return false; }
+
     virtual void on_detect_hotkey(const detect_hotkey_request &req,
                                   /*out*/ detect_hotkey_response &resp)
     {
@@ -290,6 +296,19 @@ public:
 
     virtual manual_compaction_status::type query_compact_status() const = 0;
 
+    // Query the cumulative load of the replica, which is reported to the meta server for the
+    // load-aware balancer. Returns false if it is not collected by the storage engine.
+    virtual bool query_load_stats(/*out*/ replica_load_stats &stats) const { return false; }
+
+    // Query at most `count` hottest hash keys of the replica with their estimated qps, in
+    // descending order of qps. The hash keys are escaped to be printable.
+    virtual void
+    query_top_hotkeys(hotkey_type::type type,
+                      size_t count,
+                      /*out*/ std::vector<std::pair<std::string, double>> &hotkeys) const
+    {
+    }
+
 public:
     //
     // utility functions to be used by app
@@ -15,8 +15,12 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <unistd.h>
+
 #include <atomic>
 #include <cstdint>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -37,9 +41,14 @@
 #include "replica/backup/cold_backup_context.h"
 #include "replica/replica.h"
 #include "replica/test/replication_service_test_app.h"
+#include "test_util/test_util.h"
 #include "utils/autoref_ptr.h"
 #include "utils/blob.h"
+#include "utils/error_code.h"
 #include "utils/filesystem.h"
+#include "utils/flags.h"
+
+DSN_DECLARE_bool(cold_backup_incremental_enabled);
 
 ref_ptr<block_file_mock> current_chkpt_file = new block_file_mock("", 0, "");
 ref_ptr<block_file_mock> backup_metadata_file = new block_file_mock("", 0, "");
@@ -378,6 +387,97 @@ void replication_service_test_app::on_upload_chkpt_dir_test()
     ASSERT_TRUE(regular_file->get_count() == 1);
 }
 
+void replication_service_test_app::prepare_upload_test()
+{
+    PRESERVE_FLAG(cold_backup_incremental_enabled);
+    FLAGS_cold_backup_incremental_enabled = true;
+
+    const std::string checkpoint_dir = "prepare_upload_test";
+    ASSERT_TRUE(dsn::utils::filesystem::remove_path(checkpoint_dir));
+    ASSERT_TRUE(dsn::utils::filesystem::create_directory(checkpoint_dir));
+    const std::vector<std::string> files = {"000001.sst", "MANIFEST-000002"};
+    for (const auto &file : files) {
+        std::ofstream out(dsn::utils::filesystem::path_combine(checkpoint_dir, file));
+        out << "content of " << file;
+    }
+
+    backup_request prepare_request = request;
+    prepare_request.pid = gpid(1, 1);
+    auto create_context = [&]() {
+        cold_backup_context_ptr backup_context =
+            new cold_backup_context(nullptr, prepare_request, concurrent_uploading_file_cnt);
+        backup_context->block_service = block_service.get();
+        backup_context->backup_root = backup_root;
+        backup_context->checkpoint_dir = checkpoint_dir;
+        for (const auto &file : files) {
+            int64_t size = 0;
+            dsn::utils::filesystem::file_size(
+                dsn::utils::filesystem::path_combine(checkpoint_dir, file), size);
+            backup_context->checkpoint_files.push_back(file);
+            backup_context->checkpoint_file_sizes.push_back(size);
+        }
+        // The upload which is continued after the md5 has been computed is ignored while the
+        // backup is paused.
+        backup_context->_status.store(cold_backup_status::ColdBackupPaused);
+        return backup_context;
+    };
+    auto wait_for = [](const std::function<bool()> &done) {
+        for (int i = 0; i < 1000 && !done(); ++i) {
+            usleep(10000);
+        }
+        return done();
+    };
+
+    // case1: the md5 is computed by the workers, while the caller is not blocked
+    {
+        std::cout << "testing prepare_upload with uncached files..." << std::endl;
+        auto backup_context = create_context();
+        backup_context->prepare_upload();
+        ASSERT_TRUE(wait_for([&]() { return backup_context->is_upload_prepared(); }));
+        ASSERT_EQ(files.size(), backup_context->_metadata.files.size());
+        for (const auto &f_meta : backup_context->_metadata.files) {
+            std::string md5;
+            ASSERT_EQ(ERR_OK,
+                      dsn::utils::filesystem::md5sum(
+                          dsn::utils::filesystem::path_combine(checkpoint_dir, f_meta.name), md5));
+            ASSERT_EQ(md5, f_meta.md5);
+        }
+
+        // only the sst files are uploaded to the shared files dir
+        ASSERT_EQ(std::vector<std::string>({files[0]}), backup_context->_metadata.shared_files);
+        const auto shared_files_dir = cold_backup::get_replica_shared_files_dir(
+            backup_root, prepare_request.app_name, prepare_request.pid);
+        ASSERT_EQ(0, backup_context->get_remote_file_path(files[0]).find(shared_files_dir));
+        ASSERT_EQ(std::string::npos,
+                  backup_context->get_remote_file_path(files[1]).find(shared_files_dir));
+        ASSERT_TRUE(wait_for([&]() { return backup_context->get_count() == 1; }));
+    }
+
+    // case2: the md5 of the unchanged files is got from the cache of the previous backup
+    {
+        std::cout << "testing prepare_upload with cached files..." << std::endl;
+        auto backup_context = create_context();
+        backup_context->prepare_upload();
+        ASSERT_TRUE(backup_context->is_upload_prepared());
+        ASSERT_TRUE(wait_for([&]() { return backup_context->get_count() == 1; }));
+    }
+
+    // case3: the backup fails if any file could not be read
+    {
+        std::cout << "testing prepare_upload with missing files..." << std::endl;
+        auto backup_context = create_context();
+        backup_context->checkpoint_files.push_back("000003.sst");
+        backup_context->checkpoint_file_sizes.push_back(10);
+        backup_context->prepare_upload();
+        ASSERT_TRUE(wait_for(
+            [&]() { return backup_context->status() == cold_backup_status::ColdBackupFailed; }));
+        ASSERT_FALSE(backup_context->is_upload_prepared());
+        ASSERT_TRUE(wait_for([&]() { return backup_context->get_count() == 1; }));
+    }
+
+    ASSERT_TRUE(dsn::utils::filesystem::remove_path(checkpoint_dir));
+}
+
 void replication_service_test_app::write_backup_metadata_test()
 {
     cold_backup_context_ptr backup_context =
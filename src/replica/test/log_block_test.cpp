@@ -16,6 +16,9 @@
 // under the License.
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -29,6 +32,7 @@
 #include "utils/binary_reader.h"
 #include "utils/binary_writer.h"
 #include "utils/blob.h"
+#include "utils/error_code.h"
 
 namespace dsn {
 namespace replication {
@@ -56,6 +60,129 @@ TEST_P(log_block_test, log_block_header)
     ASSERT_EQ(hdr->body_crc, 0);
 }
 
+TEST_P(log_block_test, compressed_log_block_header)
+{
+    log_block block(10, mutation_compression_type::kLZ4);
+    auto hdr = (log_block_header *)block.front().data();
+    ASSERT_EQ(kCompressedLogBlockMagic, hdr->magic);
+    ASSERT_TRUE(is_valid_log_block_magic(hdr->magic));
+    ASSERT_EQ(mutation_compression_type::kLZ4, block.compression_type());
+}
+
+TEST_P(log_block_test, compress_mutations)
+{
+    struct test_case
+    {
+        mutation_compression_type compression_type;
+        std::string data;
+        bool expect_compressed;
+    } tests[] = {{mutation_compression_type::kNone, std::string(1024, 'a'), false},
+                 {mutation_compression_type::kLZ4, std::string(1024, 'a'), true},
+                 {mutation_compression_type::kZSTD, std::string(1024, 'a'), true},
+                 // Too small to be compressed.
+                 {mutation_compression_type::kLZ4, "test", false},
+                 {mutation_compression_type::kZSTD, "test", false}};
+    for (const auto &test : tests) {
+        auto mu = create_test_mutation(1, test.data);
+        std::string buffer;
+        mu->write_to([&buffer](const blob &bb) { buffer += bb.to_string(); },
+                     test.compression_type);
+
+        std::string raw_buffer;
+        mu->write_to([&raw_buffer](const blob &bb) { raw_buffer += bb.to_string(); });
+        ASSERT_EQ(test.expect_compressed, buffer.size() < raw_buffer.size());
+
+        auto bb = blob::create_from_bytes(std::move(buffer));
+        binary_reader reader(bb);
+        auto read_mu = mutation::read_from(reader, nullptr);
+        ASSERT_TRUE(reader.is_eof());
+        ASSERT_EQ(mu->data.header, read_mu->data.header);
+        ASSERT_EQ(mu->data.updates.size(), read_mu->data.updates.size());
+        for (size_t i = 0; i < mu->data.updates.size(); ++i) {
+            ASSERT_EQ(mu->data.updates[i].data.to_string(),
+                      read_mu->data.updates[i].data.to_string());
+            ASSERT_EQ(mu->data.updates[i].code, read_mu->data.updates[i].code);
+        }
+    }
+}
+
+TEST_P(log_block_test, read_corrupted_compressed_mutation)
+{
+    const std::string data(1024, 'a');
+    auto mu = create_test_mutation(1, data);
+    std::string raw_buffer;
+    mu->write_to([&raw_buffer](const blob &bb) { raw_buffer += bb.to_string(); });
+    // The compression type and the compressed length are written just after the metadata of
+    // the updates, followed by the compressed updates.
+    const size_t compression_type_pos = raw_buffer.size() - data.size();
+    const size_t compressed_pos = compression_type_pos + 2 * sizeof(int32_t);
+
+    for (const auto compression_type :
+         {mutation_compression_type::kLZ4, mutation_compression_type::kZSTD}) {
+        std::string buffer;
+        mu->write_to([&buffer](const blob &bb) { buffer += bb.to_string(); }, compression_type);
+        ASSERT_LT(compressed_pos, buffer.size());
+
+        struct test_case
+        {
+            int32_t compression_type;
+            bool corrupt_compressed;
+        } tests[] = {{static_cast<int32_t>(compression_type), false},
+                     {static_cast<int32_t>(compression_type), true},
+                     {100, false}};
+        for (const auto &test : tests) {
+            std::string corrupted(buffer);
+            memcpy(&corrupted[compression_type_pos],
+                   &test.compression_type,
+                   sizeof(test.compression_type));
+            if (test.corrupt_compressed) {
+                std::fill(corrupted.begin() + compressed_pos, corrupted.end(), '\xff');
+            }
+
+            auto bb = blob::create_from_bytes(std::move(corrupted));
+            binary_reader reader(bb);
+            error_code err;
+            auto read_mu = mutation::read_from(reader, nullptr, err);
+            if (!test.corrupt_compressed && test.compression_type != 100) {
+                ASSERT_EQ(ERR_OK, err);
+                ASSERT_EQ(data, read_mu->data.updates[0].data.to_string());
+            } else {
+                ASSERT_EQ(ERR_INVALID_DATA, err);
+                ASSERT_TRUE(read_mu == nullptr);
+            }
+        }
+    }
+}
+
+TEST_P(log_block_test, mutation_prepare_buffers)
+{
+    auto mu = create_test_mutation(1, "test data");
+    const auto encode = [&mu]() {
+        std::string buffer;
+        for (const auto &bb : mu->prepare_buffers()) {
+            buffer += bb.to_string();
+        }
+        return buffer;
+    };
+
+    // The data of the updates is referenced rather than copied.
+    ASSERT_EQ(mu->data.updates.size() + 1, mu->prepare_buffers().size());
+    ASSERT_EQ(mu->data.updates[0].data.data(), mu->prepare_buffers()[1].data());
+
+    binary_writer writer;
+    mu->write_to(writer, nullptr);
+    ASSERT_EQ(writer.get_buffer().to_string(), encode());
+
+    // The buffers are encoded again once the header is changed.
+    mu->set_id(2, 2);
+    auto bb = blob::create_from_bytes(encode());
+    binary_reader reader(bb);
+    auto read_mu = mutation::read_from(reader, nullptr);
+    ASSERT_EQ(2, read_mu->data.header.ballot);
+    ASSERT_EQ(2, read_mu->data.header.decree);
+    ASSERT_EQ("test data", read_mu->data.updates[0].data.to_string());
+}
+
 class log_appender_test : public replica_test_base
 {
 };
@@ -53,6 +53,8 @@ TEST_P(cold_backup_context_test, read_backup_metadata) { app->read_backup_metada
 
 TEST_P(cold_backup_context_test, on_upload_chkpt_dir) { app->on_upload_chkpt_dir_test(); }
 
+TEST_P(cold_backup_context_test, prepare_upload) { app->prepare_upload_test(); }
+
 TEST_P(cold_backup_context_test, write_metadata_file) { app->write_backup_metadata_test(); }
 
 TEST_P(cold_backup_context_test, write_current_chkpt_file) { app->write_current_chkpt_file_test(); }
@@ -90,6 +90,8 @@ public:
 
     void set_ingestion_status(ingestion_status::type status) { _ingestion_status = status; }
     ingestion_status::type get_ingestion_status() override { return _ingestion_status; }
+    void set_ingestion_partially_applied(bool flag) { _ingestion_partially_applied = flag; }
+    bool is_ingestion_partially_applied() override { return _ingestion_partially_applied; }
 
     uint32_t query_data_version() const { return 1; }
 
@@ -106,6 +108,7 @@ private:
     std::map<std::string, std::string> _envs;
     decree _decree = 5;
     ingestion_status::type _ingestion_status;
+    bool _ingestion_partially_applied{false};
     decree _last_durable_decree{0};
     decree _expect_last_durable_decree{0};
 };
@@ -197,6 +200,11 @@ public:
     void set_is_ingestion(bool flag) { _is_bulk_load_ingestion = flag; }
     void set_ingestion_status(ingestion_status::type status) { _app->set_ingestion_status(status); }
     ingestion_status::type get_ingestion_status() { return _app->get_ingestion_status(); }
+    void set_ingestion_partially_applied(bool flag)
+    {
+        dynamic_cast<mock_replication_app_base *>(_app.get())
+            ->set_ingestion_partially_applied(flag);
+    }
     bool is_primary_bulk_load_states_cleaned()
     {
         return (!_primary_states.ingestion_is_empty_prepare_sent &&
@@ -28,7 +28,9 @@
 
 // IWYU pragma: no_include <ext/alloc_traits.h>
 #include <sys/types.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "aio/aio_task.h"
 #include "aio/file_io.h"
@@ -46,9 +48,15 @@
 #include "utils/binary_writer.h"
 #include "utils/blob.h"
 #include "utils/env.h"
+#include "utils/fail_point.h"
 #include "utils/filesystem.h"
+#include "utils/flags.h"
 #include "utils/fmt_logging.h"
 #include "utils/ports.h"
+#include "utils/test_macros.h"
+
+DSN_DECLARE_uint32(plog_replay_decode_threads);
+DSN_DECLARE_uint32(plog_replay_prefetch_blocks);
 
 namespace dsn {
 class message_ex;
@@ -401,6 +409,28 @@ public:
         }
     }
 
+    // Replay the log file, return the decrees of the replayed mutations in order.
+    static std::vector<decree> replay_log_file(const std::string &log_file_path,
+                                               /*out*/ error_code &ec,
+                                               /*out*/ int64_t &end_offset)
+    {
+        std::vector<decree> decrees;
+        log_file_ptr file = log_file::open_read(log_file_path.c_str(), ec);
+        EXPECT_EQ(ERR_OK, ec);
+        if (file == nullptr) {
+            return decrees;
+        }
+
+        ec = mutation_log::replay(
+            file,
+            [&decrees](int log_length, mutation_ptr &mu) -> bool {
+                decrees.push_back(mu->data.header.decree);
+                return true;
+            },
+            end_offset);
+        return decrees;
+    }
+
     void test_replay_multiple_files(int num_entries, int private_log_file_size_mb)
     {
         std::vector<mutation_ptr> mutations;
@@ -495,6 +525,76 @@ TEST_P(mutation_log_test, replay_multiple_files_20000_1mb) { test_replay_multipl
 
 TEST_P(mutation_log_test, replay_multiple_files_50000_1mb) { test_replay_multiple_files(50000, 1); }
 
+TEST_P(mutation_log_test, replay_pipelined)
+{
+    PRESERVE_FLAG(plog_replay_decode_threads);
+    PRESERVE_FLAG(plog_replay_prefetch_blocks);
+    FLAGS_plog_replay_prefetch_blocks = 2;
+
+    // Flush each mutation to write it in a separate block.
+    const int num_entries = 200;
+    {
+        mutation_log_ptr mlog = create_private_log();
+        for (int i = 0; i < num_entries; i++) {
+            mutation_ptr mu = create_test_mutation(2 + i, "hello!");
+            mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+            mlog->flush();
+        }
+        mlog->tracker()->wait_outstanding_tasks();
+    }
+
+    const std::string log_file_path = _log_dir + "/log.1.0";
+    for (bool corrupted : {false, true}) {
+        if (corrupted) {
+            // Corrupt a block in the middle of the file.
+            int64_t file_size = 0;
+            ASSERT_TRUE(utils::filesystem::file_size(
+                log_file_path, dsn::utils::FileDataType::kSensitive, file_size));
+            const std::string garbage(16, 'x');
+            overwrite_file(log_file_path.c_str(), file_size / 2, garbage.data(), garbage.size());
+        }
+
+        FLAGS_plog_replay_decode_threads = 0;
+        error_code expected_ec;
+        int64_t expected_end_offset = 0;
+        const auto expected_decrees =
+            replay_log_file(log_file_path, expected_ec, expected_end_offset);
+        if (corrupted) {
+            ASSERT_NE(ERR_HANDLE_EOF, expected_ec);
+            ASSERT_LT(expected_decrees.size(), num_entries);
+        } else {
+            ASSERT_EQ(ERR_HANDLE_EOF, expected_ec);
+            ASSERT_EQ(num_entries, expected_decrees.size());
+        }
+
+        // The pipelined replay stops at the same offset with the same error, after replaying
+        // the same mutations in the same order.
+        for (uint32_t decode_threads : {1, 3}) {
+            FLAGS_plog_replay_decode_threads = decode_threads;
+            error_code ec;
+            int64_t end_offset = 0;
+            const auto decrees = replay_log_file(log_file_path, ec, end_offset);
+            ASSERT_EQ(expected_ec, ec);
+            ASSERT_EQ(expected_end_offset, end_offset);
+            ASSERT_EQ(expected_decrees, decrees);
+        }
+    }
+
+    // Both the replays stop at the first block once it failed to be read.
+    fail::setup();
+    fail::cfg("mutation_log_replay_block", "100%return()");
+    for (uint32_t decode_threads : {0, 1, 3}) {
+        FLAGS_plog_replay_decode_threads = decode_threads;
+        error_code ec;
+        int64_t end_offset = -1;
+        const auto decrees = replay_log_file(log_file_path, ec, end_offset);
+        EXPECT_EQ(ERR_INCOMPLETE_DATA, ec);
+        EXPECT_EQ(0, end_offset);
+        EXPECT_TRUE(decrees.empty());
+    }
+    fail::teardown();
+}
+
 TEST_P(mutation_log_test, replay_start_decree)
 {
     // decree ranges from [1, 30)
@@ -99,6 +99,21 @@ public:
         ASSERT_EQ(fmt::format(unfilled_resp, expect_value), resp.body);
     }
 
+    void test_query_hotkeys(const map<string, string> &args,
+                            http_status_code expect_status,
+                            const string &expect_body)
+    {
+        http_request req;
+        for (const auto &arg : args) {
+            req.query_args[arg.first] = arg.second;
+        }
+
+        http_response resp;
+        _http_svc->query_hotkeys_handler(req, resp);
+        ASSERT_EQ(expect_status, resp.status_code);
+        ASSERT_EQ(expect_body, resp.body);
+    }
+
 private:
     std::unique_ptr<replica_http_service> _http_svc;
 };
@@ -142,5 +157,21 @@ TEST_P(replica_http_service_test, update_config_handler)
     ASSERT_EQ(10, FLAGS_config_sync_interval_ms);
 }
 
+TEST_P(replica_http_service_test, query_hotkeys_handler)
+{
+    NO_FATALS(test_query_hotkeys({}, http_status_code::kBadRequest, "app_id should not be empty"));
+    NO_FATALS(test_query_hotkeys(
+        {{"app_id", "x"}}, http_status_code::kBadRequest, "invalid app_id=x"));
+    NO_FATALS(test_query_hotkeys({{"app_id", "1"}, {"type", "scan"}},
+                                 http_status_code::kBadRequest,
+                                 "invalid type=scan, should be 'read' or 'write'"));
+    NO_FATALS(test_query_hotkeys(
+        {{"app_id", "1"}, {"top", "0"}}, http_status_code::kBadRequest, "invalid top=0"));
+
+    // There is no primary replica of the app on this replica server.
+    NO_FATALS(test_query_hotkeys(
+        {{"app_id", "2"}, {"type", "write"}, {"top", "5"}}, http_status_code::kOk, "{}"));
+}
+
 } // namespace replication
 } // namespace dsn
@@ -18,11 +18,14 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <atomic>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -44,6 +47,8 @@
 #include "http/http_status_code.h"
 #include "metadata_types.h"
 #include "replica/disk_cleaner.h"
+#include "replica/mutation.h"
+#include "replica/prepare_list.h"
 #include "replica/replica.h"
 #include "replica/replica_http_service.h"
 #include "replica/replica_stub.h"
@@ -53,10 +58,14 @@
 #include "runtime/api_layer1.h"
 #include "runtime/rpc/network.sim.h"
 #include "runtime/rpc/rpc_address.h"
+#include "runtime/rpc/rpc_host_port.h"
 #include "runtime/rpc/rpc_message.h"
+#include "runtime/rpc/rpc_stream.h"
+#include "runtime/rpc/serialization.h"
 #include "runtime/task/task_code.h"
 #include "runtime/task/task_tracker.h"
 #include "utils/autoref_ptr.h"
+#include "utils/blob.h"
 #include "utils/defer.h"
 #include "utils/env.h"
 #include "utils/error_code.h"
@@ -181,6 +190,65 @@ public:
         ASSERT_LT(0, size);
     }
 
+    void test_download_checkpoint_file()
+    {
+        auto *fs = stub->_block_service_manager.get_or_create_block_filesystem(_provider_name);
+        ASSERT_NE(nullptr, fs);
+
+        const std::string remote_dir = "download_checkpoint_file_test/remote";
+        const std::string local_chkpt_dir = "download_checkpoint_file_test/local";
+        ASSERT_TRUE(utils::filesystem::remove_path("download_checkpoint_file_test"));
+        ASSERT_TRUE(utils::filesystem::create_directory(remote_dir));
+        ASSERT_TRUE(utils::filesystem::create_directory(local_chkpt_dir));
+
+        const std::string content = "content of sst file";
+        const std::string origin_file_name =
+            utils::filesystem::path_combine(local_chkpt_dir, "origin.sst");
+        {
+            std::ofstream out(origin_file_name);
+            out << content;
+        }
+        file_meta f_meta;
+        f_meta.name = "000001.sst";
+        f_meta.size = content.size();
+        ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(origin_file_name, f_meta.md5));
+
+        // the file of an incremental backup is stored by its content-addressed name, and
+        // renamed to its original name after downloaded
+        const std::string shared_file_name =
+            cold_backup::get_shared_file_name(f_meta.name, f_meta.size, f_meta.md5);
+        ASSERT_TRUE(utils::filesystem::rename_path(
+            origin_file_name, utils::filesystem::path_combine(remote_dir, shared_file_name)));
+        uint64_t f_size = 0;
+        ASSERT_EQ(ERR_OK,
+                  _mock_replica->download_checkpoint_file(
+                      fs, remote_dir, shared_file_name, local_chkpt_dir, f_meta, f_size));
+        ASSERT_EQ(f_meta.size, f_size);
+        const std::string local_file_name =
+            utils::filesystem::path_combine(local_chkpt_dir, f_meta.name);
+        ASSERT_TRUE(utils::filesystem::file_exists(local_file_name));
+        ASSERT_FALSE(utils::filesystem::file_exists(
+            utils::filesystem::path_combine(local_chkpt_dir, shared_file_name)));
+
+        // the file which has been downloaded by the previous restore is reused
+        f_size = 0;
+        ASSERT_EQ(ERR_OK,
+                  _mock_replica->download_checkpoint_file(
+                      fs, remote_dir, shared_file_name, local_chkpt_dir, f_meta, f_size));
+        ASSERT_EQ(f_meta.size, f_size);
+
+        // the damaged file can't be reused
+        {
+            std::ofstream out(local_file_name, std::ios::app);
+            out << "damaged";
+        }
+        ASSERT_EQ(ERR_CORRUPTION,
+                  _mock_replica->download_checkpoint_file(
+                      fs, remote_dir, shared_file_name, local_chkpt_dir, f_meta, f_size));
+
+        ASSERT_TRUE(utils::filesystem::remove_path("download_checkpoint_file_test"));
+    }
+
     error_code test_find_valid_checkpoint(const std::string user_specified_path = "")
     {
         configuration_restore_request req;
@@ -248,6 +316,177 @@ public:
         std::cout << "the loaded original app_info is " << info << std::endl;
     }
 
+    void test_cleanup_prepare_batches()
+    {
+        message_ptr request = message_ex::create_request(RPC_PREPARE_BATCH);
+        auto &batch = _mock_replica->_prepare_batches[request.get()];
+        batch.request = request;
+        batch.acks.resize(1);
+        batch.left_ack_count = 1;
+        batch.expire_time_ms = dsn_now_ms() + 3600 * 1000;
+        ASSERT_EQ(2, request->get_count());
+
+        // The batches which would never be fully acked are released once the mutations are
+        // cleaned up, rather than waiting for the next batch to sweep them.
+        _mock_replica->cleanup_preparing_mutations(false);
+        ASSERT_TRUE(_mock_replica->_prepare_batches.empty());
+        ASSERT_EQ(1, request->get_count());
+    }
+
+    mutation_ptr create_prepare_mutation(decree d, bool logged)
+    {
+        mutation_ptr mu(new mutation());
+        mu->data.header.pid = _pid;
+        mu->data.header.last_committed_decree = d - 1;
+        mu->data.header.log_offset = 0;
+        mu->data.header.timestamp = d;
+        mu->set_id(_mock_replica->get_ballot(), d);
+        mu->data.updates.emplace_back(mutation_update());
+        mu->data.updates.back().code = RPC_COLD_BACKUP;
+        mu->data.updates.back().data = blob::create_from_bytes(std::string("prepare_batch_test"));
+        if (logged) {
+            mu->set_logged();
+        }
+        return mu;
+    }
+
+    // Creates a RPC_PREPARE_BATCH request of `mus` received by a secondary, whose gpid has been
+    // read as replica_stub::on_prepare_batch() does. The acks are dropped rather than sent,
+    // since the request has no sender.
+    message_ptr create_prepare_batch_request(const std::vector<mutation_ptr> &mus, int timeout_ms)
+    {
+        message_ptr request = message_ex::create_request(RPC_PREPARE_BATCH, timeout_ms);
+        {
+            rpc_write_stream writer(request.get());
+            marshall(writer, _pid, DSF_THRIFT_BINARY);
+            writer.write_pod(static_cast<int32_t>(mus.size()));
+        }
+        for (const auto &mu : mus) {
+            replica_configuration rconfig;
+            rconfig.pid = _pid;
+            rconfig.ballot = mu->get_ballot();
+            rconfig.status = partition_status::PS_SECONDARY;
+            {
+                rpc_write_stream writer(request.get());
+                marshall(writer, rconfig, DSF_THRIFT_BINARY);
+            }
+            for (const auto &buffer : mu->prepare_buffers()) {
+                request->write_append(buffer);
+            }
+        }
+
+        message_ptr received = request->copy(true, true);
+        gpid pid;
+        unmarshall(received.get(), pid);
+        CHECK_EQ(_pid, pid);
+        return received;
+    }
+
+    void prepare_on_secondary(mutation_ptr &mu)
+    {
+        ASSERT_EQ(ERR_OK,
+                  _mock_replica->_prepare_list->prepare(
+                      mu, partition_status::PS_SECONDARY, false, false));
+    }
+
+    void test_on_prepare_batch()
+    {
+        _mock_replica->as_secondary();
+        _mock_replica->set_last_committed_decree(10);
+
+        // The mutation 11 has been prepared but not logged, and 12 has been logged.
+        auto preparing = create_prepare_mutation(11, false);
+        NO_FATALS(prepare_on_secondary(preparing));
+        auto logged = create_prepare_mutation(12, true);
+        NO_FATALS(prepare_on_secondary(logged));
+
+        // The mutation 9 has been committed, thus is acked at once, as the logged one is. The
+        // duplicate of the preparing one joins it, and is acked once it is logged.
+        auto request = create_prepare_batch_request({create_prepare_mutation(9, false),
+                                                     create_prepare_mutation(11, false),
+                                                     create_prepare_mutation(12, false)},
+                                                    3600 * 1000);
+        _mock_replica->on_prepare_batch(request.get());
+        ASSERT_EQ(std::vector<message_ex *>({request.get()}), preparing->prepare_requests());
+        ASSERT_TRUE(logged->prepare_requests().empty());
+
+        // The batch is not replied until all of its mutations are acked.
+        ASSERT_EQ(1, _mock_replica->_prepare_batches.size());
+        auto iter = _mock_replica->_prepare_batches.find(request.get());
+        ASSERT_NE(_mock_replica->_prepare_batches.end(), iter);
+        const auto &batch = iter->second;
+        ASSERT_EQ(1, batch.left_ack_count);
+        ASSERT_EQ(3, batch.acks.size());
+        const std::vector<std::pair<decree, error_code>> expected_acks(
+            {{9, ERR_OK}, {11, ERR_IO_PENDING}, {12, ERR_OK}});
+        for (size_t i = 0; i < expected_acks.size(); ++i) {
+            ASSERT_EQ(expected_acks[i].first, batch.acks[i].decree);
+            ASSERT_EQ(expected_acks[i].second, batch.acks[i].err);
+        }
+
+        // The batch is replied and released once its last mutation is acked.
+        _mock_replica->ack_prepare_message(ERR_OK, preparing);
+        ASSERT_TRUE(_mock_replica->_prepare_batches.empty());
+    }
+
+    void test_prepare_batch_expired()
+    {
+        _mock_replica->as_secondary();
+        _mock_replica->set_last_committed_decree(10);
+
+        auto preparing = create_prepare_mutation(11, false);
+        NO_FATALS(prepare_on_secondary(preparing));
+
+        // The batch expires before the preparing mutation is acked.
+        auto expiring = create_prepare_batch_request(
+            {create_prepare_mutation(9, false), create_prepare_mutation(11, false)}, 1);
+        _mock_replica->on_prepare_batch(expiring.get());
+        ASSERT_EQ(1, _mock_replica->_prepare_batches.count(expiring.get()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        // The expired batch is dropped once the next batch is received, while the next batch
+        // is replied at once since all of its mutations have been committed.
+        auto request = create_prepare_batch_request(
+            {create_prepare_mutation(9, false), create_prepare_mutation(10, false)}, 3600 * 1000);
+        _mock_replica->on_prepare_batch(request.get());
+        ASSERT_TRUE(_mock_replica->_prepare_batches.empty());
+
+        // The late ack of the expired batch is ignored.
+        _mock_replica->ack_prepare_message(ERR_OK, preparing);
+        ASSERT_TRUE(_mock_replica->_prepare_batches.empty());
+    }
+
+    void test_prepare_batch_rejected()
+    {
+        ASSERT_EQ(partition_status::PS_PRIMARY, _mock_replica->status());
+
+        std::vector<std::pair<mutation_ptr, partition_status::type>> prs;
+        for (decree d = 1; d <= 3; ++d) {
+            auto mu = create_prepare_mutation(d, true);
+            mu->set_left_potential_secondary_ack_count(2);
+            prs.emplace_back(mu, partition_status::PS_POTENTIAL_SECONDARY);
+        }
+
+        // The learner has not created the replica, thus rejects the batch with a single ack.
+        message_ptr request = message_ex::create_request(RPC_PREPARE_BATCH);
+        request->to_host_port = host_port("localhost", 34802);
+        prepare_ack ack;
+        ack.pid = _pid;
+        ack.err = ERR_OBJECT_NOT_FOUND;
+        prepare_batch_ack resp;
+        resp.acks.push_back(ack);
+        message_ptr response = request->create_response();
+        marshall(response.get(), resp);
+        message_ptr received_response = response->copy(true, true);
+
+        // The single ack is taken by all the mutations of the batch.
+        _mock_replica->on_prepare_batch_reply(
+            prs, ERR_OK, request.get(), received_response.get());
+        for (const auto &pr : prs) {
+            ASSERT_EQ(1, pr.first->left_potential_secondary_ack_count()) << pr.first->name();
+        }
+    }
+
     void test_auto_trash(error_code ec);
 
 public:
@@ -424,6 +663,8 @@ TEST_P(replica_test, test_replica_backup_and_restore_with_specific_path)
     ASSERT_EQ(ERR_OK, err);
 }
 
+TEST_P(replica_test, test_download_checkpoint_file) { test_download_checkpoint_file(); }
+
 TEST_P(replica_test, test_trigger_manual_emergency_checkpoint)
 {
     ASSERT_EQ(_mock_replica->trigger_manual_emergency_checkpoint(100), ERR_OK);
@@ -584,5 +825,13 @@ TEST_P(replica_test, update_deny_client_test)
 
 TEST_P(replica_test, test_update_app_max_replica_count) { test_update_app_max_replica_count(); }
 
+TEST_P(replica_test, test_cleanup_prepare_batches) { test_cleanup_prepare_batches(); }
+
+TEST_P(replica_test, test_on_prepare_batch) { NO_FATALS(test_on_prepare_batch()); }
+
+TEST_P(replica_test, test_prepare_batch_expired) { NO_FATALS(test_prepare_batch_expired()); }
+
+TEST_P(replica_test, test_prepare_batch_rejected) { NO_FATALS(test_prepare_batch_rejected()); }
+
 } // namespace replication
 } // namespace dsn
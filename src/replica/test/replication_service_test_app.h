@@ -47,6 +47,7 @@ public:
     void upload_checkpoint_to_remote_test();
     void read_backup_metadata_test();
     void on_upload_chkpt_dir_test();
+    void prepare_upload_test();
     void write_backup_metadata_test();
     void write_current_chkpt_file_test();
 };
@@ -0,0 +1,121 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+#include "replica/write_pipeline_controller.h"
+#include "test_util/test_util.h"
+#include "utils/flags.h"
+
+DSN_DECLARE_int32(write_pipeline_min_depth);
+DSN_DECLARE_uint32(write_batch_max_delay_us);
+
+namespace dsn {
+namespace replication {
+
+class write_pipeline_controller_test : public ::testing::Test
+{
+protected:
+    // Commit a round of mutations whose service latency is `latency_us`.
+    void commit_round(uint64_t latency_us, bool backlogged)
+    {
+        const int depth = _controller.depth();
+        for (int i = 0; i < depth; ++i) {
+            _controller.on_log_appended(latency_us);
+            _controller.on_prepare_acked(latency_us);
+            _controller.on_committed(backlogged);
+        }
+    }
+
+    void receive_writes(int count, uint64_t interval_us)
+    {
+        for (int i = 0; i < count; ++i) {
+            _now_us += interval_us;
+            _controller.on_client_write(_now_us);
+        }
+    }
+
+    write_pipeline_controller _controller{10};
+    uint64_t _now_us = 1000000;
+};
+
+TEST_F(write_pipeline_controller_test, tune_depth)
+{
+    PRESERVE_FLAG(write_pipeline_min_depth);
+    FLAGS_write_pipeline_min_depth = 2;
+
+    // The depth starts from the max one.
+    ASSERT_EQ(10, _controller.depth());
+    commit_round(1000, true);
+    ASSERT_EQ(10, _controller.depth());
+
+    // The latency is inflated by queueing.
+    for (int i = 0; i < 20; ++i) {
+        commit_round(5000, true);
+    }
+    ASSERT_EQ(2, _controller.depth());
+
+    // The depth is not increased if no mutation waits for a free slot.
+    for (int i = 0; i < 20; ++i) {
+        commit_round(1000, false);
+    }
+    ASSERT_EQ(2, _controller.depth());
+
+    // The latency recovers under load.
+    for (int i = 0; i < 40; ++i) {
+        commit_round(1000, true);
+    }
+    ASSERT_EQ(10, _controller.depth());
+
+    // The updated min depth is respected at once.
+    FLAGS_write_pipeline_min_depth = 20;
+    for (int i = 0; i < 20; ++i) {
+        commit_round(5000, true);
+    }
+    ASSERT_EQ(10, _controller.depth());
+}
+
+TEST_F(write_pipeline_controller_test, batch_window)
+{
+    PRESERVE_FLAG(write_batch_max_delay_us);
+    FLAGS_write_batch_max_delay_us = 1000;
+
+    // Nothing is measured yet.
+    ASSERT_EQ(0, _controller.batch_window_us());
+
+    commit_round(800, false);
+    receive_writes(100, 1000);
+    // The writes are too rare to be batched.
+    ASSERT_EQ(0, _controller.batch_window_us());
+
+    // The window is bounded by half of the service latency.
+    receive_writes(100, 100);
+    ASSERT_EQ(400, _controller.batch_window_us());
+
+    // The window is bounded by the max delay.
+    for (int i = 0; i < 10; ++i) {
+        commit_round(10000, false);
+    }
+    ASSERT_EQ(1000, _controller.batch_window_us());
+
+    FLAGS_write_batch_max_delay_us = 0;
+    ASSERT_EQ(0, _controller.batch_window_us());
+}
+
+} // namespace replication
+} // namespace dsn
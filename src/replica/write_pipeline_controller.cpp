@@ -0,0 +1,149 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "replica/write_pipeline_controller.h"
+
+#include <algorithm>
+
+#include "utils/flags.h"
+
+DSN_DEFINE_int32(replication,
+                 write_pipeline_min_depth,
+                 2,
+                 "The min number of concurrent two-phase commit rounds that the adaptive write "
+                 "pipeline could be tuned to, see adaptive_write_pipeline_enabled");
+DSN_TAG_VARIABLE(write_pipeline_min_depth, FT_MUTABLE);
+DSN_DEFINE_validator(write_pipeline_min_depth, [](int32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint32(replication,
+                  write_batch_max_delay_us,
+                  1000,
+                  "The max time in microseconds that the adaptive write pipeline could hold a new "
+                  "mutation for more client writes to be batched into it, 0 means never hold");
+DSN_TAG_VARIABLE(write_batch_max_delay_us, FT_MUTABLE);
+
+namespace dsn {
+namespace replication {
+
+namespace {
+
+// The weight of a new sample in the moving averages.
+constexpr double kSampleWeight = 0.125;
+
+// The pipeline is deepened only if the service latency is within this ratio of the minimum, and
+// is shallowed once the latency exceeds the other one.
+constexpr double kIncreaseLatencyRatio = 1.5;
+constexpr double kDecreaseLatencyRatio = 2.0;
+
+// The minimum service latency is re-measured periodically to follow the changes of the cluster.
+constexpr int kMinLatencyResetRounds = 100;
+
+void update_average(double sample, /*in-out*/ double &average)
+{
+    average = average == 0 ? sample : average + (sample - average) * kSampleWeight;
+}
+
+} // anonymous namespace
+
+write_pipeline_controller::write_pipeline_controller(int max_depth)
+    : _max_depth(std::max(max_depth, 1)),
+      _depth(_max_depth),
+      _round_commits(0),
+      _round_backlogged(false),
+      _rounds_since_min_reset(0),
+      _log_append_us(0),
+      _prepare_rtt_us(0),
+      _arrival_interval_us(0),
+      _min_service_us(0),
+      _last_arrival_us(0)
+{
+}
+
+void write_pipeline_controller::on_client_write(uint64_t now_us)
+{
+    if (_last_arrival_us != 0 && now_us >= _last_arrival_us) {
+        update_average(static_cast<double>(now_us - _last_arrival_us), _arrival_interval_us);
+    }
+    _last_arrival_us = now_us;
+}
+
+void write_pipeline_controller::on_log_appended(uint64_t latency_us)
+{
+    update_average(static_cast<double>(latency_us), _log_append_us);
+}
+
+void write_pipeline_controller::on_prepare_acked(uint64_t rtt_us)
+{
+    update_average(static_cast<double>(rtt_us), _prepare_rtt_us);
+}
+
+void write_pipeline_controller::on_committed(bool backlogged)
+{
+    _round_backlogged = _round_backlogged || backlogged;
+    if (++_round_commits < _depth) {
+        return;
+    }
+
+    adjust_depth();
+    _round_commits = 0;
+    _round_backlogged = false;
+}
+
+void write_pipeline_controller::adjust_depth()
+{
+    const double latency_us = service_latency_us();
+    if (latency_us == 0) {
+        return;
+    }
+
+    if (_min_service_us == 0 || latency_us < _min_service_us ||
+        ++_rounds_since_min_reset >= kMinLatencyResetRounds) {
+        _min_service_us = latency_us;
+        _rounds_since_min_reset = 0;
+    }
+
+    const int min_depth = std::min(FLAGS_write_pipeline_min_depth, _max_depth);
+    if (latency_us > _min_service_us * kDecreaseLatencyRatio) {
+        _depth = std::max(_depth - std::max(_depth / 4, 1), min_depth);
+    } else if (_round_backlogged && latency_us <= _min_service_us * kIncreaseLatencyRatio) {
+        _depth = std::min(_depth + 1, _max_depth);
+    }
+    // The min depth may have been updated.
+    _depth = std::max(_depth, min_depth);
+}
+
+uint64_t write_pipeline_controller::batch_window_us() const
+{
+    const double latency_us = service_latency_us();
+    if (FLAGS_write_batch_max_delay_us == 0 || latency_us == 0 || _arrival_interval_us == 0) {
+        return 0;
+    }
+
+    // Holding a mutation longer than half of its service latency would delay the writes more
+    // than the batching saves.
+    const double window_us =
+        std::min(static_cast<double>(FLAGS_write_batch_max_delay_us), latency_us / 2);
+    return _arrival_interval_us < window_us ? static_cast<uint64_t>(window_us) : 0;
+}
+
+double write_pipeline_controller::service_latency_us() const
+{
+    return std::max(_log_append_us, _prepare_rtt_us);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace dsn {
+namespace replication {
+
+// Tunes the depth of the 2PC pipeline of a primary replica and the window in which the client
+// writes are held to be batched into a mutation, from the latencies measured on the write path.
+//
+// The depth is tuned like TCP Vegas. The service latency of a mutation, i.e. the longer one of
+// appending it to the private log and preparing it on the secondaries, is compared with the
+// minimum observed recently. Once per round of `depth` commits, the depth is increased if some
+// mutations waited for a free slot of the pipeline while the latency stayed close to the minimum,
+// and is decreased once the latency is inflated by queueing on the disk or the secondaries. A
+// shallower pipeline packs more writes into each mutation.
+//
+// The batching window works like Nagle's algorithm: while some mutations are in flight, a new
+// mutation is held for more writes to be packed into it, until an in-flight mutation is committed
+// or the window elapses. The window is only opened if the writes arrive frequently enough for at
+// least one more of them to be expected within it, thus a light load is never delayed.
+//
+// Not thread safe, it's only accessed in the replication thread of the replica.
+class write_pipeline_controller
+{
+public:
+    // The depth starts from `max_depth`, i.e. the behavior without the controller.
+    explicit write_pipeline_controller(int max_depth);
+
+    void on_client_write(uint64_t now_us);
+    void on_log_appended(uint64_t latency_us);
+    void on_prepare_acked(uint64_t rtt_us);
+    // `backlogged` is whether any mutation is waiting for a free slot of the pipeline.
+    void on_committed(bool backlogged);
+
+    int depth() const { return _depth; }
+
+    // Returns 0 if the new mutations should not be held.
+    uint64_t batch_window_us() const;
+
+private:
+    friend class write_pipeline_controller_test;
+
+    double service_latency_us() const;
+    void adjust_depth();
+
+    const int _max_depth;
+    int _depth;
+    int _round_commits;
+    bool _round_backlogged;
+    int _rounds_since_min_reset;
+
+    // Exponentially weighted moving averages, 0 if not measured yet.
+    double _log_append_us;
+    double _prepare_rtt_us;
+    double _arrival_interval_us;
+    double _min_service_us;
+    uint64_t _last_arrival_us;
+};
+
+} // namespace replication
+} // namespace dsn
@@ -39,7 +39,7 @@
 #include "runtime/task/task_spec.h"
 #include "utils/blob.h"
 #include "utils/fmt_logging.h"
-#include "utils/utils.h"
+#include "utils/slab_allocator.h"
 
 namespace dsn {
 
@@ -151,7 +151,7 @@ char *message_reader::read_buffer_ptr(unsigned int read_next)
         // TODO(wutao1): make it a buffer queue like what sofa-pbrpc does
         //               (https://github.com/baidu/sofa-pbrpc/blob/master/src/sofa/pbrpc/buffer.h)
         //               to reduce memory copy.
-        _buffer.assign(dsn::utils::make_shared_array<char>(sz), 0, sz);
+        _buffer.assign(dsn::utils::make_slab_buffer(sz), 0, sz);
         _buffer_occupied = 0;
 
         // copy
@@ -41,6 +41,7 @@
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
 #include "utils/join_point.h"
+#include "utils/slab_allocator.h"
 #include "utils/strings.h"
 #include "utils/utils.h"
 
@@ -248,7 +249,7 @@ message_ex *message_ex::copy(bool clone_content, bool copy_for_receive)
         msg->buffers = buffers;
     } else {
         int total_length = body_size() + sizeof(dsn::message_header);
-        std::shared_ptr<char> recv_buffer(dsn::utils::make_shared_array<char>(total_length));
+        std::shared_ptr<char> recv_buffer(dsn::utils::make_slab_buffer(total_length));
         char *ptr = recv_buffer.get();
 
         if ((const char *)header != buffers[0].data()) {
@@ -386,7 +387,7 @@ message_ex *message_ex::create_response()
 void message_ex::prepare_buffer_header()
 {
     size_t header_size = sizeof(message_header);
-    auto ptr(dsn::utils::make_shared_array<char>(header_size));
+    auto ptr(dsn::utils::make_slab_buffer(header_size));
 
     // here we should call placement new,
     // so the gpid & rpc_address can be initialized
@@ -412,7 +413,7 @@ void message_ex::write_next(void **ptr, size_t *size, size_t min_size)
     CHECK(!this->_is_read && this->_rw_committed,
           "there are pending msg write not committed"
           ", please invoke dsn_msg_write_next and dsn_msg_write_commit in pairs");
-    auto ptr_data(utils::make_shared_array<char>(min_size));
+    auto ptr_data(utils::make_slab_buffer(min_size));
     *size = min_size;
     *ptr = ptr_data.get();
     this->_rw_committed = false;
@@ -438,6 +439,23 @@ void message_ex::write_commit(size_t size)
     this->header->body_length += (int)size;
 }
 
+void message_ex::write_append(const blob &data)
+{
+    CHECK(!this->_is_read && this->_rw_committed,
+          "there are pending msg write not committed"
+          ", please invoke dsn_msg_write_next and dsn_msg_write_commit in pairs");
+    if (data.length() == 0) {
+        return;
+    }
+
+    this->_rw_index++;
+    this->_rw_offset = static_cast<int>(data.length());
+    this->buffers.push_back(data);
+    this->header->body_length += data.length();
+
+    CHECK_EQ_MSG(_rw_index + 1, buffers.size(), "message write buffer count is not right");
+}
+
 bool message_ex::read_next(void **ptr, size_t *size)
 {
     // printf("%p %s %d\n", this, __FUNCTION__, utils::get_current_tid());
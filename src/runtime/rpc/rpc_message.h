@@ -203,6 +203,10 @@ public:
     //
     void write_next(void **ptr, size_t *size, size_t min_size);
     void write_commit(size_t size);
+    // Append `data` to the message without copying it, thus the data referenced by `data` must
+    // not be changed before the message is sent. `data` is shared by the copies of the message
+    // which are not cloned, e.g. the same blob could be appended to several messages.
+    void write_append(const blob &data);
     bool read_next(void **ptr, size_t *size);
     bool read_next(blob &data);
     void read_commit(size_t size);
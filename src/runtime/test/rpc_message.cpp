@@ -37,6 +37,7 @@
 #include "runtime/message_utils.h"
 #include "runtime/rpc/rpc_address.h"
 #include "runtime/rpc/rpc_message.h"
+#include "runtime/rpc/rpc_stream.h"
 #include "runtime/rpc/serialization.h"
 #include "runtime/task/task_code.h"
 #include "runtime/task/task_spec.h"
@@ -229,3 +230,39 @@ TEST(rpc_message, copy_message_no_reply)
     // so we only need to call release_ref here.
     msg->release_ref();
 }
+
+TEST(rpc_message, write_append)
+{
+    const auto shared = blob::create_from_bytes(std::string("shared data"));
+    std::vector<message_ptr> requests;
+    for (int i = 0; i < 2; ++i) {
+        message_ptr request = message_ex::create_request(RPC_CODE_FOR_TEST, 100, 1);
+        {
+            rpc_write_stream writer(request.get());
+            writer.write_pod(i);
+        }
+        request->write_append(shared);
+        {
+            rpc_write_stream writer(request.get());
+            writer.write_pod(i);
+        }
+        ASSERT_EQ(sizeof(int) * 2 + shared.length(), request->body_size());
+        requests.push_back(request);
+    }
+
+    // The appended data is shared by the requests rather than copied.
+    ASSERT_EQ(requests[0]->buffers[2].data(), requests[1]->buffers[2].data());
+
+    for (int i = 0; i < 2; ++i) {
+        message_ptr received(requests[i]->copy(true, true));
+        rpc_read_stream reader(received.get());
+        int value = -1;
+        reader.read_pod(value);
+        ASSERT_EQ(i, value);
+        std::string data(shared.length(), '\0');
+        ASSERT_EQ(shared.length(), reader.read(&data[0], shared.length()));
+        ASSERT_EQ(shared.to_string(), data);
+        reader.read_pod(value);
+        ASSERT_EQ(i, value);
+    }
+}
@@ -79,6 +79,7 @@ meta_access_controller::meta_access_controller(
                                         "RPC_LEARN_COMPLETION_NOTIFY",
                                         "RPC_NEGOTIATION",
                                         "RPC_PREPARE",
+                                        "RPC_PREPARE_BATCH",
                                         "RPC_QUERY_APP_INFO",
                                         "RPC_QUERY_LAST_CHECKPOINT_INFO",
                                         "RPC_QUERY_REPLICA_INFO",
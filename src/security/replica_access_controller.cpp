@@ -15,6 +15,9 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <stddef.h>
+#include <functional>
+#include <unordered_map>
 #include <utility>
 
 // Disable class-memaccess warning to facilitate compilation with gcc>7
@@ -27,6 +30,7 @@
 
 #pragma GCC diagnostic pop
 
+#include "ranger/ranger_resource_policy.h"
 #include "replica_access_controller.h"
 #include "runtime/rpc/network.h"
 #include "runtime/rpc/rpc_message.h"
@@ -39,9 +43,59 @@
 DSN_DECLARE_bool(enable_acl);
 DSN_DECLARE_bool(enable_ranger_acl);
 
+DSN_DEFINE_uint32(security,
+                  ranger_acl_decision_cache_capacity,
+                  4096,
+                  "The maximum number of the decisions made by Ranger policies that are cached by "
+                  "each thread for the replicas, all of them would be dropped once it is reached. "
+                  "0 means the decisions are not cached");
+DSN_TAG_VARIABLE(ranger_acl_decision_cache_capacity, FT_MUTABLE);
+
 namespace dsn {
 namespace security {
+namespace {
+
+struct acl_decision_key
+{
+    uint64_t controller_id;
+    ranger::access_type req_type;
+    std::string user_name;
+
+    bool operator==(const acl_decision_key &other) const
+    {
+        return controller_id == other.controller_id && req_type == other.req_type &&
+               user_name == other.user_name;
+    }
+};
+
+struct acl_decision_key_hash
+{
+    size_t operator()(const acl_decision_key &key) const
+    {
+        size_t hash = std::hash<std::string>()(key.user_name);
+        hash = hash * 31 + std::hash<uint64_t>()(key.controller_id);
+        return hash * 31 + static_cast<size_t>(key.req_type);
+    }
+};
+
+struct acl_decision
+{
+    // The version of the policies by which the decision is made.
+    uint64_t policies_version;
+    bool allowed;
+};
+
+// Each thread caches the decisions made by itself, thus they could be looked up without any
+// lock. The decisions of a controller are invalidated once its policies are updated.
+thread_local std::unordered_map<acl_decision_key, acl_decision, acl_decision_key_hash>
+    tls_acl_decisions;
+
+std::atomic<uint64_t> next_controller_id(0);
+
+} // anonymous namespace
+
 replica_access_controller::replica_access_controller(const std::string &replica_name)
+    : _id(next_controller_id.fetch_add(1, std::memory_order_relaxed)), _ranger_policies_version(0)
 {
     _name = replica_name;
 }
@@ -68,11 +122,40 @@ bool replica_access_controller::allowed(message_ex *msg, ranger::access_type req
     }
 
     // use Ranger policy for ACL.
+    return check_ranger_policies_allowed(req_type, user_name);
+}
+
+bool replica_access_controller::check_ranger_policies_allowed(ranger::access_type req_type,
+                                                              const std::string &user_name) const
+{
+    const auto capacity = FLAGS_ranger_acl_decision_cache_capacity;
+    acl_decision_key key{_id, req_type, user_name};
+    if (capacity > 0) {
+        const auto iter = tls_acl_decisions.find(key);
+        if (iter != tls_acl_decisions.end() &&
+            iter->second.policies_version ==
+                _ranger_policies_version.load(std::memory_order_acquire)) {
+            return iter->second.allowed;
+        }
+    }
+
+    acl_decision decision;
     {
         utils::auto_read_lock l(_lock);
-        return check_ranger_database_table_policy_allowed(_ranger_policies, req_type, user_name) ==
-               ranger::access_control_result::kAllowed;
+        decision.allowed =
+            check_ranger_database_table_policy_allowed(_ranger_policies, req_type, user_name) ==
+            ranger::access_control_result::kAllowed;
+        // The version is updated along with the policies under the write lock.
+        decision.policies_version = _ranger_policies_version.load(std::memory_order_relaxed);
+    }
+
+    if (capacity > 0) {
+        if (tls_acl_decisions.size() >= capacity) {
+            tls_acl_decisions.clear();
+        }
+        tls_acl_decisions[std::move(key)] = decision;
     }
+    return decision.allowed;
 }
 
 void replica_access_controller::update_allowed_users(const std::string &users)
@@ -112,6 +195,7 @@ void replica_access_controller::update_ranger_policies(const std::string &polici
         utils::auto_write_lock l(_lock);
         _env_policies = policies;
         _ranger_policies = std::move(tmp_policies);
+        _ranger_policies_version.fetch_add(1, std::memory_order_release);
     }
 }
 
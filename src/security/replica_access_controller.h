@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -40,7 +42,8 @@ public:
     explicit replica_access_controller(const std::string &replica_name);
 
     // Check whether replica can be accessed, this method is compatible with ACL using
-    // '_allowed_users' and ACL using Ranger policy.
+    // '_allowed_users' and ACL using Ranger policy. The decisions made by Ranger policy are
+    // cached by each thread until the policies are updated.
     bool allowed(message_ex *msg, ranger::access_type req_type) const override;
 
     // Update '_allowed_users' when the app_env(REPLICA_ACCESS_CONTROLLER_ALLOWED_USERS) of the
@@ -57,6 +60,11 @@ private:
     // Security check to avoid allowed_users is not empty in special scenarios.
     void check_allowed_users_valid() const;
 
+    // Check whether 'user_name' is allowed to access the replica by 'req_type' according to
+    // '_ranger_policies', and cache the decision for the calling thread.
+    bool check_ranger_policies_allowed(ranger::access_type req_type,
+                                       const std::string &user_name) const;
+
 private:
     mutable utils::rw_lock_nr _lock;
     // Users will pass the access control in the old ACL.
@@ -73,6 +81,13 @@ private:
     // The Ranger policies for ACL.
     matched_database_table_policies _ranger_policies;
 
+    // The unique id of this controller, which identifies its cached decisions.
+    const uint64_t _id;
+
+    // Increased once '_ranger_policies' is updated, thus the decisions cached with the previous
+    // versions are invalidated.
+    std::atomic<uint64_t> _ranger_policies_version;
+
     std::string _name;
 
     friend class replica_access_controller_test;
@@ -20,18 +20,25 @@
 #include <unordered_set>
 #include <utility>
 
+#include "common/json_helper.h"
 #include "common/replication.codes.h"
 #include "gtest/gtest.h"
 #include "ranger/access_type.h"
+#include "ranger/ranger_resource_policy.h"
 #include "runtime/rpc/network.h"
 #include "runtime/rpc/network.sim.h"
 #include "runtime/rpc/rpc_address.h"
 #include "runtime/rpc/rpc_message.h"
 #include "security/replica_access_controller.h"
+#include "test_util/test_util.h"
 #include "utils/autoref_ptr.h"
+#include "utils/blob.h"
 #include "utils/flags.h"
+#include "utils/test_macros.h"
 
 DSN_DECLARE_bool(enable_acl);
+DSN_DECLARE_bool(enable_ranger_acl);
+DSN_DECLARE_uint32(ranger_acl_decision_cache_capacity);
 
 namespace dsn {
 namespace security {
@@ -54,6 +61,28 @@ public:
         _replica_access_controller->_allowed_users.swap(replica_users);
     }
 
+    static matched_database_table_policies make_read_policies(std::unordered_set<std::string> users)
+    {
+        ranger::matched_database_table_policy policy;
+        policy.policies.allow_policies.push_back({ranger::access_type::kRead, std::move(users)});
+        return {policy};
+    }
+
+    void update_ranger_policies(std::unordered_set<std::string> read_users)
+    {
+        auto policies =
+            json::json_forwarder<matched_database_table_policies>::encode(
+                make_read_policies(std::move(read_users)))
+                .to_string();
+        _replica_access_controller->update_ranger_policies(policies);
+    }
+
+    // Replace the policies without invalidating the cached decisions.
+    void replace_ranger_policies(std::unordered_set<std::string> read_users)
+    {
+        _replica_access_controller->_ranger_policies = make_read_policies(std::move(read_users));
+    }
+
     std::unique_ptr<replica_access_controller> _replica_access_controller;
 };
 
@@ -87,5 +116,52 @@ TEST_F(replica_access_controller_test, allowed)
 
     FLAGS_enable_acl = origin_enable_acl;
 }
+
+TEST_F(replica_access_controller_test, ranger_decision_cache)
+{
+    PRESERVE_FLAG(enable_acl);
+    PRESERVE_FLAG(enable_ranger_acl);
+    PRESERVE_FLAG(ranger_acl_decision_cache_capacity);
+    FLAGS_enable_acl = true;
+    FLAGS_enable_ranger_acl = true;
+
+    std::unique_ptr<tools::sim_network_provider> sim_net(
+        new tools::sim_network_provider(nullptr, nullptr));
+    auto sim_session =
+        sim_net->create_client_session(rpc_address::from_host_port("localhost", 10086));
+    dsn::message_ptr msg = message_ex::create_request(RPC_CM_LIST_APPS);
+    msg->io_session = sim_session;
+
+    const auto check_allowed = [&](const std::string &user, ranger::access_type type) {
+        sim_session->set_client_username(user);
+        return _replica_access_controller->allowed(msg, type);
+    };
+
+    update_ranger_policies({"user1"});
+    ASSERT_TRUE(check_allowed("user1", ranger::access_type::kRead));
+    ASSERT_FALSE(check_allowed("user1", ranger::access_type::kWrite));
+    ASSERT_FALSE(check_allowed("user2", ranger::access_type::kRead));
+
+    // The cached decisions are used as long as the policies are not updated.
+    replace_ranger_policies({"user2"});
+    ASSERT_TRUE(check_allowed("user1", ranger::access_type::kRead));
+    ASSERT_FALSE(check_allowed("user2", ranger::access_type::kRead));
+
+    // Updating the policies invalidates the cached decisions.
+    update_ranger_policies({"user2"});
+    ASSERT_FALSE(check_allowed("user1", ranger::access_type::kRead));
+    ASSERT_TRUE(check_allowed("user2", ranger::access_type::kRead));
+
+    // The decisions of another controller are not shared.
+    replica_access_controller another_controller("another");
+    sim_session->set_client_username("user2");
+    ASSERT_FALSE(another_controller.allowed(msg, ranger::access_type::kRead));
+
+    // The policies are always checked if the cache is disabled.
+    FLAGS_ranger_acl_decision_cache_capacity = 0;
+    replace_ranger_policies({"user1"});
+    ASSERT_TRUE(check_allowed("user1", ranger::access_type::kRead));
+    ASSERT_FALSE(check_allowed("user2", ranger::access_type::kRead));
+}
 } // namespace security
 } // namespace dsn
@@ -26,6 +26,7 @@
 #include <cstdint>
 
 #include "hotkey_collector.h"
+#include "metadata_types.h"
 #include "rrdb/rrdb_types.h"
 #include "runtime/rpc/rpc_message.h"
 #include "utils/autoref_ptr.h"
@@ -410,5 +411,17 @@ void capacity_unit_calculator::add_backup_request_bytes(dsn::message_ex *req, in
     }
 }
 
+void capacity_unit_calculator::query_load_stats(
+    dsn::replication::replica_load_stats &stats) const
+{
+    stats.read_cu = METRIC_VAR_VALUE(read_capacity_units);
+    stats.write_cu = METRIC_VAR_VALUE(write_capacity_units);
+    stats.network_bytes = METRIC_VAR_VALUE(get_bytes) + METRIC_VAR_VALUE(multi_get_bytes) +
+                          METRIC_VAR_VALUE(batch_get_bytes) + METRIC_VAR_VALUE(scan_bytes) +
+                          METRIC_VAR_VALUE(put_bytes) + METRIC_VAR_VALUE(multi_put_bytes) +
+                          METRIC_VAR_VALUE(check_and_set_bytes) +
+                          METRIC_VAR_VALUE(check_and_mutate_bytes);
+}
+
 } // namespace server
 } // namespace pegasus
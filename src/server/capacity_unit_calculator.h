@@ -30,6 +30,10 @@ namespace dsn {
 class blob;
 class message_ex;
 
+namespace replication {
+class replica_load_stats;
+} // namespace replication
+
 namespace apps {
 class full_data;
 class key_value;
@@ -92,6 +96,9 @@ public:
                                  const dsn::blob &check_sort_key,
                                  const std::vector<::dsn::apps::mutate> &mutate_list);
 
+    // Fill the cumulative capacity units and request bytes into `stats`.
+    void query_load_stats(/*out*/ dsn::replication::replica_load_stats &stats) const;
+
 protected:
     friend class capacity_unit_calculator_test;
 
@@ -74,6 +74,21 @@ DSN_DEFINE_uint32(
     "the max time (in seconds) allowed to capture hotkey, will stop if hotkey's not found");
 DSN_TAG_VARIABLE(max_seconds_to_detect_hotkey, FT_MUTABLE);
 
+DSN_DEFINE_bool(pegasus.server,
+                enable_hotkey_sketch,
+                true,
+                "whether to always count the hottest hash keys of each replica by a sketch, whose "
+                "top keys could be queried through the http service of replica server");
+DSN_TAG_VARIABLE(enable_hotkey_sketch, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.server,
+                  hotkey_sketch_capacity,
+                  64,
+                  "the max count of the hash keys counted by the hotkey sketch of each replica, "
+                  "any hash key accessed more than 1/capacity of the total is guaranteed to be "
+                  "found");
+DSN_DEFINE_validator(hotkey_sketch_capacity, [](uint32_t value) -> bool { return value > 0; });
+
 namespace pegasus {
 namespace server {
 
@@ -136,7 +151,10 @@ find_outlier_index(const std::vector<uint64_t> &captured_keys, int threshold, in
 
 hotkey_collector::hotkey_collector(dsn::replication::hotkey_type::type hotkey_type,
                                    dsn::replication::replica_base *r_base)
-    : replica_base(r_base), _hotkey_type(hotkey_type)
+    : replica_base(r_base),
+      _hotkey_type(hotkey_type),
+      _sketch(FLAGS_hotkey_sketch_capacity),
+      _sketch_window_start_ms(dsn_now_ms())
 {
     int now_hash_bucket_num = FLAGS_hotkey_buckets_num;
     _internal_coarse_collector =
@@ -235,6 +253,10 @@ void hotkey_collector::capture_raw_key(const dsn::blob &raw_key, int64_t weight)
 
 void hotkey_collector::capture_hash_key(const dsn::blob &hash_key, int64_t weight)
 {
+    if (FLAGS_enable_hotkey_sketch) {
+        _sketch.add(hash_key.to_string_view(), weight > 0 ? weight : 1);
+    }
+
     // TODO: (Tangyanzhao) add a unit test to ensure data integrity
     switch (_state.load()) {
     case hotkey_collector_state::COARSE_DETECTING:
@@ -248,6 +270,8 @@ void hotkey_collector::capture_hash_key(const dsn::blob &hash_key, int64_t weigh
 
 void hotkey_collector::analyse_data()
 {
+    rotate_sketch_window();
+
     switch (_state.load()) {
     case hotkey_collector_state::COARSE_DETECTING:
     case hotkey_collector_state::FINE_DETECTING:
@@ -261,6 +285,33 @@ void hotkey_collector::analyse_data()
     }
 }
 
+void hotkey_collector::rotate_sketch_window()
+{
+    const auto now_ms = dsn_now_ms();
+    const auto window_ms = now_ms - _sketch_window_start_ms;
+    if (window_ms == 0) {
+        return;
+    }
+    _sketch_window_start_ms = now_ms;
+
+    auto counts = _sketch.take_top(_sketch.capacity());
+    std::vector<std::pair<std::string, double>> top_hotkeys;
+    top_hotkeys.reserve(counts.size());
+    for (auto &count : counts) {
+        top_hotkeys.emplace_back(std::move(count.hash_key), count.count * 1000.0 / window_ms);
+    }
+
+    std::lock_guard<std::mutex> l(_top_hotkeys_lock);
+    _top_hotkeys = std::move(top_hotkeys);
+}
+
+std::vector<std::pair<std::string, double>> hotkey_collector::query_top_hotkeys(size_t count) const
+{
+    std::lock_guard<std::mutex> l(_top_hotkeys_lock);
+    return std::vector<std::pair<std::string, double>>(
+        _top_hotkeys.begin(), _top_hotkeys.begin() + std::min(count, _top_hotkeys.size()));
+}
+
 void hotkey_collector::on_start_detect(dsn::replication::detect_hotkey_response &resp)
 {
     auto now_state = _state.load();
@@ -21,11 +21,13 @@
 #include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "hotkey_collector_state.h"
+#include "hotkey_sketch.h"
 #include "replica/replica_base.h"
 #include "replica_admin_types.h"
 #include "utils/blob.h"
@@ -58,6 +60,10 @@ find_outlier_index(const std::vector<uint64_t> &captured_keys, int threshold, in
 //    was detected to be hot. The two types of hotkey, READ & WRITE, are detected
 //    separately.
 //
+//    Besides, all the captured hash keys are always counted by a hotkey_sketch if
+//    FLAGS_enable_hotkey_sketch is set, whose top keys in the latest analyse interval
+//    could be queried with their estimated qps at any time.
+//
 //    +--------------------+  +----------------------------------------------------+
 //    |   Replcia server   |  | Hotkey collector                                   |
 //    |                    |  | +-----------------------------------------------+  |
@@ -103,6 +109,9 @@ public:
     void analyse_data();
     void handle_rpc(const dsn::replication::detect_hotkey_request &req,
                     /*out*/ dsn::replication::detect_hotkey_response &resp);
+    // Returns at most `count` hottest hash keys with their estimated qps counted by the sketch
+    // in the latest analyse interval, in descending order of qps.
+    std::vector<std::pair<std::string, double>> query_top_hotkeys(size_t count) const;
 
 private:
     void on_start_detect(dsn::replication::detect_hotkey_response &resp);
@@ -117,6 +126,7 @@ private:
     bool terminate_if_timeout();
     std::shared_ptr<internal_collector_base> get_internal_collector_by_state();
     void change_state_by_result();
+    void rotate_sketch_window();
 
     const dsn::replication::hotkey_type::type _hotkey_type;
     detect_hotkey_result _result;
@@ -127,6 +137,13 @@ private:
     std::shared_ptr<hotkey_coarse_data_collector> _internal_coarse_collector;
     std::shared_ptr<hotkey_fine_data_collector> _internal_fine_collector;
 
+    hotkey_sketch _sketch;
+    // only accessed by analyse_data()
+    uint64_t _sketch_window_start_ms;
+    mutable std::mutex _top_hotkeys_lock;
+    // the hash keys with their estimated qps in the latest window of the sketch
+    std::vector<std::pair<std::string, double>> _top_hotkeys;
+
     friend class hotkey_collector_test;
 };
 
@@ -0,0 +1,161 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "hotkey_sketch.h"
+
+#include <boost/container_hash/extensions.hpp>
+#include <algorithm>
+#include <utility>
+
+#include "utils/fmt_logging.h"
+
+namespace pegasus {
+namespace server {
+
+size_t hotkey_sketch::string_view_hash::operator()(absl::string_view key) const
+{
+    return boost::hash_range(key.begin(), key.end());
+}
+
+hotkey_sketch::hotkey_sketch(uint32_t capacity) : _capacity(capacity)
+{
+    CHECK_GT(_capacity, 0);
+    _entries.reserve(_capacity);
+    _heap.reserve(_capacity);
+    _index.reserve(_capacity);
+}
+
+void hotkey_sketch::add(absl::string_view hash_key, uint64_t weight)
+{
+    std::unique_lock<std::mutex> l(_lock, std::try_to_lock);
+    if (!l.owns_lock()) {
+        return;
+    }
+
+    const auto iter = _index.find(hash_key);
+    if (iter != _index.end()) {
+        auto &e = _entries[iter->second];
+        e.count += weight;
+        sift_down(e.heap_index);
+        return;
+    }
+
+    if (_entries.size() < _capacity) {
+        const size_t index = _entries.size();
+        _entries.push_back({std::string(hash_key), weight, 0, _heap.size()});
+        _heap.push_back(index);
+        _index.emplace(_entries.back().hash_key, index);
+        sift_up(_entries.back().heap_index);
+        return;
+    }
+
+    // Take over the counter of the least counted key.
+    const size_t index = _heap.front();
+    auto &e = _entries[index];
+    _index.erase(e.hash_key);
+    e.hash_key.assign(hash_key.data(), hash_key.size());
+    e.error = e.count;
+    e.count += weight;
+    _index.emplace(e.hash_key, index);
+    sift_down(0);
+}
+
+std::vector<hotkey_sketch::hotkey_count> hotkey_sketch::top(size_t k) const
+{
+    std::lock_guard<std::mutex> l(_lock);
+    return top_locked(k);
+}
+
+std::vector<hotkey_sketch::hotkey_count> hotkey_sketch::take_top(size_t k)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    auto result = top_locked(k);
+    clear_locked();
+    return result;
+}
+
+void hotkey_sketch::clear()
+{
+    std::lock_guard<std::mutex> l(_lock);
+    clear_locked();
+}
+
+std::vector<hotkey_sketch::hotkey_count> hotkey_sketch::top_locked(size_t k) const
+{
+    std::vector<hotkey_count> result;
+    result.reserve(_entries.size());
+    for (const auto &e : _entries) {
+        result.push_back({e.hash_key, e.count, e.error});
+    }
+
+    k = std::min(k, result.size());
+    std::partial_sort(
+        result.begin(),
+        result.begin() + k,
+        result.end(),
+        [](const hotkey_count &lhs, const hotkey_count &rhs) { return lhs.count > rhs.count; });
+    result.resize(k);
+    return result;
+}
+
+void hotkey_sketch::clear_locked()
+{
+    // _index must be cleared before the keys it refers to.
+    _index.clear();
+    _heap.clear();
+    _entries.clear();
+}
+
+void hotkey_sketch::sift_up(size_t heap_index)
+{
+    while (heap_index > 0) {
+        const size_t parent = (heap_index - 1) / 2;
+        if (_entries[_heap[parent]].count <= _entries[_heap[heap_index]].count) {
+            break;
+        }
+        swap_heap_nodes(parent, heap_index);
+        heap_index = parent;
+    }
+}
+
+void hotkey_sketch::sift_down(size_t heap_index)
+{
+    while (true) {
+        size_t least = heap_index;
+        for (size_t child = heap_index * 2 + 1; child <= heap_index * 2 + 2; ++child) {
+            if (child < _heap.size() &&
+                _entries[_heap[child]].count < _entries[_heap[least]].count) {
+                least = child;
+            }
+        }
+        if (least == heap_index) {
+            break;
+        }
+        swap_heap_nodes(least, heap_index);
+        heap_index = least;
+    }
+}
+
+void hotkey_sketch::swap_heap_nodes(size_t i, size_t j)
+{
+    std::swap(_heap[i], _heap[j]);
+    _entries[_heap[i]].heap_index = i;
+    _entries[_heap[j]].heap_index = j;
+}
+
+} // namespace server
+} // namespace pegasus
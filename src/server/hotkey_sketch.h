@@ -0,0 +1,100 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace pegasus {
+namespace server {
+
+// hotkey_sketch finds the heavy hitters among the captured hash keys with the Space-Saving
+// algorithm: at most `capacity` keys are counted, and once they are all occupied, a new key takes
+// over the counter of the least counted key, whose count is kept as the max over-estimation
+// `error` of the new key. Any key counted more than total_weight / capacity is guaranteed to be
+// in the sketch.
+//
+// The counters are kept in a min-heap, thus each capture costs one hash lookup and O(log
+// capacity) swaps without copying the key unless it takes over a counter.
+//
+// Thread-safe. The capture is simply dropped if the sketch is being updated by another thread,
+// so that the read/write path is never blocked by the sketch.
+class hotkey_sketch
+{
+public:
+    struct hotkey_count
+    {
+        std::string hash_key;
+        uint64_t count;
+        // the max over-estimation of `count`
+        uint64_t error;
+    };
+
+    explicit hotkey_sketch(uint32_t capacity);
+
+    void add(absl::string_view hash_key, uint64_t weight);
+
+    // Returns the `k` most counted keys in descending order of their counts.
+    std::vector<hotkey_count> top(size_t k) const;
+    // Like top(), while the sketch is cleared atomically to count a new window.
+    std::vector<hotkey_count> take_top(size_t k);
+
+    void clear();
+
+    uint32_t capacity() const { return _capacity; }
+
+private:
+    struct entry
+    {
+        std::string hash_key;
+        uint64_t count;
+        uint64_t error;
+        // the index of this entry in _heap
+        size_t heap_index;
+    };
+
+    struct string_view_hash
+    {
+        size_t operator()(absl::string_view key) const;
+    };
+
+    std::vector<hotkey_count> top_locked(size_t k) const;
+    void clear_locked();
+    void sift_up(size_t heap_index);
+    void sift_down(size_t heap_index);
+    void swap_heap_nodes(size_t i, size_t j);
+
+    const uint32_t _capacity;
+
+    mutable std::mutex _lock;
+    // reserved with `_capacity` entries at construction, thus never reallocated, and the keys of
+    // _index could refer to the hash keys of the entries
+    std::vector<entry> _entries;
+    // the indexes of _entries ordered as a min-heap by their counts
+    std::vector<size_t> _heap;
+    std::unordered_map<absl::string_view, size_t, string_view_hash> _index;
+};
+
+} // namespace server
+} // namespace pegasus
@@ -25,12 +25,18 @@
 #include "absl/strings/string_view.h"
 #include "client/replication_ddl_client.h"
 #include "common/gpid.h"
+#include "common/replication_other_types.h"
 #include "common/serialization_helper/dsn.layer2_types.h"
+#include "meta/load_balance_policy.h"
+#include "meta_admin_types.h"
+#include "partition_split_types.h"
 #include "perf_counter/perf_counter.h"
+#include "runtime/api_layer1.h"
 #include "runtime/rpc/rpc_host_port.h"
 #include "server/hotspot_partition_stat.h"
 #include "shell/command_executor.h"
 #include "utils/error_code.h"
+#include "utils/errors.h"
 #include "utils/fail_point.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
@@ -63,11 +69,74 @@ DSN_DEFINE_uint32(pegasus.collector,
                   "hot paritiotion occurrence times' threshold to send rpc to detect hotkey");
 DSN_TAG_VARIABLE(occurrence_threshold, FT_MUTABLE);
 
+DSN_DEFINE_bool(pegasus.collector,
+                enable_hotspot_remediation,
+                false,
+                "auto remediate the sustained hotspots: move the primary of a read hot partition "
+                "to one of its secondaries, or split the table whose partitions are all write hot");
+DSN_TAG_VARIABLE(enable_hotspot_remediation, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.collector,
+                  hotspot_remediation_table_interval_seconds,
+                  1800,
+                  "the min interval seconds between 2 hotspot remediations of the same table");
+DSN_TAG_VARIABLE(hotspot_remediation_table_interval_seconds, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.collector,
+                  max_hotspot_remediations_per_hour,
+                  6,
+                  "the max count of the hotspot remediations of all the tables in one hour");
+DSN_TAG_VARIABLE(max_hotspot_remediations_per_hour, FT_MUTABLE);
+
+DSN_DEFINE_uint64(pegasus.collector,
+                  hotspot_split_write_qps_threshold,
+                  0,
+                  "a table is considered as write hot once the mean write qps of its partitions "
+                  "often exceeds this threshold, which would be split by the hotspot "
+                  "remediation. 0 means never split the tables automatically");
+DSN_TAG_VARIABLE(hotspot_split_write_qps_threshold, FT_MUTABLE);
+
+DSN_DEFINE_uint32(pegasus.collector,
+                  hotspot_split_max_partition_count,
+                  256,
+                  "the hotspot remediation never splits a table into more partitions than this");
+DSN_TAG_VARIABLE(hotspot_split_max_partition_count, FT_MUTABLE);
+
 struct row_data;
 
 namespace pegasus {
 namespace server {
 
+bool hotspot_remediation_limiter::try_acquire(const std::string &app_name, uint64_t now_s)
+{
+    static const uint64_t kOneHourSeconds = 3600;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    while (!_recent_remediations_s.empty() &&
+           _recent_remediations_s.front() + kOneHourSeconds <= now_s) {
+        _recent_remediations_s.pop_front();
+    }
+    if (_recent_remediations_s.size() >= FLAGS_max_hotspot_remediations_per_hour) {
+        LOG_WARNING("skip the hotspot remediation of {}: {} remediations in the last hour",
+                    app_name,
+                    _recent_remediations_s.size());
+        return false;
+    }
+
+    const auto iter = _last_remediation_s.find(app_name);
+    if (iter != _last_remediation_s.end() &&
+        iter->second + FLAGS_hotspot_remediation_table_interval_seconds > now_s) {
+        LOG_WARNING("skip the hotspot remediation of {}: it has been remediated {} seconds ago",
+                    app_name,
+                    now_s - iter->second);
+        return false;
+    }
+
+    _recent_remediations_s.push_back(now_s);
+    _last_remediation_s[app_name] = now_s;
+    return true;
+}
+
 void hotspot_partition_calculator::data_aggregate(const std::vector<row_data> &partition_stats)
 {
     while (_partitions_stat_histories.size() >= FLAGS_max_hotspot_store_size) {
@@ -173,32 +242,25 @@ void hotspot_partition_calculator::data_analyse()
     stat_histories_analyse(WRITE_HOTSPOT_DATA, write_hot_points);
     update_hot_point(WRITE_HOTSPOT_DATA, write_hot_points);
 
-    if (!FLAGS_enable_detect_hotkey) {
-        return;
+    update_hotpartition_counter(READ_HOTSPOT_DATA);
+    update_hotpartition_counter(WRITE_HOTSPOT_DATA);
+    update_write_hot_table_counter();
+
+    if (FLAGS_enable_detect_hotkey) {
+        detect_hotkey_in_hotpartition(READ_HOTSPOT_DATA);
+        detect_hotkey_in_hotpartition(WRITE_HOTSPOT_DATA);
     }
 
-    detect_hotkey_in_hotpartition(READ_HOTSPOT_DATA);
-    detect_hotkey_in_hotpartition(WRITE_HOTSPOT_DATA);
+    if (FLAGS_enable_hotspot_remediation) {
+        remediate_hotspots();
+    }
 }
 
-void hotspot_partition_calculator::detect_hotkey_in_hotpartition(int data_type)
+void hotspot_partition_calculator::update_hotpartition_counter(int data_type)
 {
-    auto now_hot_partition_threshold = FLAGS_hot_partition_threshold;
-    auto now_occurrence_threshold = FLAGS_occurrence_threshold;
     for (int index = 0; index < _hot_points.size(); index++) {
-        if (_hot_points[index][data_type].get()->get_value() >= now_hot_partition_threshold) {
-            if (++_hotpartition_counter[index][data_type] >= now_occurrence_threshold) {
-                LOG_ERROR("Find a {} hot partition {}.{}",
-                          (data_type == partition_qps_type::READ_HOTSPOT_DATA ? "read" : "write"),
-                          _app_name,
-                          index);
-                send_detect_hotkey_request(_app_name,
-                                           index,
-                                           (data_type == dsn::replication::hotkey_type::type::READ)
-                                               ? dsn::replication::hotkey_type::type::READ
-                                               : dsn::replication::hotkey_type::type::WRITE,
-                                           dsn::replication::detect_action::type::START);
-            }
+        if (_hot_points[index][data_type].get()->get_value() >= FLAGS_hot_partition_threshold) {
+            ++_hotpartition_counter[index][data_type];
         } else {
             _hotpartition_counter[index][data_type] =
                 std::max(_hotpartition_counter[index][data_type] - 1, 0);
@@ -206,6 +268,186 @@ void hotspot_partition_calculator::detect_hotkey_in_hotpartition(int data_type)
     }
 }
 
+void hotspot_partition_calculator::update_write_hot_table_counter()
+{
+    double write_qps_sum = 0;
+    const auto &anly_data = _partitions_stat_histories.back();
+    for (const auto &partition_stat : anly_data) {
+        write_qps_sum += partition_stat.total_qps[WRITE_HOTSPOT_DATA];
+    }
+    if (FLAGS_hotspot_split_write_qps_threshold > 0 && !anly_data.empty() &&
+        write_qps_sum / anly_data.size() >= FLAGS_hotspot_split_write_qps_threshold) {
+        ++_write_hot_table_counter;
+    } else {
+        _write_hot_table_counter = std::max(_write_hot_table_counter - 1, 0);
+    }
+}
+
+bool hotspot_partition_calculator::is_sustained_hotspot(int partition_index, int data_type) const
+{
+    return _hot_points[partition_index][data_type].get()->get_value() >=
+               FLAGS_hot_partition_threshold &&
+           _hotpartition_counter[partition_index][data_type] >= FLAGS_occurrence_threshold;
+}
+
+void hotspot_partition_calculator::detect_hotkey_in_hotpartition(int data_type)
+{
+    for (int index = 0; index < _hot_points.size(); index++) {
+        if (!is_sustained_hotspot(index, data_type)) {
+            continue;
+        }
+        LOG_ERROR("Find a {} hot partition {}.{}",
+                  (data_type == partition_qps_type::READ_HOTSPOT_DATA ? "read" : "write"),
+                  _app_name,
+                  index);
+        send_detect_hotkey_request(_app_name,
+                                   index,
+                                   (data_type == dsn::replication::hotkey_type::type::READ)
+                                       ? dsn::replication::hotkey_type::type::READ
+                                       : dsn::replication::hotkey_type::type::WRITE,
+                                   dsn::replication::detect_action::type::START);
+    }
+}
+
+void hotspot_partition_calculator::remediate_hotspots()
+{
+    const bool write_hot_table = _write_hot_table_counter >= FLAGS_occurrence_threshold;
+    bool has_read_hotspot = false;
+    for (int index = 0; index < _hot_points.size(); index++) {
+        if (is_sustained_hotspot(index, READ_HOTSPOT_DATA)) {
+            has_read_hotspot = true;
+            break;
+        }
+    }
+    if (!write_hot_table && !has_read_hotspot) {
+        return;
+    }
+
+    FAIL_POINT_INJECT_F("remediate_hotspots", [](absl::string_view) {});
+
+    int32_t app_id = 0;
+    int32_t partition_count = 0;
+    std::vector<dsn::partition_configuration> partitions;
+    const auto err =
+        _shell_context->ddl_client->list_app(_app_name, app_id, partition_count, partitions);
+    if (err != dsn::ERR_OK) {
+        LOG_ERROR("list app {} failed for the hotspot remediation, error = {}", _app_name, err);
+        return;
+    }
+    if (partition_count != _hot_points.size()) {
+        LOG_WARNING("the partition count of {} has been changed from {} to {}, skip the hotspot "
+                    "remediation",
+                    _app_name,
+                    _hot_points.size(),
+                    partition_count);
+        return;
+    }
+
+    if (write_hot_table && partition_count * 2 <= FLAGS_hotspot_split_max_partition_count) {
+        if (_remediation_limiter->try_acquire(_app_name, dsn_now_s())) {
+            propose_partition_split(partition_count);
+        }
+        return;
+    }
+
+    int partition_index = -1;
+    dsn::host_port from;
+    dsn::host_port to;
+    if (!find_read_hotspot_move(partitions, partition_index, from, to)) {
+        LOG_INFO("no primary of the read hot partitions of {} could be moved", _app_name);
+        return;
+    }
+    if (_remediation_limiter->try_acquire(_app_name, dsn_now_s())) {
+        propose_move_primary(app_id, partition_index, from, to);
+    }
+}
+
+bool hotspot_partition_calculator::find_read_hotspot_move(
+    const std::vector<dsn::partition_configuration> &partitions,
+    /*out*/ int &partition_index,
+    /*out*/ dsn::host_port &from,
+    /*out*/ dsn::host_port &to) const
+{
+    CHECK_EQ(partitions.size(), _hot_points.size());
+
+    // the read qps of the table on each node, which is served by the primaries
+    const auto &anly_data = _partitions_stat_histories.back();
+    std::map<dsn::host_port, double> node_read_qps;
+    for (int i = 0; i < partitions.size(); i++) {
+        if (partitions[i].hp_primary) {
+            node_read_qps[partitions[i].hp_primary] += anly_data[i].total_qps[READ_HOTSPOT_DATA];
+        }
+    }
+
+    double best_qps = 0;
+    partition_index = -1;
+    for (int i = 0; i < partitions.size(); i++) {
+        const double qps = anly_data[i].total_qps[READ_HOTSPOT_DATA];
+        if (!is_sustained_hotspot(i, READ_HOTSPOT_DATA) || !partitions[i].hp_primary ||
+            (partition_index >= 0 && qps <= best_qps)) {
+            continue;
+        }
+
+        const auto &primary = partitions[i].hp_primary;
+        for (const auto &secondary : partitions[i].hp_secondaries) {
+            const auto iter = node_read_qps.find(secondary);
+            const double secondary_qps = iter == node_read_qps.end() ? 0 : iter->second;
+            if (secondary_qps + qps >= node_read_qps[primary]) {
+                continue;
+            }
+            if (partition_index == i && secondary_qps >= node_read_qps[to]) {
+                continue;
+            }
+            partition_index = i;
+            best_qps = qps;
+            from = primary;
+            to = secondary;
+        }
+    }
+    return partition_index >= 0;
+}
+
+void hotspot_partition_calculator::propose_move_primary(int32_t app_id,
+                                                        int partition_index,
+                                                        const dsn::host_port &from,
+                                                        const dsn::host_port &to)
+{
+    dsn::replication::configuration_balancer_request request;
+    request.gpid = dsn::gpid(app_id, partition_index);
+    request.action_list = {
+        dsn::replication::new_proposal_action(
+            from, from, dsn::replication::config_type::CT_DOWNGRADE_TO_SECONDARY),
+        dsn::replication::new_proposal_action(
+            to, to, dsn::replication::config_type::CT_UPGRADE_TO_PRIMARY)};
+    request.__set_balance_type(dsn::replication::balancer_request_type::move_primary);
+    request.__set_reason(
+        fmt::format("sustained read hotspot of {}.{}", _app_name, partition_index));
+
+    const auto err = _shell_context->ddl_client->send_balancer_proposal(request);
+    LOG_WARNING("move the primary of the read hot partition {}.{} from {} to {}, error = {}",
+                _app_name,
+                partition_index,
+                from,
+                to,
+                err);
+}
+
+void hotspot_partition_calculator::propose_partition_split(int32_t partition_count)
+{
+    const auto reason =
+        fmt::format("the mean write qps of the partitions of {} has often exceeded {}",
+                    _app_name,
+                    FLAGS_hotspot_split_write_qps_threshold);
+    const auto resp = _shell_context->ddl_client->start_partition_split(
+        _app_name, partition_count * 2, reason);
+    const auto err = resp.is_ok() ? resp.get_value().err : resp.get_error().code();
+    LOG_WARNING("split the write hot table {} from {} to {} partitions, error = {}",
+                _app_name,
+                partition_count,
+                partition_count * 2,
+                err);
+}
+
 void hotspot_partition_calculator::send_detect_hotkey_request(
     const std::string &app_name,
     const uint64_t partition_index,
@@ -19,9 +19,13 @@
 
 #include <stdint.h>
 #include <array>
+#include <deque>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "hotspot_partition_stat.h"
@@ -32,6 +36,11 @@
 struct row_data;
 struct shell_context;
 
+namespace dsn {
+class host_port;
+class partition_configuration;
+} // namespace dsn
+
 namespace pegasus {
 namespace server {
 
@@ -42,17 +51,38 @@ typedef std::list<std::vector<hotspot_partition_stat>> stat_histories;
 // read/write hotspot value
 typedef std::vector<std::array<dsn::perf_counter_wrapper, 2>> hot_partition_counters;
 
+// hotspot_remediation_limiter limits the rate of the automatic hotspot remediations of all the
+// tables, which is shared by the hotspot_partition_calculators of the collector.
+class hotspot_remediation_limiter
+{
+public:
+    // Returns true and records the remediation if `app_name` could be remediated at `now_s`:
+    // the table has not been remediated in the last
+    // FLAGS_hotspot_remediation_table_interval_seconds, and less than
+    // FLAGS_max_hotspot_remediations_per_hour remediations have been made in the last hour.
+    bool try_acquire(const std::string &app_name, uint64_t now_s);
+
+private:
+    std::mutex _lock;
+    // the time of the remediations in the last hour
+    std::deque<uint64_t> _recent_remediations_s;
+    std::map<std::string, uint64_t> _last_remediation_s;
+};
+
 // hotspot_partition_calculator is used to find the hot partition in a table.
 class hotspot_partition_calculator
 {
 public:
     hotspot_partition_calculator(const std::string &app_name,
                                  int partition_count,
-                                 std::shared_ptr<shell_context> context)
+                                 std::shared_ptr<shell_context> context,
+                                 std::shared_ptr<hotspot_remediation_limiter> limiter = nullptr)
         : _app_name(app_name),
           _hot_points(partition_count),
           _shell_context(context),
-          _hotpartition_counter(partition_count)
+          _hotpartition_counter(partition_count),
+          _remediation_limiter(limiter ? std::move(limiter)
+                                       : std::make_shared<hotspot_remediation_limiter>())
     {
         init_perf_counter(partition_count);
     }
@@ -71,8 +101,33 @@ private:
     void stat_histories_analyse(uint32_t data_type, std::vector<int> &hot_points);
     // set hot_point to corresponding perf_counter
     void update_hot_point(uint32_t data_type, const std::vector<int> &hot_points);
+    void update_hotpartition_counter(int data_type);
+    void update_write_hot_table_counter();
+    // a partition is a sustained hotspot once it has been hot for FLAGS_occurrence_threshold
+    // times more than it has not
+    bool is_sustained_hotspot(int partition_index, int data_type) const;
     void detect_hotkey_in_hotpartition(int data_type);
 
+    // Remediate the sustained hotspots of the table if allowed by _remediation_limiter:
+    // - split the table if all of its partitions are write hot, since the write hotspot of
+    //   some isolated partitions is usually caused by the hot keys, which could not be relieved
+    //   by splitting;
+    // - otherwise move the primary of a read hot partition to one of its secondaries.
+    void remediate_hotspots();
+    // Find the sustained read hot partition whose primary could be moved from the node `from`
+    // to one of its secondaries `to` so that the max read qps of the table on the 2 nodes would
+    // be reduced. The hottest partition is preferred, and the secondary on which the read qps
+    // of the table is the least is chosen.
+    bool find_read_hotspot_move(const std::vector<dsn::partition_configuration> &partitions,
+                                /*out*/ int &partition_index,
+                                /*out*/ dsn::host_port &from,
+                                /*out*/ dsn::host_port &to) const;
+    void propose_move_primary(int32_t app_id,
+                              int partition_index,
+                              const dsn::host_port &from,
+                              const dsn::host_port &to);
+    void propose_partition_split(int32_t partition_count);
+
     const std::string _app_name;
     void init_perf_counter(int perf_counter_count);
     // usually a partition with "hot-point value" >= 3 can be considered as a hotspot partition.
@@ -91,6 +146,12 @@ private:
     // hotkey on the replica automatically
     std::vector<std::array<int, 2>> _hotpartition_counter;
 
+    // like _hotpartition_counter, it's a counter to find whether the mean write qps of all the
+    // partitions often exceeds FLAGS_hotspot_split_write_qps_threshold
+    int _write_hot_table_counter = 0;
+
+    std::shared_ptr<hotspot_remediation_limiter> _remediation_limiter;
+
     typedef dsn::rpc_holder<detect_hotkey_request, detect_hotkey_response> detect_hotkey_rpc;
 
     friend class hotspot_partition_test;
@@ -87,6 +87,7 @@ info_collector::info_collector()
     _shell_context->current_cluster_name = _cluster_name;
     _shell_context->meta_list = meta_servers;
     _shell_context->ddl_client.reset(new replication_ddl_client(meta_servers));
+    _hotspot_remediation_limiter = std::make_shared<hotspot_remediation_limiter>();
 
     // initialize the _client.
     CHECK(pegasus_client_factory::initialize(nullptr), "Initialize the pegasus client failed");
@@ -341,8 +342,8 @@ info_collector::get_hotspot_calculator(const std::string &app_name, const int pa
     if (iter != _hotspot_calculator_store.end()) {
         return iter->second;
     }
-    auto calculator =
-        std::make_shared<hotspot_partition_calculator>(app_name, partition_count, _shell_context);
+    auto calculator = std::make_shared<hotspot_partition_calculator>(
+        app_name, partition_count, _shell_context, _hotspot_remediation_limiter);
     _hotspot_calculator_store[app_name_pcount] = calculator;
     return calculator;
 }
@@ -43,6 +43,7 @@ class pegasus_client;
 namespace server {
 
 class hotspot_partition_calculator;
+class hotspot_remediation_limiter;
 class result_writer;
 
 class info_collector
@@ -237,6 +238,8 @@ private:
     // hotspot_partition_calculator saves historical hotspot data and alert perf_counters of
     // corresponding table
     std::map<std::string, std::shared_ptr<hotspot_partition_calculator>> _hotspot_calculator_store;
+    // limit the rate of the hotspot remediations of all the tables
+    std::shared_ptr<hotspot_remediation_limiter> _hotspot_remediation_limiter;
     std::shared_ptr<hotspot_partition_calculator>
     get_hotspot_calculator(const std::string &app_name, const int partition_count);
 };
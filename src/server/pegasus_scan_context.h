@@ -25,6 +25,7 @@
 #include "utils/rand.h"
 #include <rrdb/rrdb_types.h>
 
+#include "base/pegasus_scan_stat.h"
 #include "base/pegasus_utils.h"
 
 namespace pegasus {
@@ -43,7 +44,9 @@ struct pegasus_scan_context
                          bool no_value_,
                          bool validate_partition_hash_,
                          bool return_expire_ts_,
-                         bool only_return_count_)
+                         bool only_return_count_,
+                         bool return_stat_,
+                         scan_stat_cursor &&stat_cursor_)
         : _stop_holder(std::move(stop_)),
           _hash_key_filter_pattern_holder(std::move(hash_key_filter_pattern_)),
           _sort_key_filter_pattern_holder(std::move(sort_key_filter_pattern_)),
@@ -60,7 +63,9 @@ struct pegasus_scan_context
           no_value(no_value_),
           validate_partition_hash(validate_partition_hash_),
           return_expire_ts(return_expire_ts_),
-          only_return_count(only_return_count_)
+          only_return_count(only_return_count_),
+          return_stat(return_stat_),
+          stat_cursor(std::move(stat_cursor_))
     {
     }
 
@@ -86,6 +91,8 @@ public:
     bool validate_partition_hash;
     bool return_expire_ts;
     bool only_return_count;
+    bool return_stat;
+    scan_stat_cursor stat_cursor;
 };
 
 class pegasus_context_cache
@@ -1250,6 +1250,12 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
 
     bool return_expire_ts = request.__isset.return_expire_ts ? request.return_expire_ts : false;
     bool only_return_count = request.__isset.only_return_count ? request.only_return_count : false;
+    bool return_stat = only_return_count && request.__isset.return_stat && request.return_stat;
+    scan_stat_cursor stat_cursor;
+    ::dsn::apps::scan_stat stat;
+    if (return_stat) {
+        init_scan_stat(stat);
+    }
 
     std::unique_ptr<range_read_limiter> limiter =
         std::make_unique<range_read_limiter>(_rng_rd_opts.rocksdb_max_iteration_count,
@@ -1291,6 +1297,8 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
             if (!only_return_count) {
                 append_key_value(
                     resp.kvs, it->key(), it->value(), request.no_value, return_expire_ts);
+            } else if (return_stat) {
+                add_scan_stat(it->key(), it->value(), epoch_now, stat_cursor, stat);
             }
             break;
         case range_iteration_state::kExpired:
@@ -1313,6 +1321,9 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
     }
     if (only_return_count) {
         resp.__set_kv_count(count);
+        if (return_stat) {
+            resp.__set_stat(std::move(stat));
+        }
     }
 
     // check iteration time whether exceed limit
@@ -1366,7 +1377,9 @@ void pegasus_server_impl::on_get_scanner(get_scanner_rpc rpc)
             request.no_value,
             request.__isset.validate_partition_hash ? request.validate_partition_hash : true,
             return_expire_ts,
-            only_return_count));
+            only_return_count,
+            return_stat,
+            std::move(stat_cursor)));
         int64_t handle = _context_cache.put(std::move(context));
         resp.context_id = handle;
         // if the context is used, it will be fetched and re-put into cache,
@@ -1422,6 +1435,10 @@ void pegasus_server_impl::on_scan(scan_rpc rpc)
         uint64_t expire_count = 0;
         uint64_t filter_count = 0;
         int32_t count = 0;
+        ::dsn::apps::scan_stat stat;
+        if (context->return_stat) {
+            init_scan_stat(stat);
+        }
 
         uint32_t batch_count = _rng_rd_opts.rocksdb_max_iteration_count;
         if (context->batch_size > 0 && context->batch_size < batch_count) {
@@ -1455,6 +1472,8 @@ void pegasus_server_impl::on_scan(scan_rpc rpc)
                 count++;
                 if (!context->only_return_count) {
                     append_key_value(resp.kvs, it->key(), it->value(), no_value, return_expire_ts);
+                } else if (context->return_stat) {
+                    add_scan_stat(it->key(), it->value(), epoch_now, context->stat_cursor, stat);
                 }
                 break;
             case range_iteration_state::kExpired:
@@ -1478,6 +1497,9 @@ void pegasus_server_impl::on_scan(scan_rpc rpc)
 
         if (context->only_return_count) {
             resp.__set_kv_count(count);
+            if (context->return_stat) {
+                resp.__set_stat(std::move(stat));
+            }
         }
 
         // check iteration time whether exceed limit
@@ -2430,6 +2452,29 @@ void pegasus_server_impl::append_key_value(std::vector<::dsn::apps::key_value> &
     kvs.emplace_back(std::move(kv));
 }
 
+void pegasus_server_impl::add_scan_stat(const rocksdb::Slice &key,
+                                        const rocksdb::Slice &value,
+                                        uint32_t epoch_now,
+                                        scan_stat_cursor &cursor,
+                                        ::dsn::apps::scan_stat &stat)
+{
+    ::dsn::blob raw_key(key.data(), 0, key.size());
+    ::dsn::blob hash_key, sort_key;
+    pegasus_restore_key(raw_key, hash_key, sort_key);
+
+    auto raw_value = utils::to_string_view(value);
+    uint32_t expire_ts = pegasus_extract_expire_ts(_pegasus_data_version, raw_value);
+    // The expired records have been skipped, so the ttl is positive if the record has one.
+    uint32_t ttl_seconds = expire_ts > 0 ? expire_ts - epoch_now : 0;
+
+    add_scan_stat_row(hash_key.to_string_view(),
+                      sort_key.length(),
+                      pegasus_extract_user_data_length(_pegasus_data_version, raw_value),
+                      ttl_seconds,
+                      cursor,
+                      stat);
+}
+
 range_iteration_state pegasus_server_impl::append_key_value_for_multi_get(
     std::vector<::dsn::apps::key_value> &kvs,
     const rocksdb::Slice &key,
@@ -3500,6 +3545,9 @@ void pegasus_server_impl::set_ingestion_status(dsn::replication::ingestion_statu
     LOG_INFO_PREFIX("ingestion status from {} to {}",
                     dsn::enum_to_string(_ingestion_status),
                     dsn::enum_to_string(status));
+    if (status != dsn::replication::ingestion_status::IS_FAILED) {
+        _ingestion_partially_applied = false;
+    }
     _ingestion_status = status;
 }
 
@@ -3534,5 +3582,31 @@ dsn::replication::manual_compaction_status::type pegasus_server_impl::query_comp
     return _manual_compact_svc.query_compact_status();
 }
 
+bool pegasus_server_impl::query_load_stats(dsn::replication::replica_load_stats &stats) const
+{
+    if (_cu_calculator == nullptr) {
+        return false;
+    }
+
+    _cu_calculator->query_load_stats(stats);
+    static const int64_t bytes_per_mb = 1L << 20;
+    stats.storage_bytes = METRIC_VAR_VALUE(rdb_total_sst_size_mb) * bytes_per_mb;
+    return true;
+}
+
+void pegasus_server_impl::query_top_hotkeys(
+    dsn::replication::hotkey_type::type type,
+    size_t count,
+    std::vector<std::pair<std::string, double>> &hotkeys) const
+{
+    const auto &collector = type == dsn::replication::hotkey_type::READ ? _read_hotkey_collector
+                                                                        : _write_hotkey_collector;
+    hotkeys = collector->query_top_hotkeys(count);
+    // Hot keys should not be redacted, see hotkey_collector::query_result().
+    for (auto &hotkey : hotkeys) {
+        hotkey.first = pegasus::utils::c_escape_string(hotkey.first);
+    }
+}
+
 } // namespace server
 } // namespace pegasus
@@ -41,6 +41,7 @@
 #include "metadata_types.h"
 #include "pegasus_manual_compact_service.h"
 #include "pegasus_read_service.h"
+#include "pegasus_scan_stat.h"
 #include "pegasus_scan_context.h"
 #include "pegasus_utils.h"
 #include "pegasus_value_schema.h"
@@ -241,6 +242,8 @@ public:
         return _ingestion_status;
     }
 
+    bool is_ingestion_partially_applied() override { return _ingestion_partially_applied; }
+
 private:
     friend class manual_compact_service_test;
     friend class pegasus_compression_options_test;
@@ -272,6 +275,13 @@ private:
                           bool no_value,
                           bool request_expire_ts);
 
+    // Accumulates a record hit by a count-only scan into the statistics returned to client.
+    void add_scan_stat(const rocksdb::Slice &key,
+                       const rocksdb::Slice &value,
+                       uint32_t epoch_now,
+                       scan_stat_cursor &cursor,
+                       ::dsn::apps::scan_stat &stat);
+
     range_iteration_state
     validate_key_value_for_scan(const rocksdb::Slice &key,
                                 const rocksdb::Slice &value,
@@ -464,6 +474,13 @@ private:
 
     dsn::replication::manual_compaction_status::type query_compact_status() const override;
 
+    bool query_load_stats(dsn::replication::replica_load_stats &stats) const override;
+
+    void
+    query_top_hotkeys(dsn::replication::hotkey_type::type type,
+                      size_t count,
+                      std::vector<std::pair<std::string, double>> &hotkeys) const override;
+
     // Log expired keys for verbose mode.
     void log_expired_data(const char *op,
                           const dsn::rpc_address &addr,
@@ -534,6 +551,7 @@ private:
 
     dsn::replication::ingestion_status::type _ingestion_status{
         dsn::replication::ingestion_status::IS_INVALID};
+    bool _ingestion_partially_applied{false};
 
     dsn::task_tracker _tracker;
 
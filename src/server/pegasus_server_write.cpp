@@ -35,6 +35,7 @@
 #include "rrdb/rrdb.code.definition.h"
 #include "runtime/rpc/rpc_holder.h"
 #include "runtime/rpc/rpc_message.h"
+#include "runtime/task/task_spec.h"
 #include "server/pegasus_write_service.h"
 #include "utils/autoref_ptr.h"
 #include "utils/blob.h"
@@ -47,6 +48,14 @@ METRIC_DEFINE_counter(replica,
                       dsn::metric_unit::kRequests,
                       "The number of corrupt writes for each replica");
 
+DSN_DEFINE_bool(pegasus.server,
+                batch_atomic_writes,
+                false,
+                "Whether the primary could batch the atomic writes (MULTI_PUT, MULTI_REMOVE, INCR, "
+                "CHECK_AND_SET and CHECK_AND_MUTATE) with other writes into a single mutation. It "
+                "should not be enabled until all the replica servers have been upgraded to the "
+                "version which could apply the batched atomic writes");
+
 DSN_DECLARE_bool(rocksdb_verbose_log);
 
 namespace pegasus {
@@ -60,6 +69,21 @@ pegasus_server_write::pegasus_server_write(pegasus_server_impl *server)
     init_non_batch_write_handlers();
 }
 
+/*static*/ void pegasus_server_write::register_batchable_atomic_writes()
+{
+    if (!FLAGS_batch_atomic_writes) {
+        return;
+    }
+
+    for (const auto &code : {dsn::apps::RPC_RRDB_RRDB_MULTI_PUT,
+                             dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE,
+                             dsn::apps::RPC_RRDB_RRDB_INCR,
+                             dsn::apps::RPC_RRDB_RRDB_CHECK_AND_SET,
+                             dsn::apps::RPC_RRDB_RRDB_CHECK_AND_MUTATE}) {
+        dsn::task_spec::get(code)->rpc_request_is_write_allow_batch = true;
+    }
+}
+
 int pegasus_server_write::on_batched_write_requests(dsn::message_ex **requests,
                                                     int count,
                                                     int64_t decree,
@@ -76,9 +100,10 @@ int pegasus_server_write::on_batched_write_requests(dsn::message_ex **requests,
     }
 
     try {
+        // The atomic writes are executed without batch unless they are batched with others,
+        // while the other non-batch writes are checked by on_batched_writes().
         auto iter = _non_batch_write_handlers.find(requests[0]->rpc_code());
-        if (iter != _non_batch_write_handlers.end()) {
-            CHECK_EQ(count, 1);
+        if (iter != _non_batch_write_handlers.end() && count == 1) {
             return iter->second(requests[0]);
         }
     } catch (TTransportException &ex) {
@@ -96,35 +121,31 @@ void pegasus_server_write::set_default_ttl(uint32_t ttl) { _write_svc->set_defau
 
 int pegasus_server_write::on_batched_writes(dsn::message_ex **requests, int count)
 {
+    // The records written by the batch should be tracked once any write in the batch
+    // reads the records before writing them.
+    bool read_your_writes = false;
+    for (int i = 0; i < count; ++i) {
+        CHECK_NOTNULL(requests[i], "request[{}] is null", i);
+        dsn::task_code rpc_code(requests[i]->rpc_code());
+        if (rpc_code == dsn::apps::RPC_RRDB_RRDB_INCR ||
+            rpc_code == dsn::apps::RPC_RRDB_RRDB_CHECK_AND_SET ||
+            rpc_code == dsn::apps::RPC_RRDB_RRDB_CHECK_AND_MUTATE) {
+            read_your_writes = true;
+            break;
+        }
+    }
+
     int err = rocksdb::Status::kOk;
     {
-        _write_svc->batch_prepare(_decree);
+        _write_svc->batch_prepare(_decree, read_your_writes);
 
         for (int i = 0; i < count; ++i) {
-            CHECK_NOTNULL(requests[i], "request[{}] is null", i);
-
             // Make sure all writes are batched even if they are failed,
             // since we need to record the total qps and rpc latencies,
             // and respond for all RPCs regardless of their result.
             int local_err = rocksdb::Status::kOk;
             try {
-                dsn::task_code rpc_code(requests[i]->rpc_code());
-                if (rpc_code == dsn::apps::RPC_RRDB_RRDB_PUT) {
-                    auto rpc = put_rpc::auto_reply(requests[i]);
-                    local_err = on_single_put_in_batch(rpc);
-                    _put_rpc_batch.emplace_back(std::move(rpc));
-                } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_REMOVE) {
-                    auto rpc = remove_rpc::auto_reply(requests[i]);
-                    local_err = on_single_remove_in_batch(rpc);
-                    _remove_rpc_batch.emplace_back(std::move(rpc));
-                } else {
-                    if (_non_batch_write_handlers.find(rpc_code) !=
-                        _non_batch_write_handlers.end()) {
-                        LOG_FATAL("rpc code not allow batch: {}", rpc_code);
-                    } else {
-                        LOG_FATAL("rpc code not handled: {}", rpc_code);
-                    }
-                }
+                local_err = on_single_write_in_batch(requests[i]);
             } catch (TTransportException &ex) {
                 METRIC_VAR_INCREMENT(corrupt_writes);
                 LOG_ERROR_PREFIX("pegasus batch writes handler failed, from = {}, exception = {}",
@@ -137,8 +158,11 @@ int pegasus_server_write::on_batched_writes(dsn::message_ex **requests, int coun
             }
         }
 
-        if (dsn_unlikely(err != rocksdb::Status::kOk ||
-                         (_put_rpc_batch.empty() && _remove_rpc_batch.empty()))) {
+        const bool empty_batch = _put_rpc_batch.empty() && _remove_rpc_batch.empty() &&
+                                 _multi_put_rpc_batch.empty() && _multi_remove_rpc_batch.empty() &&
+                                 _incr_rpc_batch.empty() && _check_and_set_rpc_batch.empty() &&
+                                 _check_and_mutate_rpc_batch.empty();
+        if (dsn_unlikely(err != rocksdb::Status::kOk || empty_batch)) {
             _write_svc->batch_abort(_decree, err == rocksdb::Status::kOk ? -1 : err);
         } else {
             err = _write_svc->batch_commit(_decree);
@@ -148,6 +172,51 @@ int pegasus_server_write::on_batched_writes(dsn::message_ex **requests, int coun
     // reply the batched RPCs
     _put_rpc_batch.clear();
     _remove_rpc_batch.clear();
+    _multi_put_rpc_batch.clear();
+    _multi_remove_rpc_batch.clear();
+    _incr_rpc_batch.clear();
+    _check_and_set_rpc_batch.clear();
+    _check_and_mutate_rpc_batch.clear();
+    return err;
+}
+
+int pegasus_server_write::on_single_write_in_batch(dsn::message_ex *request)
+{
+    int err = rocksdb::Status::kOk;
+    dsn::task_code rpc_code(request->rpc_code());
+    if (rpc_code == dsn::apps::RPC_RRDB_RRDB_PUT) {
+        auto rpc = put_rpc::auto_reply(request);
+        err = on_single_put_in_batch(rpc);
+        _put_rpc_batch.emplace_back(std::move(rpc));
+    } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_REMOVE) {
+        auto rpc = remove_rpc::auto_reply(request);
+        err = on_single_remove_in_batch(rpc);
+        _remove_rpc_batch.emplace_back(std::move(rpc));
+    } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_MULTI_PUT) {
+        auto rpc = multi_put_rpc::auto_reply(request);
+        err = _write_svc->batch_multi_put(_write_ctx, rpc.request(), rpc.response());
+        _multi_put_rpc_batch.emplace_back(std::move(rpc));
+    } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_MULTI_REMOVE) {
+        auto rpc = multi_remove_rpc::auto_reply(request);
+        err = _write_svc->batch_multi_remove(_decree, rpc.request(), rpc.response());
+        _multi_remove_rpc_batch.emplace_back(std::move(rpc));
+    } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_INCR) {
+        auto rpc = incr_rpc::auto_reply(request);
+        err = _write_svc->batch_incr(_decree, rpc.request(), rpc.response());
+        _incr_rpc_batch.emplace_back(std::move(rpc));
+    } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_CHECK_AND_SET) {
+        auto rpc = check_and_set_rpc::auto_reply(request);
+        err = _write_svc->batch_check_and_set(_decree, rpc.request(), rpc.response());
+        _check_and_set_rpc_batch.emplace_back(std::move(rpc));
+    } else if (rpc_code == dsn::apps::RPC_RRDB_RRDB_CHECK_AND_MUTATE) {
+        auto rpc = check_and_mutate_rpc::auto_reply(request);
+        err = _write_svc->batch_check_and_mutate(_decree, rpc.request(), rpc.response());
+        _check_and_mutate_rpc_batch.emplace_back(std::move(rpc));
+    } else if (_non_batch_write_handlers.find(rpc_code) != _non_batch_write_handlers.end()) {
+        LOG_FATAL("rpc code not allow batch: {}", rpc_code);
+    } else {
+        LOG_FATAL("rpc code not handled: {}", rpc_code);
+    }
     return err;
 }
 
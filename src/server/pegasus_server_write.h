@@ -62,10 +62,22 @@ public:
 
     void set_default_ttl(uint32_t ttl);
 
+    /// Allow the atomic writes to be batched with others into a single mutation if
+    /// FLAGS_batch_atomic_writes is enabled. The task specs are shared by all the replicas, thus
+    /// it should be called once on the start of the server before any replica is opened.
+    static void register_batchable_atomic_writes();
+
 private:
     /// Delay replying for the batched requests until all of them complete.
+    /// Besides PUT and REMOVE, the atomic writes (MULTI_PUT, MULTI_REMOVE, INCR, CHECK_AND_SET
+    /// and CHECK_AND_MUTATE) could also be batched, each of which reads the results of the
+    /// previous writes in the same batch.
     int on_batched_writes(dsn::message_ex **requests, int count);
 
+    /// Add the request into the current batch.
+    /// \return rocksdb::Status::Code, kOk is returned if the request is corrupt.
+    int on_single_write_in_batch(dsn::message_ex *request);
+
     int on_single_put_in_batch(put_rpc &rpc)
     {
         int err = _write_svc->batch_put(_write_ctx, rpc.request(), rpc.response());
@@ -95,6 +107,11 @@ private:
     std::unique_ptr<pegasus_write_service> _write_svc;
     std::vector<put_rpc> _put_rpc_batch;
     std::vector<remove_rpc> _remove_rpc_batch;
+    std::vector<multi_put_rpc> _multi_put_rpc_batch;
+    std::vector<multi_remove_rpc> _multi_remove_rpc_batch;
+    std::vector<incr_rpc> _incr_rpc_batch;
+    std::vector<check_and_set_rpc> _check_and_set_rpc_batch;
+    std::vector<check_and_mutate_rpc> _check_and_mutate_rpc_batch;
 
     db_write_context _write_ctx;
     int64_t _decree;
@@ -138,6 +138,13 @@ DSN_DEFINE_int64(pegasus.server,
                  "If the duration that a write flows from master to slave is larger than this "
                  "threshold, the write is defined a lagging write.");
 
+DSN_DEFINE_uint64(pegasus.server,
+                  bulk_load_ingestion_group_max_size_mb,
+                  1024,
+                  "The max total size of the files ingested by one rocksdb IngestExternalFile call "
+                  "during bulk load ingestion, 0 means ingesting all the files by one call");
+DSN_TAG_VARIABLE(bulk_load_ingestion_group_max_size_mb, FT_MUTABLE);
+
 namespace dsn {
 class blob;
 class message_ex;
@@ -171,7 +178,12 @@ pegasus_write_service::pegasus_write_service(pegasus_server_impl *server)
       METRIC_VAR_INIT_replica(dup_time_lag_ms),
       METRIC_VAR_INIT_replica(dup_lagging_writes),
       _put_batch_size(0),
-      _remove_batch_size(0)
+      _remove_batch_size(0),
+      _multi_put_batch_size(0),
+      _multi_remove_batch_size(0),
+      _incr_batch_size(0),
+      _check_and_set_batch_size(0),
+      _check_and_mutate_batch_size(0)
 {
 }
 
@@ -264,12 +276,15 @@ int pegasus_write_service::check_and_mutate(int64_t decree,
     return err;
 }
 
-void pegasus_write_service::batch_prepare(int64_t decree)
+void pegasus_write_service::batch_prepare(int64_t decree, bool read_your_writes)
 {
     CHECK_EQ_MSG(
         _batch_start_time, 0, "batch_prepare and batch_commit/batch_abort must be called in pair");
 
     _batch_start_time = dsn_now_ns();
+    if (read_your_writes) {
+        _impl->track_batch_writes();
+    }
 }
 
 int pegasus_write_service::batch_put(const db_write_context &ctx,
@@ -304,6 +319,92 @@ int pegasus_write_service::batch_remove(int64_t decree,
     return err;
 }
 
+int pegasus_write_service::batch_multi_put(const db_write_context &ctx,
+                                           const dsn::apps::multi_put_request &update,
+                                           dsn::apps::update_response &resp)
+{
+    CHECK_GT_MSG(_batch_start_time, 0, "batch_multi_put must be called after batch_prepare");
+
+    ++_multi_put_batch_size;
+    int err = _impl->batch_multi_put(ctx, update, resp);
+
+    if (_server->is_primary()) {
+        _cu_calculator->add_multi_put_cu(resp.error, update.hash_key, update.kvs);
+    }
+
+    return err;
+}
+
+int pegasus_write_service::batch_multi_remove(int64_t decree,
+                                              const dsn::apps::multi_remove_request &update,
+                                              dsn::apps::multi_remove_response &resp)
+{
+    CHECK_GT_MSG(_batch_start_time, 0, "batch_multi_remove must be called after batch_prepare");
+
+    ++_multi_remove_batch_size;
+    int err = _impl->batch_multi_remove(decree, update, resp);
+
+    if (_server->is_primary()) {
+        _cu_calculator->add_multi_remove_cu(resp.error, update.hash_key, update.sort_keys);
+    }
+
+    return err;
+}
+
+int pegasus_write_service::batch_incr(int64_t decree,
+                                      const dsn::apps::incr_request &update,
+                                      dsn::apps::incr_response &resp)
+{
+    CHECK_GT_MSG(_batch_start_time, 0, "batch_incr must be called after batch_prepare");
+
+    ++_incr_batch_size;
+    int err = _impl->batch_incr(decree, update, resp);
+
+    if (_server->is_primary()) {
+        _cu_calculator->add_incr_cu(resp.error, update.key);
+    }
+
+    return err;
+}
+
+int pegasus_write_service::batch_check_and_set(int64_t decree,
+                                               const dsn::apps::check_and_set_request &update,
+                                               dsn::apps::check_and_set_response &resp)
+{
+    CHECK_GT_MSG(_batch_start_time, 0, "batch_check_and_set must be called after batch_prepare");
+
+    ++_check_and_set_batch_size;
+    int err = _impl->batch_check_and_set(decree, update, resp);
+
+    if (_server->is_primary()) {
+        _cu_calculator->add_check_and_set_cu(resp.error,
+                                             update.hash_key,
+                                             update.check_sort_key,
+                                             update.set_sort_key,
+                                             update.set_value);
+    }
+
+    return err;
+}
+
+int pegasus_write_service::batch_check_and_mutate(int64_t decree,
+                                                  const dsn::apps::check_and_mutate_request &update,
+                                                  dsn::apps::check_and_mutate_response &resp)
+{
+    CHECK_GT_MSG(
+        _batch_start_time, 0, "batch_check_and_mutate must be called after batch_prepare");
+
+    ++_check_and_mutate_batch_size;
+    int err = _impl->batch_check_and_mutate(decree, update, resp);
+
+    if (_server->is_primary()) {
+        _cu_calculator->add_check_and_mutate_cu(
+            resp.error, update.hash_key, update.check_sort_key, update.mutate_list);
+    }
+
+    return err;
+}
+
 int pegasus_write_service::batch_commit(int64_t decree)
 {
     CHECK_GT_MSG(_batch_start_time, 0, "batch_commit must be called after batch_prepare");
@@ -337,6 +438,11 @@ void pegasus_write_service::clear_up_batch_states()
 
     PROCESS_WRITE_BATCH(put);
     PROCESS_WRITE_BATCH(remove);
+    PROCESS_WRITE_BATCH(multi_put);
+    PROCESS_WRITE_BATCH(multi_remove);
+    PROCESS_WRITE_BATCH(incr);
+    PROCESS_WRITE_BATCH(check_and_set);
+    PROCESS_WRITE_BATCH(check_and_mutate);
 
     _batch_start_time = 0;
 
@@ -439,13 +545,17 @@ int pegasus_write_service::ingest_files(int64_t decree,
     // ingest files asynchronously
     _server->set_ingestion_status(dsn::replication::ingestion_status::IS_RUNNING);
     dsn::tasking::enqueue(LPC_INGESTION, &_server->_tracker, [this, decree, req]() {
-        const auto &err =
-            _impl->ingest_files(decree, _server->bulk_load_dir(), req, _server->get_ballot());
+        const auto &err = _impl->ingest_files(decree,
+                                              _server->bulk_load_dir(),
+                                              req,
+                                              _server->get_ballot(),
+                                              FLAGS_bulk_load_ingestion_group_max_size_mb << 20);
         auto status = dsn::replication::ingestion_status::IS_SUCCEED;
         if (err == dsn::ERR_INVALID_VERSION) {
             status = dsn::replication::ingestion_status::IS_INVALID;
         } else if (err != dsn::ERR_OK) {
             status = dsn::replication::ingestion_status::IS_FAILED;
+            _server->_ingestion_partially_applied = (err == dsn::ERR_INCONSISTENT_STATE);
         }
         _server->set_ingestion_status(status);
     });
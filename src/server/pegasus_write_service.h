@@ -162,7 +162,9 @@ public:
     /// For batch write.
 
     // Prepare batch write.
-    void batch_prepare(int64_t decree);
+    // `read_your_writes` should be true if any write in the batch reads the records, e.g. INCR,
+    // CHECK_AND_SET and CHECK_AND_MUTATE, so that it could read the previous writes in the batch.
+    void batch_prepare(int64_t decree, bool read_your_writes = false);
 
     // Add PUT record in batch write.
     // \returns rocksdb::Status::Code.
@@ -176,6 +178,27 @@ public:
     // NOTE that `resp` should not be moved or freed while the batch is not committed.
     int batch_remove(int64_t decree, const dsn::blob &key, dsn::apps::update_response &resp);
 
+    // Add MULTI_PUT, MULTI_REMOVE, INCR, CHECK_AND_SET and CHECK_AND_MUTATE records in batch
+    // write, whose responses are filled once they are added, and reset to the error of the batch
+    // if it failed to be committed.
+    // \returns rocksdb::Status::Code.
+    // NOTE that `resp` should not be moved or freed while the batch is not committed.
+    int batch_multi_put(const db_write_context &ctx,
+                        const dsn::apps::multi_put_request &update,
+                        dsn::apps::update_response &resp);
+    int batch_multi_remove(int64_t decree,
+                           const dsn::apps::multi_remove_request &update,
+                           dsn::apps::multi_remove_response &resp);
+    int batch_incr(int64_t decree,
+                   const dsn::apps::incr_request &update,
+                   dsn::apps::incr_response &resp);
+    int batch_check_and_set(int64_t decree,
+                            const dsn::apps::check_and_set_request &update,
+                            dsn::apps::check_and_set_response &resp);
+    int batch_check_and_mutate(int64_t decree,
+                               const dsn::apps::check_and_mutate_request &update,
+                               dsn::apps::check_and_mutate_response &resp);
+
     // Commit batch write.
     // \returns rocksdb::Status::Code.
     // NOTE that if the batch contains no updates, rocksdb::Status::kOk is returned.
@@ -225,9 +248,14 @@ private:
     METRIC_VAR_DECLARE_percentile_int64(dup_time_lag_ms);
     METRIC_VAR_DECLARE_counter(dup_lagging_writes);
 
-    // Record batch size for put and remove requests.
+    // Record batch size for each type of requests.
     uint32_t _put_batch_size;
     uint32_t _remove_batch_size;
+    uint32_t _multi_put_batch_size;
+    uint32_t _multi_remove_batch_size;
+    uint32_t _incr_batch_size;
+    uint32_t _check_and_set_batch_size;
+    uint32_t _check_and_mutate_batch_size;
 
     // TODO(wutao1): add metrics for failed rpc.
 };
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <gtest/gtest_prod.h>
+#include <functional>
 
 #include "base/idl_utils.h"
 #include "base/meta_store.h"
@@ -28,6 +29,7 @@
 #include "pegasus_server_impl.h"
 #include "pegasus_write_service.h"
 #include "rocksdb_wrapper.h"
+#include "runtime/api_layer1.h"
 #include "utils/defer.h"
 #include "utils/env.h"
 #include "utils/filesystem.h"
@@ -59,26 +61,56 @@ struct db_get_context
     bool expired{false};
 };
 
+// Get the paths of the external files in [begin, end) of `metadata.files`.
 inline dsn::error_code get_external_files_path(const std::string &bulk_load_dir,
                                                const bool verify_before_ingest,
                                                const dsn::replication::bulk_load_metadata &metadata,
+                                               size_t begin,
+                                               size_t end,
                                                /*out*/ std::vector<std::string> &files_path)
 {
-    for (const auto &f_meta : metadata.files) {
+    for (size_t i = begin; i < end; ++i) {
+        const auto &f_meta = metadata.files[i];
         const auto &file_name = dsn::utils::filesystem::path_combine(bulk_load_dir, f_meta.name);
         if (verify_before_ingest &&
             !dsn::utils::filesystem::verify_file(
                 file_name, dsn::utils::FileDataType::kSensitive, f_meta.md5, f_meta.size)) {
-            break;
+            return dsn::ERR_WRONG_CHECKSUM;
         }
         files_path.emplace_back(file_name);
     }
-    return files_path.size() == metadata.files.size() ? dsn::ERR_OK : dsn::ERR_WRONG_CHECKSUM;
+    return dsn::ERR_OK;
+}
+
+// Split the external files into groups in their original order, the files in a group are
+// ingested by one rocksdb IngestExternalFile call. The total size of a group is no more than
+// `max_group_size` unless the group consists of a single file, and 0 means all the files are in
+// a single group.
+// \return the [begin, end) ranges of the groups in `metadata.files`.
+inline std::vector<std::pair<size_t, size_t>>
+split_external_files(const dsn::replication::bulk_load_metadata &metadata, uint64_t max_group_size)
+{
+    std::vector<std::pair<size_t, size_t>> groups;
+    uint64_t group_size = 0;
+    for (size_t i = 0; i < metadata.files.size(); ++i) {
+        const auto f_size = static_cast<uint64_t>(metadata.files[i].size);
+        if (groups.empty() ||
+            (max_group_size > 0 && group_size > 0 && group_size + f_size > max_group_size)) {
+            groups.emplace_back(i, i);
+            group_size = 0;
+        }
+        groups.back().second = i + 1;
+        group_size += f_size;
+    }
+    return groups;
 }
 
 class pegasus_write_service::impl : public dsn::replication::replica_base
 {
 public:
+    // The dir under the bulk load dir, in which the hard links of the external files are ingested.
+    static constexpr const char *kIngestionStagingDir = ".ingesting";
+
     explicit impl(pegasus_server_impl *server)
         : replica_base(server),
           _primary_host_port(server->_primary_host_port),
@@ -102,6 +134,161 @@ public:
     int multi_put(const db_write_context &ctx,
                   const dsn::apps::multi_put_request &update,
                   dsn::apps::update_response &resp)
+    {
+        return commit_single_write(ctx.decree, batch_multi_put(ctx, update, resp));
+    }
+
+    int multi_remove(int64_t decree,
+                     const dsn::apps::multi_remove_request &update,
+                     dsn::apps::multi_remove_response &resp)
+    {
+        return commit_single_write(decree, batch_multi_remove(decree, update, resp));
+    }
+
+    int incr(int64_t decree, const dsn::apps::incr_request &update, dsn::apps::incr_response &resp)
+    {
+        return commit_single_write(decree, batch_incr(decree, update, resp));
+    }
+
+    int check_and_set(int64_t decree,
+                      const dsn::apps::check_and_set_request &update,
+                      dsn::apps::check_and_set_response &resp)
+    {
+        return commit_single_write(decree, batch_check_and_set(decree, update, resp));
+    }
+
+    int check_and_mutate(int64_t decree,
+                         const dsn::apps::check_and_mutate_request &update,
+                         dsn::apps::check_and_mutate_response &resp)
+    {
+        return commit_single_write(decree, batch_check_and_mutate(decree, update, resp));
+    }
+
+    // \return ERR_INVALID_VERSION: replay or commit out-date ingest request
+    // \return ERR_WRONG_CHECKSUM: verify files failed
+    // \return ERR_INGESTION_FAILED: rocksdb ingestion failed before any file has been ingested
+    // \return ERR_INCONSISTENT_STATE: rocksdb ingestion failed after some of the file groups have
+    //                                been ingested, which could not be rolled back
+    // \return ERR_OK: rocksdb ingestion succeed
+    dsn::error_code ingest_files(const int64_t decree,
+                                 const std::string &bulk_load_dir,
+                                 const dsn::replication::ingestion_request &req,
+                                 const int64_t current_ballot,
+                                 const uint64_t max_group_size)
+    {
+        const auto &req_ballot = req.ballot;
+
+        // if ballot updated, ignore this request
+        if (req_ballot < current_ballot) {
+            LOG_WARNING_PREFIX("out-dated ingestion request, ballot changed, request({}) vs "
+                               "current({}), ignore it",
+                               req_ballot,
+                               current_ballot);
+            return dsn::ERR_INVALID_VERSION;
+        }
+
+        // Verify all the files before ingesting any of them, so that a damaged file fails the
+        // ingestion before any group has been ingested.
+        const auto groups = split_external_files(req.metadata, max_group_size);
+        std::vector<std::vector<std::string>> group_files(groups.size());
+        for (size_t i = 0; i < groups.size(); ++i) {
+            const auto &err = get_external_files_path(bulk_load_dir,
+                                                      req.verify_before_ingest,
+                                                      req.metadata,
+                                                      groups[i].first,
+                                                      groups[i].second,
+                                                      group_files[i]);
+            if (err != dsn::ERR_OK) {
+                return err;
+            }
+        }
+
+        // Ingest the files group by group, rocksdb stops writing and may flush the memtable
+        // during each IngestExternalFile call, smaller groups make each stall shorter and give
+        // the background compactions chances to digest the ingested files between them.
+        //
+        // The files are moved into rocksdb by the ingestion, thus each group is ingested from
+        // the hard links of its files in a staging dir, and the original files are kept until
+        // the bulk load dir is removed. All the groups are ingested by the same write, which
+        // keeps the writes rejected until the last group is done. The groups ingested before
+        // a failed one could not be rolled back, in which case the data of this replica may
+        // diverge from the other replicas, thus the failure is reported as an inconsistent
+        // state to get this replica removed rather than just failing the bulk load.
+        const auto staging_dir =
+            dsn::utils::filesystem::path_combine(bulk_load_dir, kIngestionStagingDir);
+        if (!dsn::utils::filesystem::remove_path(staging_dir) ||
+            !dsn::utils::filesystem::create_directory(staging_dir)) {
+            LOG_ERROR_PREFIX("create ingestion staging dir({}) failed", staging_dir);
+            return dsn::ERR_FILE_OPERATION_FAILED;
+        }
+        const auto cleanup = dsn::defer([&staging_dir]() {
+            if (!dsn::utils::filesystem::remove_path(staging_dir)) {
+                LOG_WARNING("remove ingestion staging dir({}) failed", staging_dir);
+            }
+        });
+        for (size_t i = 0; i < groups.size(); ++i) {
+            std::vector<std::string> sst_file_list;
+            for (const auto &file : group_files[i]) {
+                sst_file_list.emplace_back(dsn::utils::filesystem::path_combine(
+                    staging_dir, dsn::utils::filesystem::get_file_name(file)));
+                if (!dsn::utils::filesystem::link_file(file, sst_file_list.back())) {
+                    LOG_ERROR_PREFIX("link file({}) to {} failed", file, sst_file_list.back());
+                    return dsn::ERR_FILE_OPERATION_FAILED;
+                }
+            }
+
+            // ingest external files
+            const auto start_ms = dsn_now_ms();
+            const auto s =
+                _rocksdb_wrapper->ingest_files(decree, sst_file_list, req.ingest_behind);
+            if (dsn_unlikely(s != rocksdb::Status::kOk)) {
+                LOG_ERROR_PREFIX("ingest file group({}/{}) failed, {} group(s) have been ingested",
+                                 i + 1,
+                                 groups.size(),
+                                 i);
+                return i == 0 ? dsn::ERR_INGESTION_FAILED : dsn::ERR_INCONSISTENT_STATE;
+            }
+            LOG_INFO_PREFIX("ingest file group({}/{}) succeed, file_count = {}, elapsed_ms = {}",
+                            i + 1,
+                            groups.size(),
+                            sst_file_list.size(),
+                            dsn_now_ms() - start_ms);
+        }
+        return dsn::ERR_OK;
+    }
+
+    /// For batch write.
+
+    int batch_put(const db_write_context &ctx,
+                  const dsn::apps::update_request &update,
+                  dsn::apps::update_response &resp)
+    {
+        resp.error =
+            _rocksdb_wrapper->write_batch_put_ctx(ctx,
+                                                  update.key.to_string_view(),
+                                                  update.value.to_string_view(),
+                                                  static_cast<uint32_t>(update.expire_ts_seconds));
+        _update_responses.emplace_back(&resp);
+        return resp.error;
+    }
+
+    int batch_remove(int64_t decree, const dsn::blob &key, dsn::apps::update_response &resp)
+    {
+        resp.error = _rocksdb_wrapper->write_batch_delete(decree, key.to_string_view());
+        _update_responses.emplace_back(&resp);
+        return resp.error;
+    }
+
+    void track_batch_writes() { _rocksdb_wrapper->track_batch_writes(); }
+
+    // The following batch_xxx() add the records of the atomic writes into the batch, whose
+    // responses are filled once they are added, and reset by the error if the batch fails to
+    // be committed. The results of the previous writes in the same batch could only be read by
+    // them after rocksdb_wrapper::track_batch_writes() is called.
+
+    int batch_multi_put(const db_write_context &ctx,
+                        const dsn::apps::multi_put_request &update,
+                        dsn::apps::update_response &resp)
     {
         int64_t decree = ctx.decree;
         resp.app_id = get_gpid().get_app_id();
@@ -115,10 +302,9 @@ public:
                              "request.kvs is empty");
             resp.error = rocksdb::Status::kInvalidArgument;
             // we should write empty record to update rocksdb's last flushed decree
-            return empty_put(decree);
+            return batch_empty_put(decree, resp);
         }
 
-        auto cleanup = dsn::defer([this]() { _rocksdb_wrapper->clear_up_write_batch(); });
         for (auto &kv : update.kvs) {
             resp.error = _rocksdb_wrapper->write_batch_put_ctx(
                 ctx,
@@ -131,13 +317,13 @@ public:
             }
         }
 
-        resp.error = _rocksdb_wrapper->write(decree);
-        return resp.error;
+        reset_on_batch_failure(resp);
+        return rocksdb::Status::kOk;
     }
 
-    int multi_remove(int64_t decree,
-                     const dsn::apps::multi_remove_request &update,
-                     dsn::apps::multi_remove_response &resp)
+    int batch_multi_remove(int64_t decree,
+                           const dsn::apps::multi_remove_request &update,
+                           dsn::apps::multi_remove_response &resp)
     {
         resp.app_id = get_gpid().get_app_id();
         resp.partition_index = get_gpid().get_partition_index();
@@ -150,10 +336,9 @@ public:
                              "request.sort_keys is empty");
             resp.error = rocksdb::Status::kInvalidArgument;
             // we should write empty record to update rocksdb's last flushed decree
-            return empty_put(decree);
+            return batch_empty_put(decree, resp);
         }
 
-        auto cleanup = dsn::defer([this]() { _rocksdb_wrapper->clear_up_write_batch(); });
         for (auto &sort_key : update.sort_keys) {
             resp.error = _rocksdb_wrapper->write_batch_delete(
                 decree,
@@ -164,14 +349,17 @@ public:
             }
         }
 
-        resp.error = _rocksdb_wrapper->write(decree);
-        if (resp.error == rocksdb::Status::kOk) {
-            resp.count = update.sort_keys.size();
-        }
-        return resp.error;
+        resp.count = update.sort_keys.size();
+        _batch_failure_handlers.emplace_back([&resp](int err) {
+            resp.error = err;
+            resp.count = 0;
+        });
+        return rocksdb::Status::kOk;
     }
 
-    int incr(int64_t decree, const dsn::apps::incr_request &update, dsn::apps::incr_response &resp)
+    int batch_incr(int64_t decree,
+                   const dsn::apps::incr_request &update,
+                   dsn::apps::incr_response &resp)
     {
         resp.app_id = get_gpid().get_app_id();
         resp.partition_index = get_gpid().get_partition_index();
@@ -212,7 +400,7 @@ public:
                                      utils::c_escape_sensitive_string(old_value));
                     resp.error = rocksdb::Status::kInvalidArgument;
                     // we should write empty record to update rocksdb's last flushed decree
-                    return empty_put(decree);
+                    return batch_empty_put(decree, resp);
                 }
                 new_value = old_value_int + update.increment;
                 if ((update.increment > 0 && new_value < old_value_int) ||
@@ -226,7 +414,7 @@ public:
                     resp.error = rocksdb::Status::kInvalidArgument;
                     resp.new_value = old_value_int;
                     // we should write empty record to update rocksdb's last flushed decree
-                    return empty_put(decree);
+                    return batch_empty_put(decree, resp);
                 }
             }
             // set new ttl
@@ -239,23 +427,23 @@ public:
             }
         }
 
-        auto cleanup = dsn::defer([this]() { _rocksdb_wrapper->clear_up_write_batch(); });
         resp.error = _rocksdb_wrapper->write_batch_put(
             decree, update.key.to_string_view(), std::to_string(new_value), new_expire_ts);
         if (resp.error) {
             return resp.error;
         }
 
-        resp.error = _rocksdb_wrapper->write(decree);
-        if (resp.error == rocksdb::Status::kOk) {
-            resp.new_value = new_value;
-        }
-        return resp.error;
+        resp.new_value = new_value;
+        _batch_failure_handlers.emplace_back([&resp](int err) {
+            resp.error = err;
+            resp.new_value = 0;
+        });
+        return rocksdb::Status::kOk;
     }
 
-    int check_and_set(int64_t decree,
-                      const dsn::apps::check_and_set_request &update,
-                      dsn::apps::check_and_set_response &resp)
+    int batch_check_and_set(int64_t decree,
+                            const dsn::apps::check_and_set_request &update,
+                            dsn::apps::check_and_set_response &resp)
     {
         resp.app_id = get_gpid().get_app_id();
         resp.partition_index = get_gpid().get_partition_index();
@@ -268,7 +456,7 @@ public:
                              fmt::format("check type {} not supported", update.check_type));
             resp.error = rocksdb::Status::kInvalidArgument;
             // we should write empty record to update rocksdb's last flushed decree
-            return empty_put(decree);
+            return batch_empty_put(decree, resp);
         }
 
         ::dsn::blob check_key;
@@ -330,12 +518,6 @@ public:
                 decree, absl::string_view(), absl::string_view(), 0);
         }
 
-        auto cleanup = dsn::defer([this]() { _rocksdb_wrapper->clear_up_write_batch(); });
-        if (resp.error) {
-            return resp.error;
-        }
-
-        resp.error = _rocksdb_wrapper->write(decree);
         if (resp.error) {
             return resp.error;
         }
@@ -346,12 +528,13 @@ public:
                 invalid_argument ? rocksdb::Status::kInvalidArgument : rocksdb::Status::kTryAgain;
         }
 
+        reset_on_batch_failure(resp);
         return rocksdb::Status::kOk;
     }
 
-    int check_and_mutate(int64_t decree,
-                         const dsn::apps::check_and_mutate_request &update,
-                         dsn::apps::check_and_mutate_response &resp)
+    int batch_check_and_mutate(int64_t decree,
+                               const dsn::apps::check_and_mutate_request &update,
+                               dsn::apps::check_and_mutate_response &resp)
     {
         resp.app_id = get_gpid().get_app_id();
         resp.partition_index = get_gpid().get_partition_index();
@@ -364,7 +547,7 @@ public:
                              "mutate list is empty");
             resp.error = rocksdb::Status::kInvalidArgument;
             // we should write empty record to update rocksdb's last flushed decree
-            return empty_put(decree);
+            return batch_empty_put(decree, resp);
         }
 
         for (int i = 0; i < update.mutate_list.size(); ++i) {
@@ -378,7 +561,7 @@ public:
                                  mu.operation);
                 resp.error = rocksdb::Status::kInvalidArgument;
                 // we should write empty record to update rocksdb's last flushed decree
-                return empty_put(decree);
+                return batch_empty_put(decree, resp);
             }
         }
 
@@ -388,7 +571,7 @@ public:
                              fmt::format("check type {} not supported", update.check_type));
             resp.error = rocksdb::Status::kInvalidArgument;
             // we should write empty record to update rocksdb's last flushed decree
-            return empty_put(decree);
+            return batch_empty_put(decree, resp);
         }
 
         ::dsn::blob check_key;
@@ -456,12 +639,6 @@ public:
                 decree, absl::string_view(), absl::string_view(), 0);
         }
 
-        auto cleanup = dsn::defer([this]() { _rocksdb_wrapper->clear_up_write_batch(); });
-        if (resp.error) {
-            return resp.error;
-        }
-
-        resp.error = _rocksdb_wrapper->write(decree);
         if (resp.error) {
             return resp.error;
         }
@@ -471,65 +648,9 @@ public:
             resp.error =
                 invalid_argument ? rocksdb::Status::kInvalidArgument : rocksdb::Status::kTryAgain;
         }
-        return rocksdb::Status::kOk;
-    }
 
-    // \return ERR_INVALID_VERSION: replay or commit out-date ingest request
-    // \return ERR_WRONG_CHECKSUM: verify files failed
-    // \return ERR_INGESTION_FAILED: rocksdb ingestion failed
-    // \return ERR_OK: rocksdb ingestion succeed
-    dsn::error_code ingest_files(const int64_t decree,
-                                 const std::string &bulk_load_dir,
-                                 const dsn::replication::ingestion_request &req,
-                                 const int64_t current_ballot)
-    {
-        const auto &req_ballot = req.ballot;
-
-        // if ballot updated, ignore this request
-        if (req_ballot < current_ballot) {
-            LOG_WARNING_PREFIX("out-dated ingestion request, ballot changed, request({}) vs "
-                               "current({}), ignore it",
-                               req_ballot,
-                               current_ballot);
-            return dsn::ERR_INVALID_VERSION;
-        }
-
-        // verify external files before ingestion
-        std::vector<std::string> sst_file_list;
-        const auto &err = get_external_files_path(
-            bulk_load_dir, req.verify_before_ingest, req.metadata, sst_file_list);
-        if (err != dsn::ERR_OK) {
-            return err;
-        }
-
-        // ingest external files
-        if (dsn_unlikely(_rocksdb_wrapper->ingest_files(decree, sst_file_list, req.ingest_behind) !=
-                         rocksdb::Status::kOk)) {
-            return dsn::ERR_INGESTION_FAILED;
-        }
-        return dsn::ERR_OK;
-    }
-
-    /// For batch write.
-
-    int batch_put(const db_write_context &ctx,
-                  const dsn::apps::update_request &update,
-                  dsn::apps::update_response &resp)
-    {
-        resp.error =
-            _rocksdb_wrapper->write_batch_put_ctx(ctx,
-                                                  update.key.to_string_view(),
-                                                  update.value.to_string_view(),
-                                                  static_cast<uint32_t>(update.expire_ts_seconds));
-        _update_responses.emplace_back(&resp);
-        return resp.error;
-    }
-
-    int batch_remove(int64_t decree, const dsn::blob &key, dsn::apps::update_response &resp)
-    {
-        resp.error = _rocksdb_wrapper->write_batch_delete(decree, key.to_string_view());
-        _update_responses.emplace_back(&resp);
-        return resp.error;
+        reset_on_batch_failure(resp);
+        return rocksdb::Status::kOk;
     }
 
     int batch_commit(int64_t decree)
@@ -544,6 +665,29 @@ public:
     void set_default_ttl(uint32_t ttl) { _rocksdb_wrapper->set_default_ttl(ttl); }
 
 private:
+    // Commit the batch which consists of a single write, or abort it if the write failed to be
+    // added into the batch.
+    int commit_single_write(int64_t decree, int err)
+    {
+        if (err != rocksdb::Status::kOk) {
+            batch_abort(decree, err);
+            return err;
+        }
+        return batch_commit(decree);
+    }
+
+    // Write an empty record into the batch for the write whose error has been set into `resp`.
+    template <typename TResponse>
+    int batch_empty_put(int64_t decree, TResponse &resp)
+    {
+        int err =
+            _rocksdb_wrapper->write_batch_put(decree, absl::string_view(), absl::string_view(), 0);
+        if (err == rocksdb::Status::kOk) {
+            reset_on_batch_failure(resp);
+        }
+        return err;
+    }
+
     void clear_up_batch_states(int64_t decree, int err)
     {
         if (!_update_responses.empty()) {
@@ -559,6 +703,13 @@ private:
             _update_responses.clear();
         }
 
+        if (err != rocksdb::Status::kOk) {
+            for (const auto &handler : _batch_failure_handlers) {
+                handler(err);
+            }
+        }
+        _batch_failure_handlers.clear();
+
         _rocksdb_wrapper->clear_up_write_batch();
     }
 
@@ -693,6 +844,9 @@ private:
 
     // for setting update_response.error after committed.
     std::vector<dsn::apps::update_response *> _update_responses;
+
+    // for resetting the responses of the atomic writes once the batch failed.
+    std::vector<std::function<void(int)>> _batch_failure_handlers;
 };
 
 } // namespace server
@@ -23,6 +23,7 @@
 #include <rocksdb/db.h>
 #include <rocksdb/slice.h>
 #include <rocksdb/status.h>
+#include <algorithm>
 
 #include "base/meta_store.h"
 #include "base/pegasus_value_schema.h"
@@ -35,6 +36,7 @@
 #include "server/pegasus_write_service.h"
 #include "utils/autoref_ptr.h"
 #include "utils/blob.h"
+#include "utils/defer.h"
 #include "utils/fail_point.h"
 #include "utils/flags.h"
 #include "utils/fmt_logging.h"
@@ -54,6 +56,16 @@ DSN_DEFINE_bool(pegasus.server,
 
 METRIC_DECLARE_counter(read_expired_values);
 
+METRIC_DEFINE_counter(replica,
+                      write_cache_hits,
+                      dsn::metric_unit::kPointLookups,
+                      "The number of read-before-writes served by the write cache");
+
+METRIC_DEFINE_counter(replica,
+                      write_cache_misses,
+                      dsn::metric_unit::kPointLookups,
+                      "The number of read-before-writes served by RocksDB");
+
 namespace pegasus {
 namespace server {
 
@@ -62,8 +74,12 @@ rocksdb_wrapper::rocksdb_wrapper(pegasus_server_impl *server)
       _db(server->_db),
       _rd_opts(server->_data_cf_rd_opts),
       _meta_cf(server->_meta_cf),
+      _track_batch_writes(false),
+      _user_specified_compaction(server->_user_specified_compaction),
       _pegasus_data_version(server->_pegasus_data_version),
       METRIC_VAR_INIT_replica(read_expired_values),
+      METRIC_VAR_INIT_replica(write_cache_hits),
+      METRIC_VAR_INIT_replica(write_cache_misses),
       _default_ttl(0)
 {
     _write_batch = std::make_unique<rocksdb::WriteBatch>();
@@ -78,18 +94,50 @@ int rocksdb_wrapper::get(absl::string_view raw_key, /*out*/ db_get_context *ctx)
 {
     FAIL_POINT_INJECT_F("db_get", [](absl::string_view) -> int { return FAIL_DB_GET; });
 
+    if (_track_batch_writes) {
+        const auto iter = _batch_writes.find(std::string(raw_key));
+        if (iter != _batch_writes.end()) {
+            // The record is written by the current batch, which is not visible in db yet.
+            if (iter->second.deleted) {
+                ctx->found = false;
+            } else {
+                ctx->raw_value = iter->second.raw_value;
+                on_value_found(ctx);
+            }
+            return rocksdb::Status::kOk;
+        }
+    }
+
+    const bool cacheable = _user_specified_compaction.empty();
+    if (cacheable) {
+        bool found = false;
+        if (_write_cache.get(raw_key, found, ctx->raw_value)) {
+            METRIC_VAR_INCREMENT(write_cache_hits);
+            if (found) {
+                on_value_found(ctx);
+            } else {
+                ctx->found = false;
+            }
+            return rocksdb::Status::kOk;
+        }
+        METRIC_VAR_INCREMENT(write_cache_misses);
+    } else {
+        _write_cache.clear();
+    }
+
     rocksdb::Status s = _db->Get(_rd_opts, utils::to_rocksdb_slice(raw_key), &(ctx->raw_value));
     if (dsn_likely(s.ok())) {
         // success
-        ctx->found = true;
-        ctx->expire_ts = pegasus_extract_expire_ts(_pegasus_data_version, ctx->raw_value);
-        if (check_if_ts_expired(utils::epoch_now(), ctx->expire_ts)) {
-            ctx->expired = true;
-            METRIC_VAR_INCREMENT(read_expired_values);
+        if (cacheable) {
+            _write_cache.put(raw_key, true, ctx->raw_value);
         }
+        on_value_found(ctx);
         return rocksdb::Status::kOk;
     } else if (s.IsNotFound()) {
         // NotFound is an acceptable error
+        if (cacheable) {
+            _write_cache.put(raw_key, false, absl::string_view());
+        }
         ctx->found = false;
         return rocksdb::Status::kOk;
     }
@@ -163,6 +211,16 @@ int rocksdb_wrapper::write_batch_put_ctx(const db_write_context &ctx,
                           utils::c_escape_sensitive_string(hash_key),
                           utils::c_escape_sensitive_string(sort_key),
                           expire_sec);
+        return s.code();
+    }
+
+    if (_track_batch_writes && !raw_key.empty()) {
+        auto &write = _batch_writes[std::string(raw_key)];
+        write.deleted = false;
+        write.raw_value.clear();
+        for (int i = 0; i < svalue.num_parts; ++i) {
+            write.raw_value.append(svalue.parts[i].data(), svalue.parts[i].size());
+        }
     }
     return s.code();
 }
@@ -190,7 +248,13 @@ int rocksdb_wrapper::write(int64_t decree)
     status = _db->Write(*_wt_opts, _write_batch.get());
     if (dsn_unlikely(!status.ok())) {
         LOG_ERROR_ROCKSDB("Write", status.ToString(), "write rocksdb error, decree: {}", decree);
+        // The batch might have been partially applied.
+        _write_cache.clear();
+        return status.code();
     }
+
+    // Keep the cached records up to date, including the ones read by this batch.
+    _write_cache.apply(*_write_batch);
     return status.code();
 }
 
@@ -209,16 +273,45 @@ int rocksdb_wrapper::write_batch_delete(int64_t decree, absl::string_view raw_ke
                           decree,
                           utils::c_escape_sensitive_string(hash_key),
                           utils::c_escape_sensitive_string(sort_key));
+        return s.code();
+    }
+
+    if (_track_batch_writes) {
+        auto &write = _batch_writes[std::string(raw_key)];
+        write.deleted = true;
+        write.raw_value.clear();
     }
     return s.code();
 }
 
-void rocksdb_wrapper::clear_up_write_batch() { _write_batch->Clear(); }
+void rocksdb_wrapper::clear_up_write_batch()
+{
+    _write_batch->Clear();
+    _batch_writes.clear();
+    _track_batch_writes = false;
+}
 
 int rocksdb_wrapper::ingest_files(int64_t decree,
                                   const std::vector<std::string> &sst_file_list,
                                   const bool ingest_behind)
 {
+    // Fail the ingestion of the files whose paths contain the argument of the fail point.
+    bool inject_failure = false;
+    FAIL_POINT_INJECT_NOT_RETURN_F("db_ingest_files", [&](absl::string_view file_name) {
+        inject_failure =
+            std::any_of(sst_file_list.begin(), sst_file_list.end(), [&](const std::string &file) {
+                return file.find(file_name.data(), 0, file_name.size()) != std::string::npos;
+            });
+    });
+    if (inject_failure) {
+        return rocksdb::Status::kIOError;
+    }
+
+    // The ingested records are invisible to the write cache, which is invalidated before the
+    // ingestion in case of any read-before-write meanwhile, and after it as well.
+    _write_cache.invalidate();
+    auto invalidate = dsn::defer([this]() { _write_cache.invalidate(); });
+
     rocksdb::IngestExternalFileOptions ifo;
     ifo.move_files = true;
     ifo.ingest_behind = ingest_behind;
@@ -243,10 +336,22 @@ void rocksdb_wrapper::set_default_ttl(uint32_t ttl)
 {
     if (_default_ttl != ttl) {
         _default_ttl = ttl;
+        // The default ttl would be applied to the records without ttl by the compaction filter.
+        _write_cache.invalidate();
         LOG_INFO_PREFIX("update _default_ttl to {}", ttl);
     }
 }
 
+void rocksdb_wrapper::on_value_found(db_get_context *ctx)
+{
+    ctx->found = true;
+    ctx->expire_ts = pegasus_extract_expire_ts(_pegasus_data_version, ctx->raw_value);
+    if (check_if_ts_expired(utils::epoch_now(), ctx->expire_ts)) {
+        ctx->expired = true;
+        METRIC_VAR_INCREMENT(read_expired_values);
+    }
+}
+
 uint32_t rocksdb_wrapper::db_expire_ts(uint32_t expire_ts)
 {
     // use '_default_ttl' when ttl is not set for this write operation.
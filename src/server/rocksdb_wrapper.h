@@ -25,10 +25,12 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "pegasus_value_schema.h"
 #include "replica/replica_base.h"
+#include "server/write_cache.h"
 #include "absl/strings/string_view.h"
 #include "utils/metrics.h"
 
@@ -54,6 +56,8 @@ public:
     /// is returned.
     /// \result ctx.expired=true if record expired. Still rocksdb::Status::kOk is returned.
     /// \result ctx.found=false if record is not found. Still rocksdb::Status::kOk is returned.
+    /// The pending writes in the current write batch are read first once track_batch_writes()
+    /// has been called, and then the records cached by `_write_cache`.
     int get(absl::string_view raw_key, /*out*/ db_get_context *ctx);
 
     int write_batch_put(int64_t decree,
@@ -66,6 +70,9 @@ public:
                             uint32_t expire_sec);
     int write(int64_t decree);
     int write_batch_delete(int64_t decree, absl::string_view raw_key);
+    // Record the records put or deleted into the current write batch, so that they could be read
+    // by get() before the batch is written. It keeps effective until clear_up_write_batch().
+    void track_batch_writes() { _track_batch_writes = true; }
     void clear_up_write_batch();
     int ingest_files(int64_t decree,
                      const std::vector<std::string> &sst_file_list,
@@ -73,9 +80,23 @@ public:
 
     void set_default_ttl(uint32_t ttl);
 
+    // Drop the records cached for the read-before-writes. Thread-safe.
+    void invalidate_write_cache() { _write_cache.invalidate(); }
+
 private:
     uint32_t db_expire_ts(uint32_t expire_ts);
 
+    // Fill the other fields of `ctx` by its `raw_value` which has been found.
+    void on_value_found(db_get_context *ctx);
+
+    struct batch_write
+    {
+        // Whether the record is deleted by the batch.
+        bool deleted{false};
+        // The raw value put by the batch, including the header.
+        std::string raw_value;
+    };
+
     rocksdb::DB *_db;
     rocksdb::ReadOptions &_rd_opts;
     std::unique_ptr<pegasus_value_generator> _value_generator;
@@ -83,8 +104,19 @@ private:
     std::unique_ptr<rocksdb::WriteOptions> _wt_opts;
     rocksdb::ColumnFamilyHandle *_meta_cf;
 
+    bool _track_batch_writes;
+    // The latest writes in `_write_batch` by raw keys, only recorded if `_track_batch_writes`.
+    std::unordered_map<std::string, batch_write> _batch_writes;
+
+    // The records may be modified by the compaction filter once the user specified compaction
+    // is set, thus they are not cached meanwhile.
+    const std::string &_user_specified_compaction;
+    write_cache _write_cache;
+
     const uint32_t _pegasus_data_version;
     METRIC_VAR_DECLARE_counter(read_expired_values);
+    METRIC_VAR_DECLARE_counter(write_cache_hits);
+    METRIC_VAR_DECLARE_counter(write_cache_misses);
     volatile uint32_t _default_ttl;
 
     friend class rocksdb_wrapper_test;
@@ -93,6 +125,8 @@ private:
     FRIEND_TEST(rocksdb_wrapper_test, put_verify_timetag);
     FRIEND_TEST(rocksdb_wrapper_test, verify_timetag_compatible_with_version_0);
     FRIEND_TEST(rocksdb_wrapper_test, get);
+    FRIEND_TEST(rocksdb_wrapper_test, get_batch_writes);
+    FRIEND_TEST(rocksdb_wrapper_test, write_cache);
 };
 } // namespace server
 } // namespace pegasus
@@ -400,5 +400,24 @@ TEST_P(hotkey_collector_test, data_completeness)
                      resp);
 }
 
+TEST_P(hotkey_collector_test, top_hotkeys)
+{
+    hotkey_collector collector(dsn::replication::hotkey_type::READ, _server.get());
+    for (int i = 0; i < 1000; i++) {
+        dsn::blob raw_key;
+        pegasus_generate_key(raw_key, generate_hash_key_by_random(true, 50), std::string("s"));
+        collector.capture_raw_key(raw_key, 1);
+    }
+    // The hotkeys are queried from the latest analyse interval.
+    ASSERT_TRUE(collector.query_top_hotkeys(1).empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    collector.analyse_data();
+    const auto hotkeys = collector.query_top_hotkeys(1);
+    ASSERT_EQ(1, hotkeys.size());
+    ASSERT_EQ("ThisisahotkeyThisisahotkey", hotkeys[0].first);
+    ASSERT_GT(hotkeys[0].second, 0);
+}
+
 } // namespace server
 } // namespace pegasus
@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "server/hotkey_sketch.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utils/rand.h"
+
+namespace pegasus {
+namespace server {
+
+TEST(hotkey_sketch_test, count_keys)
+{
+    hotkey_sketch sketch(3);
+    sketch.add("a", 5);
+    sketch.add("b", 3);
+    sketch.add("c", 1);
+    sketch.add("a", 2);
+
+    auto top = sketch.top(2);
+    ASSERT_EQ(2, top.size());
+    ASSERT_EQ("a", top[0].hash_key);
+    ASSERT_EQ(7, top[0].count);
+    ASSERT_EQ(0, top[0].error);
+    ASSERT_EQ("b", top[1].hash_key);
+    ASSERT_EQ(3, top[1].count);
+
+    // The new key takes over the counter of the least counted key "c".
+    sketch.add("d", 4);
+    top = sketch.top(10);
+    ASSERT_EQ(3, top.size());
+    ASSERT_EQ("d", top[1].hash_key);
+    ASSERT_EQ(5, top[1].count);
+    ASSERT_EQ(1, top[1].error);
+    ASSERT_EQ("b", top[2].hash_key);
+
+    top = sketch.take_top(1);
+    ASSERT_EQ(1, top.size());
+    ASSERT_EQ("a", top[0].hash_key);
+    ASSERT_TRUE(sketch.top(10).empty());
+}
+
+TEST(hotkey_sketch_test, find_heavy_hitters)
+{
+    hotkey_sketch sketch(16);
+    const std::vector<std::string> hotkeys = {"hotkey_0", "hotkey_1"};
+    uint64_t total = 0;
+    for (int i = 0; i < 100000; i++) {
+        const auto r = dsn::rand::next_u32(100);
+        if (r < 20) {
+            sketch.add(hotkeys[0], 1);
+        } else if (r < 30) {
+            sketch.add(hotkeys[1], 1);
+        } else {
+            sketch.add("key_" + std::to_string(dsn::rand::next_u32(10000)), 1);
+        }
+        ++total;
+    }
+
+    // The keys accessed more than total / capacity times are always found, and their counts are
+    // over-estimated by at most total / capacity.
+    const auto top = sketch.top(2);
+    ASSERT_EQ(2, top.size());
+    for (int i = 0; i < hotkeys.size(); i++) {
+        ASSERT_EQ(hotkeys[i], top[i].hash_key);
+        ASSERT_LE(top[i].error, total / 16);
+        ASSERT_GE(top[i].count - top[i].error, total * (i == 0 ? 15 : 5) / 100);
+    }
+}
+
+} // namespace server
+} // namespace pegasus
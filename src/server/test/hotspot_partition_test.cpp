@@ -22,18 +22,24 @@
 #include <utility>
 #include <vector>
 
+#include "common/serialization_helper/dsn.layer2_types.h"
 #include "gtest/gtest.h"
 #include "pegasus_server_test_base.h"
 #include "perf_counter/perf_counter.h"
 #include "perf_counter/perf_counter_wrapper.h"
+#include "runtime/rpc/rpc_host_port.h"
 #include "server/hotspot_partition_calculator.h"
 #include "server/hotspot_partition_stat.h"
 #include "shell/command_helper.h"
 #include "utils/fail_point.h"
 #include "utils/flags.h"
+#include "utils/test_macros.h"
 
 DSN_DECLARE_int32(occurrence_threshold);
 DSN_DECLARE_bool(enable_detect_hotkey);
+DSN_DECLARE_uint32(hotspot_remediation_table_interval_seconds);
+DSN_DECLARE_uint32(max_hotspot_remediations_per_hour);
+DSN_DECLARE_uint64(hotspot_split_write_qps_threshold);
 
 namespace pegasus {
 namespace server {
@@ -117,6 +123,16 @@ public:
     }
 
     void clear_calculator_histories() { calculator._partitions_stat_histories.clear(); }
+
+    bool find_read_hotspot_move(const std::vector<dsn::partition_configuration> &partitions,
+                                int &partition_index,
+                                dsn::host_port &from,
+                                dsn::host_port &to)
+    {
+        return calculator.find_read_hotspot_move(partitions, partition_index, from, to);
+    }
+
+    int write_hot_table_counter() const { return calculator._write_hot_table_counter; }
 };
 
 INSTANTIATE_TEST_SUITE_P(, hotspot_partition_test, ::testing::Values(false, true));
@@ -191,5 +207,78 @@ TEST_P(hotspot_partition_test, send_detect_hotkey_request)
     aggregate_analyse_data(generate_row_data(), expect_result, back_to_normal);
 }
 
+TEST_P(hotspot_partition_test, find_read_hotspot_move)
+{
+    const int READ_HOT_PARTITION = 7;
+    std::vector<row_data> test_rows = generate_row_data();
+    test_rows[READ_HOT_PARTITION].get_qps = 5000.0;
+    for (int i = 0; i < FLAGS_occurrence_threshold; i++) {
+        calculator.data_aggregate(test_rows);
+        calculator.data_analyse();
+    }
+
+    // The read qps of the primaries on the 3 nodes are 3000, 8000 and 1000.
+    const std::vector<dsn::host_port> nodes = {dsn::host_port("127.0.0.1", 34801),
+                                               dsn::host_port("127.0.0.1", 34802),
+                                               dsn::host_port("127.0.0.1", 34803)};
+    const std::vector<int> primaries = {0, 1, 2, 0, 1, 1, 0, 1};
+    std::vector<dsn::partition_configuration> partitions(primaries.size());
+    for (int i = 0; i < primaries.size(); i++) {
+        partitions[i].__set_hp_primary(nodes[primaries[i]]);
+        partitions[i].__set_hp_secondaries(
+            {nodes[(primaries[i] + 1) % nodes.size()], nodes[(primaries[i] + 2) % nodes.size()]});
+    }
+
+    // Moving the primary of the hot partition to node 2 rather than node 0 reduces the max read
+    // qps of the nodes.
+    int partition_index = -1;
+    dsn::host_port from;
+    dsn::host_port to;
+    ASSERT_TRUE(find_read_hotspot_move(partitions, partition_index, from, to));
+    ASSERT_EQ(READ_HOT_PARTITION, partition_index);
+    ASSERT_EQ(nodes[1], from);
+    ASSERT_EQ(nodes[2], to);
+
+    // Moving the primary to node 0 would make node 0 as hot as node 1.
+    partitions[READ_HOT_PARTITION].__set_hp_secondaries({nodes[0]});
+    ASSERT_FALSE(find_read_hotspot_move(partitions, partition_index, from, to));
+    clear_calculator_histories();
+}
+
+TEST_P(hotspot_partition_test, write_hot_table)
+{
+    PRESERVE_FLAG(hotspot_split_write_qps_threshold);
+    FLAGS_hotspot_split_write_qps_threshold = 500;
+    for (int i = 0; i < FLAGS_occurrence_threshold; i++) {
+        calculator.data_aggregate(generate_row_data());
+        calculator.data_analyse();
+    }
+    ASSERT_EQ(FLAGS_occurrence_threshold, write_hot_table_counter());
+
+    FLAGS_hotspot_split_write_qps_threshold = 2000;
+    calculator.data_aggregate(generate_row_data());
+    calculator.data_analyse();
+    ASSERT_EQ(FLAGS_occurrence_threshold - 1, write_hot_table_counter());
+    clear_calculator_histories();
+}
+
+TEST(hotspot_remediation_limiter_test, try_acquire)
+{
+    PRESERVE_FLAG(hotspot_remediation_table_interval_seconds);
+    PRESERVE_FLAG(max_hotspot_remediations_per_hour);
+    FLAGS_hotspot_remediation_table_interval_seconds = 600;
+    FLAGS_max_hotspot_remediations_per_hour = 2;
+
+    hotspot_remediation_limiter limiter;
+    ASSERT_TRUE(limiter.try_acquire("t1", 1000));
+    // The same table could not be remediated again within the interval.
+    ASSERT_FALSE(limiter.try_acquire("t1", 1500));
+    ASSERT_TRUE(limiter.try_acquire("t2", 1500));
+    // At most 2 remediations in one hour.
+    ASSERT_FALSE(limiter.try_acquire("t1", 2000));
+    ASSERT_FALSE(limiter.try_acquire("t3", 4000));
+    ASSERT_TRUE(limiter.try_acquire("t3", 4600));
+}
+
 } // namespace server
 } // namespace pegasus
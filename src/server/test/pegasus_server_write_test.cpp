@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "base/pegasus_key_schema.h"
+#include "base/pegasus_value_schema.h"
 #include "common/gpid.h"
 #include "gtest/gtest.h"
 #include "message_utils.h"
@@ -127,6 +128,69 @@ public:
         dsn::fail::teardown();
     }
 
+    void test_batch_atomic_writes()
+    {
+        RPC_MOCKING(put_rpc) RPC_MOCKING(incr_rpc) RPC_MOCKING(check_and_set_rpc)
+        {
+            dsn::blob key;
+            pegasus_generate_key(key, std::string("hash"), std::string("counter"));
+            dsn::apps::update_request put;
+            put.key = key;
+            put.value.assign("1", 0, 1);
+
+            dsn::apps::incr_request incr;
+            incr.key = key;
+            incr.increment = 2;
+
+            // Each write reads the results of the previous ones in the same batch.
+            dsn::apps::check_and_set_request cas;
+            cas.hash_key.assign("hash", 0, 4);
+            cas.check_sort_key.assign("counter", 0, 7);
+            cas.check_type = dsn::apps::cas_check_type::CT_VALUE_INT_EQUAL;
+            cas.check_operand.assign("5", 0, 1);
+            cas.set_diff_sort_key = true;
+            cas.set_sort_key.assign("flag", 0, 4);
+            cas.set_value.assign("done", 0, 4);
+
+            dsn::message_ex *writes[] = {pegasus::create_put_request(put),
+                                         pegasus::create_incr_request(incr),
+                                         pegasus::create_incr_request(incr),
+                                         pegasus::create_check_and_set_request(cas)};
+            ASSERT_EQ(0, _server_write->on_batched_write_requests(writes, 4, 1, 0));
+
+            ASSERT_EQ(1, put_rpc::mail_box().size());
+            verify_response(put_rpc::mail_box()[0].response(), 0, 1);
+            ASSERT_EQ(2, incr_rpc::mail_box().size());
+            ASSERT_EQ(0, incr_rpc::mail_box()[0].response().error);
+            ASSERT_EQ(3, incr_rpc::mail_box()[0].response().new_value);
+            ASSERT_EQ(5, incr_rpc::mail_box()[1].response().new_value);
+            ASSERT_EQ(1, check_and_set_rpc::mail_box().size());
+            ASSERT_EQ(0, check_and_set_rpc::mail_box()[0].response().error);
+
+            // The writes of the batch are cleared after it is committed.
+            auto &wrapper = _server_write->_write_svc->_impl->_rocksdb_wrapper;
+            ASSERT_FALSE(wrapper->_track_batch_writes);
+            ASSERT_TRUE(wrapper->_batch_writes.empty());
+            ASSERT_TRUE(_server_write->_incr_rpc_batch.empty());
+            ASSERT_TRUE(_server_write->_check_and_set_rpc_batch.empty());
+            ASSERT_EQ(_server_write->_write_svc->_incr_batch_size, 0);
+
+            db_get_context get_ctx;
+            ASSERT_EQ(0, wrapper->get(key.to_string_view(), &get_ctx));
+            ASSERT_TRUE(get_ctx.found);
+            dsn::blob value;
+            pegasus_extract_user_data(
+                wrapper->_pegasus_data_version, std::move(get_ctx.raw_value), value);
+            ASSERT_EQ("5", value.to_string());
+
+            dsn::blob flag_key;
+            pegasus_generate_key(flag_key, std::string("hash"), std::string("flag"));
+            db_get_context flag_ctx;
+            ASSERT_EQ(0, wrapper->get(flag_key.to_string_view(), &flag_ctx));
+            ASSERT_TRUE(flag_ctx.found);
+        }
+    }
+
     void verify_response(const dsn::apps::update_response &response, int err, int64_t decree)
     {
         ASSERT_EQ(response.error, err);
@@ -141,5 +205,7 @@ INSTANTIATE_TEST_SUITE_P(, pegasus_server_write_test, ::testing::Values(false, t
 
 TEST_P(pegasus_server_write_test, batch_writes) { test_batch_writes(); }
 
+TEST_P(pegasus_server_write_test, batch_atomic_writes) { test_batch_atomic_writes(); }
+
 } // namespace server
 } // namespace pegasus
@@ -18,13 +18,22 @@
  */
 
 #include <fmt/core.h>
+#include <rocksdb/env.h>
+#include <rocksdb/options.h>
+#include <rocksdb/slice.h>
+#include <rocksdb/sst_file_writer.h>
 #include <rocksdb/status.h>
 #include <stdint.h>
 #include <limits>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "base/pegasus_value_schema.h"
+#include "bulk_load_types.h"
 #include "gtest/gtest.h"
+#include "metadata_types.h"
 #include "pegasus_key_schema.h"
 #include "pegasus_server_test_base.h"
 #include "rrdb/rrdb_types.h"
@@ -33,7 +42,11 @@
 #include "server/pegasus_write_service_impl.h"
 #include "server/rocksdb_wrapper.h"
 #include "utils/blob.h"
+#include "utils/env.h"
+#include "utils/error_code.h"
 #include "utils/fail_point.h"
+#include "utils/filesystem.h"
+#include "utils/test_macros.h"
 #include "absl/strings/string_view.h"
 
 namespace pegasus {
@@ -70,6 +83,13 @@ public:
         _write_impl->batch_put(write_ctx, put, put_resp);
         ASSERT_EQ(_write_impl->batch_commit(0), 0);
     }
+
+    uint32_t data_version() const { return _write_impl->_pegasus_data_version; }
+
+    static const char *ingestion_staging_dir()
+    {
+        return pegasus_write_service::impl::kIngestionStagingDir;
+    }
 };
 
 class incr_test : public pegasus_write_service_impl_test
@@ -181,5 +201,166 @@ TEST_P(incr_test, incr_on_expire_record)
     db_get(req.key.to_string_view(), &get_ctx);
     ASSERT_TRUE(get_ctx.found);
 }
+
+class ingest_files_test : public pegasus_write_service_impl_test
+{
+public:
+    void SetUp() override
+    {
+        pegasus_write_service_impl_test::SetUp();
+        ASSERT_TRUE(dsn::utils::filesystem::remove_path(kBulkLoadDir));
+        ASSERT_TRUE(dsn::utils::filesystem::create_directory(kBulkLoadDir));
+        for (int i = 0; i < kFileCount; ++i) {
+            NO_FATALS(generate_file(i));
+        }
+        _req.ballot = kBallot;
+        _req.verify_before_ingest = true;
+        _req.ingest_behind = false;
+    }
+
+    void TearDown() override { ASSERT_TRUE(dsn::utils::filesystem::remove_path(kBulkLoadDir)); }
+
+    static std::string gen_hash_key(int file_index, int i)
+    {
+        return fmt::format("hash_key_{}_{}", file_index, i);
+    }
+
+    void generate_file(int file_index)
+    {
+        dsn::replication::file_meta f_meta;
+        f_meta.name = fmt::format("{}.sst", file_index);
+        const auto path = dsn::utils::filesystem::path_combine(kBulkLoadDir, f_meta.name);
+        rocksdb::Options opts;
+        opts.env = dsn::utils::PegasusEnv(dsn::utils::FileDataType::kSensitive);
+        rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), opts);
+        auto s = writer.Open(path);
+        ASSERT_TRUE(s.ok()) << s.ToString();
+        pegasus_value_generator generator;
+        for (int i = 0; i < kRecordCount; ++i) {
+            dsn::blob key;
+            pegasus_generate_key(key, gen_hash_key(file_index, i), std::string("sort_key"));
+            const auto value = generator.generate_value(data_version(), "value", 0, 0);
+            std::string raw_value;
+            for (int j = 0; j < value.num_parts; ++j) {
+                raw_value.append(value.parts[j].data(), value.parts[j].size());
+            }
+            s = writer.Put(rocksdb::Slice(key.data(), key.length()), raw_value);
+            ASSERT_TRUE(s.ok()) << s.ToString();
+        }
+        s = writer.Finish();
+        ASSERT_TRUE(s.ok()) << s.ToString();
+
+        ASSERT_TRUE(dsn::utils::filesystem::file_size(
+            path, dsn::utils::FileDataType::kSensitive, f_meta.size));
+        ASSERT_EQ(dsn::ERR_OK, dsn::utils::filesystem::md5sum(path, f_meta.md5));
+        _req.metadata.files.emplace_back(std::move(f_meta));
+    }
+
+    dsn::error_code ingest_files(uint64_t max_group_size)
+    {
+        return _write_impl->ingest_files(1, kBulkLoadDir, _req, kBallot, max_group_size);
+    }
+
+    void check_ingested_files(int file_count)
+    {
+        for (int file_index = 0; file_index < kFileCount; ++file_index) {
+            for (int i = 0; i < kRecordCount; ++i) {
+                dsn::blob key;
+                pegasus_generate_key(key, gen_hash_key(file_index, i), std::string("sort_key"));
+                db_get_context get_ctx;
+                ASSERT_EQ(0, db_get(key.to_string_view(), &get_ctx));
+                ASSERT_EQ(file_index < file_count, get_ctx.found) << file_index;
+            }
+        }
+    }
+
+    // The original files should be kept, while the staging dir should be removed.
+    void check_external_files()
+    {
+        for (const auto &f_meta : _req.metadata.files) {
+            ASSERT_TRUE(dsn::utils::filesystem::verify_file(
+                dsn::utils::filesystem::path_combine(kBulkLoadDir, f_meta.name),
+                dsn::utils::FileDataType::kSensitive,
+                f_meta.md5,
+                f_meta.size));
+        }
+        ASSERT_FALSE(dsn::utils::filesystem::path_exists(
+            dsn::utils::filesystem::path_combine(kBulkLoadDir, ingestion_staging_dir())));
+    }
+
+    const std::string kBulkLoadDir = "ingest_files_test";
+    static constexpr int kFileCount = 3;
+    static constexpr int kRecordCount = 10;
+    static constexpr int64_t kBallot = 3;
+    dsn::replication::ingestion_request _req;
+};
+
+INSTANTIATE_TEST_SUITE_P(, ingest_files_test, ::testing::Values(false, true));
+
+TEST_P(ingest_files_test, ingest_in_groups)
+{
+    // Each file is ingested as a group.
+    ASSERT_EQ(dsn::ERR_OK, ingest_files(1));
+    NO_FATALS(check_ingested_files(kFileCount));
+    NO_FATALS(check_external_files());
+}
+
+TEST_P(ingest_files_test, first_group_failure)
+{
+    // Nothing is ingested if the first group fails.
+    dsn::fail::setup();
+    dsn::fail::cfg("db_ingest_files", "100%return(0.sst)");
+    ASSERT_EQ(dsn::ERR_INGESTION_FAILED, ingest_files(1));
+    NO_FATALS(check_ingested_files(0));
+    NO_FATALS(check_external_files());
+    dsn::fail::teardown();
+}
+
+TEST_P(ingest_files_test, partial_failure)
+{
+    // The ingestion of the second group fails after the first group has been ingested, which
+    // could not be rolled back.
+    dsn::fail::setup();
+    dsn::fail::cfg("db_ingest_files", "100%return(1.sst)");
+    ASSERT_EQ(dsn::ERR_INCONSISTENT_STATE, ingest_files(1));
+    NO_FATALS(check_ingested_files(1));
+    NO_FATALS(check_external_files());
+    dsn::fail::teardown();
+}
+
+TEST_P(ingest_files_test, damaged_file)
+{
+    // No file is ingested if any file is damaged.
+    _req.metadata.files.back().md5 = "damaged";
+    ASSERT_EQ(dsn::ERR_WRONG_CHECKSUM, ingest_files(1));
+    NO_FATALS(check_ingested_files(0));
+}
+
+TEST(split_external_files_test, split)
+{
+    dsn::replication::bulk_load_metadata metadata;
+    for (const auto size : {10, 20, 30, 100, 5}) {
+        dsn::replication::file_meta f_meta;
+        f_meta.name = fmt::format("{}.sst", metadata.files.size());
+        f_meta.size = size;
+        metadata.files.emplace_back(std::move(f_meta));
+    }
+
+    struct test_case
+    {
+        uint64_t max_group_size;
+        std::vector<std::pair<size_t, size_t>> expected_groups;
+    } tests[] = {{0, {{0, 5}}},
+                 {1000, {{0, 5}}},
+                 {30, {{0, 2}, {2, 3}, {3, 4}, {4, 5}}},
+                 {60, {{0, 3}, {3, 4}, {4, 5}}},
+                 {105, {{0, 3}, {3, 5}}}};
+    for (const auto &test : tests) {
+        ASSERT_EQ(test.expected_groups, split_external_files(metadata, test.max_group_size))
+            << test.max_group_size;
+    }
+
+    ASSERT_TRUE(split_external_files(dsn::replication::bulk_load_metadata(), 10).empty());
+}
 } // namespace server
 } // namespace pegasus
@@ -218,6 +218,7 @@ public:
         ASSERT_EQ(response.server, _write_svc->_impl->_primary_host_port);
         ASSERT_EQ(_write_svc->_impl->_rocksdb_wrapper->_write_batch->Count(), 0);
         ASSERT_EQ(_write_svc->_impl->_update_responses.size(), 0);
+        ASSERT_TRUE(_write_svc->_impl->_batch_failure_handlers.empty());
     }
 };
 
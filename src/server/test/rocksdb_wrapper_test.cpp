@@ -135,6 +135,83 @@ TEST_P(rocksdb_wrapper_test, get)
     ASSERT_EQ(user_value.to_string(), value);
 }
 
+TEST_P(rocksdb_wrapper_test, get_batch_writes)
+{
+    db_write_context write_ctx;
+    single_set(write_ctx, _raw_key, "abc", 0);
+
+    // The pending writes are invisible unless they are tracked.
+    ASSERT_EQ(0, _rocksdb_wrapper->write_batch_delete(0, _raw_key.to_string_view()));
+    db_get_context get_ctx1;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx1));
+    ASSERT_TRUE(get_ctx1.found);
+    _rocksdb_wrapper->clear_up_write_batch();
+
+    _rocksdb_wrapper->track_batch_writes();
+    ASSERT_EQ(0, _rocksdb_wrapper->write_batch_delete(0, _raw_key.to_string_view()));
+    db_get_context get_ctx2;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx2));
+    ASSERT_FALSE(get_ctx2.found);
+
+    // The latest write of the key is read.
+    const std::string value = "def";
+    ASSERT_EQ(0,
+              _rocksdb_wrapper->write_batch_put_ctx(
+                  write_ctx, _raw_key.to_string_view(), value, INT32_MAX));
+    db_get_context get_ctx3;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx3));
+    ASSERT_TRUE(get_ctx3.found);
+    ASSERT_FALSE(get_ctx3.expired);
+    ASSERT_EQ(INT32_MAX, get_ctx3.expire_ts);
+    dsn::blob user_value;
+    pegasus_extract_user_data(
+        _rocksdb_wrapper->_pegasus_data_version, std::move(get_ctx3.raw_value), user_value);
+    ASSERT_EQ(value, user_value.to_string());
+
+    // The tracked writes are dropped along with the batch.
+    _rocksdb_wrapper->clear_up_write_batch();
+    ASSERT_TRUE(_rocksdb_wrapper->_batch_writes.empty());
+    db_get_context get_ctx4;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx4));
+    pegasus_extract_user_data(
+        _rocksdb_wrapper->_pegasus_data_version, std::move(get_ctx4.raw_value), user_value);
+    ASSERT_EQ("abc", user_value.to_string());
+}
+
+TEST_P(rocksdb_wrapper_test, write_cache)
+{
+    // The record read from db is cached, even if it's not found.
+    db_get_context get_ctx1;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx1));
+    ASSERT_FALSE(get_ctx1.found);
+    ASSERT_EQ(1, _rocksdb_wrapper->_write_cache.size());
+
+    // The cached record is updated by the writes.
+    db_write_context write_ctx;
+    single_set(write_ctx, _raw_key, "abc", 0);
+    db_get_context get_ctx2;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx2));
+    ASSERT_TRUE(get_ctx2.found);
+    dsn::blob user_value;
+    pegasus_extract_user_data(
+        _rocksdb_wrapper->_pegasus_data_version, std::move(get_ctx2.raw_value), user_value);
+    ASSERT_EQ("abc", user_value.to_string());
+
+    ASSERT_EQ(0, _rocksdb_wrapper->write_batch_delete(0, _raw_key.to_string_view()));
+    ASSERT_EQ(0, _rocksdb_wrapper->write(0));
+    _rocksdb_wrapper->clear_up_write_batch();
+    db_get_context get_ctx3;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx3));
+    ASSERT_FALSE(get_ctx3.found);
+
+    // The cache is invalidated once the default ttl is changed.
+    _rocksdb_wrapper->set_default_ttl(100);
+    db_get_context get_ctx4;
+    ASSERT_EQ(0, _rocksdb_wrapper->get(_raw_key.to_string_view(), &get_ctx4));
+    ASSERT_FALSE(get_ctx4.found);
+    ASSERT_EQ(1, _rocksdb_wrapper->_write_cache.size());
+}
+
 TEST_P(rocksdb_wrapper_test, put_verify_timetag)
 {
     set_app_duplicating();
@@ -0,0 +1,112 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "server/write_cache.h"
+
+#include <rocksdb/write_batch.h>
+#include <stdint.h>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "test_util/test_util.h"
+#include "utils/flags.h"
+
+DSN_DECLARE_uint64(write_cache_capacity_bytes);
+
+namespace pegasus {
+namespace server {
+
+TEST(write_cache_test, get_and_put)
+{
+    write_cache cache;
+    bool found = false;
+    std::string value;
+    ASSERT_FALSE(cache.get("a", found, value));
+
+    cache.put("a", true, "1");
+    ASSERT_TRUE(cache.get("a", found, value));
+    ASSERT_TRUE(found);
+    ASSERT_EQ("1", value);
+
+    // The absence of the record is cached as well.
+    cache.put("b", false, "");
+    ASSERT_TRUE(cache.get("b", found, value));
+    ASSERT_FALSE(found);
+
+    // The empty key is never cached.
+    cache.put("", true, "1");
+    ASSERT_EQ(2, cache.size());
+
+    cache.invalidate();
+    ASSERT_FALSE(cache.get("a", found, value));
+    ASSERT_TRUE(cache.empty());
+    ASSERT_EQ(0, cache.bytes());
+}
+
+TEST(write_cache_test, apply_write_batch)
+{
+    write_cache cache;
+    cache.put("a", true, "1");
+    cache.put("b", true, "2");
+
+    rocksdb::WriteBatch batch;
+    ASSERT_TRUE(batch.Put("a", "3").ok());
+    ASSERT_TRUE(batch.Delete("b").ok());
+    ASSERT_TRUE(batch.Put("c", "4").ok());
+    cache.apply(batch);
+
+    // Only the cached keys are updated.
+    bool found = false;
+    std::string value;
+    ASSERT_TRUE(cache.get("a", found, value));
+    ASSERT_TRUE(found);
+    ASSERT_EQ("3", value);
+    ASSERT_TRUE(cache.get("b", found, value));
+    ASSERT_FALSE(found);
+    ASSERT_FALSE(cache.get("c", found, value));
+}
+
+TEST(write_cache_test, evict_by_bytes)
+{
+    PRESERVE_FLAG(write_cache_capacity_bytes);
+
+    write_cache cache;
+    cache.put("a", true, std::string(100, 'x'));
+    const auto entry_bytes = cache.bytes();
+    FLAGS_write_cache_capacity_bytes = entry_bytes * 2;
+
+    // The least recently used key "b" is evicted.
+    cache.put("b", true, std::string(100, 'x'));
+    bool found = false;
+    std::string value;
+    ASSERT_TRUE(cache.get("a", found, value));
+    cache.put("c", true, std::string(100, 'x'));
+    ASSERT_EQ(2, cache.size());
+    ASSERT_EQ(entry_bytes * 2, cache.bytes());
+    ASSERT_TRUE(cache.get("a", found, value));
+    ASSERT_FALSE(cache.get("b", found, value));
+    ASSERT_TRUE(cache.get("c", found, value));
+
+    // The cache is disabled by 0.
+    FLAGS_write_cache_capacity_bytes = 0;
+    ASSERT_FALSE(cache.get("a", found, value));
+    cache.put("a", true, "1");
+    ASSERT_TRUE(cache.empty());
+}
+
+} // namespace server
+} // namespace pegasus
@@ -0,0 +1,187 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "write_cache.h"
+
+#include <boost/container_hash/extensions.hpp>
+#include <rocksdb/slice.h>
+#include <rocksdb/status.h>
+#include <rocksdb/write_batch.h>
+
+#include "utils/flags.h"
+#include "utils/fmt_logging.h"
+#include "utils/ports.h"
+
+DSN_DEFINE_uint64(pegasus.server,
+                  write_cache_capacity_bytes,
+                  1024 * 1024,
+                  "The max total bytes of the keys and values cached for the read-before-writes "
+                  "of each replica, such as INCR and CHECK_AND_SET, 0 means disabling the cache");
+DSN_TAG_VARIABLE(write_cache_capacity_bytes, FT_MUTABLE);
+
+namespace pegasus {
+namespace server {
+
+// Applies the records of the data column family, whose id is always 0 since it's the default
+// column family of RocksDB.
+class write_cache::updater : public rocksdb::WriteBatch::Handler
+{
+public:
+    explicit updater(write_cache *cache) : _cache(cache) {}
+
+    rocksdb::Status PutCF(uint32_t column_family_id,
+                          const rocksdb::Slice &key,
+                          const rocksdb::Slice &value) override
+    {
+        if (column_family_id == 0) {
+            _cache->update(absl::string_view(key.data(), key.size()),
+                           true,
+                           absl::string_view(value.data(), value.size()));
+        }
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status DeleteCF(uint32_t column_family_id, const rocksdb::Slice &key) override
+    {
+        if (column_family_id == 0) {
+            _cache->update(absl::string_view(key.data(), key.size()), false, absl::string_view());
+        }
+        return rocksdb::Status::OK();
+    }
+
+private:
+    write_cache *_cache;
+};
+
+size_t write_cache::string_view_hash::operator()(absl::string_view key) const
+{
+    return boost::hash_range(key.begin(), key.end());
+}
+
+bool write_cache::get(absl::string_view raw_key,
+                      /*out*/ bool &found,
+                      /*out*/ std::string &raw_value)
+{
+    if (check_capacity() == 0) {
+        return false;
+    }
+
+    const auto iter = _index.find(raw_key);
+    if (iter == _index.end()) {
+        return false;
+    }
+
+    _lru.splice(_lru.begin(), _lru, iter->second);
+    found = iter->second->found;
+    if (found) {
+        raw_value = iter->second->raw_value;
+    }
+    return true;
+}
+
+void write_cache::put(absl::string_view raw_key, bool found, absl::string_view raw_value)
+{
+    const auto capacity = check_capacity();
+    if (capacity == 0 || raw_key.empty()) {
+        return;
+    }
+
+    const auto iter = _index.find(raw_key);
+    if (iter != _index.end()) {
+        _lru.splice(_lru.begin(), _lru, iter->second);
+        update(raw_key, found, raw_value);
+        evict(capacity);
+        return;
+    }
+
+    _lru.push_front({std::string(raw_key), found, found ? std::string(raw_value) : std::string()});
+    _index.emplace(_lru.front().raw_key, _lru.begin());
+    _bytes += charge(_lru.front());
+    evict(capacity);
+}
+
+void write_cache::apply(const rocksdb::WriteBatch &batch)
+{
+    if (check_capacity() == 0 || _lru.empty()) {
+        return;
+    }
+
+    updater handler(this);
+    const auto s = batch.Iterate(&handler);
+    if (dsn_unlikely(!s.ok())) {
+        // Never serve the records which might have been overwritten.
+        LOG_ERROR("iterate write batch failed, clear the write cache: {}", s.ToString());
+        clear();
+    }
+}
+
+void write_cache::clear()
+{
+    _index.clear();
+    _lru.clear();
+    _bytes = 0;
+}
+
+void write_cache::update(absl::string_view raw_key, bool found, absl::string_view raw_value)
+{
+    const auto iter = _index.find(raw_key);
+    if (iter == _index.end()) {
+        return;
+    }
+
+    auto &e = *iter->second;
+    _bytes -= charge(e);
+    e.found = found;
+    if (found) {
+        e.raw_value.assign(raw_value.data(), raw_value.size());
+    } else {
+        e.raw_value.clear();
+    }
+    _bytes += charge(e);
+}
+
+uint64_t write_cache::check_capacity()
+{
+    if (dsn_unlikely(_invalidated.exchange(false, std::memory_order_acq_rel))) {
+        clear();
+    }
+
+    const auto capacity = FLAGS_write_cache_capacity_bytes;
+    if (capacity == 0) {
+        clear();
+    }
+    return capacity;
+}
+
+void write_cache::evict(uint64_t capacity)
+{
+    while (_bytes > capacity && !_lru.empty()) {
+        const auto &e = _lru.back();
+        _bytes -= charge(e);
+        _index.erase(e.raw_key);
+        _lru.pop_back();
+    }
+}
+
+uint64_t write_cache::charge(const entry &e)
+{
+    // Besides the key and value, each entry costs a list node and a hash map node.
+    return e.raw_key.size() + e.raw_value.size() + sizeof(entry) + 4 * sizeof(void *);
+}
+
+} // namespace server
+} // namespace pegasus
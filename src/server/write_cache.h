@@ -0,0 +1,105 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "absl/strings/string_view.h"
+
+namespace rocksdb {
+class WriteBatch;
+} // namespace rocksdb
+
+namespace pegasus {
+namespace server {
+
+// write_cache keeps the latest raw values (including the expire_ts and the timetag) of the keys
+// recently read by the write path of a replica, so that the read-before-writes of INCR,
+// CHECK_AND_SET, CHECK_AND_MUTATE and the duplicated writes verifying timetag could be served
+// without RocksDB point lookups. The absence of a record is cached as well.
+//
+// The keys are only cached by the reads, and their records are kept up to date by the write
+// batches written into RocksDB, see apply(). The cache is bounded by the total bytes of the keys
+// and values, the least recently used ones are evicted once FLAGS_write_cache_capacity_bytes is
+// exceeded, and 0 disables the cache.
+//
+// Not thread-safe except invalidate(), it's only accessed by the write thread of the replica.
+class write_cache
+{
+public:
+    write_cache() = default;
+
+    // Returns false if `raw_key` is not cached, otherwise `found` is set to whether the record
+    // exists, and `raw_value` to its raw value if it does.
+    bool get(absl::string_view raw_key, /*out*/ bool &found, /*out*/ std::string &raw_value);
+
+    // Cache the record of `raw_key` read from RocksDB, `found` is false if it does not exist.
+    void put(absl::string_view raw_key, bool found, absl::string_view raw_value);
+
+    // Update the cached records by the records written by `batch` into the data column family.
+    // It must be called once `batch` is written into RocksDB.
+    void apply(const rocksdb::WriteBatch &batch);
+
+    void clear();
+
+    // Drop all the cached records before the next access, while RocksDB is modified out of the
+    // write path, e.g. ingesting files. Thread-safe.
+    void invalidate() { _invalidated.store(true, std::memory_order_release); }
+
+    bool empty() const { return _lru.empty(); }
+    size_t size() const { return _lru.size(); }
+    uint64_t bytes() const { return _bytes; }
+
+private:
+    struct entry
+    {
+        std::string raw_key;
+        bool found;
+        std::string raw_value;
+    };
+
+    struct string_view_hash
+    {
+        size_t operator()(absl::string_view key) const;
+    };
+
+    class updater;
+
+    // Update the record of `raw_key` only if it has been cached.
+    void update(absl::string_view raw_key, bool found, absl::string_view raw_value);
+    // Returns the capacity, all the records are dropped if the cache is invalidated or disabled.
+    uint64_t check_capacity();
+    void evict(uint64_t capacity);
+
+    static uint64_t charge(const entry &e);
+
+    // the most recently used entry is at the front
+    std::list<entry> _lru;
+    // the keys refer to the raw keys of the entries in _lru, whose nodes are never moved
+    std::unordered_map<absl::string_view, std::list<entry>::iterator, string_view_hash> _index;
+    uint64_t _bytes{0};
+    std::atomic<bool> _invalidated{false};
+};
+
+} // namespace server
+} // namespace pegasus
@@ -43,6 +43,7 @@
 #include <rrdb/rrdb_types.h>
 
 #include "base/pegasus_key_schema.h"
+#include "base/pegasus_scan_stat.h"
 #include "base/pegasus_utils.h"
 #include "base/pegasus_value_schema.h"
 #include "client/replication_ddl_client.h"
@@ -172,6 +173,11 @@ struct scan_data_context
     bool count_hash_key;
     std::string last_hash_key;
     std::atomic_long split_hash_key_count;
+    // if set true, the hash keys are counted and the sizes are aggregated on the server side
+    // by the count-only scanner, and the results are merged into 'split_stat'.
+    bool server_stat;
+    dsn::apps::scan_stat split_stat;
+    mutable dsn::utils::ex_lock_nr split_stat_lock;
 
     long data_count;
     uint32_t multi_ttl_seconds;
@@ -211,6 +217,7 @@ struct scan_data_context
           top_rows(top_count_),
           count_hash_key(count_hash_key_),
           split_hash_key_count(0),
+          server_stat(false),
           data_count(0),
           multi_ttl_seconds(0),
           sema(max_multi_set_concurrency)
@@ -230,6 +237,16 @@ struct scan_data_context
         value_filter_pattern = pattern;
     }
     void set_no_overwrite() { no_overwrite = true; }
+    void set_server_stat()
+    {
+        server_stat = true;
+        pegasus::init_scan_stat(split_stat);
+    }
+    dsn::apps::scan_stat get_split_stat() const
+    {
+        dsn::utils::auto_lock<dsn::utils::ex_lock_nr> l(split_stat_lock);
+        return split_stat;
+    }
 };
 inline void update_atomic_max(std::atomic_long &max, long value)
 {
@@ -296,6 +313,19 @@ validate_filter(scan_data_context *context, const std::string &sort_key, const s
     return validate_filter(context->value_filter_type, context->value_filter_pattern, value);
 }
 
+// merge the statistics aggregated by the server for the batch just counted
+inline bool merge_batch_stats(scan_data_context *context)
+{
+    pegasus::pegasus_client::scan_stats stats;
+    if (!context->scanner->get_batch_stats(stats)) {
+        return false;
+    }
+    context->split_hash_key_count += stats.hash_key_count;
+    dsn::utils::auto_lock<dsn::utils::ex_lock_nr> l(context->split_stat_lock);
+    pegasus::merge_scan_stat(stats, context->split_stat);
+    return true;
+}
+
 inline int compute_ttl_seconds(uint32_t expire_ts_seconds, bool &ts_expired)
 {
     auto epoch_now = pegasus::utils::epoch_now();
@@ -525,6 +555,16 @@ inline void scan_data_next(scan_data_context *context)
                     case SCAN_COUNT:
                         if (kv_count != -1) {
                             context->split_rows += kv_count;
+                            if (context->server_stat && !merge_batch_stats(context)) {
+                                if (!context->split_completed.exchange(true)) {
+                                    fprintf(stderr,
+                                            "ERROR: split[%d] server doesn't support returning "
+                                            "scan stat\n",
+                                            context->split_id);
+                                    context->error_occurred->store(true);
+                                }
+                                break;
+                            }
                             scan_data_next(context);
                             break;
                         }
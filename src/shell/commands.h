@@ -288,3 +288,10 @@ bool detect_hotkey(command_executor *e, shell_context *sc, arguments args);
 // == local partition split (see 'commands/local_partition_split.cpp') == //
 extern const std::string local_partition_split_help;
 bool local_partition_split(command_executor *e, shell_context *sc, arguments args);
+
+// == local bulk load export (see 'commands/local_bulk_load_export.cpp') == //
+extern const std::string local_bulk_load_export_help;
+bool local_bulk_load_export(command_executor *e, shell_context *sc, arguments args);
+
+extern const std::string finalize_bulk_load_export_help;
+bool finalize_bulk_load_export(command_executor *e, shell_context *sc, arguments args);
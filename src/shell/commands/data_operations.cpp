@@ -78,7 +78,8 @@ print_current_scan_state(const std::vector<std::unique_ptr<scan_data_context>> &
                          const std::string &stop_desc,
                          bool stat_size,
                          std::shared_ptr<rocksdb::Statistics> statistics,
-                         bool count_hash_key);
+                         bool count_hash_key,
+                         bool server_stat);
 
 void escape_sds_argv(int argc, sds *argv);
 int mutation_check(int args_count, sds *args);
@@ -2536,13 +2537,21 @@ bool count_data(command_executor *e, shell_context *sc, arguments args)
 
     // Decide whether real data should be returned to client. Once the real data is
     // decided not to be returned to client side: option `only_return_count` will be
-    // used.
-    if (diff_hash_key || stat_size || value_filter_type != pegasus::pegasus_client::FT_NO_FILTER ||
-        sort_key_filter_type == pegasus::pegasus_client::FT_MATCH_EXACT) {
+    // used. The hash keys and the sizes could also be aggregated on the server side
+    // unless the top rows are required.
+    bool server_stat = false;
+    if (value_filter_type != pegasus::pegasus_client::FT_NO_FILTER ||
+        sort_key_filter_type == pegasus::pegasus_client::FT_MATCH_EXACT ||
+        ((diff_hash_key || stat_size) && top_count > 0)) {
         options.only_return_count = false;
     } else {
         options.only_return_count = true;
         fprintf(stderr, "INFO: scanner only return kv count, not return value\n");
+        if (diff_hash_key || stat_size) {
+            server_stat = true;
+            options.return_stat = true;
+            fprintf(stderr, "INFO: scanner aggregate hash key count and size stat on server\n");
+        }
     }
 
     int ret = sc->pg_client->get_unordered_scanners(INT_MAX, options, raw_scanners);
@@ -2590,6 +2599,9 @@ bool count_data(command_executor *e, shell_context *sc, arguments args)
                                                            diff_hash_key);
         context->set_sort_key_filter(sort_key_filter_type, sort_key_filter_pattern);
         context->set_value_filter(value_filter_type, value_filter_pattern);
+        if (server_stat) {
+            context->set_server_stat();
+        }
         contexts.emplace_back(context);
         dsn::tasking::enqueue(LPC_SCAN_DATA, nullptr, std::bind(scan_data_next, context));
     }
@@ -2649,7 +2661,8 @@ bool count_data(command_executor *e, shell_context *sc, arguments args)
             break;
         last_total_rows = cur_total_rows;
         if (stat_size && sleep_seconds % 10 == 0) {
-            print_current_scan_state(contexts, "partially", stat_size, statistics, diff_hash_key);
+            print_current_scan_state(
+                contexts, "partially", stat_size, statistics, diff_hash_key, server_stat);
         }
     }
 
@@ -2672,7 +2685,8 @@ bool count_data(command_executor *e, shell_context *sc, arguments args)
         stop_desc = "done";
     }
 
-    print_current_scan_state(contexts, stop_desc, stat_size, statistics, diff_hash_key);
+    print_current_scan_state(
+        contexts, stop_desc, stat_size, statistics, diff_hash_key, server_stat);
 
     if (stat_size) {
         if (top_count > 0) {
@@ -2800,12 +2814,65 @@ int mutation_check(int args_count, sds *args)
     return ret;
 }
 
+// print the statistics aggregated on the server side, see pegasus_scan_stat.h
+static void print_server_scan_stat(const std::vector<std::unique_ptr<scan_data_context>> &contexts,
+                                   long total_rows)
+{
+    dsn::apps::scan_stat total;
+    pegasus::init_scan_stat(total);
+    for (const auto &context : contexts) {
+        pegasus::merge_scan_stat(context->get_split_stat(), total);
+    }
+
+    const auto percent = [total_rows](int64_t value) {
+        return total_rows > 0 ? value * 100.0 / total_rows : 0.0;
+    };
+    const auto average = [total_rows](int64_t sum) {
+        return total_rows > 0 ? sum * 1.0 / total_rows : 0.0;
+    };
+
+    fprintf(stderr,
+            "\n============================[average_size]=============================\n"
+            "hash_key_size = %.2f, sort_key_size = %.2f, value_size = %.2f\n"
+            "=======================================================================",
+            average(total.hash_key_size_sum),
+            average(total.sort_key_size_sum),
+            average(total.value_size_sum));
+
+    fprintf(stderr,
+            "\n===============================[row_size]==============================\n");
+    for (size_t i = 0; i < total.row_size_histogram.size(); ++i) {
+        if (total.row_size_histogram[i] > 0) {
+            fprintf(stderr,
+                    "%-28s %20" PRId64 " %12.2f%%\n",
+                    pegasus::scan_stat_size_bucket_name(i).c_str(),
+                    total.row_size_histogram[i],
+                    percent(total.row_size_histogram[i]));
+        }
+    }
+    fprintf(stderr, "=======================================================================");
+
+    fprintf(stderr,
+            "\n==================================[ttl]================================\n");
+    for (size_t i = 0; i < total.ttl_histogram.size(); ++i) {
+        if (total.ttl_histogram[i] > 0) {
+            fprintf(stderr,
+                    "%-28s %20" PRId64 " %12.2f%%\n",
+                    pegasus::scan_stat_ttl_bucket_name(i),
+                    total.ttl_histogram[i],
+                    percent(total.ttl_histogram[i]));
+        }
+    }
+    fprintf(stderr, "=======================================================================\n\n");
+}
+
 static void
 print_current_scan_state(const std::vector<std::unique_ptr<scan_data_context>> &contexts,
                          const std::string &stop_desc,
                          bool stat_size,
                          std::shared_ptr<rocksdb::Statistics> statistics,
-                         bool count_hash_key)
+                         bool count_hash_key,
+                         bool server_stat)
 {
     long total_rows = 0;
     long total_hash_key_count = 0;
@@ -2828,7 +2895,9 @@ print_current_scan_state(const std::vector<std::unique_ptr<scan_data_context>> &
         fprintf(stderr, "\n");
     }
 
-    if (stat_size) {
+    if (stat_size && server_stat) {
+        print_server_scan_stat(contexts, total_rows);
+    } else if (stat_size) {
         fprintf(stderr,
                 "\n============================[hash_key_size]============================\n"
                 "%s=======================================================================",
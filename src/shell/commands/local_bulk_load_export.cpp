@@ -0,0 +1,672 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+// IWYU pragma: no_include <ext/alloc_traits.h>
+#include <fmt/core.h>
+#include <fmt/format.h>
+#include <rocksdb/db.h>
+#include <rocksdb/env.h>
+#include <rocksdb/iterator.h>
+#include <rocksdb/options.h>
+#include <rocksdb/slice.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/threadpool.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/meta_store.h"
+#include "base/pegasus_key_schema.h"
+#include "base/pegasus_utils.h"
+#include "block_service/block_service_manager.h"
+#include "bulk_load_types.h"
+#include "client/partition_resolver.h"
+#include "client/replication_ddl_client.h"
+#include "common/bulk_load_common.h"
+#include "common/gpid.h"
+#include "common/json_helper.h"
+#include "common/replica_envs.h"
+#include "common/replication.codes.h"
+#include "common/replication_common.h"
+#include "dsn.layer2_types.h"
+#include "meta/meta_bulk_load_service.h"
+#include "metadata_types.h"
+#include "pegasus_value_schema.h"
+#include "replica/mutation.h"
+#include "replica/mutation_log.h"
+#include "replica/replica_stub.h"
+#include "replica/replication_app_base.h"
+#include "shell/argh.h"
+#include "shell/command_executor.h"
+#include "shell/command_helper.h"
+#include "shell/commands.h"
+#include "utils/blob.h"
+#include "utils/env.h"
+#include "utils/error_code.h"
+#include "utils/filesystem.h"
+#include "utils/fmt_logging.h"
+#include "utils/output_utils.h"
+#include "absl/strings/string_view.h"
+
+const std::string local_bulk_load_export_help =
+    "<src_data_dirs> <src_app_id> <src_partition_ids> <dst_partition_count> <file_provider> "
+    "<remote_root_path> <dst_cluster_name> <dst_app_name> [--tmp_dir dir] "
+    "[--threads num] [--max_file_size_mb num] [--dst_data_version num]";
+
+const std::string finalize_bulk_load_export_help =
+    "<file_provider> <remote_root_path> <dst_cluster_name> <dst_app_name> <dst_app_id> "
+    "<src_partition_count> <dst_partition_count>";
+
+namespace {
+
+struct LocalBulkLoadExportContext
+{
+    // Parameters from the command line.
+    std::vector<std::string> src_data_dirs;
+    uint32_t src_app_id = 0;
+    std::set<uint32_t> src_partition_ids;
+    uint32_t dst_partition_count = 0;
+    std::string file_provider;
+    std::string remote_root_path;
+    std::string dst_cluster_name;
+    std::string dst_app_name;
+    std::string tmp_dir;
+    uint32_t threads = 1;
+    uint32_t max_file_size_mb = 256;
+    uint32_t dst_data_version = pegasus::PEGASUS_DATA_VERSION_MAX;
+
+    dsn::dist::block_service::block_service_manager *bsm = nullptr;
+    dsn::dist::block_service::block_filesystem *fs = nullptr;
+};
+
+struct ToExportPartition
+{
+    std::string replica_dir;
+    int32_t pidx = 0;
+};
+
+struct PartitionExportResult
+{
+    std::string src_replica_dir;
+    std::string checkpoint_dir;
+    bool success = false;
+    uint64_t exported_count = 0;
+    uint64_t expired_count = 0;
+    uint64_t exported_size = 0;
+};
+
+// The rocksdb files exported for the <dst_pidx> partition of the target table from the
+// <src_pidx> partition of the source table, they are merged into the bulk load metadata of
+// the target partition by 'finalize_bulk_load_export'.
+std::string get_metadata_fragment_name(uint32_t src_pidx)
+{
+    return fmt::format("{}.{}", dsn::replication::bulk_load_constant::BULK_LOAD_METADATA, src_pidx);
+}
+
+// See replica_bulk_loader::get_remote_bulk_load_dir() for the layout.
+std::string get_remote_partition_dir(const std::string &remote_root_path,
+                                     const std::string &cluster_name,
+                                     const std::string &app_name,
+                                     uint32_t pidx)
+{
+    return fmt::format("{}/{}/{}/{}", remote_root_path, cluster_name, app_name, pidx);
+}
+
+// Return the checkpoint with the largest decree in the replica, which is generated by the
+// replica server periodically and never changed once generated.
+bool find_latest_checkpoint(const std::string &replica_dir,
+                            std::string &checkpoint_dir,
+                            int64_t &checkpoint_decree)
+{
+    const auto data_dir = dsn::utils::filesystem::path_combine(
+        replica_dir, dsn::replication::replication_app_base::kDataDir);
+    std::vector<std::string> sub_dirs;
+    RETURN_FALSE_IF_NOT(dsn::utils::filesystem::get_subdirectories(data_dir, sub_dirs, false),
+                        "get sub-directories from '{}' failed",
+                        data_dir);
+
+    int64_t max_decree = -1;
+    for (const auto &sub_dir : sub_dirs) {
+        int64_t decree = 0;
+        const auto name = dsn::utils::filesystem::get_file_name(sub_dir);
+        if (sscanf(name.c_str(), "checkpoint.%" PRId64, &decree) == 1 &&
+            name == fmt::format("checkpoint.{}", decree) && decree > max_decree) {
+            max_decree = decree;
+            checkpoint_dir = sub_dir;
+        }
+    }
+    RETURN_FALSE_IF_NOT(max_decree >= 0, "no checkpoint found in '{}'", data_dir);
+    checkpoint_decree = max_decree;
+    return true;
+}
+
+// The checkpoint is exported rather than the latest data, thus the writes made after it would
+// be silently missing from the target table. Make sure there is no such write, i.e. no mutation
+// in the private log of the replica has a larger decree than the checkpoint, except the empty
+// writes made by the idle primaries.
+bool check_no_write_after_checkpoint(const std::string &replica_dir, int64_t checkpoint_decree)
+{
+    const auto plog_dir = dsn::utils::filesystem::path_combine(replica_dir, "plog");
+    std::vector<std::string> log_files;
+    RETURN_FALSE_IF_NOT(dsn::utils::filesystem::get_subfiles(plog_dir, log_files, false),
+                        "get files from '{}' failed",
+                        plog_dir);
+
+    int64_t max_write_decree = 0;
+    int64_t end_offset = 0;
+    const auto err = dsn::replication::mutation_log::replay(
+        log_files,
+        [&max_write_decree](int log_length, dsn::replication::mutation_ptr &mu) {
+            for (const auto &update : mu->data.updates) {
+                if (update.code != RPC_REPLICATION_WRITE_EMPTY) {
+                    max_write_decree = std::max(max_write_decree, mu->data.header.decree);
+                    break;
+                }
+            }
+            return true;
+        },
+        end_offset);
+    RETURN_FALSE_IF_NON_OK(err, "replay the private log in '{}' failed", plog_dir);
+    RETURN_FALSE_IF_NOT(max_write_decree <= checkpoint_decree,
+                        "the writes up to decree {} have been made after the checkpoint of "
+                        "decree {} in '{}', stop writing the source table (e.g. set its '{}' "
+                        "env to 'reconfig*write') and export again once a newer checkpoint has "
+                        "been generated",
+                        max_write_decree,
+                        checkpoint_decree,
+                        replica_dir,
+                        dsn::replica_envs::DENY_CLIENT_REQUEST);
+    return true;
+}
+
+// Write the records to sst files of the target partition, the records must be added in
+// ascending order, and a new file will be started once the current one is full.
+class partition_sst_writer
+{
+public:
+    partition_sst_writer(std::string dir, uint32_t src_pidx, uint64_t max_file_size)
+        : _dir(std::move(dir)), _src_pidx(src_pidx), _max_file_size(max_file_size)
+    {
+    }
+
+    bool put(const rocksdb::Slice &key, const rocksdb::Slice &value)
+    {
+        if (!_writer) {
+            RETURN_FALSE_IF_NOT(dsn::utils::filesystem::create_directory(_dir),
+                                "create directory '{}' failed",
+                                _dir);
+            _files.emplace_back(fmt::format("{}_{}.sst", _src_pidx, _files.size()));
+            const auto path = dsn::utils::filesystem::path_combine(_dir, _files.back());
+            rocksdb::Options opts;
+            opts.env = dsn::utils::PegasusEnv(dsn::utils::FileDataType::kSensitive);
+            _writer = std::make_unique<rocksdb::SstFileWriter>(rocksdb::EnvOptions(), opts);
+            RETURN_FALSE_IF_NON_RDB_OK(_writer->Open(path), "open writer file '{}' failed", path);
+        }
+
+        RETURN_FALSE_IF_NON_RDB_OK(
+            _writer->Put(key, value), "write data to file '{}' failed", _files.back());
+        if (_writer->FileSize() >= _max_file_size) {
+            return finish();
+        }
+        return true;
+    }
+
+    bool finish()
+    {
+        if (!_writer) {
+            return true;
+        }
+        RETURN_FALSE_IF_NON_RDB_OK(
+            _writer->Finish(nullptr), "finalize writer file '{}' failed", _files.back());
+        _writer.reset();
+        return true;
+    }
+
+    const std::string &dir() const { return _dir; }
+    const std::vector<std::string> &files() const { return _files; }
+
+private:
+    const std::string _dir;
+    const uint32_t _src_pidx;
+    const uint64_t _max_file_size;
+    std::vector<std::string> _files;
+    std::unique_ptr<rocksdb::SstFileWriter> _writer;
+};
+
+// Convert the raw rocksdb value from the data version of the source table to that of the
+// target table. The timetag is unknown for the v0 values, so 0 is used, which means the
+// converted records are older than any record written to the target table.
+std::string convert_value(uint32_t src_data_version,
+                          uint32_t dst_data_version,
+                          absl::string_view value)
+{
+    const auto expire_ts = pegasus::pegasus_extract_expire_ts(src_data_version, value);
+    const uint64_t timetag =
+        src_data_version == 1 ? pegasus::pegasus_extract_timetag(src_data_version, value) : 0;
+    const auto user_data_length =
+        pegasus::pegasus_extract_user_data_length(src_data_version, value);
+    pegasus::pegasus_value_generator generator;
+    const auto parts = generator.generate_value(dst_data_version,
+                                                value.substr(value.length() - user_data_length),
+                                                expire_ts,
+                                                timetag);
+    std::string converted_value;
+    for (int i = 0; i < parts.num_parts; i++) {
+        converted_value.append(parts.parts[i].data(), parts.parts[i].size());
+    }
+    return converted_value;
+}
+
+bool export_checkpoint(const LocalBulkLoadExportContext &lbec,
+                       std::vector<partition_sst_writer> &writers,
+                       PartitionExportResult &per)
+{
+    // 1. Open the checkpoint in read-only mode.
+    const std::vector<rocksdb::ColumnFamilyDescriptor> cf_dscs(
+        {{pegasus::server::meta_store::DATA_COLUMN_FAMILY_NAME, {}},
+         {pegasus::server::meta_store::META_COLUMN_FAMILY_NAME, {}}});
+    std::vector<rocksdb::ColumnFamilyHandle *> cf_hdls;
+    rocksdb::DB *db = nullptr;
+    rocksdb::DBOptions db_opts;
+    db_opts.env = dsn::utils::PegasusEnv(dsn::utils::FileDataType::kSensitive);
+    RETURN_FALSE_IF_NON_RDB_OK(
+        rocksdb::DB::OpenForReadOnly(db_opts, per.checkpoint_dir, cf_dscs, &cf_hdls, &db),
+        "open rocksdb in '{}' failed",
+        per.checkpoint_dir);
+    std::unique_ptr<rocksdb::DB> db_holder(db);
+    std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> cf_holders;
+    for (auto *cf_hdl : cf_hdls) {
+        cf_holders.emplace_back(cf_hdl);
+    }
+    CHECK_EQ(2, cf_hdls.size());
+
+    uint32_t pegasus_data_version = 0;
+    auto ms =
+        std::make_unique<pegasus::server::meta_store>(per.checkpoint_dir.c_str(), db, cf_hdls[1]);
+    RETURN_FALSE_IF_NON_OK(ms->get_data_version(&pegasus_data_version),
+                           "get_data_version from '{}' failed",
+                           per.checkpoint_dir);
+    RETURN_FALSE_IF_NOT(pegasus_data_version <= pegasus::PEGASUS_DATA_VERSION_MAX,
+                        "unsupported data version {} of '{}'",
+                        pegasus_data_version,
+                        per.checkpoint_dir);
+    if (pegasus_data_version != lbec.dst_data_version) {
+        fmt::print(stdout,
+                   " convert the records in '{}' from data version {} to {}\n",
+                   per.checkpoint_dir,
+                   pegasus_data_version,
+                   lbec.dst_data_version);
+    }
+
+    // 2. Iterate all the records in order, in which the deleted records have been skipped, and
+    //    write them to the target partitions.
+    rocksdb::ReadOptions rd_opts;
+    rd_opts.total_order_seek = true;
+    rd_opts.fill_cache = false;
+    const auto epoch_now = pegasus::utils::epoch_now();
+    std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(rd_opts, cf_hdls[0]));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        const auto &skey = iter->key();
+        const auto &svalue = iter->value();
+        // Skip empty write, see:
+        // https://pegasus.apache.org/zh/2018/03/07/last_flushed_decree.html.
+        if (skey.empty()) {
+            continue;
+        }
+        if (pegasus::check_if_record_expired(
+                pegasus_data_version, epoch_now, pegasus::utils::to_string_view(svalue))) {
+            per.expired_count++;
+            continue;
+        }
+
+        dsn::blob bb_key(skey.data(), 0, skey.size());
+        const auto dst_pidx = dsn::replication::partition_resolver::get_partition_index(
+            static_cast<int>(lbec.dst_partition_count), pegasus::pegasus_key_hash(bb_key));
+        CHECK_LE(0, dst_pidx);
+        CHECK_LT(dst_pidx, lbec.dst_partition_count);
+        std::string converted_value;
+        if (pegasus_data_version != lbec.dst_data_version) {
+            converted_value = convert_value(pegasus_data_version,
+                                            lbec.dst_data_version,
+                                            pegasus::utils::to_string_view(svalue));
+        }
+        const rocksdb::Slice dst_value =
+            pegasus_data_version == lbec.dst_data_version ? svalue : converted_value;
+        if (!writers[dst_pidx].put(skey, dst_value)) {
+            return false;
+        }
+        per.exported_count++;
+        per.exported_size += skey.size() + dst_value.size();
+    }
+    RETURN_FALSE_IF_NON_RDB_OK(
+        iter->status(), "iterate rocksdb in '{}' failed", per.checkpoint_dir);
+
+    for (auto &writer : writers) {
+        if (!writer.finish()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool upload_partition_files(const LocalBulkLoadExportContext &lbec,
+                            uint32_t src_pidx,
+                            uint32_t dst_pidx,
+                            const partition_sst_writer &writer)
+{
+    const auto remote_dir = get_remote_partition_dir(
+        lbec.remote_root_path, lbec.dst_cluster_name, lbec.dst_app_name, dst_pidx);
+
+    dsn::replication::bulk_load_metadata metadata;
+    metadata.file_total_size = 0;
+    for (const auto &file : writer.files()) {
+        dsn::replication::file_meta f_meta;
+        f_meta.name = file;
+        const auto path = dsn::utils::filesystem::path_combine(writer.dir(), file);
+        RETURN_FALSE_IF_NOT(dsn::utils::filesystem::file_size(
+                                path, dsn::utils::FileDataType::kSensitive, f_meta.size),
+                            "get size of file '{}' failed",
+                            path);
+        RETURN_FALSE_IF_NON_OK(dsn::utils::filesystem::md5sum(path, f_meta.md5),
+                               "calculate md5 of file '{}' failed",
+                               path);
+        RETURN_FALSE_IF_NON_OK(lbec.bsm->upload_file(remote_dir, writer.dir(), file, lbec.fs),
+                               "upload file '{}' to '{}' failed",
+                               path,
+                               remote_dir);
+        metadata.file_total_size += f_meta.size;
+        metadata.files.emplace_back(std::move(f_meta));
+    }
+
+    // The fragment is written after all the files have been uploaded, so that its existence
+    // means the export of the source partition is completed.
+    const auto fragment =
+        dsn::utils::filesystem::path_combine(remote_dir, get_metadata_fragment_name(src_pidx));
+    RETURN_FALSE_IF_NON_OK(
+        lbec.bsm->write_file(
+            fragment,
+            dsn::json::json_forwarder<dsn::replication::bulk_load_metadata>::encode(metadata),
+            lbec.fs),
+        "write metadata fragment '{}' failed",
+        fragment);
+    return true;
+}
+
+bool export_partition(const LocalBulkLoadExportContext &lbec,
+                      const ToExportPartition &tep,
+                      PartitionExportResult &per)
+{
+    int64_t checkpoint_decree = 0;
+    RETURN_FALSE_IF_NOT(
+        find_latest_checkpoint(tep.replica_dir, per.checkpoint_dir, checkpoint_decree), "");
+    RETURN_FALSE_IF_NOT(check_no_write_after_checkpoint(tep.replica_dir, checkpoint_decree), "");
+    fmt::print(stdout, " start to export '{}'\n", per.checkpoint_dir);
+
+    const auto tmp_partition_dir =
+        dsn::utils::filesystem::path_combine(lbec.tmp_dir, std::to_string(tep.pidx));
+    std::vector<partition_sst_writer> writers;
+    writers.reserve(lbec.dst_partition_count);
+    for (uint32_t i = 0; i < lbec.dst_partition_count; i++) {
+        writers.emplace_back(dsn::utils::filesystem::path_combine(tmp_partition_dir,
+                                                                  std::to_string(i)),
+                             tep.pidx,
+                             static_cast<uint64_t>(lbec.max_file_size_mb) << 20);
+    }
+
+    bool success = export_checkpoint(lbec, writers, per);
+    for (uint32_t i = 0; success && i < lbec.dst_partition_count; i++) {
+        success = upload_partition_files(lbec, tep.pidx, i, writers[i]);
+    }
+    dsn::utils::filesystem::remove_path(tmp_partition_dir);
+    return success;
+}
+
+bool gather_partitions(const LocalBulkLoadExportContext &lbec,
+                       std::vector<ToExportPartition> &to_export_partitions)
+{
+    static const std::string kReplicasDir =
+        dsn::utils::filesystem::path_combine(dsn::replication::replication_options::kReplicaAppType,
+                                             dsn::replication::replication_options::kRepsDir);
+
+    std::set<uint32_t> remain_partition_ids(lbec.src_partition_ids);
+    for (const auto &src_data_dir : lbec.src_data_dirs) {
+        const auto replicas_dir = dsn::utils::filesystem::path_combine(src_data_dir, kReplicasDir);
+        std::vector<std::string> replica_dirs;
+        RETURN_FALSE_IF_NOT(
+            dsn::utils::filesystem::get_subdirectories(replicas_dir, replica_dirs, false),
+            "get sub-directories from '{}' failed",
+            replicas_dir);
+
+        for (const auto &replica_dir : replica_dirs) {
+            dsn::app_info ai;
+            dsn::gpid pid;
+            std::string hint_message;
+            if (!dsn::replication::replica_stub::validate_replica_dir(
+                    replica_dir, ai, pid, hint_message)) {
+                continue;
+            }
+            if (ai.app_id != lbec.src_app_id) {
+                continue;
+            }
+
+            // A partition may have several replicas on the same server, e.g. the garbage
+            // ones, export only once.
+            const auto pidx = static_cast<uint32_t>(pid.get_partition_index());
+            if (remain_partition_ids.erase(pidx) == 0) {
+                continue;
+            }
+            to_export_partitions.push_back({replica_dir, pid.get_partition_index()});
+        }
+    }
+
+    if (!remain_partition_ids.empty()) {
+        fmt::print(stdout,
+                   "WARNING: the partitions {} are not found to be exported\n",
+                   fmt::join(remain_partition_ids, ","));
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+bool local_bulk_load_export(command_executor *e, shell_context *sc, arguments args)
+{
+    // 1. Parse parameters.
+    argh::parser cmd(args.argc, args.argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+    RETURN_FALSE_IF_NOT(cmd.pos_args().size() >= 9,
+                        "invalid command, should be in the form of '{}'",
+                        local_bulk_load_export_help);
+    int param_index = 1;
+    LocalBulkLoadExportContext lbec;
+    PARSE_STRS(lbec.src_data_dirs);
+    PARSE_UINT(lbec.src_app_id);
+    PARSE_UINTS(lbec.src_partition_ids);
+    PARSE_UINT(lbec.dst_partition_count);
+    lbec.file_provider = cmd(param_index++).str();
+    lbec.remote_root_path = cmd(param_index++).str();
+    lbec.dst_cluster_name = cmd(param_index++).str();
+    lbec.dst_app_name = cmd(param_index++).str();
+    lbec.tmp_dir = cmd("tmp_dir", "./bulk_load_export").str();
+    PARSE_OPT_UINT(lbec.threads, 1, "threads");
+    PARSE_OPT_UINT(lbec.max_file_size_mb, 256, "max_file_size_mb");
+    PARSE_OPT_UINT(lbec.dst_data_version, pegasus::PEGASUS_DATA_VERSION_MAX, "dst_data_version");
+
+    // 2. Check parameters.
+    RETURN_FALSE_IF_NOT(lbec.dst_partition_count > 0,
+                        "invalid command, <dst_partition_count> should be larger than 0");
+    RETURN_FALSE_IF_NOT(lbec.threads > 0, "invalid command, --threads should be larger than 0");
+    RETURN_FALSE_IF_NOT(lbec.max_file_size_mb > 0,
+                        "invalid command, --max_file_size_mb should be larger than 0");
+    RETURN_FALSE_IF_NOT(lbec.dst_data_version <= pegasus::PEGASUS_DATA_VERSION_MAX,
+                        "invalid command, --dst_data_version should not be larger than {}",
+                        pegasus::PEGASUS_DATA_VERSION_MAX);
+    const auto es = replication_ddl_client::validate_app_name(lbec.dst_app_name);
+    RETURN_FALSE_IF_NOT(es.is_ok(),
+                        "invalid command, <dst_app_name> '{}' is invalid: {}",
+                        lbec.dst_app_name,
+                        es.description());
+    RETURN_FALSE_IF_NOT(!dsn::utils::filesystem::directory_exists(lbec.tmp_dir),
+                        "temporary directory '{}' already exists",
+                        lbec.tmp_dir);
+    dsn::dist::block_service::block_service_manager bsm;
+    lbec.bsm = &bsm;
+    lbec.fs = bsm.get_or_create_block_filesystem(lbec.file_provider);
+    RETURN_FALSE_IF_NOT(lbec.fs != nullptr,
+                        "invalid <file_provider> '{}', check the [block_service.{}] section in "
+                        "the config file",
+                        lbec.file_provider,
+                        lbec.file_provider);
+
+    // 3. Gather the partitions to export.
+    std::vector<ToExportPartition> to_export_partitions;
+    if (!gather_partitions(lbec, to_export_partitions)) {
+        return true;
+    }
+
+    // 4. Export the partitions.
+    auto thread_pool = std::unique_ptr<rocksdb::ThreadPool>(
+        rocksdb::NewThreadPool(static_cast<int>(lbec.threads)));
+    std::vector<PartitionExportResult> pers(to_export_partitions.size());
+    for (size_t i = 0; i < to_export_partitions.size(); i++) {
+        const auto &tep = to_export_partitions[i];
+        auto &per = pers[i];
+        per.src_replica_dir = tep.replica_dir;
+        thread_pool->SubmitJob([&lbec, tep, &per]() {
+            per.success = export_partition(lbec, tep, per);
+        });
+    }
+    thread_pool->WaitForJobsAndJoinAllThreads();
+    dsn::utils::filesystem::remove_path(lbec.tmp_dir);
+
+    // 5. Output the result.
+    dsn::utils::table_printer tp("bulk_load_export_result");
+    tp.add_title("src_replica");
+    tp.add_column("checkpoint");
+    tp.add_column("success");
+    tp.add_column("exported_count");
+    tp.add_column("expired_count");
+    tp.add_column("exported_size");
+    for (const auto &per : pers) {
+        tp.add_row(per.src_replica_dir);
+        tp.append_data(per.checkpoint_dir);
+        tp.append_data(per.success);
+        tp.append_data(per.exported_count);
+        tp.append_data(per.expired_count);
+        tp.append_data(per.exported_size);
+    }
+    tp.output(std::cout, tp_output_format::kTabular);
+    return true;
+}
+
+bool finalize_bulk_load_export(command_executor *e, shell_context *sc, arguments args)
+{
+    // 1. Parse parameters.
+    argh::parser cmd(args.argc, args.argv);
+    RETURN_FALSE_IF_NOT(cmd.pos_args().size() >= 8,
+                        "invalid command, should be in the form of '{}'",
+                        finalize_bulk_load_export_help);
+    int param_index = 1;
+    const auto file_provider = cmd(param_index++).str();
+    const auto remote_root_path = cmd(param_index++).str();
+    const auto dst_cluster_name = cmd(param_index++).str();
+    const auto dst_app_name = cmd(param_index++).str();
+    uint32_t dst_app_id = 0;
+    uint32_t src_partition_count = 0;
+    uint32_t dst_partition_count = 0;
+    PARSE_UINT(dst_app_id);
+    PARSE_UINT(src_partition_count);
+    PARSE_UINT(dst_partition_count);
+
+    dsn::dist::block_service::block_service_manager bsm;
+    auto *fs = bsm.get_or_create_block_filesystem(file_provider);
+    RETURN_FALSE_IF_NOT(fs != nullptr,
+                        "invalid <file_provider> '{}', check the [block_service.{}] section in "
+                        "the config file",
+                        file_provider,
+                        file_provider);
+
+    // 2. Merge the metadata fragments exported from all the source partitions into the
+    //    bulk load metadata of each target partition.
+    for (uint32_t dst_pidx = 0; dst_pidx < dst_partition_count; dst_pidx++) {
+        const auto remote_dir =
+            get_remote_partition_dir(remote_root_path, dst_cluster_name, dst_app_name, dst_pidx);
+        dsn::replication::bulk_load_metadata metadata;
+        metadata.file_total_size = 0;
+        for (uint32_t src_pidx = 0; src_pidx < src_partition_count; src_pidx++) {
+            const auto fragment = dsn::utils::filesystem::path_combine(
+                remote_dir, get_metadata_fragment_name(src_pidx));
+            dsn::blob value;
+            RETURN_FALSE_IF_NON_OK(bsm.read_file(fragment, fs, value),
+                                   "read metadata fragment '{}' failed, make sure the source "
+                                   "partition {} has been exported",
+                                   fragment,
+                                   src_pidx);
+            dsn::replication::bulk_load_metadata fragment_metadata;
+            RETURN_FALSE_IF_NOT(
+                dsn::json::json_forwarder<dsn::replication::bulk_load_metadata>::decode(
+                    value, fragment_metadata),
+                "metadata fragment '{}' is damaged",
+                fragment);
+            metadata.file_total_size += fragment_metadata.file_total_size;
+            std::move(fragment_metadata.files.begin(),
+                      fragment_metadata.files.end(),
+                      std::back_inserter(metadata.files));
+        }
+
+        const auto metadata_path = dsn::utils::filesystem::path_combine(
+            remote_dir, dsn::replication::bulk_load_constant::BULK_LOAD_METADATA);
+        RETURN_FALSE_IF_NON_OK(
+            bsm.write_file(metadata_path,
+                           dsn::json::json_forwarder<dsn::replication::bulk_load_metadata>::encode(
+                               metadata),
+                           fs),
+            "write bulk load metadata '{}' failed",
+            metadata_path);
+        fmt::print(stdout,
+                   "partition {}: {} files, {} bytes\n",
+                   dst_pidx,
+                   metadata.files.size(),
+                   metadata.file_total_size);
+    }
+
+    // 3. Write the bulk load info of the target table at last, which is checked by the meta
+    //    server when starting bulk load.
+    const auto info_path = fmt::format("{}/{}/{}/{}",
+                                       remote_root_path,
+                                       dst_cluster_name,
+                                       dst_app_name,
+                                       dsn::replication::bulk_load_constant::BULK_LOAD_INFO);
+    const dsn::replication::bulk_load_info info(
+        static_cast<int32_t>(dst_app_id), dst_app_name, static_cast<int32_t>(dst_partition_count));
+    RETURN_FALSE_IF_NON_OK(
+        bsm.write_file(info_path,
+                       dsn::json::json_forwarder<dsn::replication::bulk_load_info>::encode(info),
+                       fs),
+        "write bulk load info '{}' failed",
+        info_path);
+    fmt::print(stdout,
+               "finalize succeed, use 'start_bulk_load' on the target table to ingest the files\n");
+    return true;
+}
@@ -567,6 +567,34 @@ static command_executor commands[] = {
         local_partition_split_help.c_str(),
         local_partition_split,
     },
+    {
+        "local_bulk_load_export",
+        "Export the local partitions of a table to the remote file system as rocksdb sst files "
+        "in the bulk load layout, which helps to migrate a large table to another cluster or "
+        "another table with a different partition count without scanning and rewriting all the "
+        "records through the servers. Note:\n"
+        "  * The latest checkpoint of each partition is exported, and the partition is refused "
+        "if there are writes after it in the private log, so stop writing the source table and "
+        "wait for a new checkpoint before exporting\n"
+        "  * The records are re-partitioned to <dst_partition_count> partitions and the expired "
+        "ones are skipped\n"
+        "  * The [block_service.<file_provider>] section should be configured in the config file "
+        "of the shell\n"
+        "  * The records are converted to --dst_data_version, which should be the data version "
+        "of the target table, and is the latest one by default\n"
+        "  * It can be executed on all the servers of the source cluster in parallel, then use "
+        "'finalize_bulk_load_export' to generate the bulk load metadata after all the "
+        "partitions have been exported\n",
+        local_bulk_load_export_help.c_str(),
+        local_bulk_load_export,
+    },
+    {
+        "finalize_bulk_load_export",
+        "Generate the bulk load metadata for the files exported by 'local_bulk_load_export', "
+        "then the files can be ingested by 'start_bulk_load' on the target table",
+        finalize_bulk_load_export_help.c_str(),
+        finalize_bulk_load_export,
+    },
     {
         "exit", "exit shell", "", exit_shell,
     },
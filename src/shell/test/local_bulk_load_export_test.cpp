@@ -0,0 +1,299 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <fmt/core.h>
+#include <rocksdb/db.h>
+#include <rocksdb/iterator.h>
+#include <rocksdb/options.h>
+#include <rocksdb/slice.h>
+#include <rocksdb/sst_file_reader.h>
+#include <rocksdb/status.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "base/meta_store.h"
+#include "base/pegasus_key_schema.h"
+#include "base/pegasus_utils.h"
+#include "base/pegasus_value_schema.h"
+#include "bulk_load_types.h"
+#include "client/partition_resolver.h"
+#include "common/bulk_load_common.h"
+#include "common/json_helper.h"
+#include "common/replication_common.h"
+#include "dsn.layer2_types.h"
+#include "gtest/gtest.h"
+#include "meta/meta_bulk_load_service.h"
+#include "replica/replication_app_base.h"
+#include "shell/command_executor.h"
+#include "shell/commands.h"
+#include "utils/blob.h"
+#include "utils/env.h"
+#include "utils/error_code.h"
+#include "utils/filesystem.h"
+#include "utils/test_macros.h"
+
+namespace pegasus {
+
+class local_bulk_load_export_test : public testing::TestWithParam<std::tuple<uint32_t, uint32_t>>
+{
+protected:
+    static constexpr int32_t kSrcAppId = 1;
+    static constexpr int32_t kSrcPartitionCount = 2;
+    static constexpr int32_t kDstPartitionCount = 3;
+    static constexpr int32_t kDstAppId = 2;
+    static constexpr int kRecordCount = 100;
+    const std::string kTestDir = "local_bulk_load_export_test";
+    const std::string kClusterName = "dst_cluster";
+    const std::string kAppName = "dst_app";
+
+    void SetUp() override
+    {
+        ASSERT_TRUE(dsn::utils::filesystem::remove_path(kTestDir));
+        _data_dir = dsn::utils::filesystem::path_combine(kTestDir, "data");
+        _remote_root = dsn::utils::filesystem::path_combine(kTestDir, "remote");
+        for (int32_t pidx = 0; pidx < kSrcPartitionCount; pidx++) {
+            NO_FATALS(create_partition(pidx));
+        }
+    }
+
+    void TearDown() override { ASSERT_TRUE(dsn::utils::filesystem::remove_path(kTestDir)); }
+
+    static std::string gen_hash_key(int32_t pidx, int i) { return fmt::format("h{}_{}", pidx, i); }
+
+    // Create a replica of the source table with a checkpoint, in which there are 'kRecordCount'
+    // records and an expired one.
+    void create_partition(int32_t pidx)
+    {
+        const auto replica_dir = dsn::utils::filesystem::path_combine(
+            _data_dir,
+            fmt::format("{}/{}/{}.{}.{}",
+                        dsn::replication::replication_options::kReplicaAppType,
+                        dsn::replication::replication_options::kRepsDir,
+                        kSrcAppId,
+                        pidx,
+                        dsn::replication::replication_options::kReplicaAppType));
+        ASSERT_TRUE(dsn::utils::filesystem::create_directory(replica_dir));
+        // There is no write after the checkpoint in the private log.
+        ASSERT_TRUE(dsn::utils::filesystem::create_directory(
+            dsn::utils::filesystem::path_combine(replica_dir, "plog")));
+        dsn::app_info ai;
+        ai.app_id = kSrcAppId;
+        ai.app_name = "src_app";
+        ai.app_type = dsn::replication::replication_options::kReplicaAppType;
+        ai.partition_count = kSrcPartitionCount;
+        dsn::replication::replica_app_info rai(&ai);
+        ASSERT_EQ(dsn::ERR_OK,
+                  rai.store(dsn::utils::filesystem::path_combine(
+                      replica_dir, dsn::replication::replica_app_info::kAppInfo)));
+
+        const auto checkpoint_dir = dsn::utils::filesystem::path_combine(
+            replica_dir,
+            fmt::format("{}/checkpoint.10", dsn::replication::replication_app_base::kDataDir));
+        rocksdb::DBOptions db_opts;
+        db_opts.create_if_missing = true;
+        db_opts.create_missing_column_families = true;
+        db_opts.env = dsn::utils::PegasusEnv(dsn::utils::FileDataType::kSensitive);
+        const std::vector<rocksdb::ColumnFamilyDescriptor> cf_dscs(
+            {{server::meta_store::DATA_COLUMN_FAMILY_NAME, {}},
+             {server::meta_store::META_COLUMN_FAMILY_NAME, {}}});
+        std::vector<rocksdb::ColumnFamilyHandle *> cf_hdls;
+        rocksdb::DB *db = nullptr;
+        auto s = rocksdb::DB::Open(db_opts, checkpoint_dir, cf_dscs, &cf_hdls, &db);
+        ASSERT_TRUE(s.ok()) << s.ToString();
+        std::unique_ptr<rocksdb::DB> db_holder(db);
+        std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> cf_holders;
+        for (auto *cf_hdl : cf_hdls) {
+            cf_holders.emplace_back(cf_hdl);
+        }
+
+        const auto src_data_version = std::get<0>(GetParam());
+        server::meta_store ms("test", db, cf_hdls[1]);
+        ms.set_data_version(src_data_version);
+
+        pegasus_value_generator generator;
+        auto put = [&](const std::string &hash_key, const std::string &value, uint32_t expire_ts) {
+            dsn::blob key;
+            pegasus_generate_key(key, hash_key, std::string("s"));
+            const auto parts = generator.generate_value(src_data_version, value, expire_ts, 1);
+            std::string raw_value;
+            for (int i = 0; i < parts.num_parts; i++) {
+                raw_value.append(parts.parts[i].data(), parts.parts[i].size());
+            }
+            auto s = db->Put(rocksdb::WriteOptions(),
+                             cf_hdls[0],
+                             rocksdb::Slice(key.data(), key.length()),
+                             raw_value);
+            ASSERT_TRUE(s.ok()) << s.ToString();
+        };
+        for (int i = 0; i < kRecordCount; i++) {
+            NO_FATALS(put(gen_hash_key(pidx, i), fmt::format("v{}", i), 0));
+        }
+        NO_FATALS(put(gen_hash_key(pidx, kRecordCount), "expired", 1));
+
+        for (auto *cf_hdl : cf_hdls) {
+            s = db->Flush(rocksdb::FlushOptions(), cf_hdl);
+            ASSERT_TRUE(s.ok()) << s.ToString();
+        }
+    }
+
+    static bool run_command(executor cmd, const std::vector<std::string> &args)
+    {
+        std::vector<char *> argv;
+        for (const auto &arg : args) {
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        }
+        return cmd(nullptr, nullptr, {static_cast<int>(argv.size()), argv.data()});
+    }
+
+    bool export_partitions(uint32_t dst_data_version)
+    {
+        return run_command(local_bulk_load_export,
+                           {"local_bulk_load_export",
+                            _data_dir,
+                            std::to_string(kSrcAppId),
+                            "0,1",
+                            std::to_string(kDstPartitionCount),
+                            "local_service",
+                            _remote_root,
+                            kClusterName,
+                            kAppName,
+                            "--tmp_dir",
+                            dsn::utils::filesystem::path_combine(kTestDir, "tmp"),
+                            "--dst_data_version",
+                            std::to_string(dst_data_version)});
+    }
+
+    bool finalize()
+    {
+        return run_command(finalize_bulk_load_export,
+                           {"finalize_bulk_load_export",
+                            "local_service",
+                            _remote_root,
+                            kClusterName,
+                            kAppName,
+                            std::to_string(kDstAppId),
+                            std::to_string(kSrcPartitionCount),
+                            std::to_string(kDstPartitionCount)});
+    }
+
+    template <typename T>
+    void load_remote_file(const std::string &path, T &obj)
+    {
+        std::string content;
+        auto s = rocksdb::ReadFileToString(rocksdb::Env::Default(), path, &content);
+        ASSERT_TRUE(s.ok()) << s.ToString();
+        ASSERT_TRUE(dsn::json::json_forwarder<T>::decode(dsn::blob::create_from_bytes(
+                                                             std::move(content)),
+                                                         obj));
+    }
+
+    // Check the files of the target partitions, which should contain all the unexpired records
+    // in the target data version.
+    void check_exported_data(uint32_t dst_data_version)
+    {
+        const auto app_dir = fmt::format("{}/{}/{}", _remote_root, kClusterName, kAppName);
+        dsn::replication::bulk_load_info info;
+        NO_FATALS(load_remote_file(
+            dsn::utils::filesystem::path_combine(
+                app_dir, dsn::replication::bulk_load_constant::BULK_LOAD_INFO),
+            info));
+        ASSERT_EQ(kDstAppId, info.app_id);
+        ASSERT_EQ(kAppName, info.app_name);
+        ASSERT_EQ(kDstPartitionCount, info.partition_count);
+
+        std::map<std::string, std::string> records;
+        for (int32_t dst_pidx = 0; dst_pidx < kDstPartitionCount; dst_pidx++) {
+            const auto partition_dir =
+                dsn::utils::filesystem::path_combine(app_dir, std::to_string(dst_pidx));
+            dsn::replication::bulk_load_metadata metadata;
+            NO_FATALS(load_remote_file(
+                dsn::utils::filesystem::path_combine(
+                    partition_dir, dsn::replication::bulk_load_constant::BULK_LOAD_METADATA),
+                metadata));
+
+            int64_t total_size = 0;
+            for (const auto &f_meta : metadata.files) {
+                total_size += f_meta.size;
+                rocksdb::Options opts;
+                opts.env = dsn::utils::PegasusEnv(dsn::utils::FileDataType::kSensitive);
+                rocksdb::SstFileReader reader(opts);
+                auto s = reader.Open(
+                    dsn::utils::filesystem::path_combine(partition_dir, f_meta.name));
+                ASSERT_TRUE(s.ok()) << s.ToString();
+                std::unique_ptr<rocksdb::Iterator> iter(reader.NewIterator(rocksdb::ReadOptions()));
+                for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                    dsn::blob key(iter->key().data(), 0, iter->key().size());
+                    ASSERT_EQ(dst_pidx,
+                              dsn::replication::partition_resolver::get_partition_index(
+                                  kDstPartitionCount, pegasus_key_hash(key)));
+                    dsn::blob hash_key;
+                    dsn::blob sort_key;
+                    pegasus_restore_key(key, hash_key, sort_key);
+                    dsn::blob user_data;
+                    pegasus_extract_user_data(
+                        dst_data_version, iter->value().ToString(), user_data);
+                    records.emplace(hash_key.to_string(), user_data.to_string());
+                }
+            }
+            ASSERT_EQ(metadata.file_total_size, total_size);
+        }
+
+        std::map<std::string, std::string> expected_records;
+        for (int32_t pidx = 0; pidx < kSrcPartitionCount; pidx++) {
+            for (int i = 0; i < kRecordCount; i++) {
+                expected_records.emplace(gen_hash_key(pidx, i), fmt::format("v{}", i));
+            }
+        }
+        ASSERT_EQ(expected_records, records);
+    }
+
+    std::string _data_dir;
+    std::string _remote_root;
+};
+
+// The data versions of the source and target tables.
+INSTANTIATE_TEST_SUITE_P(,
+                         local_bulk_load_export_test,
+                         ::testing::Values(std::make_tuple(0, 0),
+                                           std::make_tuple(0, 1),
+                                           std::make_tuple(1, 0),
+                                           std::make_tuple(1, 1)));
+
+TEST_P(local_bulk_load_export_test, export_and_finalize)
+{
+    const auto dst_data_version = std::get<1>(GetParam());
+    ASSERT_TRUE(export_partitions(dst_data_version));
+    ASSERT_TRUE(finalize());
+    NO_FATALS(check_exported_data(dst_data_version));
+}
+
+TEST_P(local_bulk_load_export_test, invalid_dst_data_version)
+{
+    ASSERT_FALSE(export_partitions(PEGASUS_DATA_VERSION_MAX + 1));
+    ASSERT_FALSE(dsn::utils::filesystem::directory_exists(_remote_root));
+}
+
+TEST_P(local_bulk_load_export_test, finalize_before_exported)
+{
+    ASSERT_FALSE(finalize());
+}
+
+} // namespace pegasus
@@ -32,6 +32,11 @@
 #include "include/pegasus/client.h"
 #include "pegasus/error.h"
 #include "test/function_test/utils/test_util.h"
+#include "test_util/test_util.h"
+#include "utils/flags.h"
+
+DSN_DECLARE_bool(coalesce_single_key_requests);
+DSN_DECLARE_uint32(batch_any_max_keys_per_request);
 
 using namespace ::pegasus;
 
@@ -1407,6 +1412,137 @@ TEST_F(basic, set_get_del_async)
               client_->get("basic_test_hash_key_1", "basic_test_sort_key_1", new_value));
 }
 
+TEST_F(basic, coalesce_single_key_requests)
+{
+    PRESERVE_FLAG(coalesce_single_key_requests);
+    FLAGS_coalesce_single_key_requests = true;
+
+    // Fill the route cache of the table, otherwise the gets could not be grouped by partitions.
+    ASSERT_EQ(PERR_OK, client_->set("coalesce_hash_key_0", "coalesce_sort_key_0", "value"));
+
+    const int kHashKeyCount = 10;
+    const int kSortKeyCount = 20;
+    const auto key = [](const char *prefix, int i) { return prefix + std::to_string(i); };
+
+    std::atomic<int> pending(kHashKeyCount * kSortKeyCount);
+    for (int i = 0; i < kHashKeyCount; ++i) {
+        for (int j = 0; j < kSortKeyCount; ++j) {
+            client_->async_set(key("coalesce_hash_key_", i),
+                               key("coalesce_sort_key_", j),
+                               key("coalesce_value_", i * kSortKeyCount + j),
+                               [&](int err, internal_info &&info) {
+                                   EXPECT_EQ(PERR_OK, err);
+                                   EXPECT_GT(info.decree, 0);
+                                   --pending;
+                               });
+        }
+    }
+    while (pending.load() > 0) {
+        usleep(100);
+    }
+
+    // The gets of both the existing and the missing keys are coalesced.
+    pending = kHashKeyCount * kSortKeyCount * 2;
+    for (int i = 0; i < kHashKeyCount; ++i) {
+        for (int j = 0; j < kSortKeyCount; ++j) {
+            const auto expected_value = key("coalesce_value_", i * kSortKeyCount + j);
+            client_->async_get(key("coalesce_hash_key_", i),
+                               key("coalesce_sort_key_", j),
+                               [&, expected_value](int err, std::string &&value, internal_info &&) {
+                                   EXPECT_EQ(PERR_OK, err);
+                                   EXPECT_EQ(expected_value, value);
+                                   --pending;
+                               });
+            client_->async_get(key("coalesce_hash_key_", i),
+                               key("coalesce_missing_sort_key_", j),
+                               [&](int err, std::string &&value, internal_info &&) {
+                                   EXPECT_EQ(PERR_NOT_FOUND, err);
+                                   EXPECT_TRUE(value.empty());
+                                   --pending;
+                               });
+        }
+    }
+    while (pending.load() > 0) {
+        usleep(100);
+    }
+}
+
+TEST_F(basic, batch_get_set_any)
+{
+    // Split the keys of the same partition or hash key into several requests.
+    PRESERVE_FLAG(batch_any_max_keys_per_request);
+    FLAGS_batch_any_max_keys_per_request = 7;
+
+    const int kHashKeyCount = 10;
+    const int kSortKeyCount = 20;
+    const auto key = [](const char *prefix, int i) { return prefix + std::to_string(i); };
+
+    std::vector<pegasus_client::full_key_value> kvs;
+    for (int i = 0; i < kHashKeyCount; ++i) {
+        for (int j = 0; j < kSortKeyCount; ++j) {
+            kvs.push_back({key("batch_any_hash_key_", i),
+                           key("batch_any_sort_key_", j),
+                           key("batch_any_value_", i * kSortKeyCount + j)});
+        }
+    }
+    // The key of the empty hash key is set by a single put.
+    kvs.push_back({"", "batch_any_sort_key", "batch_any_value"});
+
+    std::atomic<bool> done(false);
+    client_->async_batch_set_any(
+        kvs, [&](int err, std::vector<pegasus_client::batch_any_result> &&results) {
+            EXPECT_EQ(PERR_OK, err);
+            EXPECT_EQ(kvs.size(), results.size());
+            for (const auto &result : results) {
+                EXPECT_EQ(PERR_OK, result.error);
+                EXPECT_GT(result.info.decree, 0);
+            }
+            done = true;
+        });
+    while (!done.load()) {
+        usleep(100);
+    }
+
+    // Get both the existing and the missing keys, with at most 2 requests in flight.
+    std::vector<std::pair<std::string, std::string>> keys;
+    std::vector<std::string> expected_values;
+    for (const auto &kv : kvs) {
+        keys.emplace_back(kv.hash_key, kv.sort_key);
+        expected_values.push_back(kv.value);
+        keys.emplace_back(kv.hash_key, "batch_any_missing_" + kv.sort_key);
+        expected_values.emplace_back();
+    }
+    done = false;
+    client_->async_batch_get_any(
+        keys,
+        [&](int err, std::vector<pegasus_client::batch_any_result> &&results) {
+            EXPECT_EQ(PERR_OK, err);
+            EXPECT_EQ(keys.size(), results.size());
+            for (size_t i = 0; i < results.size() && i < keys.size(); ++i) {
+                EXPECT_EQ(expected_values[i].empty() ? PERR_NOT_FOUND : PERR_OK,
+                          results[i].error);
+                EXPECT_EQ(expected_values[i], results[i].value);
+            }
+            done = true;
+        },
+        2);
+    while (!done.load()) {
+        usleep(100);
+    }
+
+    // Invalid arguments are rejected as a whole.
+    done = false;
+    client_->async_batch_get_any(
+        keys,
+        [&](int err, std::vector<pegasus_client::batch_any_result> &&results) {
+            EXPECT_EQ(PERR_INVALID_ARGUMENT, err);
+            EXPECT_TRUE(results.empty());
+            done = true;
+        },
+        0);
+    ASSERT_TRUE(done.load());
+}
+
 TEST_F(basic, multi_set_get_del_async)
 {
     std::map<std::string, std::string> actual_kvs;
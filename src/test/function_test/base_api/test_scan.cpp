@@ -189,6 +189,67 @@ TEST_F(scan_test, OVERALL_COUNT_ONLY)
     ASSERT_EQ(base_data_count, data_count);
 }
 
+TEST_F(scan_test, OVERALL_COUNT_ONLY_WITH_STAT)
+{
+    pegasus_client::scan_options options;
+    options.only_return_count = true;
+    options.return_stat = true;
+    std::vector<pegasus_client::pegasus_scanner *> scanners;
+    ASSERT_EQ(PERR_OK, client_->get_unordered_scanners(3, options, scanners));
+    ASSERT_LE(scanners.size(), 3);
+
+    int32_t data_count = 0;
+    pegasus_client::scan_stats total;
+    total.ttl_histogram.resize(3, 0);
+    for (auto scanner : scanners) {
+        ASSERT_NE(nullptr, scanner);
+        int32_t kv_count;
+        int ret;
+        while (PERR_OK == (ret = (scanner->next(kv_count)))) {
+            data_count += kv_count;
+            pegasus_client::scan_stats stats;
+            ASSERT_TRUE(scanner->get_batch_stats(stats));
+            total.hash_key_count += stats.hash_key_count;
+            total.hash_key_size_sum += stats.hash_key_size_sum;
+            total.sort_key_size_sum += stats.sort_key_size_sum;
+            total.value_size_sum += stats.value_size_sum;
+            ASSERT_LE(3, stats.ttl_histogram.size());
+            for (int i = 0; i < 3; i++) {
+                total.ttl_histogram[i] += stats.ttl_histogram[i];
+            }
+        }
+        ASSERT_EQ(PERR_SCAN_COMPLETE, ret) << "Error occurred when scan. error="
+                                           << client_->get_error_string(ret);
+        delete scanner;
+    }
+
+    int64_t base_hash_key_size_sum = 0;
+    int64_t base_sort_key_size_sum = 0;
+    int64_t base_value_size_sum = 0;
+    int64_t base_ttl_count = 0;
+    int base_data_count = 0;
+    for (const auto &m : expect_kvs_) {
+        base_data_count += m.second.size();
+        base_hash_key_size_sum += m.first.size() * m.second.size();
+        for (const auto &kv : m.second) {
+            base_sort_key_size_sum += kv.first.size();
+            base_value_size_sum += kv.second.size();
+        }
+    }
+    for (const auto &m : expect_kvs_with_ttl_) {
+        base_ttl_count += m.second.size();
+    }
+    ASSERT_EQ(base_data_count, data_count);
+    ASSERT_EQ(expect_kvs_.size(), total.hash_key_count);
+    ASSERT_EQ(base_hash_key_size_sum, total.hash_key_size_sum);
+    ASSERT_EQ(base_sort_key_size_sum, total.sort_key_size_sum);
+    ASSERT_EQ(base_value_size_sum, total.value_size_sum);
+    // All the records with ttl will expire in less than 1 day.
+    ASSERT_EQ(base_data_count - base_ttl_count, total.ttl_histogram[0]);
+    ASSERT_EQ(0, total.ttl_histogram[1]);
+    ASSERT_EQ(base_ttl_count, total.ttl_histogram[2]);
+}
+
 TEST_F(scan_test, ALL_SORT_KEY)
 {
     pegasus_client::scan_options options;
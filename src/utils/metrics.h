@@ -809,7 +809,8 @@ ENUM_END(metric_type)
     DEF(FileLoads)                                                                                 \
     DEF(FileUploads)                                                                               \
     DEF(BulkLoads)                                                                                 \
-    DEF(Beacons)
+    DEF(Beacons)                                                                                   \
+    DEF(Allocations)
 
 enum class metric_unit : size_t
 {
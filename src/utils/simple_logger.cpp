@@ -28,8 +28,12 @@
 
 // IWYU pragma: no_include <ext/alloc_traits.h>
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <stdint.h>
+#include <string.h>
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <sstream>
 #include <vector>
@@ -70,11 +74,26 @@ DSN_DEFINE_validator(stderr_start_level, [](const char *level) -> bool {
     return !dsn::utils::equals(level, "LOG_LEVEL_INVALID");
 });
 
+DSN_DEFINE_uint32(tools.async_logger,
+                  buffer_size_per_thread_kb,
+                  256,
+                  "The size of the ring buffer of each logging thread, in which the formatted logs "
+                  "are buffered before being written into the log file. The new logs of a thread "
+                  "are dropped once its buffer is full");
+DSN_DEFINE_validator(buffer_size_per_thread_kb, [](uint32_t value) -> bool { return value > 0; });
+
+DSN_DEFINE_uint32(tools.async_logger,
+                  flush_interval_ms,
+                  100,
+                  "The interval in milliseconds at which the flusher thread writes the buffered "
+                  "logs into the log file");
+DSN_DEFINE_validator(flush_interval_ms, [](uint32_t value) -> bool { return value > 0; });
+
 DSN_DECLARE_string(logging_start_level);
 
 namespace dsn {
 namespace tools {
-static void print_header(FILE *fp, log_level_t log_level)
+static void format_header(fmt::memory_buffer &buf, log_level_t log_level)
 {
     // The leading character of each log lines, corresponding to the log level
     // D: Debug
@@ -89,13 +108,20 @@ static void print_header(FILE *fp, log_level_t log_level)
     dsn::utils::time_ms_to_string(ts / 1000000, time_str);
 
     int tid = dsn::utils::get_current_tid();
-    fmt::print(fp,
-               "{}{} ({} {}) {}",
-               s_level_char[log_level],
-               time_str,
-               ts,
-               tid,
-               log_prefixed_message_func().c_str());
+    fmt::format_to(std::back_inserter(buf),
+                   "{}{} ({} {}) {}",
+                   s_level_char[log_level],
+                   time_str,
+                   ts,
+                   tid,
+                   log_prefixed_message_func().c_str());
+}
+
+static void print_header(FILE *fp, log_level_t log_level)
+{
+    fmt::memory_buffer buf;
+    format_header(buf, log_level);
+    ::fwrite(buf.data(), 1, buf.size(), fp);
 }
 
 namespace {
@@ -288,5 +314,268 @@ void simple_logger::log(
     }
 }
 
+void simple_logger::write_line(log_level_t log_level, const char *data, size_t size)
+{
+    ::fwrite(data, 1, size, _log);
+    if (log_level >= _stderr_start_level) {
+        ::fwrite(data, 1, size, stdout);
+    }
+
+    if (++_lines >= 200000) {
+        create_log_file();
+    }
+}
+
+// A single-producer single-consumer ring buffer of the formatted logs: the producer is the
+// thread owning it, and the consumer is whoever holds the logger's _lock. Each record is
+// [size(uint32_t)][log_level(uint8_t)][line(size bytes)].
+class async_logger::log_ring
+{
+public:
+    static constexpr size_t kRecordHeaderSize = sizeof(uint32_t) + sizeof(uint8_t);
+
+    explicit log_ring(size_t capacity)
+        : _capacity(capacity), _data(new char[capacity]), _head(0), _tail(0), _retired(false)
+    {
+    }
+
+    // Called by the owner thread only. Returns false if the ring has no enough space.
+    bool try_write(log_level_t log_level, const char *data, uint32_t size)
+    {
+        const uint64_t head = _head.load(std::memory_order_relaxed);
+        const uint64_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail + kRecordHeaderSize + size > _capacity) {
+            return false;
+        }
+
+        char header[kRecordHeaderSize];
+        memcpy(header, &size, sizeof(size));
+        header[sizeof(size)] = static_cast<char>(log_level);
+        copy_in(head, header, kRecordHeaderSize);
+        copy_in(head + kRecordHeaderSize, data, size);
+        _head.store(head + kRecordHeaderSize + size, std::memory_order_release);
+        return true;
+    }
+
+    // Passes all the records written so far to `handler` in order, and then frees their space.
+    template <typename Handler>
+    void consume(const Handler &handler)
+    {
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+        const uint64_t head = _head.load(std::memory_order_acquire);
+        std::string wrapped_line;
+        while (tail < head) {
+            char header[kRecordHeaderSize];
+            copy_out(tail, header, kRecordHeaderSize);
+            uint32_t size = 0;
+            memcpy(&size, header, sizeof(size));
+            const auto log_level = static_cast<log_level_t>(header[sizeof(size)]);
+
+            const size_t begin = (tail + kRecordHeaderSize) % _capacity;
+            if (begin + size <= _capacity) {
+                handler(log_level, _data.get() + begin, size);
+            } else {
+                // the line is wrapped around the end of the ring
+                wrapped_line.resize(size);
+                copy_out(tail + kRecordHeaderSize, &wrapped_line[0], size);
+                handler(log_level, wrapped_line.data(), size);
+            }
+            tail += kRecordHeaderSize + size;
+        }
+        _tail.store(tail, std::memory_order_release);
+    }
+
+    // Marks that the owner thread has exited, thus nothing will be written any more.
+    void retire() { _retired.store(true, std::memory_order_release); }
+
+    bool retired_and_empty() const
+    {
+        return _retired.load(std::memory_order_acquire) &&
+               _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+    }
+
+private:
+    void copy_in(uint64_t pos, const char *src, size_t size)
+    {
+        const size_t offset = pos % _capacity;
+        const size_t first = std::min(size, _capacity - offset);
+        memcpy(_data.get() + offset, src, first);
+        memcpy(_data.get(), src + first, size - first);
+    }
+
+    void copy_out(uint64_t pos, char *dst, size_t size) const
+    {
+        const size_t offset = pos % _capacity;
+        const size_t first = std::min(size, _capacity - offset);
+        memcpy(dst, _data.get() + offset, first);
+        memcpy(dst + first, _data.get(), size - first);
+    }
+
+    const size_t _capacity;
+    std::unique_ptr<char[]> _data;
+    // the total bytes ever written, only updated by the producer
+    std::atomic<uint64_t> _head;
+    // the total bytes ever consumed, only updated by the consumer
+    std::atomic<uint64_t> _tail;
+    std::atomic<bool> _retired;
+};
+
+namespace {
+
+std::atomic<uint64_t> s_next_async_logger_id(1);
+
+void format_line(fmt::memory_buffer &buf,
+                 const char *file,
+                 const char *function,
+                 const int line,
+                 log_level_t log_level,
+                 const char *str)
+{
+    format_header(buf, log_level);
+    if (!FLAGS_short_header) {
+        fmt::format_to(std::back_inserter(buf), "{}:{}:{}(): ", file, line, function);
+    }
+    fmt::format_to(std::back_inserter(buf), "{}\n", str);
+}
+
+} // anonymous namespace
+
+async_logger::async_logger(const char *log_dir)
+    : simple_logger(log_dir),
+      _id(s_next_async_logger_id.fetch_add(1, std::memory_order_relaxed)),
+      _dropped_count(0),
+      _reported_dropped_count(0),
+      _stopped(false)
+{
+    _flusher = std::thread([this]() { flusher_loop(); });
+}
+
+async_logger::~async_logger()
+{
+    _stopped.store(true, std::memory_order_release);
+    _flush_event.notify();
+    _flusher.join();
+
+    utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+    drain_rings();
+}
+
+async_logger::log_ring *async_logger::local_ring()
+{
+    // The ring of a thread is retired once the thread exits, and then removed by the flusher
+    // after all of its logs are written.
+    struct ring_holder
+    {
+        uint64_t logger_id = 0;
+        std::shared_ptr<log_ring> ring;
+
+        ~ring_holder()
+        {
+            if (ring) {
+                ring->retire();
+            }
+        }
+    };
+    static thread_local ring_holder holder;
+
+    if (dsn_unlikely(holder.logger_id != _id)) {
+        // the first logging of this thread, or the logger has been replaced
+        if (holder.ring) {
+            holder.ring->retire();
+        }
+        holder.ring =
+            std::make_shared<log_ring>(static_cast<size_t>(FLAGS_buffer_size_per_thread_kb) << 10);
+        holder.logger_id = _id;
+
+        utils::auto_lock<::dsn::utils::ex_lock_nr> l(_rings_lock);
+        _rings.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+void async_logger::log(
+    const char *file, const char *function, const int line, log_level_t log_level, const char *str)
+{
+    fmt::memory_buffer buf;
+    format_line(buf, file, function, line, log_level, str);
+
+    if (dsn_unlikely(log_level >= LOG_LEVEL_FATAL)) {
+        // write the fatal log synchronously after all the buffered ones, since the process is
+        // going to exit
+        {
+            utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+            drain_rings();
+            write_line(log_level, buf.data(), buf.size());
+            ::fflush(_log);
+            ::fflush(stdout);
+        }
+        process_fatal_log(log_level);
+        return;
+    }
+
+    if (!local_ring()->try_write(log_level, buf.data(), static_cast<uint32_t>(buf.size()))) {
+        _dropped_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void async_logger::flush()
+{
+    utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+    drain_rings();
+    ::fflush(_log);
+    ::fflush(stdout);
+}
+
+void async_logger::drain_rings()
+{
+    std::vector<std::shared_ptr<log_ring>> rings;
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr> l(_rings_lock);
+        rings = _rings;
+    }
+
+    for (const auto &ring : rings) {
+        ring->consume([this](log_level_t log_level, const char *data, size_t size) {
+            write_line(log_level, data, size);
+        });
+    }
+
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr> l(_rings_lock);
+        _rings.erase(std::remove_if(_rings.begin(),
+                                    _rings.end(),
+                                    [](const std::shared_ptr<log_ring> &ring) {
+                                        return ring->retired_and_empty();
+                                    }),
+                     _rings.end());
+    }
+
+    const uint64_t dropped_count = _dropped_count.load(std::memory_order_relaxed);
+    if (dropped_count > _reported_dropped_count) {
+        fmt::memory_buffer buf;
+        format_line(buf,
+                    __FILE__,
+                    __FUNCTION__,
+                    __LINE__,
+                    LOG_LEVEL_WARNING,
+                    fmt::format("{} logs have been dropped since the log buffers were full",
+                                dropped_count - _reported_dropped_count)
+                        .c_str());
+        write_line(LOG_LEVEL_WARNING, buf.data(), buf.size());
+        _reported_dropped_count = dropped_count;
+    }
+}
+
+void async_logger::flusher_loop()
+{
+    while (!_stopped.load(std::memory_order_acquire)) {
+        _flush_event.wait_for(static_cast<int>(FLAGS_flush_interval_ms));
+
+        utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+        drain_rings();
+        ::fflush(_log);
+    }
+}
+
 } // namespace tools
 } // namespace dsn
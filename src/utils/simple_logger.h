@@ -26,8 +26,14 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
 #include <cstdio>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "utils/api_utilities.h"
 #include "utils/logging_provider.h"
@@ -76,10 +82,14 @@ public:
 
     void flush() override;
 
-private:
+protected:
     void create_log_file();
 
-private:
+    // Writes a formatted log line, which has been ended with '\n', into the log file, and copies
+    // it to stderr if needed. Must be called with _lock held.
+    void write_line(log_level_t log_level, const char *data, size_t size);
+
+protected:
     ::dsn::utils::ex_lock _lock; // use recursive lock to avoid dead lock when flush() is called
                                  // in signal handler if cored for bad logging format reason.
     const std::string _log_dir;
@@ -89,5 +99,55 @@ private:
     int _lines;
     log_level_t _stderr_start_level;
 };
+
+/*
+ * async_logger writes to the same log files as simple_logger, while the log lines are
+ * formatted by the logging threads into their own lock-free ring buffers, and then written
+ * into the file by a dedicated flusher thread. Thus a logging thread never waits for the
+ * file lock or the file I/O, except for the fatal logs which are written synchronously.
+ * Once the ring buffer of a thread is full, its new logs are dropped and counted, and the
+ * count is reported in the log file by the flusher.
+ * NOTE: the logs of different threads are not strictly ordered by time in the file.
+ */
+class async_logger : public simple_logger
+{
+public:
+    explicit async_logger(const char *log_dir);
+    ~async_logger() override;
+
+    void log(const char *file,
+             const char *function,
+             const int line,
+             log_level_t log_level,
+             const char *str) override;
+
+    void flush() override;
+
+    uint64_t dropped_count() const { return _dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    class log_ring;
+
+    // Gets the ring buffer of the current thread, which is created on the first logging of it.
+    log_ring *local_ring();
+
+    // Writes the logs in all the ring buffers into the log file. Must be called with _lock held.
+    void drain_rings();
+
+    void flusher_loop();
+
+    const uint64_t _id;
+
+    ::dsn::utils::ex_lock_nr _rings_lock;
+    std::vector<std::shared_ptr<log_ring>> _rings;
+
+    std::atomic<uint64_t> _dropped_count;
+    // Protected by _lock.
+    uint64_t _reported_dropped_count;
+
+    std::atomic<bool> _stopped;
+    ::dsn::utils::notify_event _flush_event;
+    std::thread _flusher;
+};
 } // namespace tools
 } // namespace dsn
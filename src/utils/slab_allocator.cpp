@@ -0,0 +1,298 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "utils/slab_allocator.h"
+
+#include <array>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "utils/autoref_ptr.h"
+#include "utils/flags.h"
+#include "utils/metrics.h"
+#include "utils/ports.h"
+#include "utils/utils.h"
+
+METRIC_DEFINE_counter(server,
+                      message_buffer_slab_hits,
+                      dsn::metric_unit::kAllocations,
+                      "The number of message buffers allocated from the per-thread free lists of "
+                      "the slab allocator");
+
+METRIC_DEFINE_counter(server,
+                      message_buffer_slab_misses,
+                      dsn::metric_unit::kAllocations,
+                      "The number of message buffers allocated from the heap by the slab allocator "
+                      "since the per-thread free lists were empty");
+
+METRIC_DEFINE_counter(server,
+                      message_buffer_heap_allocations,
+                      dsn::metric_unit::kAllocations,
+                      "The number of message buffers allocated from the heap directly since they "
+                      "were too large for the slab allocator, or the slab allocator was disabled");
+
+DSN_DEFINE_bool(network,
+                enable_message_buffer_slab,
+                true,
+                "Whether to allocate the small message buffers from the per-thread free lists "
+                "of the slab allocator");
+DSN_TAG_VARIABLE(enable_message_buffer_slab, FT_MUTABLE);
+
+DSN_DEFINE_uint64(network,
+                  message_buffer_slab_cache_bytes_per_size_class,
+                  256 * 1024,
+                  "The maximum total bytes of the free blocks of each size class cached by each "
+                  "thread for the slab allocator of message buffers, the blocks released beyond "
+                  "it are freed to the heap");
+DSN_TAG_VARIABLE(message_buffer_slab_cache_bytes_per_size_class, FT_MUTABLE);
+
+namespace dsn {
+namespace utils {
+namespace {
+
+static_assert(kSlabMaxBlockSize == kSlabMinBlockSize << (kSlabSizeClassCount - 1),
+              "kSlabSizeClassCount does not match the range of the block sizes");
+
+class slab_allocator_metrics
+{
+public:
+    // The buffers may be allocated by the threads which are still running while the process
+    // is exiting, thus the metrics are never destructed.
+    static slab_allocator_metrics &instance()
+    {
+        static auto *metrics = new slab_allocator_metrics();
+        return *metrics;
+    }
+
+    void on_slab_hit() { METRIC_VAR_INCREMENT(message_buffer_slab_hits); }
+    void on_slab_miss() { METRIC_VAR_INCREMENT(message_buffer_slab_misses); }
+    void on_heap_allocation() { METRIC_VAR_INCREMENT(message_buffer_heap_allocations); }
+
+private:
+    slab_allocator_metrics()
+        : METRIC_VAR_INIT_server(message_buffer_slab_hits),
+          METRIC_VAR_INIT_server(message_buffer_slab_misses),
+          METRIC_VAR_INIT_server(message_buffer_heap_allocations)
+    {
+    }
+
+    METRIC_VAR_DECLARE_counter(message_buffer_slab_hits);
+    METRIC_VAR_DECLARE_counter(message_buffer_slab_misses);
+    METRIC_VAR_DECLARE_counter(message_buffer_heap_allocations);
+
+    DISALLOW_COPY_AND_ASSIGN(slab_allocator_metrics);
+};
+
+// The free blocks of each size class cached by a thread. All the blocks of a size class share the
+// same size, since they are always allocated for the same control block type, see
+// make_slab_block().
+class slab_thread_cache
+{
+public:
+    static void *allocate(size_t size_class, size_t block_bytes)
+    {
+        auto *cache = local();
+        if (dsn_likely(cache != nullptr)) {
+            auto &blocks = cache->_free_blocks[size_class];
+            if (!blocks.empty()) {
+                void *block = blocks.back();
+                blocks.pop_back();
+                cache->_cached_bytes[size_class] -= block_bytes;
+                slab_allocator_metrics::instance().on_slab_hit();
+                return block;
+            }
+        }
+
+        slab_allocator_metrics::instance().on_slab_miss();
+        return ::operator new(block_bytes);
+    }
+
+    static void deallocate(size_t size_class, void *block, size_t block_bytes)
+    {
+        // The block is cached by the releasing thread rather than the allocating thread, so that
+        // no synchronization is needed. Since the messages received by the network threads are
+        // released by the worker threads, the blocks are also reused by the worker threads to
+        // build the responses.
+        //
+        // Each size class is capped separately, otherwise the large blocks released by a thread,
+        // e.g. the bodies of the large requests, would use up the cache and leave no room for the
+        // small ones.
+        auto *cache = local();
+        if (cache == nullptr ||
+            cache->_cached_bytes[size_class] + block_bytes >
+                FLAGS_message_buffer_slab_cache_bytes_per_size_class) {
+            ::operator delete(block);
+            return;
+        }
+
+        cache->_free_blocks[size_class].push_back(block);
+        cache->_cached_bytes[size_class] += block_bytes;
+    }
+
+private:
+    // Returns nullptr once the cache of the calling thread has been destroyed during the exit of
+    // the thread, in which case the blocks are allocated from and freed to the heap directly.
+    static slab_thread_cache *local()
+    {
+        if (dsn_unlikely(tls_cache == nullptr)) {
+            if (tls_cache_destroyed) {
+                return nullptr;
+            }
+
+            // Touch the holder to register the destructor of the cache for the calling thread.
+            static thread_local cache_holder holder;
+            tls_cache = new slab_thread_cache();
+        }
+        return tls_cache;
+    }
+
+    slab_thread_cache() { _cached_bytes.fill(0); }
+
+    ~slab_thread_cache()
+    {
+        for (auto &blocks : _free_blocks) {
+            for (void *block : blocks) {
+                ::operator delete(block);
+            }
+        }
+    }
+
+    struct cache_holder
+    {
+        ~cache_holder()
+        {
+            delete tls_cache;
+            tls_cache = nullptr;
+            tls_cache_destroyed = true;
+        }
+    };
+
+    static thread_local slab_thread_cache *tls_cache;
+    static thread_local bool tls_cache_destroyed;
+
+    std::array<std::vector<void *>, kSlabSizeClassCount> _free_blocks;
+    std::array<size_t, kSlabSizeClassCount> _cached_bytes;
+
+    DISALLOW_COPY_AND_ASSIGN(slab_thread_cache);
+};
+
+thread_local slab_thread_cache *slab_thread_cache::tls_cache = nullptr;
+thread_local bool slab_thread_cache::tls_cache_destroyed = false;
+
+// The allocator passed to std::allocate_shared(), by which the control block of the shared
+// pointer and the buffer are allocated as a whole from the free list of the size class.
+template <typename T, size_t SizeClass>
+class slab_block_allocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = slab_block_allocator<U, SizeClass>;
+    };
+
+    slab_block_allocator() = default;
+
+    template <typename U>
+    slab_block_allocator(const slab_block_allocator<U, SizeClass> &)
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(slab_thread_cache::allocate(SizeClass, n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) { slab_thread_cache::deallocate(SizeClass, p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const slab_block_allocator<U, SizeClass> &) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const slab_block_allocator<U, SizeClass> &) const
+    {
+        return false;
+    }
+};
+
+// The buffer is aligned as malloc() does, since the objects such as message_header would be
+// constructed in it.
+template <size_t SizeClass>
+struct alignas(std::max_align_t) slab_block
+{
+    // The user-provided constructor prevents std::allocate_shared() from zeroing the buffer.
+    slab_block() {}
+
+    char data[kSlabMinBlockSize << SizeClass];
+};
+
+template <size_t SizeClass>
+std::shared_ptr<char> make_slab_block()
+{
+    auto block = std::allocate_shared<slab_block<SizeClass>>(
+        slab_block_allocator<slab_block<SizeClass>, SizeClass>());
+    // Share the ownership of the whole block while pointing to the buffer.
+    return std::shared_ptr<char>(block, block->data);
+}
+
+using slab_block_factory = std::shared_ptr<char> (*)();
+
+template <size_t... SizeClasses>
+constexpr std::array<slab_block_factory, sizeof...(SizeClasses)>
+make_slab_block_factories(std::index_sequence<SizeClasses...>)
+{
+    return {{&make_slab_block<SizeClasses>...}};
+}
+
+constexpr auto kSlabBlockFactories =
+    make_slab_block_factories(std::make_index_sequence<kSlabSizeClassCount>());
+
+} // anonymous namespace
+
+size_t slab_size_class(size_t size)
+{
+    size_t size_class = 0;
+    size_t capacity = kSlabMinBlockSize;
+    while (capacity < size && size_class < kSlabSizeClassCount) {
+        capacity <<= 1;
+        ++size_class;
+    }
+    return size_class;
+}
+
+std::shared_ptr<char> make_slab_buffer(size_t size)
+{
+    if (FLAGS_enable_message_buffer_slab) {
+        const size_t size_class = slab_size_class(size);
+        if (size_class < kSlabSizeClassCount) {
+            return kSlabBlockFactories[size_class]();
+        }
+    }
+
+    slab_allocator_metrics::instance().on_heap_allocation();
+    return make_shared_array<char>(size);
+}
+
+} // namespace utils
+} // namespace dsn
@@ -0,0 +1,53 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace dsn {
+namespace utils {
+
+// The size classes of the slab allocator are the powers of 2 in
+// [kSlabMinBlockSize, kSlabMaxBlockSize].
+constexpr size_t kSlabMinBlockSize = 64;
+constexpr size_t kSlabMaxBlockSize = 64 * 1024;
+constexpr size_t kSlabSizeClassCount = 11;
+
+// Returns the index of the smallest size class whose blocks could hold `size` bytes, or
+// kSlabSizeClassCount if `size` is larger than kSlabMaxBlockSize.
+size_t slab_size_class(size_t size);
+
+// Returns the capacity of the blocks in the size class `size_class`.
+inline size_t slab_size_class_capacity(size_t size_class)
+{
+    return kSlabMinBlockSize << size_class;
+}
+
+// Allocates an uninitialized buffer of at least `size` bytes, which is used for the headers and
+// bodies of the rpc messages.
+//
+// A buffer no larger than kSlabMaxBlockSize is carved from a block of its size class, which is
+// taken from the free list of the calling thread, and the control block of the returned pointer
+// lives in the same block. Once the last reference to the buffer is released, the whole block is
+// returned to the free list of the releasing thread, thus neither malloc nor free is involved
+// once the free lists are warmed up. Larger buffers are allocated from the heap directly.
+std::shared_ptr<char> make_slab_buffer(size_t size);
+
+} // namespace utils
+} // namespace dsn
@@ -417,6 +417,35 @@ std::string string_md5(const char *buffer, unsigned length)
     return result;
 }
 
+struct md5_calculator::context
+{
+    MD5_CTX c;
+};
+
+md5_calculator::md5_calculator() : _ctx(new context())
+{
+    CHECK_EQ(1, MD5_Init(&_ctx->c));
+}
+
+md5_calculator::~md5_calculator() = default;
+
+void md5_calculator::update(const char *buffer, size_t length)
+{
+    CHECK_EQ(1, MD5_Update(&_ctx->c, buffer, length));
+}
+
+std::string md5_calculator::finalize()
+{
+    unsigned char out[MD5_DIGEST_LENGTH];
+    CHECK_EQ(1, MD5_Final(out, &_ctx->c));
+
+    char str[MD5_DIGEST_LENGTH * 2 + 1];
+    str[MD5_DIGEST_LENGTH * 2] = 0;
+    for (int n = 0; n < MD5_DIGEST_LENGTH; n++)
+        sprintf(str + n + n, "%02x", out[n]);
+    return std::string(str);
+}
+
 std::string find_string_prefix(const std::string &input, char separator)
 {
     auto current = input.find(separator);
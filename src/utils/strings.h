@@ -30,6 +30,7 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -118,6 +119,24 @@ char *trim_string(char *s);
 // calculate the md5 checksum of buffer
 std::string string_md5(const char *buffer, unsigned int length);
 
+// calculate the md5 checksum of data which is fed piece by piece, the result is the same as
+// string_md5() of the whole data
+class md5_calculator
+{
+public:
+    md5_calculator();
+    ~md5_calculator();
+
+    void update(const char *buffer, size_t length);
+
+    // return the md5 checksum of all the data fed, no more data could be fed after it is called
+    std::string finalize();
+
+private:
+    struct context;
+    std::unique_ptr<context> _ctx;
+};
+
 // splits the "input" string by the only character "separator" to get the string prefix.
 // if there is no prefix or the first character is "separator", it will return "".
 std::string find_string_prefix(const std::string &input, char separator);
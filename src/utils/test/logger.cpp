@@ -30,19 +30,24 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "test_util/test_util.h"
 #include "utils/api_utilities.h"
 #include "utils/filesystem.h"
 #include "utils/flags.h"
 #include "utils/logging_provider.h"
 #include "utils/safe_strerror_posix.h"
 #include "utils/simple_logger.h"
+#include "utils/test_macros.h"
 
+DSN_DECLARE_uint32(buffer_size_per_thread_kb);
 DSN_DECLARE_uint64(max_number_of_log_files_on_disk);
 
 namespace dsn {
@@ -72,6 +77,25 @@ void get_log_file_index(std::vector<int> &log_index)
     }
 }
 
+// Count the lines containing `pattern` in all the log files.
+void count_log_lines(const std::string &pattern, uint64_t &count)
+{
+    std::vector<int> log_index;
+    NO_FATALS(get_log_file_index(log_index));
+
+    count = 0;
+    for (const auto index : log_index) {
+        std::ifstream file(fmt::format("log.{}.txt", index));
+        ASSERT_TRUE(file.is_open());
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.find(pattern) != std::string::npos) {
+                ++count;
+            }
+        }
+    }
+}
+
 // Don't name the dir with "./test", otherwise the whole utils test dir would be removed.
 const std::string kTestDir("./test_logger");
 
@@ -127,5 +151,79 @@ TEST(LoggerTest, SimpleLogger)
     remove_test_dir();
 }
 
+TEST(LoggerTest, AsyncLogger)
+{
+    // Deregister commands to avoid re-register error.
+    dsn::logging_provider::instance()->deregister_commands();
+
+    prepare_test_dir();
+
+    const int kThreadCount = 4;
+    const int kLinesPerThread = 1000;
+    {
+        auto logger = std::make_unique<async_logger>("./");
+        std::vector<std::thread> threads;
+        for (int i = 0; i < kThreadCount; ++i) {
+            threads.emplace_back([&logger]() {
+                for (int j = 0; j < kLinesPerThread; ++j) {
+                    LOG_PRINT(logger.get(), "{}", "async_test_print");
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        logger->flush();
+        ASSERT_EQ(0, logger->dropped_count());
+        logger->deregister_commands();
+    }
+
+    // All the logs of the exited threads should have been written.
+    uint64_t count = 0;
+    NO_FATALS(count_log_lines("async_test_print", count));
+    ASSERT_EQ(kThreadCount * kLinesPerThread, count);
+
+    remove_test_dir();
+}
+
+TEST(LoggerTest, AsyncLoggerDropLogs)
+{
+    // Deregister commands to avoid re-register error.
+    dsn::logging_provider::instance()->deregister_commands();
+
+    PRESERVE_FLAG(buffer_size_per_thread_kb);
+    FLAGS_buffer_size_per_thread_kb = 1;
+
+    prepare_test_dir();
+
+    const int kLineCount = 1000;
+    uint64_t dropped_count = 0;
+    {
+        auto logger = std::make_unique<async_logger>("./");
+        // The logs of the new thread are logged much faster than being flushed, thus some of
+        // them will be dropped by the tiny buffer.
+        std::thread t([&logger]() {
+            for (int i = 0; i < kLineCount; ++i) {
+                LOG_PRINT(logger.get(), "{}", "async_test_print");
+            }
+        });
+        t.join();
+        logger->flush();
+        dropped_count = logger->dropped_count();
+        logger->deregister_commands();
+    }
+    ASSERT_GT(dropped_count, 0);
+
+    uint64_t count = 0;
+    NO_FATALS(count_log_lines("async_test_print", count));
+    ASSERT_EQ(kLineCount - dropped_count, count);
+
+    // The dropped logs should be reported in the log file.
+    NO_FATALS(count_log_lines("logs have been dropped", count));
+    ASSERT_LE(1, count);
+
+    remove_test_dir();
+}
+
 } // namespace tools
 } // namespace dsn
@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <stdint.h>
+#include <string.h>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "test_util/test_util.h"
+#include "utils/flags.h"
+#include "utils/slab_allocator.h"
+
+DSN_DECLARE_bool(enable_message_buffer_slab);
+DSN_DECLARE_uint64(message_buffer_slab_cache_bytes_per_size_class);
+
+namespace dsn {
+namespace utils {
+
+TEST(slab_allocator_test, size_class)
+{
+    struct test_case
+    {
+        size_t size;
+        size_t expected_size_class;
+    } tests[] = {{0, 0},
+                 {1, 0},
+                 {64, 0},
+                 {65, 1},
+                 {128, 1},
+                 {1000, 4},
+                 {1024, 4},
+                 {64 * 1024 - 1, kSlabSizeClassCount - 1},
+                 {kSlabMaxBlockSize, kSlabSizeClassCount - 1},
+                 {kSlabMaxBlockSize + 1, kSlabSizeClassCount},
+                 {SIZE_MAX, kSlabSizeClassCount}};
+    for (const auto &test : tests) {
+        const auto size_class = slab_size_class(test.size);
+        ASSERT_EQ(test.expected_size_class, size_class) << test.size;
+        if (size_class < kSlabSizeClassCount) {
+            ASSERT_LE(test.size, slab_size_class_capacity(size_class));
+        }
+    }
+}
+
+TEST(slab_allocator_test, reuse_blocks)
+{
+    PRESERVE_FLAG(enable_message_buffer_slab);
+    FLAGS_enable_message_buffer_slab = true;
+
+    // The block released by a thread is reused by its next allocation of the same size class.
+    auto buffer = make_slab_buffer(100);
+    memset(buffer.get(), 'x', 100);
+    const char *data = buffer.get();
+    buffer.reset();
+    ASSERT_EQ(data, make_slab_buffer(128).get());
+
+    // The blocks of different size classes are not mixed.
+    buffer = make_slab_buffer(100);
+    data = buffer.get();
+    buffer.reset();
+    ASSERT_NE(data, make_slab_buffer(1000).get());
+
+    // The buffers are aligned for the objects constructed in them.
+    for (size_t size = 1; size <= kSlabMaxBlockSize * 2; size <<= 1) {
+        buffer = make_slab_buffer(size);
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(buffer.get()) % alignof(std::max_align_t));
+        memset(buffer.get(), 'x', size);
+    }
+}
+
+TEST(slab_allocator_test, cache_limit_per_size_class)
+{
+    PRESERVE_FLAG(enable_message_buffer_slab);
+    PRESERVE_FLAG(message_buffer_slab_cache_bytes_per_size_class);
+    FLAGS_enable_message_buffer_slab = true;
+    FLAGS_message_buffer_slab_cache_bytes_per_size_class = 4 * kSlabMaxBlockSize;
+
+    // A new thread starts with an empty cache.
+    std::thread releaser([]() {
+        // Release more large blocks than the cache could hold.
+        std::vector<std::shared_ptr<char>> buffers;
+        for (size_t i = 0; i < 16; ++i) {
+            buffers.push_back(make_slab_buffer(kSlabMaxBlockSize));
+        }
+        buffers.clear();
+
+        // The small blocks are still cached.
+        auto buffer = make_slab_buffer(100);
+        const char *data = buffer.get();
+        buffer.reset();
+        EXPECT_EQ(data, make_slab_buffer(100).get());
+    });
+    releaser.join();
+}
+
+TEST(slab_allocator_test, release_on_other_threads)
+{
+    PRESERVE_FLAG(enable_message_buffer_slab);
+    FLAGS_enable_message_buffer_slab = true;
+
+    std::vector<std::shared_ptr<char>> buffers;
+    for (size_t i = 0; i < 1000; ++i) {
+        buffers.push_back(make_slab_buffer(i * 100));
+        memset(buffers.back().get(), 'x', i * 100);
+    }
+
+    // The blocks are cached by the releasing thread, and freed once the thread exits.
+    std::thread releaser([&buffers]() {
+        buffers.clear();
+        for (size_t i = 0; i < 1000; ++i) {
+            auto buffer = make_slab_buffer(i * 100);
+            memset(buffer.get(), 'y', i * 100);
+        }
+    });
+    releaser.join();
+    ASSERT_TRUE(buffers.empty());
+}
+
+} // namespace utils
+} // namespace dsn
@@ -25,6 +25,7 @@
  */
 
 #include <stddef.h>
+#include <algorithm>
 #include <list>
 #include <map>
 #include <set>
@@ -71,6 +72,24 @@ TEST(core, crc)
     EXPECT_TRUE(c3 == c4);
 }
 
+TEST(core, md5_calculator)
+{
+    std::string data(10000, '\0');
+    for (auto &c : data) {
+        c = static_cast<char>(rand::next_u32(0, 255));
+    }
+
+    for (const size_t piece_size : {1, 7, 4096, 10000}) {
+        md5_calculator calculator;
+        for (size_t offset = 0; offset < data.size(); offset += piece_size) {
+            calculator.update(data.data() + offset, std::min(piece_size, data.size() - offset));
+        }
+        ASSERT_EQ(string_md5(data.data(), data.size()), calculator.finalize()) << piece_size;
+    }
+
+    ASSERT_EQ(string_md5("", 0), md5_calculator().finalize());
+}
+
 TEST(core, binary_io)
 {
     int value = 0xdeadbeef;